@@ -9,6 +9,10 @@
 #include "ui_history.h"
 #include "ui_sidebar.h"
 #include "ui_update.h"
+// Backend Headers
+#include "archive_scan.h"
+#include "signature_scan.h"
+#include "scan_core.h"
 
 // --- Global Variables ---
 gboolean auto_update_enabled = TRUE;
@@ -68,6 +72,34 @@ void load_settings(void) {
         } else if (strncmp(line, "last_update=", 12) == 0) {
             strncpy(last_update_time, line + 12, sizeof(last_update_time) - 1);
             last_update_time[strcspn(last_update_time, "\r\n")] = 0;
+        } else if (strncmp(line, "archive_depth=", 14) == 0) {
+            archive_limits.max_depth = atoi(line + 14);
+        } else if (strncmp(line, "archive_max_mb=", 15) == 0) {
+            archive_limits.max_total_bytes = strtoull(line + 15, NULL, 10) * 1024 * 1024;
+        } else if (strncmp(line, "archive_max_ratio=", 18) == 0) {
+            archive_limits.max_ratio = (guint32)strtoul(line + 18, NULL, 10);
+        } else if (strncmp(line, "retro_quarantine=", 17) == 0) {
+            retro_hunt_quarantine = atoi(line + 17);
+        } else if (strncmp(line, "incremental_scan=", 17) == 0) {
+            incremental_scan = atoi(line + 17);
+        } else if (strncmp(line, "heuristic_threshold=", 20) == 0) {
+            heuristic_threshold = atoi(line + 20);
+        } else if (strncmp(line, "fuzzy_threshold=", 16) == 0) {
+            fuzzy_threshold = atoi(line + 16);
+        } else if (strncmp(line, "golden_image=", 13) == 0) {
+            golden_image = atoi(line + 13);
+        } else if (strncmp(line, "scan_stats_json=", 16) == 0) {
+            scan_stats_json = atoi(line + 16);
+        } else if (strncmp(line, "scan_trace=", 11) == 0) {
+            scan_trace = atoi(line + 11);
+        } else if (strncmp(line, "scan_record=", 12) == 0) {
+            scan_record = atoi(line + 12);
+        } else if (strncmp(line, "memory_limit_mb=", 16) == 0) {
+            memory_limit_mb = atoi(line + 16);
+        } else if (strncmp(line, "one_filesystem=", 15) == 0) {
+            walk_limits.one_filesystem = atoi(line + 15) != 0;
+        } else if (strncmp(line, "read_timeout_s=", 15) == 0) {
+            walk_limits.read_timeout_ms = (guint)strtoul(line + 15, NULL, 10) * 1000;
         }
     }
     fclose(f);
@@ -78,6 +110,31 @@ void save_settings(void) {
     if (!f) return;
     fprintf(f, "auto_update=%d\n", auto_update_enabled ? 1 : 0);
     fprintf(f, "last_update=%s\n", last_update_time);
+    // Zip bomb budgets (archive_depth=0 turns archive scanning off)
+    fprintf(f, "archive_depth=%d\n", archive_limits.max_depth);
+    fprintf(f, "archive_max_mb=%llu\n", (unsigned long long)(archive_limits.max_total_bytes / (1024 * 1024)));
+    fprintf(f, "archive_max_ratio=%u\n", archive_limits.max_ratio);
+    // Quarantine files that a signature update newly flags (0 = report only)
+    fprintf(f, "retro_quarantine=%d\n", retro_hunt_quarantine ? 1 : 0);
+    // Full system scans only list directories that changed since the previous one
+    fprintf(f, "incremental_scan=%d\n", incremental_scan ? 1 : 0);
+    // Score at which unknown files are reported as suspicious (0 turns heuristics off)
+    fprintf(f, "heuristic_threshold=%d\n", heuristic_threshold);
+    // Largest similarity distance to a known sample that counts as a match (0 turns it off)
+    fprintf(f, "fuzzy_threshold=%d\n", fuzzy_threshold);
+    // This machine is the reference install: clean scans rewrite the allowlist baseline
+    fprintf(f, "golden_image=%d\n", golden_image ? 1 : 0);
+    // Also write each scan's stage latency histograms to scan_stats.json
+    fprintf(f, "scan_stats_json=%d\n", scan_stats_json ? 1 : 0);
+    // Record a per-thread timeline of each scan in scan_trace.json (open it in ui.perfetto.dev)
+    fprintf(f, "scan_trace=%d\n", scan_trace ? 1 : 0);
+    // Record every file a scan reads and its I/O times in scan_record.tsv (fos-bench replay)
+    fprintf(f, "scan_record=%d\n", scan_record ? 1 : 0);
+    // Memory ceiling for a scan in MB; near it the scan streams paths and spills to disk (0 = no limit)
+    fprintf(f, "memory_limit_mb=%d\n", memory_limit_mb);
+    // Walker limits (read_timeout_s=0 lets a single file take as long as it needs)
+    fprintf(f, "one_filesystem=%d\n", walk_limits.one_filesystem ? 1 : 0);
+    fprintf(f, "read_timeout_s=%u\n", walk_limits.read_timeout_ms / 1000);
     fclose(f);
 }
 
@@ -0,0 +1,253 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "allowlist.h"
+#include "sig_db.h"
+#include "scan_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define ALLOW_LINE_MAX  4096
+#define ALLOW_BATCH     (1024 * 1024)   // Text handed to the builder at a time
+#define ALLOW_CSV_COLS  16
+
+typedef struct {
+    FileStamp stamp;            // stamp.id is the hash key
+    guint64 size;
+    gint64 mtime;
+    guint32 file_type;
+    unsigned char sha256[32];
+} AllowFile;
+
+struct allowlist {
+    sig_db digests;             // Every trusted digest, one sorted index per algorithm
+    GHashTable *files;          // FileIdentity -> AllowFile, recorded with a trusted SHA-256
+};
+
+// --- NSRL Rows ---
+// Strongest first: one digest per row is enough, and SHA-256 is computed anyway
+static const HashAlgo csv_prefer[] = { HASH_SHA256, HASH_SHA1, HASH_MD5 };
+
+typedef struct {
+    int col[HASH_ALGO_COUNT];   // Column of each digest, -1 if the export lacks it
+} csv_layout;
+
+// Splits a quoted CSV row in place; returns the number of fields
+static int csv_split(char *line, char **fields, int max) {
+    int n = 0;
+    char *p = line;
+    while (n < max) {
+        if (*p == '"') {
+            char *start = ++p, *out = p;
+            while (*p && !(*p == '"' && p[1] != '"')) {
+                if (*p == '"') ++p;     // "" inside a quoted field
+                *out++ = *p++;
+            }
+            if (*p == '"') ++p;
+            *out = 0;
+            fields[n++] = start;
+            // Whatever sits between the closing quote and the comma is dropped
+            while (*p && *p != ',') ++p;
+        } else {
+            fields[n++] = p;
+            while (*p && *p != ',') ++p;
+        }
+        if (*p != ',') break;
+        *p++ = 0;
+    }
+    return n;
+}
+
+static gboolean is_hex(const char *s, size_t len) {
+    if (strlen(s) != len) return FALSE;
+    for (size_t i = 0; i < len; ++i)
+        if (g_ascii_xdigit_value(s[i]) < 0) return FALSE;
+    return TRUE;
+}
+
+// "SHA-256", "sha256", "SHA_1"... -> algorithm, -1 for other columns
+static int csv_column_algo(const char *name) {
+    char norm[16];
+    size_t n = 0;
+    for (; *name && n + 1 < sizeof(norm); ++name)
+        if (g_ascii_isalnum(*name)) norm[n++] = g_ascii_tolower(*name);
+    norm[n] = 0;
+    if (strcmp(norm, "sha256") == 0) return HASH_SHA256;
+    if (strcmp(norm, "sha1") == 0) return HASH_SHA1;
+    if (strcmp(norm, "md5") == 0) return HASH_MD5;
+    return -1;
+}
+
+// A header row names the digest columns; a data row adds "<hex> NSRL" to the batch.
+// FALSE if a data row carries no usable digest.
+static gboolean csv_row(char *line, csv_layout *layout, GString *batch) {
+    char *fields[ALLOW_CSV_COLS];
+    int n = csv_split(line, fields, ALLOW_CSV_COLS);
+    gboolean header = TRUE;
+    for (int i = 0; i < n && header; ++i)
+        if (is_hex(fields[i], strlen(fields[i])) && fields[i][0]) header = FALSE;
+    if (header) {
+        for (int a = 0; a < HASH_ALGO_COUNT; ++a) layout->col[a] = -1;
+        for (int i = 0; i < n; ++i) {
+            int a = csv_column_algo(fields[i]);
+            if (a >= 0 && layout->col[a] < 0) layout->col[a] = i;
+        }
+        return TRUE;
+    }
+    for (size_t k = 0; k < G_N_ELEMENTS(csv_prefer); ++k) {
+        int c = layout->col[csv_prefer[k]];
+        if (c < 0 || c >= n || !is_hex(fields[c], 2 * hash_digest_len(csv_prefer[k]))) continue;
+        g_string_append(batch, fields[c]);
+        g_string_append(batch, " " ALLOW_LABEL_NSRL "\n");
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// --- Loading ---
+// Feeds one list to the builder. Plain "<hex> [label]" lines go through as they are.
+static void feed_list(sig_builder *b, const char *path, size_t *malformed) {
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    // Rows of the legacy NSRLFile.txt have no header: SHA-1, then MD5
+    csv_layout layout;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) layout.col[a] = -1;
+    layout.col[HASH_SHA1] = 0;
+    layout.col[HASH_MD5] = 1;
+    GString *batch = g_string_sized_new(ALLOW_BATCH + ALLOW_LINE_MAX);
+    char *line = g_malloc(ALLOW_LINE_MAX);
+    while (fgets(line, ALLOW_LINE_MAX, f)) {
+        if (line[0] == '"') {
+            line[strcspn(line, "\r\n")] = 0;
+            if (!csv_row(line, &layout, batch)) (*malformed)++;
+        } else {
+            g_string_append(batch, line);
+            if (batch->len && batch->str[batch->len - 1] != '\n') g_string_append_c(batch, '\n');
+        }
+        if (batch->len >= ALLOW_BATCH) {
+            sigdb_builder_feed(b, batch->str, batch->len);
+            g_string_truncate(batch, 0);
+        }
+    }
+    if (batch->len) sigdb_builder_feed(b, batch->str, batch->len);
+    g_string_free(batch, TRUE);
+    g_free(line);
+    fclose(f);
+}
+
+// Recorded files whose SHA-256 is trusted; the stamp, size and mtime are checked at
+// lookup. Entries from before stamps were recorded are left to be hashed again.
+static void add_recorded(void *user, const unsigned char sha256[32], const char *path,
+                         gint64 mtime, guint64 size, guint32 file_type, const FileStamp *stamp) {
+    allowlist *al = (allowlist *)user;
+    if (!stamp || !sigdb_lookup(&al->digests, HASH_SHA256, sha256)) return;
+    AllowFile *af = g_new(AllowFile, 1);
+    af->stamp = *stamp;
+    af->size = size;
+    af->mtime = mtime;
+    af->file_type = file_type;
+    memcpy(af->sha256, sha256, sizeof(af->sha256));
+    g_hash_table_replace(al->files, &af->stamp.id, af);
+    (void)path;
+}
+
+allowlist *allowlist_load(const char *list_path, const char *baseline_path, seen_index *seen,
+                          allow_report *report) {
+    memset(report, 0, sizeof(*report));
+    sig_builder *b = sigdb_builder_new();
+    if (!b) return NULL;
+    feed_list(b, list_path, &report->malformed);
+    feed_list(b, baseline_path, &report->malformed);
+    allowlist *al = g_new0(allowlist, 1);
+    sig_load_report lr;
+    if (sigdb_builder_finish(b, &al->digests, &lr) != 0) {
+        g_free(al);
+        return NULL;
+    }
+    report->lines = lr.lines;
+    report->malformed += lr.malformed;
+    report->digests = sigdb_count(&al->digests);
+    if (report->digests == 0) {
+        sigdb_free(&al->digests);
+        g_free(al);
+        return NULL;
+    }
+    al->files = g_hash_table_new_full(file_identity_hash, file_identity_equal, NULL, g_free);
+    if (seen) seen_index_foreach(seen, add_recorded, al);
+    report->files = g_hash_table_size(al->files);
+    return al;
+}
+
+void allowlist_free(allowlist *al) {
+    if (!al) return;
+    sigdb_free(&al->digests);
+    g_hash_table_destroy(al->files);
+    g_free(al);
+}
+
+unsigned allowlist_algos(const allowlist *al) {
+    return al ? sigdb_algos(&al->digests) : 0;
+}
+
+// A GHashTable slot is a hash, a key and a value pointer
+size_t allowlist_bytes(const allowlist *al) {
+    if (!al) return 0;
+    return sizeof(*al) + sigdb_bytes(&al->digests) +
+           g_hash_table_size(al->files) * (sizeof(AllowFile) + sizeof(guint) + 2 * sizeof(gpointer));
+}
+
+// --- Lookup ---
+gboolean allowlist_match_digest(const allowlist *al, const MultiDigest *d) {
+    return al && sigdb_match(&al->digests, d, NULL) != NULL;
+}
+
+gboolean allowlist_match_file(const allowlist *al, const FileStamp *stamp, guint64 size, gint64 mtime,
+                              unsigned char sha256[32], guint32 *file_type) {
+    if (!al) return FALSE;
+    const AllowFile *af = g_hash_table_lookup(al->files, &stamp->id);
+    if (!af || af->stamp.change != stamp->change || af->size != size || af->mtime != mtime) return FALSE;
+    memcpy(sha256, af->sha256, sizeof(af->sha256));
+    *file_type = af->file_type;
+    return TRUE;
+}
+
+// --- Baseline ---
+typedef struct {
+    FILE *f;
+    int ok;
+    unsigned char last[32];     // Visits come in digest order; copies are written once
+    gboolean any;
+} baseline_writer;
+
+static void write_recorded(void *user, const unsigned char sha256[32], const char *path,
+                           gint64 mtime, guint64 size, guint32 file_type, const FileStamp *stamp) {
+    baseline_writer *w = (baseline_writer *)user;
+    if (w->any && memcmp(w->last, sha256, sizeof(w->last)) == 0) return;
+    memcpy(w->last, sha256, sizeof(w->last));
+    w->any = TRUE;
+    char hex[65];
+    for (int i = 0; i < 32; ++i) snprintf(hex + 2 * i, 3, "%02x", sha256[i]);
+    if (fprintf(w->f, "%s " ALLOW_LABEL_BASELINE "\n", hex) < 0) w->ok = 0;
+    (void)path;
+    (void)mtime;
+    (void)size;
+    (void)file_type;
+    (void)stamp;
+}
+
+int allowlist_write_baseline(seen_index *scan, const char *path) {
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    baseline_writer w = { fopen(tmp, "w"), 1, { 0 }, FALSE };
+    if (!w.f) return -1;
+    fprintf(w.f, "# Golden-image baseline: SHA-256 of every clean file of one scan\n");
+    seen_index_foreach(scan, write_recorded, &w);
+    if (fclose(w.f) != 0) w.ok = 0;
+    if (!w.ok) {
+        remove(tmp);
+        return -1;
+    }
+    return replace_file_atomic(tmp, path);
+}
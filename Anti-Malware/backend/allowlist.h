@@ -0,0 +1,47 @@
+#ifndef ALLOWLIST_H
+#define ALLOWLIST_H
+#include <glib.h>
+#include "multi_hash.h"
+#include "seen_index.h"
+#include "scan_core.h"
+/* Known-good files. Trusted digests come from two optional lists:
+ *   allowlist.db           - an NSRL export (RDS CSV rows, the strongest digest column
+ *                            is taken) or any "<hex> [label]" list, MD5/SHA-1/SHA-256
+ *   allowlist_baseline.db  - written on the golden image: every clean file of a scan
+ *
+ * A file whose digest is trusted skips every engine after hashing. A file the
+ * seen-file index recorded with a trusted SHA-256 is not read at all, its
+ * recorded digest standing in, while it is the same file (volume and file index)
+ * with the same change time, size and mtime. mtime alone could be set back after
+ * a rewrite; the change time (POSIX ctime, NTFS ChangeTime) cannot. */
+
+#define ALLOW_LABEL_NSRL     "NSRL"
+#define ALLOW_LABEL_BASELINE "Baseline"
+
+typedef struct allowlist allowlist;
+
+typedef struct {
+    size_t lines;               // Digest lines read from both lists
+    size_t malformed;           // Skipped
+    size_t digests;             // Distinct trusted digests
+    size_t files;               // Recorded files trusted by their stamp
+} allow_report;
+
+// Either list may be missing. NULL when neither holds a digest.
+allowlist *allowlist_load(const char *list_path, const char *baseline_path, seen_index *seen,
+                          allow_report *report);
+void allowlist_free(allowlist *al);
+// HASH_BIT mask of the algorithms the lists use (what has to be computed to match them)
+unsigned allowlist_algos(const allowlist *al);
+// Allocated for the trusted digests and the per-file table (an estimate, for the memory budget)
+size_t allowlist_bytes(const allowlist *al);
+gboolean allowlist_match_digest(const allowlist *al, const MultiDigest *d);
+// TRUE if the file behind `stamp` was recorded with a trusted SHA-256 at this change
+// time, size and mtime; the recorded digest and file type are copied out
+gboolean allowlist_match_file(const allowlist *al, const FileStamp *stamp, guint64 size, gint64 mtime,
+                              unsigned char sha256[32], guint32 *file_type);
+
+// Golden image: writes the SHA-256 of every file in `scan` as a baseline list
+int allowlist_write_baseline(seen_index *scan, const char *path);
+
+#endif
@@ -0,0 +1,390 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "archive_scan.h"
+#include "scan_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define ZIP_CHUNK (64 * 1024)
+#define ZIP_NAME_MAX 256
+#define ZIP_RATIO_FLOOR (1024 * 1024)   // Small members legitimately compress very well
+#define ZIP_SIG_LOCAL      0x04034b50
+#define ZIP_SIG_CENTRAL    0x02014b50
+#define ZIP_SIG_END        0x06054b50
+#define ZIP_SIG_DESCRIPTOR 0x08074b50
+#define ZIP_FLAG_ENCRYPTED  0x0001
+#define ZIP_FLAG_DESCRIPTOR 0x0008
+#define ZIP_METHOD_STORED   0
+#define ZIP_METHOD_DEFLATE  8
+#define ZIP_EXTRA_ZIP64     0x0001
+
+// Defaults; app.c overrides them from settings.conf
+ArchiveLimits archive_limits = { 3, 512ULL * 1024 * 1024, 200, 10000 };
+
+/* The archive is walked front to back through its local headers instead of
+ * seeking to the central directory. That way the exact same code parses the
+ * outer file and a ZIP that only exists as an inflate stream inside it. */
+
+// --- Byte Streams ---
+typedef struct ZipStream ZipStream;
+struct ZipStream {
+    long (*fill)(ZipStream *s, unsigned char *buf, size_t len);  // >0 bytes, 0 EOF, -1 error
+    unsigned char back[ZIP_CHUNK];  // Bytes handed back by a consumer that over-read; as large as ZipMember.in
+    size_t back_len;
+    size_t back_pos;
+};
+
+typedef struct {
+    const ArchiveLimits *limits;
+    ArchiveMemberFn on_member;
+    void *user;
+    unsigned algos;             // Digests computed for every member
+    ArchiveStats stats;
+    int members_seen;
+    gboolean limit_hit;
+    unsigned char scratch[ZIP_CHUNK];
+} ZipWalk;
+
+typedef struct {
+    ZipStream base;
+    ZipWalk *walk;
+    FILE *f;
+    ReadWatch *watch;           // The outer file is read under walk_limits.read_timeout_ms
+} ZipFileStream;
+
+// Expanded view of one member; everything it yields is also fed to its digests
+typedef struct {
+    ZipStream base;
+    ZipWalk *walk;
+    ZipStream *parent;
+    int method;
+    gboolean size_known;        // FALSE when sizes live in a trailing data descriptor
+    guint64 remaining_in;       // Compressed bytes still owned by this member
+    guint64 produced;
+    gboolean done;
+    gboolean failed;
+    gboolean z_ready;
+    z_stream z;
+    MultiHash hash;
+    unsigned char in[ZIP_CHUNK];
+} ZipMember;
+
+static long zs_read(ZipStream *s, unsigned char *buf, size_t len) {
+    if (s->back_pos < s->back_len) {
+        size_t n = MIN(len, s->back_len - s->back_pos);
+        memcpy(buf, s->back + s->back_pos, n);
+        s->back_pos += n;
+        return (long)n;
+    }
+    return s->fill(s, buf, len);
+}
+
+static int zs_read_full(ZipStream *s, unsigned char *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        long n = zs_read(s, buf + got, len - got);
+        if (n <= 0) return -1;
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+static int zs_skip(ZipStream *s, guint64 len) {
+    unsigned char tmp[4096];
+    while (len > 0) {
+        long n = zs_read(s, tmp, (size_t)MIN(len, (guint64)sizeof(tmp)));
+        if (n <= 0) return -1;
+        len -= (guint64)n;
+    }
+    return 0;
+}
+
+// Pushes bytes back in front of the stream. Callers return part of their last
+// read, which came from the back buffer or was at most ZIP_CHUNK, so it fits;
+// -1 if it ever does not, and the caller fails rather than lose the bytes.
+static int zs_unread(ZipStream *s, const unsigned char *data, size_t len) {
+    size_t pending = s->back_len - s->back_pos;
+    if (len == 0) return 0;
+    if (len + pending > sizeof(s->back)) return -1;
+    memmove(s->back + len, s->back + s->back_pos, pending);
+    memcpy(s->back, data, len);
+    s->back_pos = 0;
+    s->back_len = len + pending;
+    return 0;
+}
+
+static guint16 rd16(const unsigned char *p) {
+    return (guint16)(p[0] | (p[1] << 8));
+}
+static guint32 rd32(const unsigned char *p) {
+    return (guint32)p[0] | ((guint32)p[1] << 8) | ((guint32)p[2] << 16) | ((guint32)p[3] << 24);
+}
+static guint64 rd64(const unsigned char *p) {
+    return (guint64)rd32(p) | ((guint64)rd32(p + 4) << 32);
+}
+
+static long file_fill(ZipStream *s, unsigned char *buf, size_t len) {
+    ZipFileStream *fs = (ZipFileStream *)s;
+    if (read_watch_expired(fs->watch)) return -1;
+    size_t n = fread(buf, 1, len, fs->f);
+    if (n == 0 && ferror(fs->f)) return -1;
+    fs->walk->stats.bytes_in += n;
+    return (long)n;
+}
+
+// --- Member Expansion ---
+static gboolean member_over_budget(ZipMember *m) {
+    const ArchiveLimits *lim = m->walk->limits;
+    if (lim->max_total_bytes && m->walk->stats.bytes_out > lim->max_total_bytes) return TRUE;
+    if (lim->max_ratio && m->method == ZIP_METHOD_DEFLATE && m->produced > ZIP_RATIO_FLOOR &&
+        m->produced > (guint64)lim->max_ratio * MAX((guint64)m->z.total_in, 1))
+        return TRUE;
+    return FALSE;
+}
+
+static long member_fill(ZipStream *s, unsigned char *buf, size_t len) {
+    ZipMember *m = (ZipMember *)s;
+    if (m->failed) return -1;
+    if (m->done) return 0;
+
+    size_t produced;
+    if (m->method == ZIP_METHOD_STORED) {
+        size_t want = (size_t)MIN((guint64)len, m->remaining_in);
+        if (want == 0) {
+            m->done = TRUE;
+            return 0;
+        }
+        long n = zs_read(m->parent, buf, want);
+        if (n <= 0) { m->failed = TRUE; return -1; }
+        m->remaining_in -= (guint64)n;
+        produced = (size_t)n;
+    } else {
+        m->z.next_out = buf;
+        m->z.avail_out = (uInt)len;
+        while (m->z.avail_out == len && !m->done) {
+            if (m->z.avail_in == 0) {
+                size_t want = sizeof(m->in);
+                if (m->size_known) want = (size_t)MIN((guint64)want, m->remaining_in);
+                if (want == 0) { m->failed = TRUE; return -1; }   // Truncated deflate stream
+                long n = zs_read(m->parent, m->in, want);
+                if (n <= 0) { m->failed = TRUE; return -1; }
+                if (m->size_known) m->remaining_in -= (guint64)n;
+                m->z.next_in = m->in;
+                m->z.avail_in = (uInt)n;
+            }
+            int zr = inflate(&m->z, Z_NO_FLUSH);
+            if (zr == Z_STREAM_END) {
+                m->done = TRUE;
+                // Input read past the end of the deflate stream belongs to what follows
+                if (m->z.avail_in > 0) {
+                    if (zs_unread(m->parent, m->z.next_in, m->z.avail_in) != 0) {
+                        m->failed = TRUE;
+                        return -1;
+                    }
+                    if (m->size_known) m->remaining_in += m->z.avail_in;
+                    m->z.avail_in = 0;
+                }
+            } else if (zr != Z_OK && zr != Z_BUF_ERROR) {
+                m->failed = TRUE;
+                return -1;
+            }
+        }
+        produced = len - m->z.avail_out;
+    }
+
+    m->produced += produced;
+    m->walk->stats.bytes_out += produced;
+    if (member_over_budget(m)) {
+        m->walk->limit_hit = TRUE;
+        m->failed = TRUE;
+        return -1;
+    }
+    multi_hash_update(&m->hash, buf, produced);
+    return (long)produced;
+}
+
+static ZipMember *member_open(ZipWalk *w, ZipStream *parent, int method, gboolean size_known, guint64 csize) {
+    ZipMember *m = g_new0(ZipMember, 1);
+    m->base.fill = member_fill;
+    m->walk = w;
+    m->parent = parent;
+    m->method = method;
+    m->size_known = size_known;
+    m->remaining_in = size_known ? csize : 0;
+    multi_hash_init(&m->hash, w->algos, NULL);
+    if (method == ZIP_METHOD_DEFLATE) {
+        // Raw deflate: ZIP members carry no zlib header
+        if (inflateInit2(&m->z, -MAX_WBITS) == Z_OK) m->z_ready = TRUE;
+        else m->failed = TRUE;
+    }
+    return m;
+}
+
+static void member_close(ZipMember *m) {
+    if (m->z_ready) inflateEnd(&m->z);
+    g_free(m);
+}
+
+// --- Local Header Walk ---
+static int read_extra_fields(ZipStream *src, guint32 extra_len, guint64 *csize, guint64 *usize, gboolean *zip64) {
+    while (extra_len >= 4) {
+        unsigned char eh[4];
+        if (zs_read_full(src, eh, 4)) return -1;
+        extra_len -= 4;
+        guint32 id = rd16(eh);
+        guint32 sz = MIN((guint32)rd16(eh + 2), extra_len);
+        extra_len -= sz;
+
+        if (id != ZIP_EXTRA_ZIP64) {
+            if (zs_skip(src, sz)) return -1;
+            continue;
+        }
+        // ZIP64 sizes are present only for the fields saturated in the header
+        unsigned char z64[16];
+        guint32 keep = MIN(sz, (guint32)sizeof(z64));
+        if (zs_read_full(src, z64, keep) || zs_skip(src, sz - keep)) return -1;
+        guint32 off = 0;
+        if (*usize == 0xFFFFFFFFu && off + 8 <= keep) { *usize = rd64(z64 + off); off += 8; }
+        if (*csize == 0xFFFFFFFFu && off + 8 <= keep) { *csize = rd64(z64 + off); off += 8; }
+        *zip64 = TRUE;
+    }
+    return zs_skip(src, extra_len);
+}
+
+static int skip_data_descriptor(ZipStream *src, gboolean zip64) {
+    unsigned char d[4];
+    if (zs_read_full(src, d, 4)) return -1;
+    guint64 rest = zip64 ? 16 : 8;                  // Compressed + uncompressed size
+    if (rd32(d) == ZIP_SIG_DESCRIPTOR) rest += 4;   // Optional signature, CRC still follows
+    return zs_skip(src, rest);
+}
+
+static int zip_walk(ZipWalk *w, ZipStream *src, int depth, const char *prefix) {
+    const ArchiveLimits *lim = w->limits;
+    unsigned char sig[4];
+    unsigned char hdr[26];
+    char name[ZIP_NAME_MAX];
+
+    while (zs_read_full(src, sig, 4) == 0) {
+        guint32 s = rd32(sig);
+        if (s == ZIP_SIG_CENTRAL || s == ZIP_SIG_END) return ARCHIVE_OK;
+        if (s != ZIP_SIG_LOCAL) return ARCHIVE_CORRUPT;
+        if (zs_read_full(src, hdr, sizeof(hdr))) return ARCHIVE_CORRUPT;
+
+        guint16 flags = rd16(hdr + 2);
+        guint16 method = rd16(hdr + 4);
+        guint64 csize = rd32(hdr + 14);
+        guint64 usize = rd32(hdr + 18);
+        guint16 name_len = rd16(hdr + 22);
+        guint16 extra_len = rd16(hdr + 24);
+
+        size_t keep = MIN((size_t)name_len, sizeof(name) - 1);
+        if (zs_read_full(src, (unsigned char *)name, keep) || zs_skip(src, name_len - keep))
+            return ARCHIVE_CORRUPT;
+        name[keep] = '\0';
+
+        gboolean zip64 = FALSE;
+        if (read_extra_fields(src, extra_len, &csize, &usize, &zip64)) return ARCHIVE_CORRUPT;
+
+        if (lim->max_members && ++w->members_seen > lim->max_members) {
+            w->limit_hit = TRUE;
+            return ARCHIVE_LIMIT;
+        }
+
+        gboolean has_descriptor = (flags & ZIP_FLAG_DESCRIPTOR) != 0;
+        gboolean is_dir = keep > 0 && name[keep - 1] == '/';
+        gboolean expandable = !(flags & ZIP_FLAG_ENCRYPTED) && !is_dir &&
+                              (method == ZIP_METHOD_DEFLATE ||
+                               (method == ZIP_METHOD_STORED && !has_descriptor));
+        if (!expandable) {
+            // Without a known size there is no way to find the next header
+            if (has_descriptor) return ARCHIVE_OK;
+            if (zs_skip(src, csize)) return ARCHIVE_CORRUPT;
+            continue;
+        }
+
+        ZipMember *m = member_open(w, src, method, !has_descriptor, csize);
+        char *member_path = g_strdup_printf("%s::%s", prefix, name);
+        int rc = ARCHIVE_OK;
+
+        // Peek at the first bytes to spot a nested archive, then hand them back
+        unsigned char peek[4];
+        size_t got = 0;
+        long n;
+        while (got < sizeof(peek) && (n = zs_read(&m->base, peek + got, sizeof(peek) - got)) > 0)
+            got += (size_t)n;
+        if (zs_unread(&m->base, peek, got) != 0) m->failed = TRUE;
+
+        if (depth < lim->max_depth && archive_is_zip(peek, got)) {
+            rc = zip_walk(w, &m->base, depth + 1, member_path);
+            // Not really a ZIP after all: still hash it as a plain member
+            if (rc == ARCHIVE_CORRUPT && !m->failed) rc = ARCHIVE_OK;
+        }
+        // Hash whatever the nested walk did not consume (central directory, trailing data)
+        if (rc == ARCHIVE_OK) {
+            while (zs_read(&m->base, w->scratch, sizeof(w->scratch)) > 0)
+                ;
+            if (m->failed) rc = w->limit_hit ? ARCHIVE_LIMIT : ARCHIVE_CORRUPT;
+        }
+        if (rc == ARCHIVE_OK) {
+            MultiDigest digest;
+            multi_hash_final(&m->hash, &digest);
+            w->stats.members++;
+            if (w->on_member && w->on_member(w->user, member_path, &digest)) rc = ARCHIVE_STOPPED;
+        }
+        // Resynchronise the parent on the next local header
+        if (rc == ARCHIVE_OK) {
+            int skip_rc = has_descriptor ? skip_data_descriptor(src, zip64)
+                                         : zs_skip(src, m->remaining_in);
+            if (skip_rc != 0) rc = ARCHIVE_CORRUPT;
+        }
+
+        member_close(m);
+        g_free(member_path);
+        if (rc != ARCHIVE_OK) return rc;
+    }
+    // Ran out of data before the central directory: keep what was found
+    return ARCHIVE_OK;
+}
+
+// --- Public API ---
+gboolean archive_is_zip(const unsigned char *head, size_t len) {
+    return len >= 4 && rd32(head) == ZIP_SIG_LOCAL;
+}
+
+int archive_scan_zip(const char *path, const ArchiveLimits *limits, unsigned algos,
+                     ArchiveMemberFn on_member, void *user, ArchiveStats *stats) {
+    if (!limits) limits = &archive_limits;
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (limits->max_depth <= 0) return ARCHIVE_OK;
+
+    // Same budget as the hashing pass over this file: a stalled share fails the walk
+    ReadWatch watch;
+    read_watch_begin(&watch, walk_limits.read_timeout_ms);
+    FILE *f = fopen(path, "rb");
+    if (!f) return read_watch_end(&watch) ? ARCHIVE_TIMEOUT : ARCHIVE_IO_ERR;
+
+    ZipWalk *w = g_new0(ZipWalk, 1);
+    w->limits = limits;
+    w->on_member = on_member;
+    w->user = user;
+    w->algos = algos;
+
+    ZipFileStream *fs = g_new0(ZipFileStream, 1);
+    fs->base.fill = file_fill;
+    fs->walk = w;
+    fs->f = f;
+    fs->watch = &watch;
+
+    int rc = zip_walk(w, &fs->base, 1, path);
+    if (read_watch_end(&watch) && rc != ARCHIVE_STOPPED) rc = ARCHIVE_TIMEOUT;
+    if (rc == ARCHIVE_OK && w->limit_hit) rc = ARCHIVE_LIMIT;
+    if (rc == ARCHIVE_OK && ferror(f)) rc = ARCHIVE_IO_ERR;
+    if (stats) *stats = w->stats;
+
+    fclose(f);
+    g_free(fs);
+    g_free(w);
+    return rc;
+}
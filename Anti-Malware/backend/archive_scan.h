@@ -0,0 +1,40 @@
+#ifndef ARCHIVE_SCAN_H
+#define ARCHIVE_SCAN_H
+#include <glib.h>
+#include <stddef.h>
+#include "multi_hash.h"
+/* Return codes */
+#define ARCHIVE_OK          0
+#define ARCHIVE_STOPPED     1   // Callback asked to stop (e.g. a member matched)
+#define ARCHIVE_LIMIT       2   // A budget was exhausted; the rest of the archive was skipped
+#define ARCHIVE_IO_ERR     -1
+#define ARCHIVE_CORRUPT    -2
+#define ARCHIVE_TIMEOUT    -3  // Reading the file outlasted walk_limits.read_timeout_ms
+
+// Budgets that keep zip bombs from eating CPU, RAM or time
+typedef struct {
+    int max_depth;              // 1 = members of the outer ZIP only, 0 = archive scanning off
+    guint64 max_total_bytes;    // Expanded bytes across the whole outer archive
+    guint32 max_ratio;          // Expanded / compressed bytes per member
+    int max_members;            // Entries visited across all nesting levels
+} ArchiveLimits;
+
+typedef struct {
+    guint64 members;            // Members hashed
+    guint64 bytes_in;           // Compressed bytes consumed
+    guint64 bytes_out;          // Expanded bytes hashed
+} ArchiveStats;
+
+// Called for every member (nested containers included, after their own members).
+// member_path is "outer.zip::dir/inner.zip::file". Return non-zero to stop the walk.
+typedef int (*ArchiveMemberFn)(void *user, const char *member_path, const MultiDigest *digest);
+
+// Loaded from / saved to settings.conf by the app
+extern ArchiveLimits archive_limits;
+
+gboolean archive_is_zip(const unsigned char *head, size_t len);
+// Streams every member through inflate straight into the `algos` digests; nothing touches disk
+int archive_scan_zip(const char *path, const ArchiveLimits *limits, unsigned algos,
+                     ArchiveMemberFn on_member, void *user, ArchiveStats *stats);
+
+#endif
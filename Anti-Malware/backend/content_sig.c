@@ -0,0 +1,548 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "content_sig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define CS_LINEAR_EDGES 8   // Above this, edge lists are binary searched
+#define CS_DENSE_STATES 257  // Root + every depth-1 state get a full 256-entry row (~257 KB, L2 sized)
+#define CS_QUAD_BITS    20   // Hashed filter over the first 4 anchor bytes (128 KB)
+#define CS_SIMD_FIRST   16   // Up to this many first bytes are compared 16 input bytes at a time
+
+// --- Internal Structs ---
+typedef struct {
+    guint32 name;           // Offset into names
+    guint32 data;           // Offset into bytes / masks
+    guint16 len;
+    guint16 anchor_off;     // First byte of the literal run used as anchor
+    guint16 anchor_len;
+} cs_pattern;
+
+// Build-time trie node (children as a sibling list)
+typedef struct {
+    guint32 first_child;
+    guint32 next_sibling;
+    guint32 out;            // Head of output list (1-based), 0 = none
+    guint8 label;
+} cs_build_node;
+
+// Frozen automaton node, stored in BFS order so the hot shallow states share cache lines
+typedef struct {
+    guint32 fail;
+    guint32 dict;           // Nearest state on the fail chain that has outputs
+    guint32 out;            // Head of output list (1-based), 0 = none
+    guint32 edge_start;
+    guint32 edge_count;
+} ac_node;
+
+struct content_db {
+    GArray *patterns;       // cs_pattern
+    GArray *bytes;          // guint8
+    GArray *masks;          // guint8: 0xFF literal, 0x00 wildcard
+    GString *names;         // NUL separated
+    GArray *out_pattern;    // guint32, output list payload
+    GArray *out_next;       // guint32, output list links (1-based)
+    GArray *build;          // cs_build_node, dropped by content_db_compile
+    gboolean compiled;
+
+    ac_node *nodes;
+    guint32 n_nodes;
+    guint8 *edge_labels;    // Sorted per node
+    guint32 *edge_targets;
+    guint32 root_next[256]; // Dense root row; 0 = stay at root
+    guint32 *dense;         // Full transition rows for BFS states [0, n_dense)
+    guint32 n_dense;
+    guint32 n_shallow;      // States [1, n_shallow] are depth 1 (BFS order)
+    guint8 *emit;           // Per state: own or dictionary outputs to check
+    guint8 pair_map[8192];  // Bitmap of the first two bytes of every anchor
+    guint8 short_map[8192]; // Same, only anchors shorter than 4 bytes
+    guint8 *quad_map;       // Hashed bitmap of the first four bytes of longer anchors
+    guint8 first_map[256];  // Bytes that can start an anchor
+    guint8 first_bytes[256];
+    guint8 needles[CS_SIMD_FIRST][16];  // Each of the first n_first bytes, splatted
+    int n_first;
+};
+
+static int hexnibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return 10 + (c - 'a');
+    if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
+    return -1;
+}
+
+// --- Building ---
+content_db *content_db_new(void) {
+    content_db *db = g_new0(content_db, 1);
+    db->patterns = g_array_new(FALSE, FALSE, sizeof(cs_pattern));
+    db->bytes = g_array_new(FALSE, FALSE, sizeof(guint8));
+    db->masks = g_array_new(FALSE, FALSE, sizeof(guint8));
+    db->names = g_string_new(NULL);
+    db->out_pattern = g_array_new(FALSE, FALSE, sizeof(guint32));
+    db->out_next = g_array_new(FALSE, FALSE, sizeof(guint32));
+    db->build = g_array_new(FALSE, TRUE, sizeof(cs_build_node));
+    cs_build_node root;
+    memset(&root, 0, sizeof(root));
+    g_array_append_val(db->build, root);
+    return db;
+}
+
+static guint32 build_child(content_db *db, guint32 node, guint8 c) {
+    cs_build_node *n = &g_array_index(db->build, cs_build_node, node);
+    for (guint32 k = n->first_child; k; k = g_array_index(db->build, cs_build_node, k).next_sibling) {
+        if (g_array_index(db->build, cs_build_node, k).label == c) return k;
+    }
+    cs_build_node child;
+    memset(&child, 0, sizeof(child));
+    child.label = c;
+    child.next_sibling = n->first_child;
+    guint32 idx = db->build->len;
+    g_array_append_val(db->build, child);   // May move the array, re-fetch the parent
+    g_array_index(db->build, cs_build_node, node).first_child = idx;
+    return idx;
+}
+
+int content_db_add(content_db *db, const char *name, const char *hex) {
+    if (db->compiled) return -1;
+
+    guint8 bytes[CONTENT_MAX_PATTERN];
+    guint8 mask[CONTENT_MAX_PATTERN];
+    int n = 0;
+    for (const char *p = hex; *p; ) {
+        if (*p == ' ' || *p == '\t') { p++; continue; }
+        if (n >= CONTENT_MAX_PATTERN) return -1;
+        if (p[0] == '?' && p[1] == '?') {
+            bytes[n] = 0;
+            mask[n++] = 0x00;
+            p += 2;
+            continue;
+        }
+        int hi = hexnibble(p[0]);
+        int lo = hexnibble(p[1]);
+        if (hi < 0 || lo < 0) return -1;
+        bytes[n] = (guint8)((hi << 4) | lo);
+        mask[n++] = 0xFF;
+        p += 2;
+    }
+    // Anchor on the longest literal run: fewest false hits to verify
+    int best_off = 0, best_len = 0, run_off = 0, run = 0;
+    for (int k = 0; k < n; ++k) {
+        if (!mask[k]) { run = 0; continue; }
+        if (run == 0) run_off = k;
+        if (++run > best_len) { best_len = run; best_off = run_off; }
+    }
+    if (best_len < CONTENT_MIN_ANCHOR) return -1;
+
+    cs_pattern pat;
+    pat.name = (guint32)db->names->len;
+    pat.data = db->bytes->len;
+    pat.len = (guint16)n;
+    pat.anchor_off = (guint16)best_off;
+    pat.anchor_len = (guint16)best_len;
+    g_string_append_len(db->names, name, (long)strlen(name) + 1);
+    g_array_append_vals(db->bytes, bytes, (guint)n);
+    g_array_append_vals(db->masks, mask, (guint)n);
+    guint32 id = db->patterns->len;
+    g_array_append_val(db->patterns, pat);
+
+    guint32 node = 0;
+    for (int k = 0; k < best_len; ++k) node = build_child(db, node, bytes[best_off + k]);
+    cs_build_node *end = &g_array_index(db->build, cs_build_node, node);
+    guint32 next = end->out;
+    g_array_append_val(db->out_pattern, id);
+    g_array_append_val(db->out_next, next);
+    end->out = db->out_pattern->len;
+    return 0;
+}
+
+static int label_cmp(const void *a, const void *b) {
+    return (int)((const guint8 *)a)[0] - (int)((const guint8 *)b)[0];
+}
+
+static inline guint32 cs_quad_hash(const guint8 *p) {
+    guint32 v = (guint32)p[0] | ((guint32)p[1] << 8) | ((guint32)p[2] << 16) | ((guint32)p[3] << 24);
+    return (v * 2654435761u) >> (32 - CS_QUAD_BITS);
+}
+
+static guint32 ac_goto(const content_db *db, guint32 s, guint8 c) {
+    const ac_node *n = &db->nodes[s];
+    const guint8 *lab = db->edge_labels + n->edge_start;
+    if (n->edge_count <= CS_LINEAR_EDGES) {
+        for (guint32 k = 0; k < n->edge_count; ++k)
+            if (lab[k] == c) return db->edge_targets[n->edge_start + k];
+        return 0;
+    }
+    guint32 lo = 0, hi = n->edge_count;
+    while (lo < hi) {
+        guint32 mid = (lo + hi) / 2;
+        if (lab[mid] == c) return db->edge_targets[n->edge_start + mid];
+        if (lab[mid] < c) lo = mid + 1;
+        else hi = mid;
+    }
+    return 0;
+}
+
+void content_db_compile(content_db *db) {
+    if (db->compiled) return;
+    guint32 n = db->build->len;
+    cs_build_node *b = (cs_build_node *)(void *)db->build->data;
+
+    // 1. BFS renumbering: order[] holds old ids, new_id[] maps old -> new
+    guint32 *order = g_new(guint32, n);
+    guint32 *new_id = g_new(guint32, n);
+    guint32 head = 0, tail = 0;
+    order[tail++] = 0;
+    new_id[0] = 0;
+    while (head < tail) {
+        guint32 u = order[head++];
+        for (guint32 k = b[u].first_child; k; k = b[k].next_sibling) {
+            new_id[k] = tail;
+            order[tail++] = k;
+        }
+    }
+
+    // 2. Flat nodes and sorted edge lists
+    db->n_nodes = n;
+    db->nodes = g_new0(ac_node, n);
+    db->edge_labels = g_new(guint8, MAX(n, 1));
+    db->edge_targets = g_new(guint32, MAX(n, 1));
+    guint32 n_edges = 0;
+    struct { guint8 label; guint32 target; } kids[256];
+    for (guint32 i = 0; i < n; ++i) {
+        guint32 u = order[i];
+        int nk = 0;
+        for (guint32 k = b[u].first_child; k; k = b[k].next_sibling) {
+            kids[nk].label = b[k].label;
+            kids[nk].target = new_id[k];
+            nk++;
+        }
+        qsort(kids, (size_t)nk, sizeof(kids[0]), label_cmp);
+        db->nodes[i].out = b[u].out;
+        db->nodes[i].edge_start = n_edges;
+        db->nodes[i].edge_count = (guint32)nk;
+        for (int k = 0; k < nk; ++k) {
+            db->edge_labels[n_edges] = kids[k].label;
+            db->edge_targets[n_edges] = kids[k].target;
+            n_edges++;
+            if (i == 0) db->root_next[kids[k].label] = kids[k].target;
+        }
+    }
+
+    // 3. Failure and dictionary links, parents before children thanks to BFS order
+    for (guint32 u = 0; u < n; ++u) {
+        const ac_node *un = &db->nodes[u];
+        for (guint32 k = 0; k < un->edge_count; ++k) {
+            guint8 c = db->edge_labels[un->edge_start + k];
+            guint32 v = db->edge_targets[un->edge_start + k];
+            guint32 f = 0;
+            if (u != 0) {
+                f = un->fail;
+                while (f != 0 && ac_goto(db, f, c) == 0) f = db->nodes[f].fail;
+                f = (f == 0) ? db->root_next[c] : ac_goto(db, f, c);
+            }
+            db->nodes[v].fail = f;
+            db->nodes[v].dict = db->nodes[f].out ? f : db->nodes[f].dict;
+        }
+    }
+
+    // 4. Full DFA rows for the hot shallow states; every failure chain ends in here.
+    //    fail[s] < s in BFS order, so its row is always ready when s is filled.
+    db->n_dense = MIN(n, (guint32)CS_DENSE_STATES);
+    db->dense = g_new(guint32, (gsize)db->n_dense * 256);
+    for (guint32 st = 0; st < db->n_dense; ++st) {
+        guint32 *row = db->dense + (gsize)st * 256;
+        for (int c = 0; c < 256; ++c) {
+            guint32 t = ac_goto(db, st, (guint8)c);
+            if (!t && st != 0) t = db->dense[(gsize)db->nodes[st].fail * 256 + c];
+            row[c] = t;
+        }
+    }
+
+    // 5. Prefilters: which bytes, and which byte pairs, can start an anchor at all.
+    //    Anchors are at least CONTENT_MIN_ANCHOR (2) bytes, so every depth-2 state is a pair.
+    db->n_shallow = db->nodes[0].edge_count;
+    for (int c = 0; c < 256; ++c) {
+        guint32 d1 = db->root_next[c];
+        if (!d1) continue;
+        db->first_map[c] = 1;
+        db->first_bytes[db->n_first++] = (guint8)c;
+        const ac_node *dn = &db->nodes[d1];
+        for (guint32 k = 0; k < dn->edge_count; ++k) {
+            guint32 bit = ((guint32)c << 8) | db->edge_labels[dn->edge_start + k];
+            db->pair_map[bit >> 3] |= (guint8)(1u << (bit & 7));
+        }
+    }
+    for (int k = 0; k < MIN(db->n_first, CS_SIMD_FIRST); ++k) memset(db->needles[k], db->first_bytes[k], 16);
+    db->quad_map = g_new0(guint8, (1u << CS_QUAD_BITS) / 8);
+    for (guint i = 0; i < db->patterns->len; ++i) {
+        const cs_pattern *pat = &g_array_index(db->patterns, cs_pattern, i);
+        const guint8 *a = &g_array_index(db->bytes, guint8, pat->data + pat->anchor_off);
+        if (pat->anchor_len < 4) {
+            guint32 bit = ((guint32)a[0] << 8) | a[1];
+            db->short_map[bit >> 3] |= (guint8)(1u << (bit & 7));
+        } else {
+            guint32 bit = cs_quad_hash(a);
+            db->quad_map[bit >> 3] |= (guint8)(1u << (bit & 7));
+        }
+    }
+    db->emit = g_new0(guint8, MAX(n, 1));
+    for (guint32 st = 0; st < n; ++st)
+        db->emit[st] = (db->nodes[st].out || db->nodes[st].dict) ? 1 : 0;
+
+    g_free(order);
+    g_free(new_id);
+    g_array_free(db->build, TRUE);
+    db->build = NULL;
+    db->compiled = TRUE;
+}
+
+content_db *content_db_load(const char *path, int *bad_lines) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    content_db *db = content_db_new();
+    int bad = 0;
+    char line[2048];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == 0 || line[0] == '#') continue;
+        char *sep = strchr(line, ':');
+        if (!sep) { bad++; continue; }
+        *sep = 0;
+        if (content_db_add(db, line, sep + 1) != 0) bad++;
+    }
+    fclose(f);
+    content_db_compile(db);
+    if (bad_lines) *bad_lines = bad;
+    return db;
+}
+
+void content_db_free(content_db *db) {
+    if (!db) return;
+    g_array_free(db->patterns, TRUE);
+    g_array_free(db->bytes, TRUE);
+    g_array_free(db->masks, TRUE);
+    g_string_free(db->names, TRUE);
+    g_array_free(db->out_pattern, TRUE);
+    g_array_free(db->out_next, TRUE);
+    if (db->build) g_array_free(db->build, TRUE);
+    g_free(db->nodes);
+    g_free(db->edge_labels);
+    g_free(db->edge_targets);
+    g_free(db->dense);
+    g_free(db->emit);
+    g_free(db->quad_map);
+    g_free(db);
+}
+
+size_t content_db_count(const content_db *db) {
+    return db ? db->patterns->len : 0;
+}
+
+size_t content_db_bytes(const content_db *db) {
+    if (!db) return 0;
+    size_t n = sizeof(*db) + db->patterns->len * sizeof(cs_pattern) + db->bytes->len + db->masks->len +
+               db->names->allocated_len + (db->out_pattern->len + db->out_next->len) * sizeof(guint32);
+    if (db->build) n += db->build->len * sizeof(cs_build_node);
+    n += (size_t)db->n_nodes * (sizeof(ac_node) + sizeof(guint8) + sizeof(guint32) + sizeof(guint8));
+    n += (size_t)db->n_dense * 256 * sizeof(guint32);
+    if (db->quad_map) n += (1u << CS_QUAD_BITS) / 8;
+    return n;
+}
+
+// --- Matching ---
+static guint32 ac_step(const content_db *db, guint32 s, guint8 c) {
+    while (s >= db->n_dense) {
+        guint32 t = ac_goto(db, s, c);
+        if (t) return t;
+        s = db->nodes[s].fail;
+    }
+    return db->dense[(gsize)s * 256 + c];
+}
+
+static inline int cs_bit(const guint8 *map, guint32 bit) {
+    return (map[bit >> 3] >> (bit & 7)) & 1;
+}
+
+// Can an anchor start at buf[p]? Only says no when the bytes in this chunk prove it.
+static inline int cs_can_start(const content_db *db, const unsigned char *buf, size_t p, size_t len) {
+    if (p + 1 >= len) return 1;
+    guint32 pair = ((guint32)buf[p] << 8) | buf[p + 1];
+    if (!cs_bit(db->pair_map, pair)) return 0;
+    if (cs_bit(db->short_map, pair) || p + 4 > len) return 1;
+    return cs_bit(db->quad_map, cs_quad_hash(buf + p));
+}
+
+// Index of the next byte that can leave the root state. Bytes near the end of
+// the chunk cannot be looked ahead of, so they are handed to the automaton as is.
+static size_t cs_skip(const content_db *db, const unsigned char *buf, size_t i, size_t len) {
+#if defined(__SSE2__)
+    if (db->n_first > 0 && db->n_first <= CS_SIMD_FIRST) {
+        // A multi-needle memchr: one compare per candidate byte, 16 bytes at a time.
+        // Past CS_SIMD_FIRST the compares cost more than the pair lookups below.
+        __m128i n[CS_SIMD_FIRST];
+        int nn = db->n_first;
+        for (int k = 0; k < nn; ++k) n[k] = _mm_loadu_si128((const __m128i *)db->needles[k]);
+        while (i + 16 <= len) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+            __m128i hit = _mm_cmpeq_epi8(v, n[0]);
+            for (int k = 1; k < nn; ++k) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, n[k]));
+            unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+            while (mask) {
+                size_t p = i + (size_t)__builtin_ctz(mask);
+                if (cs_can_start(db, buf, p, len)) return p;
+                mask &= mask - 1;
+            }
+            i += 16;
+        }
+    }
+#endif
+    // The pair bitmap already implies a valid first byte
+    for (; i + 1 < len; ++i) {
+        guint32 pair = ((guint32)buf[i] << 8) | buf[i + 1];
+        if (cs_bit(db->pair_map, pair) && cs_can_start(db, buf, i, len)) return i;
+    }
+    while (i < len && !db->first_map[buf[i]]) i++;
+    return i;
+}
+
+// 1 = match, 0 = mismatch, 2 = pattern runs past the bytes seen so far
+static int cs_verify(const content_scan *s, const cs_pattern *pat, guint64 start,
+                     const unsigned char *buf, guint64 base, size_t len) {
+    if (start + pat->len > base + len) return 2;
+    const guint8 *pb = &g_array_index(s->db->bytes, guint8, pat->data);
+    const guint8 *pm = &g_array_index(s->db->masks, guint8, pat->data);
+    for (guint32 k = 0; k < pat->len; ++k) {
+        if (!pm[k]) continue;
+        guint64 abs = start + k;
+        unsigned char c = (abs >= base) ? buf[abs - base] : s->history[abs % CONTENT_MAX_PATTERN];
+        if (c != pb[k]) return 0;
+    }
+    return 1;
+}
+
+// Many patterns on one anchor near the end of a chunk all wait; they spill to the heap
+static void cs_pend(content_scan *s, guint32 id, guint64 start) {
+    if (s->n_pending == s->cap_pending) {
+        if (s->cap_pending >= CONTENT_PENDING_LIMIT) {
+            s->incomplete = TRUE;
+            return;
+        }
+        int cap = s->cap_pending * 2;
+        if (s->pending == s->inline_pending) {
+            s->pending = g_new(content_pending, cap);
+            memcpy(s->pending, s->inline_pending, sizeof(s->inline_pending));
+        } else {
+            s->pending = g_renew(content_pending, s->pending, cap);
+        }
+        s->cap_pending = cap;
+    }
+    s->pending[s->n_pending].pattern = id;
+    s->pending[s->n_pending].start = start;
+    s->n_pending++;
+}
+
+static void cs_emit(content_scan *s, guint32 state, guint64 anchor_end,
+                    const unsigned char *buf, guint64 base, size_t len) {
+    const content_db *db = s->db;
+    for (guint32 t = state; t && s->match < 0; t = db->nodes[t].dict) {
+        for (guint32 o = db->nodes[t].out; o; o = g_array_index(db->out_next, guint32, o - 1)) {
+            guint32 id = g_array_index(db->out_pattern, guint32, o - 1);
+            const cs_pattern *pat = &g_array_index(db->patterns, cs_pattern, id);
+            guint64 lead = (guint64)pat->anchor_off + pat->anchor_len;
+            if (anchor_end + 1 < lead) continue;
+            guint64 start = anchor_end + 1 - lead;
+
+            int r = cs_verify(s, pat, start, buf, base, len);
+            if (r == 1) {
+                s->match = (int)id;
+                return;
+            }
+            if (r == 2) cs_pend(s, id, start);
+        }
+    }
+}
+
+static void cs_resolve_pending(content_scan *s, const unsigned char *buf, guint64 base, size_t len) {
+    int kept = 0;
+    for (int i = 0; i < s->n_pending && s->match < 0; ++i) {
+        const cs_pattern *pat = &g_array_index(s->db->patterns, cs_pattern, s->pending[i].pattern);
+        int r = cs_verify(s, pat, s->pending[i].start, buf, base, len);
+        if (r == 1) s->match = (int)s->pending[i].pattern;
+        else if (r == 2) s->pending[kept++] = s->pending[i];
+    }
+    s->n_pending = kept;
+}
+
+static void cs_history_push(content_scan *s, const unsigned char *buf, guint64 base, size_t len) {
+    size_t keep = MIN(len, (size_t)CONTENT_MAX_PATTERN);
+    for (size_t k = len - keep; k < len; ++k)
+        s->history[(base + k) % CONTENT_MAX_PATTERN] = buf[k];
+}
+
+void content_scan_init(content_scan *s, const content_db *db) {
+    s->db = db;
+    s->state = 0;
+    s->offset = 0;
+    s->match = -1;
+    s->n_pending = 0;
+    s->cap_pending = CONTENT_MAX_PENDING;
+    s->pending = s->inline_pending;
+    s->incomplete = FALSE;
+}
+
+void content_scan_free(content_scan *s) {
+    if (s->pending != s->inline_pending) g_free(s->pending);
+    s->pending = s->inline_pending;
+    s->cap_pending = CONTENT_MAX_PENDING;
+    s->n_pending = 0;
+}
+
+void content_scan_feed(content_scan *s, const unsigned char *buf, size_t len) {
+    const content_db *db = s->db;
+    guint64 base = s->offset;
+    s->offset += len;
+    if (!db || !db->compiled || s->match >= 0 || len == 0) return;
+
+    // 1. Hits from the previous chunk that were waiting for these bytes
+    if (s->n_pending) cs_resolve_pending(s, buf, base, len);
+
+    // 2. Automaton pass. With at most one byte in flight (root or depth 1) the
+    //    automaton falls back to the root unless that byte can start an anchor,
+    //    then jumps straight to the next possible anchor start.
+    guint32 st = s->state;
+    size_t i = 0;
+    while (i < len && s->match < 0) {
+        if (st <= db->n_shallow) {
+            if (st != 0 && i > 0 && !cs_can_start(db, buf, i - 1, len)) st = 0;
+            if (st == 0) {
+                i = cs_skip(db, buf, i, len);
+                if (i >= len) break;
+            }
+        }
+        st = ac_step(db, st, buf[i]);
+        if (db->emit[st]) cs_emit(s, st, base + i, buf, base, len);
+        i++;
+    }
+    s->state = st;
+
+    // 3. Keep the tail so hits straddling the chunk boundary can be verified
+    cs_history_push(s, buf, base, len);
+}
+
+int content_scan_chunk(void *user, guint64 offset, const unsigned char *buf, size_t len) {
+    (void)offset;   // Chunks arrive in order; the matcher tracks its own offset
+    content_scan_feed((content_scan *)user, buf, len);
+    return 0;
+}
+
+const char *content_scan_result(const content_scan *s) {
+    if (!s->db || s->match < 0) return NULL;
+    const cs_pattern *pat = &g_array_index(s->db->patterns, cs_pattern, (guint)s->match);
+    return s->db->names->str + pat->name;
+}
+
+gboolean content_scan_complete(const content_scan *s) {
+    return !s->incomplete;
+}
@@ -0,0 +1,62 @@
+#ifndef CONTENT_SIG_H
+#define CONTENT_SIG_H
+#include <glib.h>
+#include <stddef.h>
+/* Byte-pattern ("content") signatures matched with an Aho-Corasick automaton.
+ * Signature file, one per line ('#' comments):
+ *     Family.Name:4d5a??00ff??e8
+ * Hex bytes, "??" matches any byte. The longest literal run of each pattern
+ * goes into the automaton; the full pattern is verified around every hit. */
+
+#define CONTENT_MAX_PATTERN 256     // Bytes, wildcards included (also the history window)
+#define CONTENT_MIN_ANCHOR  2       // Shortest literal run accepted as an anchor
+#define CONTENT_MAX_PENDING 32      // Hits waiting for bytes from the next chunk, held inline
+#define CONTENT_PENDING_LIMIT 65536 // On the heap beyond the inline ones; past this the file is incomplete
+
+typedef struct content_db content_db;
+
+typedef struct {
+    guint32 pattern;
+    guint64 start;                  // Absolute offset of the pattern's first byte
+} content_pending;
+
+// Per-file matcher state; lives on the worker's stack and must not be copied
+typedef struct {
+    const content_db *db;
+    guint32 state;
+    guint64 offset;                 // Bytes consumed so far
+    int match;                      // Pattern index, -1 while nothing matched
+    int n_pending;
+    int cap_pending;
+    content_pending *pending;       // `inline_pending` until more hits wait at once
+    gboolean incomplete;            // Hits were dropped at CONTENT_PENDING_LIMIT
+    content_pending inline_pending[CONTENT_MAX_PENDING];
+    unsigned char history[CONTENT_MAX_PATTERN];   // Ring indexed by offset % size
+} content_scan;
+
+// --- Building ---
+content_db *content_db_new(void);
+// Returns -1 for malformed hex, oversized patterns or patterns without a usable anchor
+int content_db_add(content_db *db, const char *name, const char *hex);
+// Freezes the automaton; no more content_db_add afterwards
+void content_db_compile(content_db *db);
+// Reads and compiles a signature file. NULL if it cannot be opened.
+content_db *content_db_load(const char *path, int *bad_lines);
+void content_db_free(content_db *db);
+size_t content_db_count(const content_db *db);
+// Allocated for patterns and the automaton (an estimate, for the memory budget)
+size_t content_db_bytes(const content_db *db);
+
+// --- Matching ---
+void content_scan_init(content_scan *s, const content_db *db);
+void content_scan_feed(content_scan *s, const unsigned char *buf, size_t len);
+// ScanChunkFn adapter (user = content_scan*) so matching rides compute_file_sha256_ex
+int content_scan_chunk(void *user, guint64 offset, const unsigned char *buf, size_t len);
+// Name of the first matching pattern, NULL if none
+const char *content_scan_result(const content_scan *s);
+// FALSE when hits had to be dropped, so a NULL result does not clear the file
+gboolean content_scan_complete(const content_scan *s);
+// Frees pending hits that outgrew the inline array
+void content_scan_free(content_scan *s);
+
+#endif
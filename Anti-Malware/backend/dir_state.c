@@ -0,0 +1,400 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "dir_state.h"
+#include "scan_bridge.h"
+#include "scan_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#define DIR_SEP '\\'
+#else
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#define DIR_SEP '/'
+#endif
+
+#define DIRSTATE_MAGIC "FOSDIRS2"
+#define TICKS_PER_SEC 10000000LL        // Markers are 100 ns ticks since the Unix epoch
+#define RACY_TICKS (2 * TICKS_PER_SEC)  // Changed this close to a scan: timestamp cannot be trusted
+#define SKEW_TICKS (5 * 60 * TICKS_PER_SEC)
+#define STATE_LINE 8192
+
+// --- Internal Structs ---
+typedef struct {
+    gint64 mtime;               // Entry added, removed or renamed
+    gint64 ctime;               // POSIX inode change (utimes() cannot forge it); Windows creation
+} DirMarker;
+
+typedef struct {
+    DirMarker marker;
+    guint32 entries;            // Files + subdirectories when last listed
+    GPtrArray *subdirs;         // Paths, borrowed from the keys of dir_state.dirs
+} DirRecord;
+
+struct dir_state {
+    char file[64];
+    gint64 scan_time;           // When the walk that produced these markers started
+    gint64 full_time;           // Last walk that trusted no marker
+    guint32 seq;
+    guint64 rules;              // scan_rules_fingerprint the markers were taken under
+    GHashTable *dirs;           // Path -> DirRecord
+    GMutex lock;
+};
+
+typedef struct {
+    dir_state *old;
+    dir_state *st;
+    FilePathList *list;
+    IncrementalStats *stats;
+    WalkGuard *guard;           // Cycles, pseudo filesystems, one_filesystem
+    gboolean full;
+    const char *suspect;        // Set when the walk has to start over as a full one
+} DirWalk;
+
+static void record_free(gpointer data) {
+    DirRecord *rec = (DirRecord *)data;
+    g_ptr_array_free(rec->subdirs, TRUE);
+    g_free(rec);
+}
+
+static DirRecord *record_new(const DirMarker *m, guint32 entries) {
+    DirRecord *rec = g_new0(DirRecord, 1);
+    rec->marker = *m;
+    rec->entries = entries;
+    rec->subdirs = g_ptr_array_new();
+    return rec;
+}
+
+static gint64 ticks_now(void) {
+    return (gint64)time(NULL) * TICKS_PER_SEC;
+}
+
+static dir_state *dir_state_new(const char *root) {
+    dir_state *st = g_new0(dir_state, 1);
+    // One state file per scan root
+    guint64 h = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)root; *p; ++p) h = (h ^ *p) * 1099511628211ULL;
+    snprintf(st->file, sizeof(st->file), "dirs_%016llx.db", (unsigned long long)h);
+    st->dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, record_free);
+    g_mutex_init(&st->lock);
+    return st;
+}
+
+void dir_state_free(dir_state *st) {
+    if (!st) return;
+    g_hash_table_destroy(st->dirs);
+    g_mutex_clear(&st->lock);
+    g_free(st);
+}
+
+// --- Persistence ---
+// Unknown or damaged files give an empty state: the next walk is a full one
+static dir_state *dir_state_load(const char *root) {
+    dir_state *st = dir_state_new(root);
+    FILE *f = fopen(st->file, "r");
+    if (!f) return st;
+    char *line = g_malloc(STATE_LINE);
+    long long scan_time, full_time;
+    unsigned seq;
+    unsigned long long rules;
+    if (!fgets(line, STATE_LINE, f) ||
+        sscanf(line, DIRSTATE_MAGIC " %lld %lld %u %llx", &scan_time, &full_time, &seq, &rules) != 4) {
+        g_free(line);
+        fclose(f);
+        return st;
+    }
+    st->scan_time = scan_time;
+    st->full_time = full_time;
+    st->seq = seq;
+    st->rules = rules;
+    while (fgets(line, STATE_LINE, f)) {
+        long long mtime, ctime;
+        unsigned entries;
+        int path_at = 0;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (sscanf(line, "D %lld %lld %u %n", &mtime, &ctime, &entries, &path_at) != 3 || !line[path_at]) continue;
+        DirMarker m = { mtime, ctime };
+        g_hash_table_replace(st->dirs, g_strdup(line + path_at), record_new(&m, entries));
+    }
+    g_free(line);
+    fclose(f);
+    // Rebuild the tree: every directory hangs off its parent's record
+    GHashTableIter it;
+    gpointer key, value;
+    g_hash_table_iter_init(&it, st->dirs);
+    while (g_hash_table_iter_next(&it, &key, &value)) {
+        const char *path = (const char *)key;
+        const char *sep = strrchr(path, DIR_SEP);
+        if (!sep || sep == path) continue;
+        char *parent = g_strndup(path, (gsize)(sep - path));
+        DirRecord *prec = g_hash_table_lookup(st->dirs, parent);
+        if (prec) g_ptr_array_add(prec->subdirs, key);
+        g_free(parent);
+    }
+    return st;
+}
+
+int dir_state_commit(dir_state *st) {
+    char tmp[80];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", st->file);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return -1;
+    fprintf(f, DIRSTATE_MAGIC " %lld %lld %u %llx\n", (long long)st->scan_time, (long long)st->full_time,
+            st->seq, (unsigned long long)st->rules);
+    GHashTableIter it;
+    gpointer key, value;
+    g_mutex_lock(&st->lock);
+    g_hash_table_iter_init(&it, st->dirs);
+    while (g_hash_table_iter_next(&it, &key, &value)) {
+        const DirRecord *rec = (const DirRecord *)value;
+        fprintf(f, "D %lld %lld %u %s\n", (long long)rec->marker.mtime, (long long)rec->marker.ctime,
+                rec->entries, (const char *)key);
+    }
+    g_mutex_unlock(&st->lock);
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        remove(tmp);
+        return -1;
+    }
+    return replace_file_atomic(tmp, st->file);
+}
+
+void dir_state_forget(dir_state *st, const char *file_path) {
+    const char *sep = strrchr(file_path, DIR_SEP);
+    if (!sep) return;
+    char *dir = g_strndup(file_path, (gsize)(sep - file_path));
+    // The record stays in its parent's tree; only its marker stops matching
+    g_mutex_lock(&st->lock);
+    DirRecord *rec = g_hash_table_lookup(st->dirs, dir);
+    if (rec) rec->marker.mtime = -1;
+    g_mutex_unlock(&st->lock);
+    g_free(dir);
+}
+
+// --- Platform Helpers ---
+#ifdef _WIN32
+static gint64 filetime_ticks(const FILETIME *ft) {
+    guint64 t = ((guint64)ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+    return (gint64)(t - 116444736000000000ULL);   // 1601 -> 1970
+}
+
+static int read_marker(const char *path, DirMarker *m) {
+    WIN32_FILE_ATTRIBUTE_DATA fa;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &fa)) return -1;
+    if (!(fa.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) return -1;
+    m->mtime = filetime_ticks(&fa.ftLastWriteTime);
+    m->ctime = filetime_ticks(&fa.ftCreationTime);
+    return 0;
+}
+
+// Counts the entries of one directory; files go to `files` (NULL = count only),
+// filtered by walk_limits.rules under `cur`. *too_new is set when min_age held a file back.
+static guint32 list_dir(const char *path, const RuleCursor *cur, GList **files, int *n_files,
+                        GPtrArray *subdirs, gboolean *too_new) {
+    ScanRules *rules = walk_limits.rules;
+    WIN32_FIND_DATA find_data;
+    char search_path[MAX_PATH];
+    guint32 entries = 0;
+    snprintf(search_path, sizeof(search_path), "%s\\*", path);
+    HANDLE h_find = FindFirstFile(search_path, &find_data);
+    if (h_find == INVALID_HANDLE_VALUE) return 0;
+    do {
+        if (strcmp(find_data.cFileName, ".") == 0 || strcmp(find_data.cFileName, "..") == 0)
+            continue;
+        char full_path[MAX_PATH];
+        snprintf(full_path, sizeof(full_path), "%s\\%s", path, find_data.cFileName);
+        entries++;
+        if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            g_ptr_array_add(subdirs, g_strdup(full_path));
+        } else if (files && !(find_data.dwFileAttributes & FILE_ATTRIBUTE_DEVICE)) {
+            if (rules) {
+                guint64 size = ((guint64)find_data.nFileSizeHigh << 32) | find_data.nFileSizeLow;
+                gint64 mtime = filetime_ticks(&find_data.ftLastWriteTime) / TICKS_PER_SEC;
+                RuleVerdict v = scan_rules_want_file(rules, cur, find_data.cFileName, size, mtime);
+                if (v == RULES_TOO_NEW) *too_new = TRUE;
+                if (v != RULES_SCAN) continue;
+            }
+            *files = g_list_prepend(*files, g_strdup(full_path));
+            (*n_files)++;
+        }
+    } while (FindNextFile(h_find, &find_data) != 0);
+    FindClose(h_find);
+    return entries;
+}
+#else
+static int read_marker(const char *path, DirMarker *m) {
+    struct stat st;
+    if (lstat(path, &st) != 0 || !S_ISDIR(st.st_mode)) return -1;
+    m->mtime = (gint64)st.st_mtime * TICKS_PER_SEC;
+    m->ctime = (gint64)st.st_ctime * TICKS_PER_SEC;
+    return 0;
+}
+
+static guint32 list_dir(const char *path, const RuleCursor *cur, GList **files, int *n_files,
+                        GPtrArray *subdirs, gboolean *too_new) {
+    ScanRules *rules = walk_limits.rules;
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+    guint32 entries = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        char full_path[PATH_MAX];
+        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
+        entries++;
+        // lstat: never follow symlinks out of the tree
+        struct stat st;
+        if (lstat(full_path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            g_ptr_array_add(subdirs, g_strdup(full_path));
+        } else if (S_ISREG(st.st_mode) && files) {
+            if (rules) {
+                RuleVerdict v = scan_rules_want_file(rules, cur, entry->d_name, (guint64)st.st_size,
+                                                     (gint64)st.st_mtime);
+                if (v == RULES_TOO_NEW) *too_new = TRUE;
+                if (v != RULES_SCAN) continue;
+            }
+            *files = g_list_prepend(*files, g_strdup(full_path));
+            (*n_files)++;
+        }
+    }
+    closedir(dir);
+    return entries;
+}
+#endif
+
+// --- Incremental Walk ---
+static gboolean stop_requested(void) {
+    g_mutex_lock(&global_scan_ctx.mutex);
+    gboolean stop = global_scan_ctx.stop_requested;
+    g_mutex_unlock(&global_scan_ctx.mutex);
+    return stop;
+}
+
+// Subdirectory `path` of a directory at `cur`; false when the rules exclude it
+static gboolean enter_subdir(const RuleCursor *cur, const char *path, RuleCursor *child) {
+    if (!walk_limits.rules) return TRUE;
+    const char *sep = strrchr(path, DIR_SEP);
+    return scan_rules_enter_dir(walk_limits.rules, cur, sep ? sep + 1 : path, child);
+}
+
+// Returns -1 when a marker looks forged or the clock is off (w->suspect says which).
+// `cur` is the rule cursor of `path` (NULL without rules).
+static int walk_dir(DirWalk *w, const char *path, DirRecord *parent, const RuleCursor *cur) {
+    if (stop_requested()) return 0;
+    if (!walk_guard_enter(w->guard, path)) return 0;
+    DirMarker m;
+    if (read_marker(path, &m) != 0) return 0;
+    w->stats->dirs_visited++;
+    gint64 now = w->st->scan_time;
+    if (!w->full && (m.mtime > now + SKEW_TICKS || m.ctime > now + SKEW_TICKS)) {
+        w->suspect = "directory timestamps in the future (clock skew)";
+        return -1;
+    }
+    DirRecord *rec = record_new(&m, 0);
+    char *key = g_strdup(path);
+    g_hash_table_replace(w->st->dirs, key, rec);
+    if (parent) g_ptr_array_add(parent->subdirs, key);
+
+    const DirRecord *old = w->full ? NULL : g_hash_table_lookup(w->old->dirs, path);
+    // Same marker, and old enough that a change in the same timestamp tick is ruled out
+    gboolean unchanged = old && old->marker.mtime == m.mtime && old->marker.ctime == m.ctime &&
+                         old->marker.mtime + RACY_TICKS < w->old->scan_time;
+    if (unchanged && (g_str_hash(path) + w->st->seq) % DIRSTATE_AUDIT_EVERY != 0) {
+        // Not listed: its files are as scanned last time, its subdirectories are checked one by one
+        w->stats->dirs_skipped++;
+        rec->entries = old->entries;
+        for (guint i = 0; i < old->subdirs->len; ++i) {
+            const char *sub = g_ptr_array_index(old->subdirs, i);
+            RuleCursor child;
+            if (!enter_subdir(cur, sub, &child)) continue;
+            if (walk_dir(w, sub, rec, cur ? &child : NULL) != 0) return -1;
+        }
+        return 0;
+    }
+    // New, changed or audited: list it (files only when something changed)
+    w->stats->dirs_listed++;
+    GPtrArray *subdirs = g_ptr_array_new_with_free_func(g_free);
+    gboolean too_new = FALSE;
+    rec->entries = list_dir(path, cur, unchanged ? NULL : &w->list->paths,
+                            &w->list->total_files, subdirs, &too_new);
+    // min_age held files back: list the directory again next time
+    if (too_new) rec->marker.mtime = -1;
+    if (unchanged && rec->entries != old->entries) {
+        // Entries came or went without the directory's timestamp moving
+        g_ptr_array_free(subdirs, TRUE);
+        w->suspect = "directory changed but kept its timestamp";
+        return -1;
+    }
+    int rc = 0;
+    for (guint i = 0; rc == 0 && i < subdirs->len; ++i) {
+        const char *sub = g_ptr_array_index(subdirs, i);
+        RuleCursor child;
+        if (enter_subdir(cur, sub, &child)) rc = walk_dir(w, sub, rec, cur ? &child : NULL);
+    }
+    g_ptr_array_free(subdirs, TRUE);
+    return rc;
+}
+
+FilePathList *list_files_incremental(const char *root, dir_state **out_state, IncrementalStats *stats) {
+    IncrementalStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    *out_state = NULL;
+
+    dir_state *old = dir_state_load(root);
+    gint64 now = ticks_now();
+    guint64 rules = scan_rules_fingerprint(walk_limits.rules);
+    DirWalk w = { old, NULL, NULL, stats, NULL, FALSE, NULL };
+    if (old->scan_time == 0) {
+        w.full = TRUE;
+        stats->reason = "no previous scan";
+    } else if (now < old->scan_time) {
+        w.full = TRUE;
+        stats->reason = "clock moved backwards";
+    } else if (now - old->full_time > (gint64)DIRSTATE_FULL_EVERY * TICKS_PER_SEC) {
+        w.full = TRUE;
+        stats->reason = "periodic full walk";
+    } else if (old->rules != rules) {
+        // Directories the old rules pruned have no markers, files they skipped were never scanned
+        w.full = TRUE;
+        stats->reason = "scan rules changed";
+    }
+    RuleCursor root_cur;
+    gboolean root_in = !walk_limits.rules || scan_rules_begin(walk_limits.rules, root, &root_cur);
+    for (;;) {
+        w.st = dir_state_new(root);
+        w.st->scan_time = now;
+        w.st->full_time = w.full ? now : old->full_time;
+        w.st->seq = old->seq + 1;
+        w.st->rules = rules;
+        w.list = malloc(sizeof(FilePathList));
+        if (!w.list) {
+            dir_state_free(w.st);
+            dir_state_free(old);
+            return NULL;
+        }
+        w.list->paths = NULL;
+        w.list->total_files = 0;
+        w.guard = walk_guard_new(root);
+        int rc = root_in ? walk_dir(&w, root, NULL, walk_limits.rules ? &root_cur : NULL) : 0;
+        walk_guard_free(w.guard);
+        if (rc == 0) break;
+        // Suspicious marker: trust none of them and start over
+        free_filepath_list(w.list);
+        dir_state_free(w.st);
+        memset(stats, 0, sizeof(*stats));
+        w.full = TRUE;
+        stats->reason = w.suspect;
+    }
+    stats->full_walk = w.full;
+    dir_state_free(old);
+    w.list->paths = g_list_reverse(w.list->paths);
+    *out_state = w.st;
+    return w.list;
+}
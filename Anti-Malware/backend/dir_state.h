@@ -0,0 +1,34 @@
+#ifndef DIR_STATE_H
+#define DIR_STATE_H
+#include <glib.h>
+#include "scan_core.h"
+/* Incremental scans. The previous walk of a root left one change marker per
+ * directory (mtime, ctime, entry count). A directory whose marker still
+ * matches is not listed again: its files are skipped and only its recorded
+ * subdirectories are visited (one stat each). Changed directories are listed
+ * and their files hashed. Anything that looks like forged timestamps or a
+ * jumping clock turns the walk into a full one. */
+
+#define DIRSTATE_FULL_EVERY (7 * 24 * 60 * 60) // Seconds; in-place edits do not touch the directory
+#define DIRSTATE_AUDIT_EVERY 16                // Unchanged dirs re-listed per scan: 1 in N, rotating
+
+typedef struct dir_state dir_state;
+
+typedef struct {
+    guint dirs_visited;
+    guint dirs_listed;          // Enumerated: new, changed or audited
+    guint dirs_skipped;         // Marker unchanged: files not listed
+    gboolean full_walk;
+    const char *reason;         // Why the walk was full (static string), NULL otherwise
+} IncrementalStats;
+
+// Lists the files of directories that changed since the last committed scan of
+// `root`. *out_state receives the markers of this walk; hand it to
+// dir_state_commit once every listed file was scanned.
+FilePathList *list_files_incremental(const char *root, dir_state **out_state, IncrementalStats *stats);
+// A file could not be scanned: list its directory again next time (thread-safe)
+void dir_state_forget(dir_state *st, const char *file_path);
+int dir_state_commit(dir_state *st);
+void dir_state_free(dir_state *st);
+
+#endif
@@ -0,0 +1,565 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "feature_extract.h"
+#include "md5.h"
+#include "sha2.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FX_MAX_DESCRIPTORS  4096    // PE import descriptors walked
+#define FX_MAX_THUNKS       65536   // PE thunks visited per file, named or not
+#define FX_MAX_ENTRIES      (1u << 20) // ELF dynamic and symbol entries visited per file
+#define FX_NAME_MAX         256     // Longest DLL / function / symbol name hashed
+#define FX_MIN_SECTION      512     // Smaller sections are too generic to match on
+
+#define PE_SCN_MEM_EXECUTE  0x20000000u
+#define PE_SCN_MEM_WRITE    0x80000000u
+#define ELF_SHT_DYNAMIC     6
+#define ELF_SHT_NOBITS      8
+#define ELF_SHT_DYNSYM      11
+#define ELF_SHF_WRITE       0x1
+#define ELF_SHF_EXECINSTR   0x4
+#define ELF_PT_LOAD         1
+#define ELF_PF_X            0x1
+#define ELF_PF_W            0x2
+#define ELF_DT_NEEDED       1
+
+// --- Bounds-checked reads ---
+typedef struct {
+    const unsigned char *p;
+    size_t len;
+    gboolean be;                // ELF big-endian
+} FxBuf;
+
+// Pointer to n bytes at off, NULL if any of them lies outside the buffer
+static const unsigned char *fx_at(const FxBuf *b, guint64 off, guint64 n) {
+    if (off > b->len || n > b->len - off) return NULL;
+    return b->p + off;
+}
+
+static gboolean rd16(const FxBuf *b, guint64 off, guint16 *v) {
+    const unsigned char *q = fx_at(b, off, 2);
+    if (!q) return FALSE;
+    *v = b->be ? (guint16)((q[0] << 8) | q[1]) : (guint16)(q[0] | (q[1] << 8));
+    return TRUE;
+}
+
+static gboolean rd32(const FxBuf *b, guint64 off, guint32 *v) {
+    const unsigned char *q = fx_at(b, off, 4);
+    if (!q) return FALSE;
+    *v = b->be ? ((guint32)q[0] << 24) | ((guint32)q[1] << 16) | ((guint32)q[2] << 8) | q[3]
+               : (guint32)q[0] | ((guint32)q[1] << 8) | ((guint32)q[2] << 16) | ((guint32)q[3] << 24);
+    return TRUE;
+}
+
+static gboolean rd64(const FxBuf *b, guint64 off, guint64 *v) {
+    guint32 lo, hi;
+    if (!rd32(b, off, &lo) || !rd32(b, off + 4, &hi)) return FALSE;
+    if (b->be) { guint32 t = lo; lo = hi; hi = t; }
+    *v = ((guint64)hi << 32) | lo;
+    return TRUE;
+}
+
+// Word of the file's class: 8 bytes for 64-bit, else 4
+static gboolean rdword(const FxBuf *b, gboolean is_64, guint64 off, guint64 *v) {
+    if (is_64) return rd64(b, off, v);
+    guint32 w;
+    if (!rd32(b, off, &w)) return FALSE;
+    *v = w;
+    return TRUE;
+}
+
+// NUL-terminated string at off, no longer than max; NULL if it does not end in the buffer
+static const char *fx_str(const FxBuf *b, guint64 off, size_t max) {
+    if (off >= b->len) return NULL;
+    size_t room = MIN(max + 1, b->len - (size_t)off);
+    const char *s = (const char *)b->p + off;
+    return memchr(s, '\0', room) ? s : NULL;
+}
+
+static void md5_item(md5_ctx *md5, gboolean *first, const char *s, size_t n) {
+    if (!*first) md5_update(md5, (const unsigned char *)",", 1);
+    md5_update(md5, (const unsigned char *)s, n);
+    *first = FALSE;
+}
+
+static size_t copy_lower(char *dst, const char *src, size_t cap) {
+    size_t n = 0;
+    for (; src[n] && n + 1 < cap; ++n) dst[n] = g_ascii_tolower(src[n]);
+    dst[n] = '\0';
+    return n;
+}
+
+// Overlapping sections would hash the same bytes again: no more than the file in total
+static void hash_sections(const FxBuf *b, FileFeatures *ff) {
+    guint64 budget = b->len;
+    for (int i = 0; i < ff->n_sections; ++i) {
+        FxSection *s = &ff->sections[i];
+        if (s->size == 0) continue;
+        if (s->size > budget) {
+            ff->anomalies |= FX_ANOMALY_CAPPED;
+            break;
+        }
+        budget -= s->size;
+        sha256(b->p + s->offset, s->size, s->sha256);
+    }
+}
+
+// Raw data range of a section, clamped to the file
+static void section_raw(const FxBuf *b, FileFeatures *ff, FxSection *s, guint64 offset, guint64 size) {
+    s->offset = offset;
+    s->size = size;
+    if (size == 0) return;
+    if (offset >= b->len) {
+        s->offset = 0;
+        s->size = 0;
+        ff->anomalies |= FX_ANOMALY_TRUNCATED;
+    } else if (size > b->len - offset) {
+        s->size = b->len - offset;
+        ff->anomalies |= FX_ANOMALY_TRUNCATED;
+    }
+}
+
+// --- PE ---
+static gboolean pe_rva_to_off(const FileFeatures *ff, guint32 size_headers, guint64 rva, guint64 *off) {
+    for (int i = 0; i < ff->n_sections; ++i) {
+        const FxSection *s = &ff->sections[i];
+        if (rva >= s->vaddr && rva - s->vaddr < MAX(s->vsize, s->size)) {
+            if (rva - s->vaddr >= s->size) return FALSE;    // Zero-filled at load, not in the file
+            *off = s->offset + (rva - s->vaddr);
+            return TRUE;
+        }
+    }
+    if (rva < size_headers) {
+        *off = rva;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// pefile's imphash: MD5 of "lib.func,lib.func,..." lowercased, lib without .dll/.ocx/.sys
+static void pe_imports(const FxBuf *b, FileFeatures *ff, guint32 size_headers, guint32 imp_rva) {
+    guint64 desc;
+    if (imp_rva == 0 || !pe_rva_to_off(ff, size_headers, imp_rva, &desc)) return;
+    md5_ctx md5;
+    md5_init(&md5);
+    gboolean first = TRUE;
+    guint64 ord_flag = ff->is_64 ? 0x8000000000000000ULL : 0x80000000ULL;
+    guint thunk_size = ff->is_64 ? 8 : 4;
+    guint thunks = 0;           // Every descriptor may point at the same long array
+
+    for (guint d = 0; d < FX_MAX_DESCRIPTORS; ++d) {
+        const unsigned char *e = fx_at(b, desc + 20ull * d, 20);
+        if (!e) {
+            ff->anomalies |= FX_ANOMALY_TRUNCATED;
+            break;
+        }
+        guint32 oft, name_rva, ft;
+        rd32(b, desc + 20ull * d, &oft);
+        rd32(b, desc + 20ull * d + 12, &name_rva);
+        rd32(b, desc + 20ull * d + 16, &ft);
+        if (oft == 0 && name_rva == 0 && ft == 0) break;
+
+        guint64 name_off, thunk_off;
+        const char *raw = pe_rva_to_off(ff, size_headers, name_rva, &name_off) ? fx_str(b, name_off, FX_NAME_MAX) : NULL;
+        if (!raw || !pe_rva_to_off(ff, size_headers, oft ? oft : ft, &thunk_off)) continue;
+        char lib[FX_NAME_MAX + 1];
+        size_t lib_len = copy_lower(lib, raw, sizeof(lib));
+        if (lib_len > 4 && (strcmp(lib + lib_len - 4, ".dll") == 0 || strcmp(lib + lib_len - 4, ".ocx") == 0 ||
+                            strcmp(lib + lib_len - 4, ".sys") == 0))
+            lib[lib_len -= 4] = '\0';
+        ff->n_libraries++;
+
+        for (guint64 t = thunk_off;; t += thunk_size) {
+            guint64 v;
+            if (++thunks > FX_MAX_THUNKS) {
+                ff->anomalies |= FX_ANOMALY_CAPPED;
+                d = FX_MAX_DESCRIPTORS;
+                break;
+            }
+            if (!rdword(b, ff->is_64, t, &v)) {
+                ff->anomalies |= FX_ANOMALY_TRUNCATED;
+                break;
+            }
+            if (v == 0) break;
+            if (ff->n_imports >= FX_MAX_IMPORTS) {
+                ff->anomalies |= FX_ANOMALY_CAPPED;
+                d = FX_MAX_DESCRIPTORS;
+                break;
+            }
+            char item[2 * FX_NAME_MAX + 2];
+            memcpy(item, lib, lib_len);
+            item[lib_len] = '.';
+            size_t n;
+            if (v & ord_flag) {
+                n = lib_len + 1 + (size_t)snprintf(item + lib_len + 1, FX_NAME_MAX, "ord%u", (unsigned)(v & 0xFFFF));
+            } else {
+                guint64 hint_off;
+                const char *fn = pe_rva_to_off(ff, size_headers, v & 0x7FFFFFFF, &hint_off)
+                                     ? fx_str(b, hint_off + 2, FX_NAME_MAX) : NULL;
+                if (!fn) continue;
+                n = lib_len + 1 + copy_lower(item + lib_len + 1, fn, FX_NAME_MAX + 1);
+            }
+            md5_item(&md5, &first, item, n);
+            ff->n_imports++;
+        }
+    }
+    if (!first) {
+        md5_final(&md5, ff->imphash);
+        ff->has_imphash = TRUE;
+    }
+}
+
+static int parse_pe(const FxBuf *b, gboolean hash, FileFeatures *ff) {
+    guint32 nt;
+    if (!rd32(b, 0x3C, &nt)) return FX_NOT_EXEC;
+    const unsigned char *sig = fx_at(b, nt, 24);
+    if (!sig || memcmp(sig, "PE\0\0", 4) != 0) return FX_NOT_EXEC;     // DOS program or junk
+
+    guint16 n_sec, opt_size, magic;
+    ff->format = FX_PE;
+    rd16(b, nt + 4, &ff->machine);
+    rd16(b, nt + 6, &n_sec);
+    rd32(b, nt + 8, &ff->timestamp);
+    rd16(b, nt + 20, &opt_size);
+    rd16(b, nt + 22, &ff->characteristics);
+    guint64 opt = (guint64)nt + 24;
+    if (!rd16(b, opt, &magic) || (magic != 0x10B && magic != 0x20B)) return FX_MALFORMED;
+    ff->is_64 = (magic == 0x20B);
+
+    guint32 entry, size_image, size_headers, n_dirs, imp_rva = 0;
+    if (!rd32(b, opt + 16, &entry) || !rd32(b, opt + 56, &size_image) || !rd32(b, opt + 60, &size_headers) ||
+        !rd16(b, opt + 68, &ff->subsystem) || !rd16(b, opt + 70, &ff->dll_characteristics) ||
+        !rd32(b, opt + (ff->is_64 ? 108 : 92), &n_dirs))
+        return FX_MALFORMED;
+    ff->entry = entry;
+    ff->image_size = size_image;
+    guint64 dirs = opt + (ff->is_64 ? 112 : 96);
+    if (n_dirs > 1 && dirs + 16 <= opt + opt_size) rd32(b, dirs + 8, &imp_rva);
+
+    // Section table
+    guint64 table = opt + opt_size, raw_end = MIN((guint64)size_headers, (guint64)b->len);
+    for (guint i = 0; i < n_sec; ++i) {
+        const unsigned char *h = fx_at(b, table + 40ull * i, 40);
+        if (!h) {
+            ff->anomalies |= FX_ANOMALY_TRUNCATED;
+            break;
+        }
+        if (ff->n_sections == FX_MAX_SECTIONS) {
+            ff->anomalies |= FX_ANOMALY_CAPPED;
+            break;
+        }
+        FxSection *s = &ff->sections[ff->n_sections];
+        memset(s, 0, sizeof(*s));
+        guint32 vsize, va, raw_size, raw_ptr, flags;
+        memcpy(s->name, h, 8);
+        s->name[8] = '\0';
+        rd32(b, table + 40ull * i + 8, &vsize);
+        rd32(b, table + 40ull * i + 12, &va);
+        rd32(b, table + 40ull * i + 16, &raw_size);
+        rd32(b, table + 40ull * i + 20, &raw_ptr);
+        rd32(b, table + 40ull * i + 36, &flags);
+        s->vaddr = va;
+        s->vsize = vsize;
+        s->flags = flags;
+        section_raw(b, ff, s, raw_ptr, raw_size);
+        if ((flags & PE_SCN_MEM_EXECUTE) && (flags & PE_SCN_MEM_WRITE)) ff->anomalies |= FX_ANOMALY_WX;
+        if (s->size && s->offset + s->size > raw_end) raw_end = s->offset + s->size;
+        if (ff->entry_section < 0 && entry >= va && entry - va < MAX(vsize, raw_size))
+            ff->entry_section = ff->n_sections;
+        ff->n_sections++;
+    }
+    ff->overlay = b->len > raw_end ? b->len - raw_end : 0;
+    if (ff->entry_section < 0 && entry != 0) ff->anomalies |= FX_ANOMALY_ENTRY;
+
+    pe_imports(b, ff, size_headers, imp_rva);
+    if (hash) hash_sections(b, ff);
+    return FX_OK;
+}
+
+// --- ELF ---
+// Undefined dynamic symbols and DT_NEEDED libraries, hashed like an imphash:
+// MD5 of "lib,lib,...;sym,sym,..." in table order
+static void elf_imports(const FxBuf *b, FileFeatures *ff, guint64 shoff, guint16 shentsize, guint16 shnum) {
+    md5_ctx md5;
+    md5_init(&md5);
+    gboolean first = TRUE, any = FALSE;
+    guint64 entries = 0;        // Every section header may span the whole file
+    for (int pass = 0; pass < 2; ++pass) {
+        guint32 want = pass == 0 ? ELF_SHT_DYNAMIC : ELF_SHT_DYNSYM;
+        for (guint i = 0; i < shnum; ++i) {
+            guint64 sh = shoff + (guint64)shentsize * i;
+            guint32 type, link;
+            guint64 off, size;
+            if (!rd32(b, sh + 4, &type) || type != want) continue;
+            if (!rd32(b, sh + (ff->is_64 ? 40 : 24), &link) ||
+                !rdword(b, ff->is_64, sh + (ff->is_64 ? 24 : 16), &off) ||
+                !rdword(b, ff->is_64, sh + (ff->is_64 ? 32 : 20), &size))
+                continue;
+            guint64 str_off;
+            if (link >= shnum || !rdword(b, ff->is_64, shoff + (guint64)shentsize * link + (ff->is_64 ? 24 : 16), &str_off))
+                continue;
+            guint64 ent = pass == 0 ? (ff->is_64 ? 16 : 8) : (ff->is_64 ? 24 : 16);
+            if (!fx_at(b, off, size)) {
+                ff->anomalies |= FX_ANOMALY_TRUNCATED;
+                size = off < b->len ? b->len - off : 0;
+            }
+            for (guint64 e = 0; e + ent <= size; e += ent) {
+                guint32 name;
+                if (++entries > FX_MAX_ENTRIES) {
+                    ff->anomalies |= FX_ANOMALY_CAPPED;
+                    i = shnum;
+                    pass = 2;
+                    break;
+                }
+                if (pass == 0) {
+                    guint64 tag, val;
+                    rdword(b, ff->is_64, off + e, &tag);
+                    rdword(b, ff->is_64, off + e + ent / 2, &val);
+                    if (tag == 0) break;
+                    if (tag != ELF_DT_NEEDED) continue;
+                    name = (guint32)val;
+                    ff->n_libraries++;
+                } else {
+                    guint16 shndx;
+                    rd32(b, off + e, &name);
+                    rd16(b, off + e + (ff->is_64 ? 6 : 14), &shndx);
+                    if (name == 0 || shndx != 0) continue;
+                    if (ff->n_imports >= FX_MAX_IMPORTS) {
+                        ff->anomalies |= FX_ANOMALY_CAPPED;
+                        break;
+                    }
+                    ff->n_imports++;
+                }
+                const char *s = fx_str(b, str_off + name, FX_NAME_MAX);
+                if (!s) continue;
+                md5_item(&md5, &first, s, strlen(s));
+                any = TRUE;
+            }
+        }
+        if (pass == 0) {
+            md5_update(&md5, (const unsigned char *)";", 1);
+            first = TRUE;
+        }
+    }
+    if (any) {
+        md5_final(&md5, ff->imphash);
+        ff->has_imphash = TRUE;
+    }
+}
+
+static int parse_elf(const FxBuf *in, gboolean hash, FileFeatures *ff) {
+    const unsigned char *id = fx_at(in, 0, 16);
+    if (!id || (id[4] != 1 && id[4] != 2) || (id[5] != 1 && id[5] != 2)) return FX_MALFORMED;
+    FxBuf b = *in;
+    b.be = (id[5] == 2);
+    ff->format = FX_ELF;
+    ff->is_64 = (id[4] == 2);
+
+    guint64 phoff, shoff;
+    guint16 phentsize, phnum, shentsize, shnum, shstrndx;
+    gboolean w = ff->is_64;
+    if (!rd16(&b, 16, &ff->characteristics) || !rd16(&b, 18, &ff->machine) ||
+        !rdword(&b, w, 24, &ff->entry) || !rdword(&b, w, w ? 32 : 28, &phoff) ||
+        !rdword(&b, w, w ? 40 : 32, &shoff) || !rd16(&b, w ? 54 : 42, &phentsize) ||
+        !rd16(&b, w ? 56 : 44, &phnum) || !rd16(&b, w ? 58 : 46, &shentsize) ||
+        !rd16(&b, w ? 60 : 48, &shnum) || !rd16(&b, w ? 62 : 50, &shstrndx))
+        return FX_MALFORMED;
+    if ((phnum && phentsize < (w ? 56 : 32)) || (shnum && shentsize < (w ? 64 : 40))) return FX_MALFORMED;
+
+    guint64 raw_end = w ? 64 : 52;
+    if (shnum && shoff + (guint64)shentsize * shnum > raw_end) raw_end = shoff + (guint64)shentsize * shnum;
+    if (phnum && phoff + (guint64)phentsize * phnum > raw_end) raw_end = phoff + (guint64)phentsize * phnum;
+
+    // Segments: image size always, and the "sections" of binaries stripped of section headers
+    if (!shnum) ff->anomalies |= FX_ANOMALY_NO_SECTIONS;
+    for (guint i = 0; i < phnum; ++i) {
+        guint64 ph = phoff + (guint64)phentsize * i;
+        guint32 type, flags;
+        guint64 off, vaddr, filesz, memsz;
+        if (!rd32(&b, ph, &type) || !rd32(&b, ph + (w ? 4 : 24), &flags) ||
+            !rdword(&b, w, ph + (w ? 8 : 4), &off) || !rdword(&b, w, ph + (w ? 16 : 8), &vaddr) ||
+            !rdword(&b, w, ph + (w ? 32 : 16), &filesz) || !rdword(&b, w, ph + (w ? 40 : 20), &memsz)) {
+            ff->anomalies |= FX_ANOMALY_TRUNCATED;
+            break;
+        }
+        if (type != ELF_PT_LOAD) continue;
+        if (vaddr + memsz > ff->image_size) ff->image_size = vaddr + memsz;
+        if (shnum) continue;
+        if (ff->n_sections == FX_MAX_SECTIONS) {
+            ff->anomalies |= FX_ANOMALY_CAPPED;
+            break;
+        }
+        FxSection *s = &ff->sections[ff->n_sections];
+        memset(s, 0, sizeof(*s));
+        snprintf(s->name, sizeof(s->name), "LOAD%u", i);
+        s->vaddr = vaddr;
+        s->vsize = memsz;
+        s->flags = flags;
+        section_raw(&b, ff, s, off, filesz);
+        if ((flags & ELF_PF_X) && (flags & ELF_PF_W)) ff->anomalies |= FX_ANOMALY_WX;
+        if (ff->entry_section < 0 && ff->entry >= vaddr && ff->entry - vaddr < memsz) ff->entry_section = ff->n_sections;
+        if (s->size && s->offset + s->size > raw_end) raw_end = s->offset + s->size;
+        ff->n_sections++;
+    }
+
+    // Sections
+    guint64 names = 0;
+    gboolean have_names = shstrndx < shnum &&
+                          rdword(&b, w, shoff + (guint64)shentsize * shstrndx + (w ? 24 : 16), &names);
+    for (guint i = 1; i < shnum; ++i) {
+        guint64 sh = shoff + (guint64)shentsize * i;
+        guint32 name, type;
+        guint64 flags, addr, off, size;
+        if (!rd32(&b, sh, &name) || !rd32(&b, sh + 4, &type) || !rdword(&b, w, sh + 8, &flags) ||
+            !rdword(&b, w, sh + (w ? 16 : 12), &addr) || !rdword(&b, w, sh + (w ? 24 : 16), &off) ||
+            !rdword(&b, w, sh + (w ? 32 : 20), &size)) {
+            ff->anomalies |= FX_ANOMALY_TRUNCATED;
+            break;
+        }
+        if (ff->n_sections == FX_MAX_SECTIONS) {
+            ff->anomalies |= FX_ANOMALY_CAPPED;
+            break;
+        }
+        FxSection *s = &ff->sections[ff->n_sections];
+        memset(s, 0, sizeof(*s));
+        const char *nm = have_names ? fx_str(&b, names + name, sizeof(s->name) * 4) : NULL;
+        snprintf(s->name, sizeof(s->name), "%s", nm ? nm : "");
+        s->vaddr = addr;
+        s->vsize = size;
+        s->flags = (guint32)flags;
+        section_raw(&b, ff, s, off, type == ELF_SHT_NOBITS ? 0 : size);
+        if ((flags & ELF_SHF_EXECINSTR) && (flags & ELF_SHF_WRITE)) ff->anomalies |= FX_ANOMALY_WX;
+        if (ff->entry_section < 0 && (flags & ELF_SHF_EXECINSTR) && ff->entry >= addr && ff->entry - addr < size)
+            ff->entry_section = ff->n_sections;
+        if (s->size && s->offset + s->size > raw_end) raw_end = s->offset + s->size;
+        ff->n_sections++;
+    }
+    ff->overlay = b.len > raw_end ? b.len - raw_end : 0;
+    // Relocatable objects have no entry point
+    if (ff->entry_section < 0 && ff->entry != 0) ff->anomalies |= FX_ANOMALY_ENTRY;
+
+    if (shnum) elf_imports(&b, ff, shoff, shentsize, shnum);
+    if (hash) hash_sections(&b, ff);
+    return FX_OK;
+}
+
+int fx_parse(const unsigned char *buf, size_t len, gboolean hash_sections, FileFeatures *out) {
+    memset(out, 0, offsetof(FileFeatures, sections));
+    out->entry_section = -1;
+    FxBuf b = { buf, len, FALSE };
+    if (len >= 64 && buf[0] == 'M' && buf[1] == 'Z') return parse_pe(&b, hash_sections, out);
+    if (len >= 52 && memcmp(buf, "\x7F" "ELF", 4) == 0) return parse_elf(&b, hash_sections, out);
+    return FX_NOT_EXEC;
+}
+
+// --- Feature Signatures ---
+enum { FX_KEY_IMPHASH = 0, FX_KEY_SECTION = 1 };
+
+typedef struct {
+    guint8 kind;
+    unsigned char key[32];      // Imphash keys use the first 16 bytes
+    guint32 label;              // Offset into fx_db.labels
+} FxSig;
+
+struct fx_db {
+    GArray *sigs;               // FxSig, sorted by (kind, key)
+    GString *labels;            // NUL separated
+};
+
+static int fxsig_cmp(const void *a, const void *b) {
+    const FxSig *x = (const FxSig *)a, *y = (const FxSig *)b;
+    if (x->kind != y->kind) return x->kind < y->kind ? -1 : 1;
+    return memcmp(x->key, y->key, sizeof(x->key));
+}
+
+static int parse_hex(const char *hex, unsigned char *out, size_t n) {
+    if (strlen(hex) != n * 2) return -1;
+    for (size_t i = 0; i < n; ++i) {
+        int hi = g_ascii_xdigit_value(hex[2 * i]), lo = g_ascii_xdigit_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return -1;
+        out[i] = (unsigned char)((hi << 4) | lo);
+    }
+    return 0;
+}
+
+fx_db *fx_db_load(const char *path, int *bad_lines) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    fx_db *db = g_new0(fx_db, 1);
+    db->sigs = g_array_new(FALSE, FALSE, sizeof(FxSig));
+    db->labels = g_string_new(NULL);
+    int bad = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == 0 || line[0] == '#') continue;
+        // Name:kind:hex
+        char *kind = strchr(line, ':');
+        char *hex = kind ? strchr(kind + 1, ':') : NULL;
+        if (!hex) { bad++; continue; }
+        *kind++ = 0;
+        *hex++ = 0;
+        FxSig sig;
+        memset(&sig, 0, sizeof(sig));
+        int rc = -1;
+        if (strcmp(kind, "imphash") == 0) {
+            sig.kind = FX_KEY_IMPHASH;
+            rc = parse_hex(hex, sig.key, 16);
+        } else if (strcmp(kind, "section") == 0) {
+            sig.kind = FX_KEY_SECTION;
+            rc = parse_hex(hex, sig.key, 32);
+        }
+        if (rc != 0) { bad++; continue; }
+        sig.label = (guint32)db->labels->len;
+        g_string_append_len(db->labels, line, (gssize)strlen(line) + 1);
+        g_array_append_val(db->sigs, sig);
+    }
+    fclose(f);
+    if (db->sigs->len > 1) qsort(db->sigs->data, db->sigs->len, sizeof(FxSig), fxsig_cmp);
+    if (bad_lines) *bad_lines = bad;
+    return db;
+}
+
+void fx_db_free(fx_db *db) {
+    if (!db) return;
+    g_array_free(db->sigs, TRUE);
+    g_string_free(db->labels, TRUE);
+    g_free(db);
+}
+
+size_t fx_db_count(const fx_db *db) {
+    return db ? db->sigs->len : 0;
+}
+
+size_t fx_db_bytes(const fx_db *db) {
+    return db ? sizeof(*db) + db->sigs->len * sizeof(FxSig) + db->labels->allocated_len : 0;
+}
+
+static const char *fx_lookup(const fx_db *db, guint8 kind, const unsigned char *key, size_t n) {
+    FxSig probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.kind = kind;
+    memcpy(probe.key, key, n);
+    const FxSig *hit = bsearch(&probe, db->sigs->data, db->sigs->len, sizeof(FxSig), fxsig_cmp);
+    return hit ? db->labels->str + hit->label : NULL;
+}
+
+const char *fx_db_match(const fx_db *db, const FileFeatures *ff, char *why, size_t why_len) {
+    if (!db || db->sigs->len == 0 || ff->format == FX_NONE) return NULL;
+    const char *label = ff->has_imphash ? fx_lookup(db, FX_KEY_IMPHASH, ff->imphash, 16) : NULL;
+    if (label) {
+        snprintf(why, why_len, "imphash");
+        return label;
+    }
+    for (int i = 0; i < ff->n_sections; ++i) {
+        const FxSection *s = &ff->sections[i];
+        if (s->size < FX_MIN_SECTION) continue;
+        label = fx_lookup(db, FX_KEY_SECTION, s->sha256, 32);
+        if (label) {
+            snprintf(why, why_len, "section %s", s->name);
+            return label;
+        }
+    }
+    return NULL;
+}
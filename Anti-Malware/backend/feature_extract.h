@@ -0,0 +1,74 @@
+#ifndef FEATURE_EXTRACT_H
+#define FEATURE_EXTRACT_H
+#include <glib.h>
+#include <stddef.h>
+/* Structure of PE and ELF executables, parsed in place over a mapped or
+ * already-read buffer: every offset is bounds-checked against it and nothing
+ * is copied but the fields below. Import hashes and per-section SHA-256 stay
+ * the same when a sample is repacked with a new overlay, resources or
+ * timestamp, so they back a second signature index (feature_sigs.db). */
+
+/* Return codes */
+#define FX_OK           0
+#define FX_NOT_EXEC     1       // Neither PE nor ELF
+#define FX_MALFORMED   -1       // Headers broken; what was parsed before is kept
+
+#define FX_MAX_SECTIONS 96
+#define FX_MAX_IMPORTS  16384   // Functions hashed; more sets FX_ANOMALY_CAPPED
+
+// Anomalies seen while parsing (FileFeatures.anomalies)
+#define FX_ANOMALY_TRUNCATED    (1u << 0)   // A section or table runs past the end of the file
+#define FX_ANOMALY_ENTRY        (1u << 1)   // Entry point outside every section
+#define FX_ANOMALY_WX           (1u << 2)   // A section is both writable and executable
+#define FX_ANOMALY_CAPPED       (1u << 3)   // Sections or imports beyond the limits were ignored
+#define FX_ANOMALY_NO_SECTIONS  (1u << 4)   // ELF without section headers (segments used instead)
+
+typedef enum { FX_NONE = 0, FX_PE, FX_ELF } FxFormat;
+
+typedef struct {
+    char name[16];
+    guint64 offset;             // Raw data in the file
+    guint64 size;               // Raw bytes, clamped to the file
+    guint64 vaddr;              // RVA (PE) / virtual address (ELF)
+    guint64 vsize;
+    guint32 flags;              // PE Characteristics / ELF sh_flags or p_flags
+    unsigned char sha256[32];   // Of the raw bytes; all zero when size is 0
+} FxSection;
+
+typedef struct {
+    FxFormat format;
+    gboolean is_64;
+    guint16 machine;
+    guint16 characteristics;    // PE file characteristics / ELF e_type
+    guint32 timestamp;          // PE TimeDateStamp
+    guint16 subsystem;          // PE only
+    guint16 dll_characteristics;
+    guint64 entry;              // Entry point RVA (PE) / virtual address (ELF)
+    int entry_section;          // Index into sections, -1 when outside all of them
+    guint64 image_size;         // PE SizeOfImage / ELF highest loaded address
+    guint64 overlay;            // Bytes after the last section's raw data
+    guint32 n_libraries;        // Imported DLLs / DT_NEEDED entries
+    guint32 n_imports;          // Imported functions / undefined dynamic symbols
+    gboolean has_imphash;
+    unsigned char imphash[16];  // MD5; PE follows the pefile convention, ordinals as "ordN"
+    guint32 anomalies;
+    int n_sections;
+    FxSection sections[FX_MAX_SECTIONS];
+} FileFeatures;
+
+// Parses `buf` (the whole file); with hash_sections FALSE the per-section SHA-256 is skipped
+int fx_parse(const unsigned char *buf, size_t len, gboolean hash_sections, FileFeatures *out);
+
+// --- Feature signatures ---
+// feature_sigs.db, one "Name:imphash:<32 hex>" or "Name:section:<64 hex>" per line
+typedef struct fx_db fx_db;
+
+fx_db *fx_db_load(const char *path, int *bad_lines);
+void fx_db_free(fx_db *db);
+size_t fx_db_count(const fx_db *db);
+// Allocated for signatures and labels (an estimate, for the memory budget)
+size_t fx_db_bytes(const fx_db *db);
+// Label of the first matching feature, NULL if none. *why names it ("imphash", "section .text").
+const char *fx_db_match(const fx_db *db, const FileFeatures *ff, char *why, size_t why_len);
+
+#endif
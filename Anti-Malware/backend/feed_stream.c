@@ -0,0 +1,185 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "feed_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <zlib.h>
+
+#define FEED_OUT_CHUNK (256 * 1024)
+#define FEED_ZIP_HEADER 30          // Fixed part of a local file header
+#define FEED_ZIP_SIG 0x04034b50
+#define FEED_FLAG_ENCRYPTED  0x0001
+#define FEED_FLAG_DESCRIPTOR 0x0008
+#define FEED_METHOD_STORED   0
+#define FEED_METHOD_DEFLATE  8
+
+// --- Internal Structs ---
+typedef enum {
+    FEED_DETECT,                // Collecting the first header bytes
+    FEED_PLAIN,                 // Not a ZIP: every byte is feed text
+    FEED_MEMBER,                // Inside the first member
+    FEED_DONE,                  // Member complete; the central directory is ignored
+    FEED_FAILED
+} FeedState;
+
+struct feed_stream {
+    FeedState state;
+    sig_builder *builder;
+    FILE *copy;
+    unsigned char head[FEED_ZIP_HEADER];
+    size_t head_len;
+    guint64 skip;               // File name and extra field still to pass over
+    int method;
+    guint64 stored_left;
+    z_stream z;
+    gboolean z_ready;
+    FeedStreamStats stats;
+    unsigned char out[FEED_OUT_CHUNK];
+};
+
+static guint16 rd16(const unsigned char *p) {
+    return (guint16)(p[0] | (p[1] << 8));
+}
+static guint32 rd32(const unsigned char *p) {
+    return (guint32)p[0] | ((guint32)p[1] << 8) | ((guint32)p[2] << 16) | ((guint32)p[3] << 24);
+}
+
+// Feed text goes to the index builder and to the on-disk copy
+static int feed_emit(feed_stream *fs, const unsigned char *text, size_t len) {
+    fs->stats.bytes_out += len;
+    if (sigdb_builder_feed(fs->builder, (const char *)text, len) != 0) return -1;
+    if (fs->copy && fwrite(text, 1, len, fs->copy) != len) return -1;
+    return 0;
+}
+
+// Reads the local header once all 30 bytes are in
+static int feed_open_member(feed_stream *fs) {
+    guint16 flags = rd16(fs->head + 6);
+    fs->method = rd16(fs->head + 8);
+    guint32 csize = rd32(fs->head + 18);
+    fs->skip = (guint64)rd16(fs->head + 26) + rd16(fs->head + 28);
+    if (flags & FEED_FLAG_ENCRYPTED) return -1;
+    if (fs->method == FEED_METHOD_DEFLATE) {
+        // Raw deflate: ZIP members carry no zlib header
+        memset(&fs->z, 0, sizeof(fs->z));
+        if (inflateInit2(&fs->z, -MAX_WBITS) != Z_OK) return -1;
+        fs->z_ready = TRUE;
+        return 0;
+    }
+    // A stored member needs its size up front (no data descriptor, no ZIP64)
+    if (fs->method != FEED_METHOD_STORED || (flags & FEED_FLAG_DESCRIPTOR) || csize == 0xFFFFFFFFu) return -1;
+    fs->stored_left = csize;
+    return 0;
+}
+
+// Consumes member bytes; returns how many were used or -1
+static long feed_member(feed_stream *fs, const unsigned char *buf, size_t len) {
+    if (fs->skip > 0) {
+        size_t n = (size_t)MIN((guint64)len, fs->skip);
+        fs->skip -= n;
+        return (long)n;
+    }
+    if (fs->method == FEED_METHOD_STORED) {
+        size_t n = (size_t)MIN((guint64)len, fs->stored_left);
+        if (feed_emit(fs, buf, n) != 0) return -1;
+        fs->stored_left -= n;
+        if (fs->stored_left == 0) fs->state = FEED_DONE;
+        return (long)n;
+    }
+    fs->z.next_in = (Bytef *)buf;
+    fs->z.avail_in = (uInt)MIN(len, (size_t)UINT_MAX);
+    size_t offered = fs->z.avail_in;
+    for (;;) {
+        fs->z.next_out = fs->out;
+        fs->z.avail_out = sizeof(fs->out);
+        int zr = inflate(&fs->z, Z_NO_FLUSH);
+        size_t produced = sizeof(fs->out) - fs->z.avail_out;
+        if (produced && feed_emit(fs, fs->out, produced) != 0) return -1;
+        if (zr == Z_STREAM_END) {
+            fs->state = FEED_DONE;
+            break;
+        }
+        if (zr != Z_OK && zr != Z_BUF_ERROR) return -1;
+        // Input used up and the output buffer was not filled: wait for the next piece
+        if (fs->z.avail_in == 0 && fs->z.avail_out != 0) break;
+        if (zr == Z_BUF_ERROR) break;
+    }
+    return (long)(offered - fs->z.avail_in);
+}
+
+// --- Public API ---
+feed_stream *feed_stream_new(FILE *copy) {
+    feed_stream *fs = calloc(1, sizeof(feed_stream));
+    if (!fs) return NULL;
+    fs->builder = sigdb_builder_new();
+    if (!fs->builder) {
+        free(fs);
+        return NULL;
+    }
+    fs->copy = copy;
+    return fs;
+}
+
+int feed_stream_write(feed_stream *fs, const unsigned char *buf, size_t len) {
+    if (fs->state == FEED_FAILED) return -1;
+    fs->stats.bytes_in += len;
+    while (len > 0 && fs->state != FEED_FAILED) {
+        long used = 0;
+        switch (fs->state) {
+        case FEED_DETECT: {
+            size_t n = MIN(len, sizeof(fs->head) - fs->head_len);
+            memcpy(fs->head + fs->head_len, buf, n);
+            fs->head_len += n;
+            used = (long)n;
+            if (fs->head_len >= 4 && rd32(fs->head) != FEED_ZIP_SIG) {
+                fs->state = FEED_PLAIN;
+                if (feed_emit(fs, fs->head, fs->head_len) != 0) used = -1;
+            } else if (fs->head_len == sizeof(fs->head)) {
+                fs->state = FEED_MEMBER;
+                if (feed_open_member(fs) != 0) used = -1;
+            }
+            break;
+        }
+        case FEED_PLAIN:
+            used = feed_emit(fs, buf, len) == 0 ? (long)len : -1;
+            break;
+        case FEED_MEMBER:
+            used = feed_member(fs, buf, len);
+            break;
+        default:
+            used = (long)len;     // FEED_DONE: trailing directory records
+            break;
+        }
+        if (used < 0) {
+            fs->state = FEED_FAILED;
+            break;
+        }
+        buf += used;
+        len -= (size_t)used;
+    }
+    return fs->state == FEED_FAILED ? -1 : 0;
+}
+
+int feed_stream_finish(feed_stream *fs, sig_db *db, sig_load_report *report, FeedStreamStats *stats) {
+    // A plain feed shorter than the ZIP signature is still a feed
+    if (fs->state == FEED_DETECT && fs->head_len < 4) {
+        fs->state = (feed_emit(fs, fs->head, fs->head_len) == 0) ? FEED_PLAIN : FEED_FAILED;
+    }
+    gboolean complete = (fs->state == FEED_PLAIN || fs->state == FEED_DONE);
+    if (stats) *stats = fs->stats;
+    sig_builder *b = fs->builder;
+    fs->builder = NULL;
+    feed_stream_free(fs);
+    if (!complete) {
+        sigdb_builder_free(b);
+        return -1;
+    }
+    return sigdb_builder_finish(b, db, report);
+}
+
+void feed_stream_free(feed_stream *fs) {
+    if (!fs) return;
+    if (fs->z_ready) inflateEnd(&fs->z);
+    sigdb_builder_free(fs->builder);
+    free(fs);
+}
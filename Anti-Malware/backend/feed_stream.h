@@ -0,0 +1,27 @@
+#ifndef FEED_STREAM_H
+#define FEED_STREAM_H
+#include <stdio.h>
+#include "sig_db.h"
+/* Turns a signature feed into a sig_db while it is still downloading. The feed
+ * is either plain text or a ZIP whose first member is the text (the
+ * MalwareBazaar export). That member is inflated in memory and parsed as it
+ * arrives; nothing is extracted to disk. The only file written is the
+ * optional text copy that becomes the new signatures.db. */
+
+typedef struct feed_stream feed_stream;
+
+typedef struct {
+    guint64 bytes_in;           // As received
+    guint64 bytes_out;          // Feed text after inflate
+} FeedStreamStats;
+
+// copy may be NULL; otherwise the expanded text is written to it as it arrives
+feed_stream *feed_stream_new(FILE *copy);
+// Pieces may be split anywhere. -1 on a corrupt or unsupported archive, a failed
+// copy write or out of memory; later writes are then ignored.
+int feed_stream_write(feed_stream *fs, const unsigned char *buf, size_t len);
+// Sorts and returns the index, then frees fs. -1 if the stream was truncated or failed.
+int feed_stream_finish(feed_stream *fs, sig_db *db, sig_load_report *report, FeedStreamStats *stats);
+void feed_stream_free(feed_stream *fs);
+
+#endif
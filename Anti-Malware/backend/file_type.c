@@ -0,0 +1,150 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "file_type.h"
+#include <string.h>
+
+static const char *type_names[FTYPE_COUNT] = {
+    "Unknown", "PE", "ELF", "Mach-O", "Script", "ZIP", "Archive", "Office", "PDF", "Media", "Text", "Installer",
+};
+
+// Extensions Windows and the usual interpreters run as scripts
+static const char *script_exts[] = {
+    ".ps1", ".psm1", ".bat", ".cmd", ".vbs", ".vbe", ".js", ".jse", ".wsf", ".wsh", ".hta",
+    ".sh", ".py", ".pl", ".rb", ".php", NULL,
+};
+
+// OLE2 compound files that msiexec runs
+static const char *installer_exts[] = { ".msi", ".msp", ".msm", NULL };
+
+// --- Helpers ---
+static gboolean has_prefix(const unsigned char *head, size_t len, size_t at, const void *magic, size_t n) {
+    return len >= at + n && memcmp(head + at, magic, n) == 0;
+}
+#define HAS(at, lit) has_prefix(head, len, (at), (lit), sizeof(lit) - 1)
+
+static guint32 be32(const unsigned char *p) {
+    return ((guint32)p[0] << 24) | ((guint32)p[1] << 16) | ((guint32)p[2] << 8) | (guint32)p[3];
+}
+
+// No NUL and almost nothing below 0x20 but whitespace; UTF-8 passes
+static gboolean looks_textual(const unsigned char *head, size_t len) {
+    if (len == 0) return FALSE;
+    size_t odd = 0;
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = head[i];
+        if (c == 0) return FALSE;
+        if (c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != 0x1B) odd++;
+    }
+    return odd * 32 <= len;
+}
+
+// UTF-16 text, as Notepad ("Unicode") and PowerShell's redirection write it: a
+// BOM, or with `guess` mostly ASCII in little-endian units. No NUL unit.
+static gboolean looks_utf16(const unsigned char *head, size_t len, gboolean guess) {
+    gboolean bom = HAS(0, "\xFF\xFE") || HAS(0, "\xFE\xFF");
+    gboolean be = HAS(0, "\xFE\xFF");
+    if (!bom && !guess) return FALSE;
+    size_t units = 0, odd = 0, ascii = 0;
+    for (size_t i = bom ? 2 : 0; i + 1 < len; i += 2) {
+        unsigned c = be ? ((unsigned)head[i] << 8 | head[i + 1]) : (head[i] | (unsigned)head[i + 1] << 8);
+        if (c == 0) return FALSE;
+        units++;
+        if (c < 0x80) ascii++;
+        if (c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != 0x1B) odd++;
+    }
+    if (odd * 32 > units) return FALSE;
+    // Without a BOM, binary data could pass on a short head: most units must be ASCII
+    return bom || (units > 0 && ascii * 4 >= units * 3);
+}
+
+static gboolean has_ext(const char *path, const char *const *exts) {
+    const char *dot = path ? strrchr(path, '.') : NULL;
+    if (!dot || strpbrk(dot, "/\\")) return FALSE;
+    for (int i = 0; exts[i]; ++i)
+        if (g_ascii_strcasecmp(dot, exts[i]) == 0) return TRUE;
+    return FALSE;
+}
+
+// OOXML and ODF are ZIPs; their first member gives them away
+static FileType classify_zip(const unsigned char *head, size_t len) {
+    if (len < 30) return FTYPE_ZIP;
+    size_t name_len = head[26] | ((size_t)head[27] << 8);
+    const unsigned char *name = head + 30;
+    if (30 + name_len > len) return FTYPE_ZIP;
+    static const char *office_members[] = { "[Content_Types].xml", "_rels/", "docProps/", "word/", "xl/", "ppt/", NULL };
+    for (int i = 0; office_members[i]; ++i) {
+        size_t n = strlen(office_members[i]);
+        if (name_len >= n && memcmp(name, office_members[i], n) == 0) return FTYPE_OFFICE;
+    }
+    // ODF: an uncompressed "mimetype" member holding application/vnd.oasis.opendocument.*
+    if (name_len == 8 && memcmp(name, "mimetype", 8) == 0 &&
+        has_prefix(head, len, 30 + 8 + (head[28] | ((size_t)head[29] << 8)), "application/vnd.oasis", 21))
+        return FTYPE_OFFICE;
+    return FTYPE_ZIP;
+}
+
+// --- Classification ---
+FileType file_type_classify(const unsigned char *head, size_t len, const char *path) {
+    if (len < 2) return len && looks_textual(head, len) ? FTYPE_TEXT : FTYPE_UNKNOWN;
+
+    // Executables
+    if (HAS(0, "MZ")) return FTYPE_PE;     // PE, or a DOS executable: either runs
+    if (HAS(0, "\x7F" "ELF")) return FTYPE_ELF;
+    if (len >= 8) {
+        guint32 m = be32(head);
+        if (m == 0xFEEDFACEu || m == 0xFEEDFACFu || m == 0xCEFAEDFEu || m == 0xCFFAEDFEu) return FTYPE_MACHO;
+        // 0xCAFEBABE is also a Java class file; fat binaries hold a handful of slices
+        if (m == 0xCAFEBABEu && be32(head + 4) < 32) return FTYPE_MACHO;
+    }
+    if (HAS(0, "#!")) return FTYPE_SCRIPT;
+
+    // Containers
+    if (HAS(0, "PK\x03\x04")) return classify_zip(head, len);
+    if (HAS(0, "\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1")) {
+        // The MSI root CLSID sits in the directory sector, past the head
+        return has_ext(path, installer_exts) ? FTYPE_INSTALLER : FTYPE_OFFICE;
+    }
+    if (HAS(0, "{\\rtf")) return FTYPE_OFFICE;
+    if (HAS(0, "\x1F\x8B") || HAS(0, "7z\xBC\xAF\x27\x1C") || HAS(0, "Rar!\x1A\x07") ||
+        HAS(0, "BZh") || HAS(0, "\xFD" "7zXZ\0") || HAS(0, "\x28\xB5\x2F\xFD") ||
+        HAS(0, "MSCF") || HAS(257, "ustar"))
+        return FTYPE_ARCHIVE;
+    if (HAS(0, "%PDF-")) return FTYPE_PDF;
+
+    // Media
+    if (HAS(0, "\x89PNG") || HAS(0, "\xFF\xD8\xFF") || HAS(0, "GIF8") || HAS(0, "II*\0") ||
+        HAS(0, "MM\0*") || HAS(0, "ID3") || HAS(0, "OggS") || HAS(0, "fLaC") ||
+        HAS(0, "\x1A\x45\xDF\xA3") || HAS(4, "ftyp") ||
+        (HAS(0, "RIFF") && (HAS(8, "WAVE") || HAS(8, "AVI ") || HAS(8, "WEBP"))) ||
+        (head[0] == 0xFF && (head[1] & 0xF6) == 0xF2))    // MP3 frame without an ID3 tag
+        return FTYPE_MEDIA;
+
+    // Text: scripts carry no magic, so the extension decides
+    if (HAS(0, "<?php")) return FTYPE_SCRIPT;
+    gboolean script = has_ext(path, script_exts);
+    // UTF-16 has a NUL in every ASCII unit: a BOM or a script extension lets it through
+    if (looks_textual(head, len) || looks_utf16(head, len, script)) return script ? FTYPE_SCRIPT : FTYPE_TEXT;
+    return FTYPE_UNKNOWN;
+}
+
+const char *file_type_name(FileType t) {
+    return (t < FTYPE_COUNT) ? type_names[t] : type_names[FTYPE_UNKNOWN];
+}
+
+// --- Cost ---
+void file_type_cost_add(FileTypeCost *dst, const FileTypeCost *src) {
+    for (int t = 0; t < FTYPE_COUNT; ++t) {
+        dst->files[t] += src->files[t];
+        dst->bytes[t] += src->bytes[t];
+        dst->ns[t] += src->ns[t];
+    }
+}
+
+void file_type_cost_print(FILE *out, const FileTypeCost *cost) {
+    fprintf(out, "By file type:\n");
+    for (int t = 0; t < FTYPE_COUNT; ++t) {
+        if (cost->files[t] == 0) continue;
+        fprintf(out, "  %-8s %7llu files %9.1f MB %8.3f s\n", type_names[t],
+                (unsigned long long)cost->files[t], (double)cost->bytes[t] / (1024.0 * 1024.0),
+                (double)cost->ns[t] / 1e9);
+    }
+}
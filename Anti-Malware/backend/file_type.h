@@ -0,0 +1,44 @@
+#ifndef FILE_TYPE_H
+#define FILE_TYPE_H
+#include <glib.h>
+#include <stdio.h>
+/* File type from the first bytes of the first buffer read for hashing (plus the
+ * extension for text formats without magic), so classifying costs no syscall.
+ * The type decides which engines a file goes through. */
+
+typedef enum {
+    FTYPE_UNKNOWN = 0,
+    FTYPE_PE,                   // MZ / PE executables and DLLs
+    FTYPE_ELF,
+    FTYPE_MACHO,                // Thin and fat
+    FTYPE_SCRIPT,               // Shebang, or a script extension on a text file (UTF-8 or UTF-16)
+    FTYPE_ZIP,
+    FTYPE_ARCHIVE,              // gzip, 7z, RAR, bzip2, xz, zstd, CAB, tar
+    FTYPE_OFFICE,               // OLE2, OOXML / ODF (ZIP underneath), RTF
+    FTYPE_PDF,
+    FTYPE_MEDIA,                // Images, audio, video
+    FTYPE_TEXT,
+    FTYPE_INSTALLER,            // Windows Installer (OLE2 .msi, .msp, .msm): runs like an executable
+    FTYPE_COUNT
+} FileType;                     // Numbers are stored in the seen index: append only
+
+#define FTYPE_BIT(t)        (1u << (t))
+#define FTYPE_EXECUTABLE    (FTYPE_BIT(FTYPE_PE) | FTYPE_BIT(FTYPE_ELF) | FTYPE_BIT(FTYPE_MACHO))
+#define FTYPE_ALL           (FTYPE_BIT(FTYPE_COUNT) - 1)
+#define FTYPE_HEAD          512 // Bytes the classifier looks at (tar magic sits at 257)
+
+// Time and bytes per type, so a slow class of files shows up after a scan
+typedef struct {
+    guint64 files[FTYPE_COUNT];
+    guint64 bytes[FTYPE_COUNT];
+    guint64 ns[FTYPE_COUNT];
+} FileTypeCost;
+
+// `path` only breaks ties (script and installer extensions); may be NULL
+FileType file_type_classify(const unsigned char *head, size_t len, const char *path);
+const char *file_type_name(FileType t);
+
+void file_type_cost_add(FileTypeCost *dst, const FileTypeCost *src);
+void file_type_cost_print(FILE *out, const FileTypeCost *cost);
+
+#endif
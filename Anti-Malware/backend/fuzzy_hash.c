@@ -0,0 +1,372 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "fuzzy_hash.h"
+#include "multi_hash.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZY_KEYS (1u << (2 * FUZZY_KEY_BUCKETS))
+#define FUZZY_PREFETCH 8        // Candidates fetched ahead of the one being compared
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PREFETCH(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#else
+#define PREFETCH(p) ((void)0)
+#endif
+
+// Pearson permutation shared by every TLSH implementation
+static const guint8 pearson[256] = {
+    1, 87, 49, 12, 176, 178, 102, 166, 121, 193, 6, 84, 249, 230, 44, 163,
+    14, 197, 213, 181, 161, 85, 218, 80, 64, 239, 24, 226, 236, 142, 38, 200,
+    110, 177, 104, 103, 141, 253, 255, 50, 77, 101, 81, 18, 45, 96, 31, 222,
+    25, 107, 190, 70, 86, 237, 240, 34, 72, 242, 20, 214, 244, 227, 149, 235,
+    97, 234, 57, 22, 60, 250, 82, 175, 208, 5, 127, 199, 111, 62, 135, 248,
+    174, 169, 211, 58, 66, 154, 106, 195, 245, 171, 17, 187, 182, 179, 0, 243,
+    132, 56, 148, 75, 128, 133, 158, 100, 130, 126, 91, 13, 153, 246, 216, 219,
+    119, 68, 223, 78, 83, 88, 201, 99, 122, 11, 92, 32, 136, 114, 52, 10,
+    138, 30, 48, 183, 156, 35, 61, 26, 143, 74, 251, 94, 129, 162, 63, 152,
+    170, 7, 115, 167, 241, 206, 3, 150, 55, 59, 151, 220, 90, 53, 23, 131,
+    125, 173, 15, 238, 79, 95, 89, 16, 105, 137, 225, 224, 217, 160, 37, 123,
+    118, 73, 2, 157, 46, 116, 9, 145, 134, 228, 207, 212, 202, 215, 69, 229,
+    27, 188, 67, 124, 168, 252, 42, 4, 29, 108, 21, 247, 19, 205, 39, 203,
+    233, 40, 186, 147, 198, 192, 155, 33, 164, 191, 98, 204, 165, 180, 117, 76,
+    140, 36, 210, 172, 41, 54, 159, 8, 185, 232, 113, 196, 231, 47, 146, 120,
+    51, 65, 28, 144, 254, 221, 93, 189, 194, 139, 112, 43, 71, 109, 184, 209,
+};
+
+static guint32 mix[256];                                        // pearson widened: no byte extends in the loop
+static guint8 body_diff[256][256];                              // Four bucket codes per byte
+static guint8 key_buckets[FUZZY_TABLES][FUZZY_KEY_BUCKETS];     // Disjoint across tables
+
+// --- Setup ---
+void fuzzy_init(void) {
+    if (body_diff[0][3] == 6) return;
+    for (int i = 0; i < 256; ++i) mix[i] = pearson[i];
+    for (int x = 0; x < 256; ++x) {
+        for (int y = 0; y < 256; ++y) {
+            int diff = 0;
+            for (int j = 0; j < 4; ++j) {
+                int d = abs(((x >> (2 * j)) & 3) - ((y >> (2 * j)) & 3));
+                diff += (d == 3) ? 6 : d;   // Opposite quartiles weigh double
+            }
+            body_diff[x][y] = (guint8)diff;
+        }
+    }
+    // Fixed shuffle, so every build keys the same buckets
+    guint8 order[FUZZY_BUCKETS];
+    for (int i = 0; i < FUZZY_BUCKETS; ++i) order[i] = (guint8)i;
+    guint32 rng = 0x9E3779B9u;
+    for (int i = FUZZY_BUCKETS - 1; i > 0; --i) {
+        rng = rng * 1664525u + 1013904223u;
+        int j = (int)((rng >> 8) % (guint32)(i + 1));
+        guint8 t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for (int t = 0; t < FUZZY_TABLES; ++t)
+        for (int k = 0; k < FUZZY_KEY_BUCKETS; ++k)
+            key_buckets[t][k] = order[(t * FUZZY_KEY_BUCKETS + k) % FUZZY_BUCKETS];
+}
+
+// --- Digest ---
+void fuzzy_state_init(fuzzy_state *s) {
+    memset(s, 0, sizeof(*s));
+}
+
+// Pearson hash of (salt, a, b, c); the salt step is folded into the caller's constant
+#define MIX(h0, a, b, c) mix[mix[mix[(h0) ^ (a)] ^ (b)] ^ (c)]
+
+// Six byte triplets of each 5-byte window land in the buckets
+void fuzzy_update(fuzzy_state *s, const unsigned char *buf, size_t len) {
+    guint32 w1 = s->window[0], w2 = s->window[1], w3 = s->window[2], w4 = s->window[3];
+    guint32 checksum = s->checksum;
+    size_t i = 0;
+    // The first four bytes only fill the window
+    for (; i < len && s->len + i < 4; ++i) {
+        w4 = w3;
+        w3 = w2;
+        w2 = w1;
+        w1 = buf[i];
+    }
+    guint32 *b = s->buckets;
+    for (; i < len; ++i) {
+        guint32 c = buf[i];
+        checksum = MIX(pearson[0], c, w1, checksum);
+        b[MIX(pearson[2], c, w1, w2)]++;
+        b[MIX(pearson[3], c, w1, w3)]++;
+        b[MIX(pearson[5], c, w2, w3)]++;
+        b[MIX(pearson[7], c, w2, w4)]++;
+        b[MIX(pearson[11], c, w1, w4)]++;
+        b[MIX(pearson[13], c, w3, w4)]++;
+        w4 = w3;
+        w3 = w2;
+        w2 = w1;
+        w1 = c;
+    }
+    s->window[0] = (guint8)w1;
+    s->window[1] = (guint8)w2;
+    s->window[2] = (guint8)w3;
+    s->window[3] = (guint8)w4;
+    s->checksum = (guint8)checksum;
+    s->len += len;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    guint32 x = *(const guint32 *)a, y = *(const guint32 *)b;
+    return (x > y) - (x < y);
+}
+
+// Length on a log scale: fine steps for small inputs, coarse for large ones
+static guint8 length_code(guint64 len) {
+    double l = log((double)MIN(len, (guint64)G_MAXUINT32));
+    int i;
+    if (len <= 656) i = (int)floor(l / 0.4054651);
+    else if (len <= 3199) i = (int)floor(l / 0.26236426 - 8.72777);
+    else i = (int)floor(l / 0.095310180 - 62.5472);
+    return (guint8)(i & 0xFF);
+}
+
+int fuzzy_final(const fuzzy_state *s, FuzzyDigest *out) {
+    memset(out, 0, sizeof(*out));
+    if (s->len < FUZZY_MIN_LEN) return -1;
+    guint32 sorted[FUZZY_BUCKETS];
+    int nonzero = 0;
+    for (int i = 0; i < FUZZY_BUCKETS; ++i) {
+        sorted[i] = s->buckets[i];
+        if (sorted[i]) nonzero++;
+    }
+    // Half the buckets empty: too little variety to compare
+    if (nonzero <= FUZZY_BUCKETS / 2) return -1;
+    qsort(sorted, FUZZY_BUCKETS, sizeof(guint32), cmp_u32);
+    guint32 q1 = sorted[FUZZY_BUCKETS / 4 - 1], q2 = sorted[FUZZY_BUCKETS / 2 - 1], q3 = sorted[3 * FUZZY_BUCKETS / 4 - 1];
+    if (q3 == 0) return -1;
+    for (int i = 0; i < FUZZY_CODE_SIZE; ++i) {
+        guint8 h = 0;
+        for (int j = 0; j < 4; ++j) {
+            guint32 k = s->buckets[4 * i + j];
+            if (k > q3) h |= (guint8)(3 << (2 * j));
+            else if (k > q2) h |= (guint8)(2 << (2 * j));
+            else if (k > q1) h |= (guint8)(1 << (2 * j));
+        }
+        out->code[i] = h;
+    }
+    out->checksum = s->checksum;
+    out->lvalue = length_code(s->len);
+    out->q1ratio = (guint8)((guint32)((float)((guint64)q1 * 100) / (float)q3) % 16);
+    out->q2ratio = (guint8)((guint32)((float)((guint64)q2 * 100) / (float)q3) % 16);
+    return 0;
+}
+
+// --- Text Form ---
+static guint8 swap_nibbles(guint8 x) {
+    return (guint8)((x << 4) | (x >> 4));
+}
+
+void fuzzy_to_hex(const FuzzyDigest *d, char *buf) {
+    static const char digits[] = "0123456789ABCDEF";
+    guint8 raw[3 + FUZZY_CODE_SIZE];
+    raw[0] = swap_nibbles(d->checksum);
+    raw[1] = swap_nibbles(d->lvalue);
+    raw[2] = (guint8)((d->q1ratio << 4) | d->q2ratio);
+    for (int i = 0; i < FUZZY_CODE_SIZE; ++i) raw[3 + i] = d->code[FUZZY_CODE_SIZE - 1 - i];
+    buf[0] = 'T';
+    buf[1] = '1';
+    for (size_t i = 0; i < sizeof(raw); ++i) {
+        buf[2 + 2 * i] = digits[raw[i] >> 4];
+        buf[3 + 2 * i] = digits[raw[i] & 15];
+    }
+    buf[2 + 2 * sizeof(raw)] = 0;
+}
+
+int fuzzy_from_hex(const char *hex, FuzzyDigest *out) {
+    if ((hex[0] == 'T' || hex[0] == 't') && hex[1] == '1') hex += 2;
+    if (strlen(hex) != FUZZY_HEX_LEN) return -1;
+    guint8 raw[3 + FUZZY_CODE_SIZE];
+    for (size_t i = 0; i < sizeof(raw); ++i) {
+        int hi = g_ascii_xdigit_value(hex[2 * i]), lo = g_ascii_xdigit_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return -1;
+        raw[i] = (guint8)((hi << 4) | lo);
+    }
+    out->checksum = swap_nibbles(raw[0]);
+    out->lvalue = swap_nibbles(raw[1]);
+    out->q1ratio = raw[2] >> 4;
+    out->q2ratio = raw[2] & 15;
+    for (int i = 0; i < FUZZY_CODE_SIZE; ++i) out->code[FUZZY_CODE_SIZE - 1 - i] = raw[3 + i];
+    return 0;
+}
+
+// --- Distance ---
+// Distance on a ring of `range` values
+static int ring_diff(int x, int y, int range) {
+    int d = abs(x - y);
+    return MIN(d, range - d);
+}
+
+static int header_distance(const FuzzyDigest *a, const FuzzyDigest *b) {
+    int diff = 0;
+    int ldiff = ring_diff(a->lvalue, b->lvalue, 256);
+    diff += (ldiff <= 1) ? ldiff : ldiff * 12;
+    int q1diff = ring_diff(a->q1ratio, b->q1ratio, 16);
+    diff += (q1diff <= 1) ? q1diff : (q1diff - 1) * 12;
+    int q2diff = ring_diff(a->q2ratio, b->q2ratio, 16);
+    diff += (q2diff <= 1) ? q2diff : (q2diff - 1) * 12;
+    if (a->checksum != b->checksum) diff++;
+    return diff;
+}
+
+int fuzzy_distance(const FuzzyDigest *a, const FuzzyDigest *b) {
+    int diff = header_distance(a, b);
+    for (int i = 0; i < FUZZY_CODE_SIZE; ++i) diff += body_diff[a->code[i]][b->code[i]];
+    return diff;
+}
+
+// --- Reference Index ---
+struct fuzzy_db {
+    GArray *refs;               // FuzzyDigest
+    GArray *label_at;           // guint32 offsets into labels, parallel to refs
+    GString *labels;            // NUL separated
+    guint32 *offsets;           // [FUZZY_TABLES][FUZZY_KEYS + 1], NULL when scanned linearly
+    guint32 *ids;               // [FUZZY_TABLES][n], grouped by key
+};
+
+static guint32 table_key(const FuzzyDigest *d, int table) {
+    guint32 key = 0;
+    for (int k = 0; k < FUZZY_KEY_BUCKETS; ++k) {
+        int b = key_buckets[table][k];
+        key = (key << 2) | ((d->code[b >> 2] >> (2 * (b & 3))) & 3u);
+    }
+    return key;
+}
+
+fuzzy_db *fuzzy_db_new(void) {
+    fuzzy_init();
+    fuzzy_db *db = g_new0(fuzzy_db, 1);
+    db->refs = g_array_new(FALSE, FALSE, sizeof(FuzzyDigest));
+    db->label_at = g_array_new(FALSE, FALSE, sizeof(guint32));
+    db->labels = g_string_new(NULL);
+    return db;
+}
+
+int fuzzy_db_add(fuzzy_db *db, const char *name, const FuzzyDigest *d) {
+    if (db->offsets || db->refs->len >= G_MAXUINT32 - 1) return -1;
+    guint32 at = (guint32)db->labels->len;
+    g_string_append_len(db->labels, name, (gssize)strlen(name) + 1);
+    g_array_append_val(db->label_at, at);
+    g_array_append_vals(db->refs, d, 1);
+    return 0;
+}
+
+// Counting sort of the reference ids by key, per table
+void fuzzy_db_compile(fuzzy_db *db) {
+    guint32 n = db->refs->len;
+    if (db->offsets || n <= FUZZY_LINEAR_MAX) return;
+    const FuzzyDigest *refs = (const FuzzyDigest *)db->refs->data;
+    db->offsets = g_new0(guint32, (gsize)FUZZY_TABLES * (FUZZY_KEYS + 1));
+    db->ids = g_new(guint32, (gsize)FUZZY_TABLES * n);
+    for (int t = 0; t < FUZZY_TABLES; ++t) {
+        guint32 *off = db->offsets + (gsize)t * (FUZZY_KEYS + 1);
+        guint32 *ids = db->ids + (gsize)t * n;
+        for (guint32 i = 0; i < n; ++i) off[table_key(&refs[i], t) + 1]++;
+        for (guint32 k = 0; k < FUZZY_KEYS; ++k) off[k + 1] += off[k];
+        for (guint32 i = 0; i < n; ++i) ids[off[table_key(&refs[i], t)]++] = i;
+        // The fill advanced each start to the next key's; shift back
+        memmove(off + 1, off, FUZZY_KEYS * sizeof(guint32));
+        off[0] = 0;
+    }
+}
+
+fuzzy_db *fuzzy_db_load(const char *path, int *bad_lines) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    fuzzy_db *db = fuzzy_db_new();
+    int bad = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == 0 || line[0] == '#') continue;
+        char *hex = strrchr(line, ':');
+        FuzzyDigest d;
+        if (!hex || hex == line || fuzzy_from_hex(hex + 1, &d) != 0) {
+            bad++;
+            continue;
+        }
+        *hex = 0;
+        fuzzy_db_add(db, line, &d);
+    }
+    fclose(f);
+    fuzzy_db_compile(db);
+    if (bad_lines) *bad_lines = bad;
+    return db;
+}
+
+void fuzzy_db_free(fuzzy_db *db) {
+    if (!db) return;
+    g_array_free(db->refs, TRUE);
+    g_array_free(db->label_at, TRUE);
+    g_string_free(db->labels, TRUE);
+    g_free(db->offsets);
+    g_free(db->ids);
+    g_free(db);
+}
+
+size_t fuzzy_db_count(const fuzzy_db *db) {
+    return db ? db->refs->len : 0;
+}
+
+size_t fuzzy_db_bytes(const fuzzy_db *db) {
+    if (!db) return 0;
+    size_t n = sizeof(*db) + db->refs->len * (sizeof(FuzzyDigest) + sizeof(guint32)) + db->labels->allocated_len;
+    if (db->offsets) n += (size_t)FUZZY_TABLES * ((FUZZY_KEYS + 1) + db->refs->len) * sizeof(guint32);
+    return n;
+}
+
+// Body distance is only summed for candidates whose header is already close enough
+static void consider(const fuzzy_db *db, const FuzzyDigest *d, guint32 id, int *best, guint32 *best_id,
+                     guint64 *compared) {
+    const FuzzyDigest *ref = &g_array_index(db->refs, FuzzyDigest, id);
+    int diff = header_distance(d, ref);
+    (*compared)++;
+    if (diff > *best) return;
+    for (int i = 0; i < FUZZY_CODE_SIZE && diff <= *best; ++i) diff += body_diff[d->code[i]][ref->code[i]];
+    if (diff < *best || (diff == *best && id < *best_id)) {
+        *best = diff;
+        *best_id = id;
+    }
+}
+
+const char *fuzzy_db_query(const fuzzy_db *db, const FuzzyDigest *d, int max_distance,
+                           int *distance, FuzzyQueryStats *stats) {
+    if (!db || db->refs->len == 0) return NULL;
+    guint64 t0 = stats ? hash_clock_ns() : 0;
+    int best = max_distance;
+    guint32 best_id = G_MAXUINT32;
+    guint64 compared = 0;
+    guint32 n = db->refs->len;
+    const FuzzyDigest *refs = (const FuzzyDigest *)db->refs->data;
+    if (!db->offsets) {
+        for (guint32 i = 0; i < n; ++i) consider(db, d, i, &best, &best_id, &compared);
+    } else {
+        // A reference sharing keys in several tables is compared again; cheaper than tracking it.
+        // Each candidate is a cache miss, so the ones a few slots ahead are fetched early.
+        for (int t = 0; t < FUZZY_TABLES; ++t) {
+            const guint32 *off = db->offsets + (gsize)t * (FUZZY_KEYS + 1);
+            const guint32 *ids = db->ids + (gsize)t * n;
+            guint32 key = table_key(d, t);
+            guint32 end = off[key + 1];
+            for (guint32 k = off[key]; k < end; ++k) {
+                if (k + FUZZY_PREFETCH < end) PREFETCH(&refs[ids[k + FUZZY_PREFETCH]]);
+                consider(db, d, ids[k], &best, &best_id, &compared);
+            }
+        }
+    }
+    if (stats) {
+        stats->queries++;
+        stats->candidates += compared;
+        stats->ns += hash_clock_ns() - t0;
+    }
+    if (best_id == G_MAXUINT32) return NULL;
+    if (distance) *distance = best;
+    return db->labels->str + g_array_index(db->label_at, guint32, best_id);
+}
@@ -0,0 +1,79 @@
+#ifndef FUZZY_HASH_H
+#define FUZZY_HASH_H
+#include <glib.h>
+#include <stddef.h>
+/* Similarity digests (TLSH layout: 128 buckets, 1-byte checksum) computed on
+ * the hashing read, and an index of known-malware digests searched by
+ * distance. Exact hashes miss a sample once a byte changes; these still match
+ * a recompiled or patched variant.
+ *
+ * fuzzy_sigs.db, one reference per line ('#' comments):
+ *     Family.Name:T1<70 hex digits>
+ *
+ * The index is locality-sensitive: FUZZY_TABLES tables, each keyed on the
+ * codes of FUZZY_KEY_BUCKETS fixed buckets. Digests that agree on most
+ * buckets share a key in at least one table with high probability, so a query
+ * compares against a few thousand candidates instead of every reference. */
+
+#define FUZZY_BUCKETS       128
+#define FUZZY_CODE_SIZE     (FUZZY_BUCKETS / 4)
+#define FUZZY_HEX_LEN       (2 + 2 + 2 + 2 * FUZZY_CODE_SIZE)   // Without the "T1" prefix
+#define FUZZY_MIN_LEN       50                                  // Shorter inputs have no digest
+#define FUZZY_DEFAULT_THRESHOLD 40      // Distance; 0 identical, < 30 near-certain, > 100 unrelated
+#define FUZZY_TABLES        16
+#define FUZZY_KEY_BUCKETS   8           // 16-bit keys
+#define FUZZY_LINEAR_MAX    4096        // Smaller indexes are scanned in full (exact)
+
+typedef struct {
+    guint8 checksum;
+    guint8 lvalue;                      // Log-scaled length
+    guint8 q1ratio, q2ratio;            // Quartile ratios, 4 bits each
+    guint8 code[FUZZY_CODE_SIZE];       // Bucket 4i+j in bits 2j..2j+1 of code[i]
+} FuzzyDigest;
+
+// Streaming state; lives on the worker's stack (~1 KB)
+typedef struct {
+    guint32 buckets[256];
+    guint8 window[4];                   // Previous bytes, most recent first
+    guint8 checksum;
+    guint64 len;
+} fuzzy_state;
+
+// Fills the lookup tables; call once before the workers start
+void fuzzy_init(void);
+
+void fuzzy_state_init(fuzzy_state *s);
+void fuzzy_update(fuzzy_state *s, const unsigned char *buf, size_t len);
+// -1 if the input was too short or too uniform to have a digest
+int fuzzy_final(const fuzzy_state *s, FuzzyDigest *out);
+
+// "T1" + FUZZY_HEX_LEN hex digits; buf needs FUZZY_HEX_LEN + 3 bytes
+void fuzzy_to_hex(const FuzzyDigest *d, char *buf);
+// Accepts the digits with or without the "T1" prefix
+int fuzzy_from_hex(const char *hex, FuzzyDigest *out);
+int fuzzy_distance(const FuzzyDigest *a, const FuzzyDigest *b);
+
+// --- Reference index ---
+typedef struct fuzzy_db fuzzy_db;
+
+typedef struct {
+    guint64 queries;
+    guint64 candidates;                 // Distances computed
+    guint64 ns;
+} FuzzyQueryStats;
+
+fuzzy_db *fuzzy_db_new(void);
+int fuzzy_db_add(fuzzy_db *db, const char *name, const FuzzyDigest *d);
+// Builds the LSH tables; no more fuzzy_db_add afterwards
+void fuzzy_db_compile(fuzzy_db *db);
+// Reads and compiles a reference file. NULL if it cannot be opened.
+fuzzy_db *fuzzy_db_load(const char *path, int *bad_lines);
+void fuzzy_db_free(fuzzy_db *db);
+size_t fuzzy_db_count(const fuzzy_db *db);
+// Allocated for references, labels and the LSH tables (an estimate, for the memory budget)
+size_t fuzzy_db_bytes(const fuzzy_db *db);
+// Label of the closest reference within max_distance, NULL if none. stats may be NULL.
+const char *fuzzy_db_query(const fuzzy_db *db, const FuzzyDigest *d, int max_distance,
+                           int *distance, FuzzyQueryStats *stats);
+
+#endif
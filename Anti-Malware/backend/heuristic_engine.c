@@ -0,0 +1,318 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "heuristic_engine.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HEUR_SSE2 1
+#endif
+
+#define HEUR_PACKER_SCAN 4096   // Section tables sit in the first page
+#define HEUR_MIN_BYTES   HEUR_BLOCK // Entropy of less says nothing
+#define HEUR_DENSE_TEXT  5.8    // Source code and prose stay under ~5.3 bits per byte
+#define HEUR_FEW_IMPORTS 4
+
+// Section names (PE) and stub magic (UPX on ELF) left behind by common packers
+static const char *packer_names[] = {
+    "UPX0", "UPX1", "UPX!", ".aspack", ".adata", "MPRESS1", "MPRESS2", ".petite", "PEC2TO",
+    ".nsp0", ".nsp1", ".themida", ".vmp0", ".vmp1", ".enigma1", ".MPRESS", "kkrunchy", NULL,
+};
+
+// Decode-and-run idioms, matched case-insensitively (lower case here). A keyword
+// split across two read buffers is missed; scripts rarely fill one.
+static const char *script_keywords[] = {
+    "frombase64string", "-encodedcommand", "invoke-expression", "downloadstring", "downloadfile(",
+    "string.fromcharcode", "unescape(", "eval(", "wscript.shell", "base64_decode(", "gzinflate(",
+    "certutil -decode", "iex(", "[char[]]", NULL,
+};
+
+static float entropy_terms[HEUR_WINDOW + 1];   // c * log2(c)
+static guint32 base64_mask[256];               // All ones for base64 characters
+static gboolean keyword_first[256];
+static guint32 keyword_heads[32];              // First four characters, case bit set
+static size_t keyword_lens[32];
+#ifdef HEUR_SSE2
+// Distinct first two characters of the keywords, case bit set: a keyword can
+// only start where both match
+static int n_bigrams;
+static __m128i bigram_first[16], bigram_second[16];
+#endif
+
+// Four characters with the case bit set; keywords are at least that long
+static guint32 heur_head(const unsigned char *p) {
+    return (((guint32)p[0] << 24) | ((guint32)p[1] << 16) | ((guint32)p[2] << 8) | p[3]) | 0x20202020u;
+}
+
+// --- Setup ---
+void heuristic_init(void) {
+    if (entropy_terms[2] == 2.0f) return;
+    entropy_terms[0] = 0.0f;
+    for (int c = 1; c <= HEUR_WINDOW; ++c) entropy_terms[c] = (float)(c * log2((double)c));
+    for (int c = 0; c < 256; ++c) {
+        base64_mask[c] = (g_ascii_isalnum(c) || c == '+' || c == '/' || c == '=') ? G_MAXUINT32 : 0;
+    }
+#ifdef HEUR_SSE2
+    guint8 pairs[16][2];
+#endif
+    for (int k = 0; script_keywords[k]; ++k) {
+        const unsigned char *kw = (const unsigned char *)script_keywords[k];
+        keyword_heads[k] = heur_head(kw);
+        keyword_lens[k] = strlen(script_keywords[k]);
+        keyword_first[kw[0]] = TRUE;
+        keyword_first[(unsigned char)g_ascii_toupper((gchar)kw[0])] = TRUE;
+#ifdef HEUR_SSE2
+        guint8 a = (guint8)(kw[0] | 0x20), b = (guint8)(kw[1] | 0x20);
+        int j = 0;
+        while (j < n_bigrams && (pairs[j][0] != a || pairs[j][1] != b)) j++;
+        if (j == n_bigrams && n_bigrams < 16) {
+            pairs[j][0] = a;
+            pairs[j][1] = b;
+            bigram_first[j] = _mm_set1_epi8((char)a);
+            bigram_second[j] = _mm_set1_epi8((char)b);
+            n_bigrams++;
+        }
+#endif
+    }
+}
+
+void heur_scan_init(heur_scan *s) {
+    memset(s, 0, sizeof(*s));
+}
+
+// --- Entropy ---
+// Bits per byte of n bytes with these counts: log2(n) - sum(c log2 c) / n
+static float window_entropy(const guint16 *counts, guint32 n) {
+    // Four partial sums: one chain of 256 dependent adds costs more than the lookups
+    float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 256; i += 4) {
+        sum[0] += entropy_terms[counts[i]];
+        sum[1] += entropy_terms[counts[i + 1]];
+        sum[2] += entropy_terms[counts[i + 2]];
+        sum[3] += entropy_terms[counts[i + 3]];
+    }
+    return (entropy_terms[n] - (sum[0] + sum[1]) - (sum[2] + sum[3])) / (float)n;
+}
+
+static void eval_window(heur_scan *s) {
+    float h = window_entropy(s->window, s->window_bytes);
+    s->windows++;
+    if (h >= HEUR_HIGH_ENTROPY) s->high_windows++;
+    if (h > s->max_window) s->max_window = h;
+}
+
+// Four interleaved counters break the store-to-load chain on runs of one byte value
+static void count_bytes(heur_scan *s, const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s->lanes[0][p[i]]++;
+        s->lanes[1][p[i + 1]]++;
+        s->lanes[2][p[i + 2]]++;
+        s->lanes[3][p[i + 3]]++;
+    }
+    for (; i < n; ++i) s->lanes[0][p[i]]++;
+}
+
+// Folds the lanes into one block histogram and slides the window past it:
+// window += block - oldest block, eight 16-bit counters per instruction
+static void close_block(heur_scan *s) {
+    int slot = (int)(s->blocks % HEUR_WINDOW_BLOCKS);
+    guint16 *old = s->ring[slot];
+    guint32 old_bytes = 0;
+    if (s->blocks >= HEUR_WINDOW_BLOCKS) old_bytes = HEUR_BLOCK;  // Only the last block can be short
+#ifdef HEUR_SSE2
+    for (int i = 0; i < 256; i += 8) {
+        __m128i a = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(s->lanes[0] + i)),
+                                  _mm_loadu_si128((const __m128i *)(s->lanes[1] + i)));
+        __m128i b = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(s->lanes[2] + i)),
+                                  _mm_loadu_si128((const __m128i *)(s->lanes[3] + i)));
+        __m128i block = _mm_add_epi16(a, b);
+        __m128i w = _mm_loadu_si128((const __m128i *)(s->window + i));
+        w = _mm_add_epi16(_mm_sub_epi16(w, _mm_loadu_si128((const __m128i *)(old + i))), block);
+        _mm_storeu_si128((__m128i *)(s->window + i), w);
+        _mm_storeu_si128((__m128i *)(old + i), block);
+    }
+#else
+    for (int i = 0; i < 256; ++i) {
+        guint16 block = (guint16)(s->lanes[0][i] + s->lanes[1][i] + s->lanes[2][i] + s->lanes[3][i]);
+        s->window[i] = (guint16)(s->window[i] - old[i] + block);
+        old[i] = block;
+    }
+#endif
+    for (int i = 0; i < 256; ++i) s->hist[i] += old[i];
+    memset(s->lanes, 0, sizeof(s->lanes));
+    s->window_bytes = s->window_bytes - old_bytes + (guint32)s->block_fill;
+    s->block_fill = 0;
+    s->blocks++;
+    if (s->blocks >= HEUR_WINDOW_BLOCKS) eval_window(s);
+}
+
+// --- Indicators ---
+static gboolean contains(const unsigned char *buf, size_t len, const char *needle) {
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= len; ++i)
+        if (buf[i] == (unsigned char)needle[0] && memcmp(buf + i, needle, n) == 0) return TRUE;
+    return FALSE;
+}
+
+static void find_packer(heur_scan *s, const unsigned char *buf, size_t len) {
+    for (int k = 0; packer_names[k]; ++k) {
+        if (contains(buf, len, packer_names[k])) {
+            snprintf(s->packer, sizeof(s->packer), "%s", packer_names[k]);
+            return;
+        }
+    }
+}
+
+// Keyword starting at buf[at]; one running into the next buffer is missed
+static void match_keywords(heur_scan *s, const unsigned char *buf, size_t len, size_t at) {
+    if (at + 4 > len) return;
+    guint32 head = heur_head(buf + at);
+    for (int k = 0; script_keywords[k]; ++k) {
+        if (keyword_heads[k] != head || at + keyword_lens[k] > len) continue;
+        if (g_ascii_strncasecmp((const char *)buf + at, script_keywords[k], keyword_lens[k]) == 0)
+            s->keywords |= 1u << k;
+    }
+}
+
+// Base64 runs and keywords, 16 bytes per step: OR 0x20 folds letter case, range
+// compares classify, and only bigram hits reach the scalar keyword compare
+static void scan_text(heur_scan *s, const unsigned char *buf, size_t len) {
+    guint32 run = s->base64_run, best = s->base64_max;
+    size_t i = 0;
+#ifdef HEUR_SSE2
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    for (; i + 17 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i lower = _mm_or_si128(v, case_bit);
+        __m128i next = _mm_or_si128(_mm_loadu_si128((const __m128i *)(buf + i + 1)), case_bit);
+        __m128i b64 = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                    _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        b64 = _mm_or_si128(b64, _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                              _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1))));
+        b64 = _mm_or_si128(b64, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')),
+                                             _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')),
+                                                          _mm_cmpeq_epi8(v, _mm_set1_epi8('=')))));
+        unsigned gaps = ~(unsigned)_mm_movemask_epi8(b64) & 0xFFFF;
+        if (gaps == 0) {
+            run += 16;
+        } else {
+            // Close the run coming in, restart after the last gap; runs wholly
+            // inside 16 bytes are far below HEUR_BASE64_RUN
+            run += (guint32)__builtin_ctz(gaps);
+            best = MAX(best, run);
+            run = (guint32)__builtin_clz(gaps) - 16;
+        }
+        __m128i hit = _mm_setzero_si128();
+        for (int b = 0; b < n_bigrams; ++b)
+            hit = _mm_or_si128(hit, _mm_and_si128(_mm_cmpeq_epi8(lower, bigram_first[b]),
+                                                  _mm_cmpeq_epi8(next, bigram_second[b])));
+        unsigned cand = (unsigned)_mm_movemask_epi8(hit);
+        while (cand) {
+            match_keywords(s, buf, len, i + (size_t)__builtin_ctz(cand));
+            cand &= cand - 1;
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        unsigned char c = buf[i];
+        // Branch-free: text flips between base64 and other characters every few bytes
+        run = (run + 1) & base64_mask[c];
+        best = MAX(best, run);
+        if (keyword_first[c]) match_keywords(s, buf, len, i);
+    }
+    s->base64_run = run;
+    s->base64_max = MAX(best, run);
+}
+
+// --- Scanning ---
+void heur_scan_feed(heur_scan *s, FileType type, const unsigned char *buf, size_t len) {
+    if (!(FTYPE_BIT(type) & HEUR_TYPES) || len == 0) return;
+    if (s->bytes == 0) {
+        s->type = type;
+        if (FTYPE_BIT(type) & FTYPE_EXECUTABLE) find_packer(s, buf, MIN(len, HEUR_PACKER_SCAN));
+    }
+    if (type == FTYPE_SCRIPT) scan_text(s, buf, len);
+    s->bytes += len;
+    while (len > 0) {
+        size_t take = MIN(len, HEUR_BLOCK - s->block_fill);
+        count_bytes(s, buf, take);
+        s->block_fill += take;
+        buf += take;
+        len -= take;
+        if (s->block_fill == HEUR_BLOCK) close_block(s);
+    }
+}
+
+void heur_scan_finish(heur_scan *s) {
+    if (s->block_fill > 0) close_block(s);
+    // Shorter than one window: judge what there is
+    if (s->windows == 0 && s->bytes >= HEUR_MIN_BYTES) eval_window(s);
+}
+
+static double file_entropy(const heur_scan *s) {
+    if (s->bytes == 0) return 0.0;
+    double sum = 0.0, n = (double)s->bytes;
+    for (int i = 0; i < 256; ++i)
+        if (s->hist[i]) sum += (double)s->hist[i] * log2((double)s->hist[i]);
+    return log2(n) - sum / n;
+}
+
+void heur_score(const heur_scan *s, const FileFeatures *ff, heur_result *out) {
+    memset(out, 0, sizeof(*out));
+    if (s->bytes == 0) return;
+    out->entropy = file_entropy(s);
+    out->max_window = s->max_window;
+    out->high_fraction = s->windows ? (double)s->high_windows / (double)s->windows : 0.0;
+    snprintf(out->packer, sizeof(out->packer), "%s", s->packer);
+    int score = 0;
+    guint32 ind = 0;
+    if (FTYPE_BIT(s->type) & FTYPE_EXECUTABLE) {
+        // Legitimate builds ship UPX-packed too: a packer name plus compressed
+        // windows (60) stays under the default threshold without a header anomaly
+        if (s->packer[0]) { ind |= HEUR_IND_PACKER; score += 30; }
+        if (s->bytes >= HEUR_MIN_BYTES) {
+            if (out->high_fraction >= 0.5) { ind |= HEUR_IND_ENTROPY; score += 30; }
+            else if (out->high_fraction >= 0.2) { ind |= HEUR_IND_SOME_ENTROPY; score += 15; }
+        }
+        if (ff && ff->format != FX_NONE) {
+            if (ff->anomalies & FX_ANOMALY_WX) { ind |= HEUR_IND_WX; score += 20; }
+            if (ff->anomalies & FX_ANOMALY_ENTRY) { ind |= HEUR_IND_ENTRY; score += 15; }
+            if (ff->anomalies & FX_ANOMALY_TRUNCATED) { ind |= HEUR_IND_TRUNCATED; score += 10; }
+            // .NET assemblies import one function too, but are not mostly compressed
+            if (ff->format == FX_PE && ff->n_imports <= HEUR_FEW_IMPORTS && (ind & HEUR_IND_ENTROPY)) {
+                ind |= HEUR_IND_FEW_IMPORTS;
+                score += 20;
+            }
+        }
+    } else if (s->type == FTYPE_SCRIPT) {
+        if (s->base64_max >= HEUR_BASE64_RUN) { ind |= HEUR_IND_BASE64; score += 35; }
+        int hits = 0;
+        for (guint32 k = s->keywords; k; k &= k - 1) hits++;
+        if (hits) { ind |= HEUR_IND_KEYWORDS; score += MIN(45, 15 * hits); }
+        if (s->bytes >= HEUR_WINDOW && out->entropy >= HEUR_DENSE_TEXT) { ind |= HEUR_IND_DENSE_TEXT; score += 20; }
+    }
+    out->score = MIN(100, score);
+    out->indicators = ind;
+}
+
+const char *heur_describe(const heur_result *r, char *buf, size_t len) {
+    size_t at = 0;
+    buf[0] = 0;
+#define HEUR_PART(...) do { \
+        if (at < len) at += (size_t)snprintf(buf + at, len - at, "%s", at ? ", " : ""); \
+        if (at < len) at += (size_t)snprintf(buf + at, len - at, __VA_ARGS__); \
+    } while (0)
+    if (r->indicators & HEUR_IND_PACKER) HEUR_PART("packer %s", r->packer);
+    if (r->indicators & (HEUR_IND_ENTROPY | HEUR_IND_SOME_ENTROPY))
+        HEUR_PART("%.0f%% high-entropy windows", r->high_fraction * 100.0);
+    if (r->indicators & HEUR_IND_WX) HEUR_PART("W+X section");
+    if (r->indicators & HEUR_IND_ENTRY) HEUR_PART("entry outside sections");
+    if (r->indicators & HEUR_IND_FEW_IMPORTS) HEUR_PART("few imports");
+    if (r->indicators & HEUR_IND_TRUNCATED) HEUR_PART("truncated");
+    if (r->indicators & HEUR_IND_BASE64) HEUR_PART("base64 blob");
+    if (r->indicators & HEUR_IND_KEYWORDS) HEUR_PART("decode/exec keywords");
+    if (r->indicators & HEUR_IND_DENSE_TEXT) HEUR_PART("text entropy %.1f", r->entropy);
+#undef HEUR_PART
+    return buf;
+}
@@ -0,0 +1,74 @@
+#ifndef HEURISTIC_ENGINE_H
+#define HEURISTIC_ENGINE_H
+#include <glib.h>
+#include <stddef.h>
+#include "file_type.h"
+#include "feature_extract.h"
+/* Scores files no signature knows. Rides the hashing read like the content
+ * matcher: byte histograms per 1 KB block, Shannon entropy over a 4 KB window
+ * sliding one block at a time, plus packer section names, base64 blobs and
+ * script keywords. Only executables and scripts are scored; archives and media
+ * are high-entropy by nature and cost nothing here. */
+
+#define HEUR_BLOCK          1024
+#define HEUR_WINDOW_BLOCKS  4
+#define HEUR_WINDOW         (HEUR_BLOCK * HEUR_WINDOW_BLOCKS)
+#define HEUR_HIGH_ENTROPY   7.2     // Bits per byte; compressed or encrypted data
+#define HEUR_BASE64_RUN     1024    // Base64 characters in a row that make a blob
+#define HEUR_DEFAULT_THRESHOLD 70
+#define HEUR_TYPES (FTYPE_EXECUTABLE | FTYPE_BIT(FTYPE_SCRIPT))
+
+// Indicators (heur_result.indicators)
+#define HEUR_IND_PACKER         (1u << 0)   // Section name of a known packer
+#define HEUR_IND_ENTROPY        (1u << 1)   // Most windows look compressed
+#define HEUR_IND_SOME_ENTROPY   (1u << 2)   // A fifth of them do
+#define HEUR_IND_WX             (1u << 3)   // Writable and executable section
+#define HEUR_IND_ENTRY          (1u << 4)   // Entry point outside every section
+#define HEUR_IND_FEW_IMPORTS    (1u << 5)   // Packed PE: a loader stub's handful of imports
+#define HEUR_IND_TRUNCATED      (1u << 6)   // Headers point past the end of the file
+#define HEUR_IND_BASE64         (1u << 7)   // Long base64 run in a script
+#define HEUR_IND_KEYWORDS       (1u << 8)   // Decode-and-run idioms in a script
+#define HEUR_IND_DENSE_TEXT     (1u << 9)   // Script text with the entropy of packed data
+
+// Per-file state; lives on the worker's stack (~5 KB)
+typedef struct {
+    FileType type;
+    guint64 bytes;
+    guint64 hist[256];                          // Whole file
+    guint16 lanes[4][256];                      // Block being filled, 4 interleaved counters
+    size_t block_fill;
+    guint16 ring[HEUR_WINDOW_BLOCKS][256];      // Last blocks; the window is their sum
+    guint16 window[256];
+    guint32 window_bytes;
+    guint64 blocks;
+    guint64 windows, high_windows;
+    float max_window;
+    guint32 base64_run, base64_max;             // Carried across chunks
+    guint32 keywords;                           // Bit per keyword seen
+    char packer[12];
+} heur_scan;
+
+typedef struct {
+    int score;                  // 0..100
+    guint32 indicators;
+    double entropy;             // Whole file, bits per byte
+    double max_window;
+    double high_fraction;       // Windows at or above HEUR_HIGH_ENTROPY
+    char packer[12];
+} heur_result;
+
+// Fills the entropy table; call once before the workers start
+void heuristic_init(void);
+
+void heur_scan_init(heur_scan *s);
+// `type` is the file's class from its first buffer; other types are ignored
+void heur_scan_feed(heur_scan *s, FileType type, const unsigned char *buf, size_t len);
+// Closes the last block; call once, after the last buffer
+void heur_scan_finish(heur_scan *s);
+// ff: structure of the file when it was parsed, else NULL. May be called again
+// once the structure is known.
+void heur_score(const heur_scan *s, const FileFeatures *ff, heur_result *out);
+// "packer UPX0, 93% high-entropy windows"; returns buf
+const char *heur_describe(const heur_result *r, char *buf, size_t len);
+
+#endif
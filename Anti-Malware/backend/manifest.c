@@ -0,0 +1,322 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "manifest.h"
+#include "scan_core.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define MANIFEST_WINDOW     4                   // Blocks in flight per thread
+#define MANIFEST_OUT_BUFFER (1024 * 1024)
+
+// --- Writing ---
+typedef struct {
+    char **paths;               // Sorted, unique
+    size_t n;
+    gsize n_blocks;
+    FILE *out;
+    GMutex lock;
+    GCond ready;                // A block was written: its slot is free again
+    gsize next_claim;
+    gsize next_write;
+    GString **pending;          // Finished blocks by block % window, waiting for their turn
+    gsize window;
+    gboolean write_failed;
+    ManifestStats *st;
+} manifest_writer;
+
+static int path_cmp(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void append_line(GString *s, const char *path, HashCost *cost, ManifestStats *local) {
+    static const char digits[] = "0123456789abcdef";
+    struct stat st;
+    gboolean have_stat = stat(path, &st) == 0;
+    MultiDigest d;
+    if (have_stat && compute_file_hashes(path, HASH_BIT(HASH_SHA256), &d, NULL, 0, cost) == 0) {
+        char hex[2 * 32];
+        for (int i = 0; i < 32; ++i) {
+            hex[2 * i] = digits[d.digest[HASH_SHA256][i] >> 4];
+            hex[2 * i + 1] = digits[d.digest[HASH_SHA256][i] & 15];
+        }
+        g_string_append_len(s, hex, sizeof(hex));
+        local->bytes += (guint64)st.st_size;
+    } else {
+        g_string_append_c(s, '-');
+        local->unreadable++;
+    }
+    g_string_append_printf(s, "\t%llu\t%lld\t", have_stat ? (unsigned long long)st.st_size : 0ULL,
+                           have_stat ? (long long)st.st_mtime : 0LL);
+    append_escaped_path(s, path);
+    g_string_append_c(s, '\n');
+    local->files++;
+}
+
+static gpointer manifest_worker(gpointer data) {
+    manifest_writer *w = (manifest_writer *)data;
+    HashCost cost = { 0 };
+    ManifestStats local = { 0 };
+    while (1) {
+        // A block may only start once the block `window` places before it is out,
+        // so one slow file holds back at most window blocks of memory
+        g_mutex_lock(&w->lock);
+        while (w->next_claim < w->n_blocks && w->next_claim >= w->next_write + w->window)
+            g_cond_wait(&w->ready, &w->lock);
+        gsize b = w->next_claim;
+        if (b >= w->n_blocks) {
+            g_mutex_unlock(&w->lock);
+            break;
+        }
+        w->next_claim++;
+        g_mutex_unlock(&w->lock);
+
+        GString *text = g_string_sized_new(MANIFEST_BLOCK * 160);
+        size_t end = MIN(w->n, (size_t)(b + 1) * MANIFEST_BLOCK);
+        for (size_t i = (size_t)b * MANIFEST_BLOCK; i < end; ++i) append_line(text, w->paths[i], &cost, &local);
+
+        // Whoever finishes the block that is due writes it and every finished one behind it
+        g_mutex_lock(&w->lock);
+        w->pending[b % w->window] = text;
+        while (w->next_write < w->n_blocks && (text = w->pending[w->next_write % w->window]) != NULL) {
+            w->pending[w->next_write % w->window] = NULL;
+            if (!w->write_failed && fwrite(text->str, 1, text->len, w->out) != text->len) w->write_failed = TRUE;
+            g_string_free(text, TRUE);
+            w->next_write++;
+        }
+        g_cond_broadcast(&w->ready);
+        g_mutex_unlock(&w->lock);
+    }
+    g_mutex_lock(&w->lock);
+    w->st->files += local.files;
+    w->st->unreadable += local.unreadable;
+    w->st->bytes += local.bytes;
+    w->st->hash_ns += cost.ns[HASH_SHA256];
+    g_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+int manifest_write(GList *roots, const char *out_path, guint num_threads, ManifestStats *st) {
+    memset(st, 0, sizeof(*st));
+    guint64 t0 = hash_clock_ns();
+    FILE *out = fopen(out_path, "wb");
+    if (!out) return -1;
+    setvbuf(out, NULL, _IOFBF, MANIFEST_OUT_BUFFER);
+
+    // Every root's listing in one sorted array; overlapping roots list a path twice
+    GPtrArray *all = g_ptr_array_new();
+    for (GList *r = roots; r; r = r->next) {
+        FilePathList *part = list_files_recursive((const char *)r->data);
+        if (!part) continue;
+        for (GList *p = part->paths; p; p = p->next) g_ptr_array_add(all, p->data);
+        g_list_free(part->paths);   // The strings now belong to `all`
+        part->paths = NULL;
+        free_filepath_list(part);
+    }
+    char **paths = (char **)all->pdata;
+    size_t n = all->len;
+    if (n > 1) qsort(paths, n, sizeof(char *), path_cmp);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (unique > 0 && strcmp(paths[unique - 1], paths[i]) == 0) {
+            g_free(paths[i]);
+            continue;
+        }
+        paths[unique++] = paths[i];
+    }
+
+    manifest_writer w;
+    memset(&w, 0, sizeof(w));
+    w.paths = paths;
+    w.n = unique;
+    w.n_blocks = (unique + MANIFEST_BLOCK - 1) / MANIFEST_BLOCK;
+    w.out = out;
+    w.st = st;
+    if (num_threads == 0) num_threads = MAX(1, g_get_num_processors());
+    st->threads = num_threads;
+    w.window = (gsize)num_threads * MANIFEST_WINDOW;
+    w.pending = g_new0(GString *, w.window);
+    g_mutex_init(&w.lock);
+    g_cond_init(&w.ready);
+    fprintf(out, MANIFEST_HEADER "\n");
+
+    GThread **threads = g_new(GThread *, num_threads);
+    for (guint i = 0; i < num_threads; ++i) threads[i] = g_thread_new(NULL, manifest_worker, &w);
+    for (guint i = 0; i < num_threads; ++i) g_thread_join(threads[i]);
+    g_free(threads);
+
+    int rc = w.write_failed ? -1 : 0;
+    if (fclose(out) != 0) rc = -1;
+    g_mutex_clear(&w.lock);
+    g_cond_clear(&w.ready);
+    g_free(w.pending);
+    for (size_t i = 0; i < unique; ++i) g_free(paths[i]);
+    g_ptr_array_free(all, TRUE);
+    st->ns = hash_clock_ns() - t0;
+    return rc;
+}
+
+void manifest_print_stats(FILE *out, const ManifestStats *st) {
+    double s = st->ns ? (double)st->ns / 1e9 : 0.0;
+    fprintf(out, "[MANIFEST] %llu file(s), %.1f MB in %.2f s on %u thread(s): %.0f files/s, %.1f MB/s; %llu unreadable\n",
+            (unsigned long long)st->files, (double)st->bytes / (1024.0 * 1024.0), s, st->threads,
+            s > 0 ? (double)st->files / s : 0.0, s > 0 ? (double)st->bytes / (1024.0 * 1024.0) / s : 0.0,
+            (unsigned long long)st->unreadable);
+}
+
+// --- Diffing ---
+typedef struct {
+    const char *line;           // Up to, not including, the newline
+    size_t line_len;
+    const char *path;
+    size_t path_len;
+} mf_line;
+
+typedef struct {
+    FileMap map;
+    const char *p, *end;        // In order: read straight from the mapping
+    mf_line *sorted;            // Out of order: every line, sorted by path
+    size_t count, at;
+} mf_reader;
+
+// Next data line at or after *p; FALSE at the end. Comments and lines without
+// four fields are skipped.
+static gboolean parse_next(const char **p, const char *end, mf_line *out) {
+    while (*p < end) {
+        const char *line = *p;
+        const char *nl = memchr(line, '\n', (size_t)(end - line));
+        const char *stop = nl ? nl : end;
+        *p = nl ? nl + 1 : end;
+        size_t len = (size_t)(stop - line);
+        if (len > 0 && line[len - 1] == '\r') len--;
+        if (len == 0 || line[0] == '#') continue;
+        const char *path = line;
+        int tabs = 0;
+        while (tabs < 3 && (path = memchr(path, '\t', (size_t)(line + len - path))) != NULL) {
+            ++path;
+            ++tabs;
+        }
+        if (tabs < 3) continue;
+        out->line = line;
+        out->line_len = len;
+        out->path = path;
+        out->path_len = (size_t)(line + len - path);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static int path_order(const mf_line *a, const mf_line *b) {
+    int c = memcmp(a->path, b->path, MIN(a->path_len, b->path_len));
+    if (c) return c;
+    return (a->path_len > b->path_len) - (a->path_len < b->path_len);
+}
+
+static int mf_line_cmp(const void *a, const void *b) {
+    return path_order((const mf_line *)a, (const mf_line *)b);
+}
+
+// Maps the manifest and checks its order in one pass; only a file that is out of
+// order gets an index, sorted once
+static int reader_open(mf_reader *r, const char *path, gboolean *resorted) {
+    memset(r, 0, sizeof(*r));
+    if (map_file(path, (size_t)-1, &r->map) != 0) return -1;
+    const char *p = (const char *)r->map.data, *end = p + r->map.len;
+    mf_line prev, cur;
+    gboolean in_order = TRUE, have_prev = FALSE;
+    while (parse_next(&p, end, &cur)) {
+        if (have_prev && path_order(&prev, &cur) > 0) in_order = FALSE;
+        prev = cur;
+        have_prev = TRUE;
+        r->count++;
+    }
+    r->p = (const char *)r->map.data;
+    r->end = end;
+    if (!in_order) {
+        r->sorted = g_new(mf_line, r->count);
+        size_t i = 0;
+        while (parse_next(&r->p, r->end, &r->sorted[i])) ++i;
+        qsort(r->sorted, r->count, sizeof(mf_line), mf_line_cmp);
+        *resorted = TRUE;
+    }
+    return 0;
+}
+
+static gboolean reader_next(mf_reader *r, mf_line *out) {
+    if (r->sorted) {
+        if (r->at >= r->count) return FALSE;
+        *out = r->sorted[r->at++];
+        return TRUE;
+    }
+    return parse_next(&r->p, r->end, out);
+}
+
+static void reader_close(mf_reader *r) {
+    g_free(r->sorted);
+    unmap_file(&r->map);
+}
+
+static void emit(FILE *out, char kind, const mf_line *l) {
+    if (!out) return;
+    fputc(kind, out);
+    fputc('\t', out);
+    fwrite(l->path, 1, l->path_len, out);
+    fputc('\n', out);
+}
+
+int manifest_diff(const char *old_path, const char *new_path, FILE *out, ManifestDiffStats *st) {
+    memset(st, 0, sizeof(*st));
+    guint64 t0 = hash_clock_ns();
+    mf_reader a, b;
+    if (reader_open(&a, old_path, &st->resorted) != 0) return -1;
+    if (reader_open(&b, new_path, &st->resorted) != 0) {
+        reader_close(&a);
+        return -1;
+    }
+    st->old_lines = a.count;
+    st->new_lines = b.count;
+    mf_line x, y;
+    gboolean hx = reader_next(&a, &x), hy = reader_next(&b, &y);
+    while (hx || hy) {
+        int c = !hx ? 1 : !hy ? -1 : path_order(&x, &y);
+        if (c < 0) {
+            emit(out, 'D', &x);
+            st->removed++;
+            hx = reader_next(&a, &x);
+        } else if (c > 0) {
+            emit(out, 'A', &y);
+            st->added++;
+            hy = reader_next(&b, &y);
+        } else {
+            // Same path: the digest decides content, the rest of the fields metadata
+            size_t xh = (size_t)((const char *)memchr(x.line, '\t', x.line_len) - x.line);
+            size_t yh = (size_t)((const char *)memchr(y.line, '\t', y.line_len) - y.line);
+            size_t xm = (size_t)(x.path - x.line), ym = (size_t)(y.path - y.line);
+            if (xh != yh || memcmp(x.line, y.line, xh) != 0) {
+                emit(out, 'M', &y);
+                st->modified++;
+            } else if (xm != ym || memcmp(x.line + xh, y.line + yh, xm - xh) != 0) {
+                emit(out, 'T', &y);
+                st->touched++;
+            } else {
+                st->unchanged++;
+            }
+            hx = reader_next(&a, &x);
+            hy = reader_next(&b, &y);
+        }
+    }
+    reader_close(&a);
+    reader_close(&b);
+    st->ns = hash_clock_ns() - t0;
+    return 0;
+}
+
+void manifest_print_diff_stats(FILE *out, const ManifestDiffStats *st) {
+    double s = (double)st->ns / 1e9;
+    fprintf(out, "[DIFF] %llu -> %llu file(s): %llu added, %llu removed, %llu modified, %llu touched, %llu unchanged in %.2f s (%.1f M lines/s)%s\n",
+            (unsigned long long)st->old_lines, (unsigned long long)st->new_lines,
+            (unsigned long long)st->added, (unsigned long long)st->removed,
+            (unsigned long long)st->modified, (unsigned long long)st->touched,
+            (unsigned long long)st->unchanged, s,
+            s > 0 ? (double)(st->old_lines + st->new_lines) / 1e6 / s : 0.0,
+            st->resorted ? "; an input was out of order and was sorted first" : "");
+}
@@ -0,0 +1,50 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+#include <glib.h>
+#include <stdio.h>
+/* Integrity audits: a manifest of every file under some roots, and the
+ * difference between two manifests.
+ *
+ * One line per file, sorted by path (byte order), tab separated:
+ *     <sha256 hex | ->  <size>  <mtime>  <path>
+ * "-" marks a file that could not be read. Control characters and '%' in a
+ * path are written as %XX, so a line never holds a stray tab or newline.
+ *
+ * Files are hashed by a worker pool in blocks of consecutive paths; each block
+ * is formatted by its worker and handed to the output in path order, so the
+ * file comes out sorted without a sort pass over the lines. */
+
+#define MANIFEST_HEADER "# fos-manifest 1\tsha256\tsize\tmtime\tpath"
+#define MANIFEST_BLOCK  256     // Files formatted per block
+
+typedef struct {
+    guint64 files;
+    guint64 unreadable;
+    guint64 bytes;
+    guint64 ns;                 // Wall time of the whole write
+    guint64 hash_ns;            // SHA-256 time summed over the workers
+    guint threads;
+} ManifestStats;
+
+// Walks every root (overlapping roots are listed once) and writes the manifest.
+// num_threads 0 = one per core. -1 if the output cannot be written.
+int manifest_write(GList *roots, const char *out_path, guint num_threads, ManifestStats *st);
+void manifest_print_stats(FILE *out, const ManifestStats *st);
+
+typedef struct {
+    guint64 old_lines, new_lines;
+    guint64 added, removed;
+    guint64 modified;           // Content changed (or became readable / unreadable)
+    guint64 touched;            // Same content, new size or mtime
+    guint64 unchanged;
+    gboolean resorted;          // An input was out of order and had to be sorted first
+    guint64 ns;
+} ManifestDiffStats;
+
+// Sorted merge of two manifests. Writes one line per difference to `out`
+// (may be NULL): "A", "D", "M" or "T", a tab, then the path as stored.
+// -1 if either manifest cannot be read.
+int manifest_diff(const char *old_path, const char *new_path, FILE *out, ManifestDiffStats *st);
+void manifest_print_diff_stats(FILE *out, const ManifestDiffStats *st);
+
+#endif
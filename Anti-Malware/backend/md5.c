@@ -0,0 +1,92 @@
+#include "md5.h"
+#include <string.h>
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+// Per-round shift amounts and sine-derived constants (RFC 1321, 3.4)
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+static const unsigned char md5_r[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void md5_transf(md5_ctx *ctx, const unsigned char *blk) {
+    uint32_t w[16];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (uint32_t)blk[4*i] | ((uint32_t)blk[4*i+1] << 8)
+             | ((uint32_t)blk[4*i+2] << 16) | ((uint32_t)blk[4*i+3] << 24);
+    }
+    uint32_t a = ctx->h[0], b = ctx->h[1], c = ctx->h[2], d = ctx->h[3];
+#define MD5_STEP(f, g) do {                                            \
+        uint32_t t = b + ROTL32(a + (f) + md5_k[i] + w[(g)], md5_r[i]); \
+        a = d; d = c; c = b; b = t;                                    \
+    } while (0)
+    int i = 0;
+    for (; i < 16; ++i) MD5_STEP((b & c) | (~b & d), i);
+    for (; i < 32; ++i) MD5_STEP((d & b) | (~d & c), (5 * i + 1) & 15);
+    for (; i < 48; ++i) MD5_STEP(b ^ c ^ d, (3 * i + 5) & 15);
+    for (; i < 64; ++i) MD5_STEP(c ^ (b | ~d), (7 * i) & 15);
+#undef MD5_STEP
+    ctx->h[0] += a;
+    ctx->h[1] += b;
+    ctx->h[2] += c;
+    ctx->h[3] += d;
+}
+
+void md5_init(md5_ctx *ctx) {
+    ctx->h[0] = 0x67452301;
+    ctx->h[1] = 0xefcdab89;
+    ctx->h[2] = 0x98badcfe;
+    ctx->h[3] = 0x10325476;
+    ctx->len = 0;
+    ctx->tot_len = 0;
+}
+
+void md5_update(md5_ctx *ctx, const unsigned char *message, size_t len) {
+    ctx->tot_len += len;
+    if (ctx->len) {
+        size_t take = MD5_BLOCK_SIZE - ctx->len;
+        if (take > len) take = len;
+        memcpy(ctx->block + ctx->len, message, take);
+        ctx->len += take;
+        message += take;
+        len -= take;
+        if (ctx->len < MD5_BLOCK_SIZE) return;
+        md5_transf(ctx, ctx->block);
+        ctx->len = 0;
+    }
+    while (len >= MD5_BLOCK_SIZE) {
+        md5_transf(ctx, message);
+        message += MD5_BLOCK_SIZE;
+        len -= MD5_BLOCK_SIZE;
+    }
+    memcpy(ctx->block, message, len);
+    ctx->len = len;
+}
+
+void md5_final(md5_ctx *ctx, unsigned char digest[MD5_DIGEST_SIZE]) {
+    uint64_t bits = ctx->tot_len * 8;
+    unsigned char pad[MD5_BLOCK_SIZE * 2];
+    size_t pad_len = (ctx->len < 56) ? 56 - ctx->len : 120 - ctx->len;
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (int i = 0; i < 8; ++i) pad[pad_len + i] = (unsigned char)(bits >> (8 * i));  // Little endian
+    md5_update(ctx, pad, pad_len + 8);
+    for (int i = 0; i < 4; ++i) {
+        digest[4*i]     = (unsigned char)(ctx->h[i]);
+        digest[4*i + 1] = (unsigned char)(ctx->h[i] >> 8);
+        digest[4*i + 2] = (unsigned char)(ctx->h[i] >> 16);
+        digest[4*i + 3] = (unsigned char)(ctx->h[i] >> 24);
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef MD5_H
+#define MD5_H
+#include <stdint.h>
+#include <stddef.h>
+/* MD5 (RFC 1321). Only for matching the MD5 column of threat-intel feeds. */
+
+#define MD5_DIGEST_SIZE 16
+#define MD5_BLOCK_SIZE  64
+
+typedef struct {
+    uint64_t tot_len;
+    size_t len;
+    unsigned char block[MD5_BLOCK_SIZE];
+    uint32_t h[4];
+} md5_ctx;
+
+void md5_init(md5_ctx *ctx);
+void md5_update(md5_ctx *ctx, const unsigned char *message, size_t len);
+void md5_final(md5_ctx *ctx, unsigned char digest[MD5_DIGEST_SIZE]);
+
+#endif
@@ -0,0 +1,124 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "mem_budget.h"
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char *component_names[MEM_COMPONENT_COUNT] = {
+    "paths", "signatures", "file-table", "seen", "buffers", "record", "allowlist", "engines", "trace"
+};
+
+// One lock for every counter: accounting happens per file at most, next to a read
+static GMutex budget_lock;
+static guint64 current[MEM_COMPONENT_COUNT];
+static guint64 peak[MEM_COMPONENT_COUNT];
+static guint64 total, total_peak;
+static guint64 limit;
+static guint64 rss_peak;        // Largest sample of this scan
+
+void mem_budget_begin(guint64 limit_bytes) {
+    g_mutex_lock(&budget_lock);
+    memset(current, 0, sizeof(current));
+    memset(peak, 0, sizeof(peak));
+    total = total_peak = 0;
+    limit = limit_bytes;
+    rss_peak = 0;
+    g_mutex_unlock(&budget_lock);
+}
+
+// Under budget_lock
+static void set_locked(MemComponent c, guint64 bytes) {
+    total = total - current[c] + bytes;
+    current[c] = bytes;
+    if (bytes > peak[c]) peak[c] = bytes;
+    if (total > total_peak) total_peak = total;
+}
+
+void mem_account(MemComponent c, gint64 delta) {
+    if (c >= MEM_COMPONENT_COUNT) return;
+    g_mutex_lock(&budget_lock);
+    // A release larger than what was accounted clamps at zero rather than wrapping
+    guint64 bytes = (delta < 0 && (guint64)-delta > current[c]) ? 0 : current[c] + (guint64)delta;
+    set_locked(c, bytes);
+    g_mutex_unlock(&budget_lock);
+}
+
+void mem_set(MemComponent c, guint64 bytes) {
+    if (c >= MEM_COMPONENT_COUNT) return;
+    g_mutex_lock(&budget_lock);
+    set_locked(c, bytes);
+    g_mutex_unlock(&budget_lock);
+}
+
+guint64 mem_used(void) {
+    g_mutex_lock(&budget_lock);
+    guint64 used = total;
+    g_mutex_unlock(&budget_lock);
+    return used;
+}
+
+guint64 mem_limit(void) {
+    g_mutex_lock(&budget_lock);
+    guint64 l = limit;
+    g_mutex_unlock(&budget_lock);
+    return l;
+}
+
+gboolean mem_tight(void) {
+    g_mutex_lock(&budget_lock);
+    gboolean tight = limit > 0 && total >= limit / 4 * 3;
+    g_mutex_unlock(&budget_lock);
+    return tight;
+}
+
+// The process peak (PeakWorkingSetSize, ru_maxrss) would include whatever ran
+// before the scan, so the current figure is sampled instead
+guint64 mem_rss(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return (guint64)pmc.WorkingSetSize;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) return 0;
+    return (guint64)info.resident_size;
+#else
+    // statm: size, resident, ... in pages
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long long size = 0, resident = 0;
+    int n = fscanf(f, "%llu %llu", &size, &resident);
+    fclose(f);
+    return n == 2 ? (guint64)resident * (guint64)sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+void mem_sample_rss(void) {
+    guint64 rss = mem_rss();
+    g_mutex_lock(&budget_lock);
+    if (rss > rss_peak) rss_peak = rss;
+    g_mutex_unlock(&budget_lock);
+}
+
+void mem_budget_print(FILE *out) {
+    const double mb = 1024.0 * 1024.0;
+    g_mutex_lock(&budget_lock);
+    fprintf(out, "Memory: %.1f MB tracked at peak", (double)total_peak / mb);
+    if (limit > 0) fprintf(out, " of a %.0f MB limit", (double)limit / mb);
+    fprintf(out, "\n");
+    for (int c = 0; c < MEM_COMPONENT_COUNT; ++c) {
+        if (peak[c] == 0) continue;
+        fprintf(out, "  %-10s %9.1f MB peak %9.1f MB at the end\n", component_names[c],
+                (double)peak[c] / mb, (double)current[c] / mb);
+    }
+    guint64 rss = rss_peak;
+    g_mutex_unlock(&budget_lock);
+    if (rss > 0) fprintf(out, "  %-10s %9.1f MB, whole process, largest sample\n", "RSS", (double)rss / mb);
+}
@@ -0,0 +1,48 @@
+#ifndef MEM_BUDGET_H
+#define MEM_BUDGET_H
+#include <glib.h>
+#include <stdio.h>
+/* What a scan holds in memory, by component, against an optional ceiling
+ * (memory_limit_mb in settings.conf).
+ *
+ * The scanner accounts the structures that grow with the tree or the feed; the
+ * counts are estimates of what they allocate, not allocator statistics. Not
+ * counted: what the OS maps for a file being read, zlib's inflate state inside
+ * archive members, and GLib's own bookkeeping. Above
+ * three quarters of the limit memory is "tight" and the scan degrades instead of
+ * growing: the path queue shrinks, the hardlink table admits only files with
+ * several links and the scan's clean-file index is spilled to disk. Resident
+ * memory is what the OS reports for the whole process, sampled at every
+ * checkpoint; its maximum is kept per scan. */
+
+typedef enum {
+    MEM_PATHS = 0,              // Listed paths not yet claimed by a worker
+    MEM_SIGDB,                  // Signature records and interned labels
+    MEM_FILE_TABLE,             // Hardlink table: one entry per file identity
+    MEM_SEEN,                   // Clean files of this scan, before they reach the seen index
+    MEM_BUFFERS,                // Per-worker read buffer, histograms and parser state
+    MEM_RECORD,                 // scan_record slots
+    MEM_ALLOWLIST,              // Trusted digests (NSRL, baseline) and the trusted-file table
+    MEM_ENGINES,                // Content, feature and fuzzy signature indexes
+    MEM_TRACE,                  // Timeline spans, up to TRACE_MAX_SPANS per thread
+    MEM_COMPONENT_COUNT
+} MemComponent;
+
+// Starts a scan: every component at zero, `limit_bytes` the ceiling (0 = none)
+void mem_budget_begin(guint64 limit_bytes);
+// Thread-safe
+void mem_account(MemComponent c, gint64 delta);
+void mem_set(MemComponent c, guint64 bytes);
+guint64 mem_used(void);
+guint64 mem_limit(void);
+// At or above three quarters of the limit; never without one
+gboolean mem_tight(void);
+// Resident bytes of the whole process right now; 0 where the OS does not say
+guint64 mem_rss(void);
+// Takes a mem_rss sample into this scan's maximum. Thread-safe.
+void mem_sample_rss(void);
+// Peak of each component during the scan, their combined peak, the limit and the
+// largest RSS sampled
+void mem_budget_print(FILE *out);
+
+#endif
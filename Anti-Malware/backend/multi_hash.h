@@ -0,0 +1,61 @@
+#ifndef MULTI_HASH_H
+#define MULTI_HASH_H
+#include <glib.h>
+#include <stdio.h>
+#include "md5.h"
+#include "sha1.h"
+#include "sha2.h"
+/* One read buffer, several digests: every enabled context is updated from the
+ * same chunk, so adding an algorithm never adds a read of the file. */
+
+typedef enum {
+    HASH_MD5 = 0,
+    HASH_SHA1,
+    HASH_SHA256,
+    HASH_SHA512,
+    HASH_ALGO_COUNT
+} HashAlgo;
+
+#define HASH_BIT(a)      (1u << (a))
+#define HASH_ALL         (HASH_BIT(HASH_ALGO_COUNT) - 1)
+#define HASH_MAX_DIGEST  SHA512_DIGEST_SIZE
+
+typedef struct {
+    unsigned algos;                                     // HASH_BIT mask of valid rows
+    unsigned char digest[HASH_ALGO_COUNT][HASH_MAX_DIGEST];
+} MultiDigest;
+
+// Time spent inside each algorithm, so the price of enabling a feed is visible
+typedef struct {
+    guint64 files;
+    guint64 bytes;
+    guint64 ns[HASH_ALGO_COUNT];
+    guint64 open_ns;            // Filled in by compute_file_hashes: opening,
+    guint64 read_ns;            // reading, and the sinks riding the read pass
+    guint64 sink_ns;
+} HashCost;
+
+typedef struct {
+    unsigned algos;
+    HashCost *cost;             // NULL = don't time
+    md5_ctx md5;
+    sha1_ctx sha1;
+    sha256_ctx sha256;
+    sha512_ctx sha512;
+} MultiHash;
+
+size_t hash_digest_len(HashAlgo algo);
+const char *hash_algo_name(HashAlgo algo);
+// Feed hash columns are told apart by length; -1 if no algorithm has that many hex digits
+int hash_algo_from_hexlen(size_t hex_len);
+
+void multi_hash_init(MultiHash *mh, unsigned algos, HashCost *cost);
+void multi_hash_update(MultiHash *mh, const unsigned char *buf, size_t len);
+void multi_hash_final(MultiHash *mh, MultiDigest *out);
+
+// Monotonic nanoseconds, for the cost reports
+guint64 hash_clock_ns(void);
+void hash_cost_add(HashCost *dst, const HashCost *src);
+void hash_cost_print(FILE *out, const HashCost *cost);
+
+#endif
@@ -0,0 +1,509 @@
+#define _GNU_SOURCE
+#include "realtime_scan.h"
+#include "scan_core.h"
+#include "sig_store.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/fanotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef FAN_OPEN_EXEC_PERM
+#define FAN_OPEN_EXEC_PERM 0x00040000   // Linux 5.0+
+#endif
+#define RT_CACHE_SHARDS 16
+#define RT_POLL_MS 200
+#define RT_EVENT_BATCH 256
+
+// --- Internal Structs ---
+// Identity of one version of a file. mtime alone can be put back after a rewrite
+// (futimens, touch -r); ctime cannot be set from user space and moves on every write
+// or metadata change, so a stale verdict never matches.
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    gint64 mtime_sec;
+    glong mtime_nsec;
+    gint64 ctime_sec;
+    glong ctime_nsec;
+} RtFileKey;
+
+typedef struct {
+    int fd;             // Event fd from the kernel (we own it until we respond)
+    RtFileKey key;
+    gint64 t_start;     // Monotonic time the event was read
+} RtEvent;
+
+// Fixed-size ring; the reader never blocks on it (see rt_dispatch)
+typedef struct {
+    RtEvent *slots;
+    guint capacity;
+    guint head;
+    guint count;
+    GMutex lock;
+    GCond not_empty;
+} RtQueue;
+
+typedef struct {
+    GMutex lock;
+    GHashTable *verdicts;   // RtFileKey* -> GUINT_TO_POINTER(generation << 1 | denied)
+} RtCacheShard;
+
+typedef struct RtWorker RtWorker;
+
+typedef struct {
+    int fan_fd;
+    const char *sigdb_path; // Re-read on realtime_scan_reload()
+    GThread *loader;        // Background reload, so the reader never blocks on it
+    volatile gint loading;
+    RtCacheShard shards[RT_CACHE_SHARDS];
+    guint shard_capacity;
+    guint num_workers;
+    RtWorker *workers;
+    RealtimeStats reader_stats;   // Owned by the reader thread
+} RtEngine;
+
+struct RtWorker {
+    RtEngine *engine;
+    RtQueue queue;
+    GThread *thread;
+    RealtimeStats stats;          // Owned by this worker, merged at shutdown
+};
+
+static volatile gint rt_stop = 0;
+static volatile gint rt_reload = 0;
+
+// --- Verdict Cache ---
+static guint rt_key_hash(gconstpointer p) {
+    const RtFileKey *k = (const RtFileKey *)p;
+    guint64 h = (guint64)k->ino * G_GINT64_CONSTANT(0x9E3779B97F4A7C15);
+    h ^= (guint64)k->dev + ((guint64)k->mtime_sec << 20) + (guint64)k->mtime_nsec;
+    h ^= ((guint64)k->ctime_sec << 24) + (guint64)k->ctime_nsec * G_GINT64_CONSTANT(0xC2B2AE3D27D4EB4F);
+    h ^= h >> 29;
+    return (guint)(h ^ (h >> 32));
+}
+
+static gboolean rt_key_equal(gconstpointer a, gconstpointer b) {
+    const RtFileKey *x = (const RtFileKey *)a;
+    const RtFileKey *y = (const RtFileKey *)b;
+    return x->ino == y->ino && x->dev == y->dev &&
+           x->mtime_sec == y->mtime_sec && x->mtime_nsec == y->mtime_nsec &&
+           x->ctime_sec == y->ctime_sec && x->ctime_nsec == y->ctime_nsec;
+}
+
+static void rt_key_from_stat(RtFileKey *key, const struct stat *st) {
+    memset(key, 0, sizeof(*key));
+    key->dev = st->st_dev;
+    key->ino = st->st_ino;
+    key->mtime_sec = (gint64)st->st_mtim.tv_sec;
+    key->mtime_nsec = (glong)st->st_mtim.tv_nsec;
+    key->ctime_sec = (gint64)st->st_ctim.tv_sec;
+    key->ctime_nsec = (glong)st->st_ctim.tv_nsec;
+}
+
+// Verdicts reached with an older signature generation miss, so a reload takes
+// effect on the next open without flushing the cache.
+static gboolean rt_cache_lookup(RtEngine *e, const RtFileKey *key, guint h, guint32 *verdict) {
+    RtCacheShard *shard = &e->shards[h % RT_CACHE_SHARDS];
+    g_mutex_lock(&shard->lock);
+    gpointer v = g_hash_table_lookup(shard->verdicts, key);
+    g_mutex_unlock(&shard->lock);
+    if (!v) return FALSE;
+    guint packed = GPOINTER_TO_UINT(v);
+    if ((packed >> 1) != sigstore_generation()) return FALSE;
+    *verdict = (packed & 1) ? FAN_DENY : FAN_ALLOW;
+    return TRUE;
+}
+
+static void rt_cache_store(RtEngine *e, const RtFileKey *key, guint h, guint32 verdict, guint generation) {
+    guint packed = (generation << 1) | (verdict == FAN_DENY ? 1u : 0u);
+    RtCacheShard *shard = &e->shards[h % RT_CACHE_SHARDS];
+    g_mutex_lock(&shard->lock);
+    // Crude but bounded: recycle the whole shard instead of tracking LRU order
+    if (g_hash_table_size(shard->verdicts) >= e->shard_capacity)
+        g_hash_table_remove_all(shard->verdicts);
+    g_hash_table_replace(shard->verdicts, g_memdup2(key, sizeof(*key)), GUINT_TO_POINTER(packed));
+    g_mutex_unlock(&shard->lock);
+}
+
+// --- Bounded Queue ---
+static void rt_queue_init(RtQueue *q, guint capacity) {
+    q->slots = g_new0(RtEvent, capacity);
+    q->capacity = capacity;
+    q->head = 0;
+    q->count = 0;
+    g_mutex_init(&q->lock);
+    g_cond_init(&q->not_empty);
+}
+
+static void rt_queue_clear(RtQueue *q) {
+    g_free(q->slots);
+    g_mutex_clear(&q->lock);
+    g_cond_clear(&q->not_empty);
+}
+
+static gboolean rt_queue_push(RtQueue *q, const RtEvent *ev) {
+    g_mutex_lock(&q->lock);
+    if (q->count == q->capacity) {
+        g_mutex_unlock(&q->lock);
+        return FALSE;
+    }
+    q->slots[(q->head + q->count) % q->capacity] = *ev;
+    q->count++;
+    g_cond_signal(&q->not_empty);
+    g_mutex_unlock(&q->lock);
+    return TRUE;
+}
+
+// Returns FALSE once a stop was requested and the queue is drained
+static gboolean rt_queue_pop(RtQueue *q, RtEvent *out) {
+    g_mutex_lock(&q->lock);
+    while (q->count == 0) {
+        if (g_atomic_int_get(&rt_stop)) {
+            g_mutex_unlock(&q->lock);
+            return FALSE;
+        }
+        g_cond_wait_until(&q->not_empty, &q->lock, g_get_monotonic_time() + RT_POLL_MS * 1000);
+    }
+    *out = q->slots[q->head];
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    g_mutex_unlock(&q->lock);
+    return TRUE;
+}
+
+// --- Verdicts ---
+// stats may be NULL for events that should not count towards open() latency
+static void rt_respond(RtEngine *e, RealtimeStats *stats, int fd, guint32 verdict, gint64 t_start) {
+    struct fanotify_response resp;
+    resp.fd = fd;
+    resp.response = verdict;
+    if (write(e->fan_fd, &resp, sizeof(resp)) != (ssize_t)sizeof(resp)) {
+        // Nothing sensible to do; the kernel allows the access once the fd is gone
+    }
+    close(fd);
+    if (!stats) return;
+
+    guint64 lat = (guint64)MAX(0, g_get_monotonic_time() - t_start);
+    stats->events++;
+    stats->latency_total_us += lat;
+    if (lat > stats->latency_max_us) stats->latency_max_us = lat;
+    guint b = 0;
+    while (b < RT_LATENCY_BUCKETS - 1 && ((guint64)1 << b) <= lat) b++;
+    stats->latency_buckets[b]++;
+    if (verdict == FAN_DENY) stats->denied++;
+}
+
+// *generation is the signature generation the verdict holds for
+static guint32 rt_scan_fd(SigReader *reader, RealtimeStats *stats, int fd, guint *generation) {
+    // Re-open through /proc so the regular hashing path is used unchanged.
+    // Our own open raises another event; the reader allows it by pid.
+    char proc_path[64];
+    snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", fd);
+
+    // SHA-256 always; MD5/SHA-1/SHA-512 only if the feed has them
+    const sig_db *db = sigstore_acquire_ex(reader, generation);
+    unsigned algos = (db ? sigdb_algos(db) : 0) | HASH_BIT(HASH_SHA256);
+    sigstore_release(reader);
+
+    // Hash without pinning a generation; a reload may land meanwhile
+    MultiDigest digest;
+    if (compute_file_hashes(proc_path, algos, &digest, NULL, 0, &stats->hash_cost) != 0) {
+        stats->hash_errors++;
+        return FAN_ALLOW;
+    }
+    // If a reload lands mid-hash the digests may not cover the new feed; the
+    // verdict keeps the older generation's tag and is never served from cache
+    char match[128] = "";
+    db = sigstore_acquire(reader);
+    const char *label = db ? sigdb_match(db, &digest, NULL) : NULL;
+    if (label) snprintf(match, sizeof(match), "%s", label);
+    sigstore_release(reader);
+    if (!match[0]) return FAN_ALLOW;
+
+    char target[PATH_MAX];
+    ssize_t n = readlink(proc_path, target, sizeof(target) - 1);
+    target[n > 0 ? n : 0] = '\0';
+    printf("[ALERT] BLOCKED: %s (%s)\n", n > 0 ? target : "?", match);
+    fflush(stdout);
+    return FAN_DENY;
+}
+
+static gpointer rt_worker_thread(gpointer data) {
+    RtWorker *w = (RtWorker *)data;
+    RtEngine *e = w->engine;
+    RtEvent ev;
+    SigReader reader;
+    if (sigstore_reader_register(&reader) != 0)
+        fprintf(stderr, "[WARN] Too many workers for the signature store; this one allows everything\n");
+
+    while (rt_queue_pop(&w->queue, &ev)) {
+        if (g_atomic_int_get(&rt_stop)) {
+            rt_respond(e, &w->stats, ev.fd, FAN_ALLOW, ev.t_start);
+            continue;
+        }
+        // Same key always lands on the same worker, so a burst of opens of one
+        // file is hashed once and the rest are answered from the cache here.
+        guint h = rt_key_hash(&ev.key);
+        guint32 verdict;
+        if (!rt_cache_lookup(e, &ev.key, h, &verdict)) {
+            guint generation;
+            verdict = rt_scan_fd(&reader, &w->stats, ev.fd, &generation);
+            rt_cache_store(e, &ev.key, h, verdict, generation);
+        }
+        rt_respond(e, &w->stats, ev.fd, verdict, ev.t_start);
+    }
+    sigstore_reader_unregister(&reader);
+    return NULL;
+}
+
+// --- Reload ---
+static gpointer rt_loader_thread(gpointer data) {
+    RtEngine *e = (RtEngine *)data;
+    sig_load_report report;
+    // Workers keep answering from the old generation until the new one is published
+    if (sigstore_load(e->sigdb_path, &report) != 0) {
+        fprintf(stderr, "[WARN] Reload failed, keeping the current signatures: %s\n", e->sigdb_path);
+    } else {
+        if (report.malformed > 0)
+            fprintf(stderr, "[WARN] %zu of %zu signature line(s) malformed and skipped\n", report.malformed, report.lines);
+        printf("Signatures reloaded (generation %u)\n", sigstore_generation());
+        fflush(stdout);
+    }
+    g_atomic_int_set(&e->loading, 0);
+    return NULL;
+}
+
+// Called from the reader loop; never waits for a load in progress
+static void rt_maybe_reload(RtEngine *e) {
+    if (!g_atomic_int_get(&rt_reload) || g_atomic_int_get(&e->loading)) return;
+    g_atomic_int_set(&rt_reload, 0);
+    if (e->loader) g_thread_join(e->loader);
+    g_atomic_int_set(&e->loading, 1);
+    e->loader = g_thread_new("RealtimeReload", rt_loader_thread, e);
+}
+
+// --- Reader ---
+static void rt_dispatch(RtEngine *e, const struct fanotify_event_metadata *md, pid_t self, gint64 now) {
+    RealtimeStats *stats = &e->reader_stats;
+
+    if (md->pid == self) {
+        stats->self_events++;
+        rt_respond(e, NULL, md->fd, FAN_ALLOW, now);
+        return;
+    }
+    struct stat st;
+    if (fstat(md->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        rt_respond(e, stats, md->fd, FAN_ALLOW, now);
+        return;
+    }
+
+    RtEvent ev;
+    ev.fd = md->fd;
+    ev.t_start = now;
+    rt_key_from_stat(&ev.key, &st);
+    guint h = rt_key_hash(&ev.key);
+
+    guint32 verdict;
+    if (rt_cache_lookup(e, &ev.key, h, &verdict)) {
+        stats->cache_hits++;
+        rt_respond(e, stats, ev.fd, verdict, now);
+        return;
+    }
+    stats->cache_misses++;
+
+    RtWorker *w = &e->workers[(h / RT_CACHE_SHARDS) % e->num_workers];
+    if (!rt_queue_push(&w->queue, &ev)) {
+        // Never block the reader: a stuck reader would freeze every open() on the mount
+        stats->queue_overflows++;
+        rt_respond(e, stats, ev.fd, FAN_ALLOW, now);
+    }
+}
+
+// Allows every permission event left in the batch and closes every fd, so no
+// open() stays blocked on events this reader will not dispatch
+static void rt_release_batch(RtEngine *e, const struct fanotify_event_metadata *md, ssize_t len) {
+    for (; FAN_EVENT_OK(md, len); md = FAN_EVENT_NEXT(md, len)) {
+        if (md->fd < 0) continue;
+        if (md->mask & (FAN_OPEN_PERM | FAN_OPEN_EXEC_PERM)) rt_respond(e, NULL, md->fd, FAN_ALLOW, 0);
+        else close(md->fd);
+    }
+}
+
+// Returns 0 when stopped, -3 when the kernel speaks another metadata version
+static int rt_reader_loop(RtEngine *e) {
+    struct fanotify_event_metadata buf[RT_EVENT_BATCH];
+    struct pollfd pfd = { .fd = e->fan_fd, .events = POLLIN };
+    pid_t self = getpid();
+
+    while (!g_atomic_int_get(&rt_stop)) {
+        rt_maybe_reload(e);
+        int ready = poll(&pfd, 1, RT_POLL_MS);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+
+        ssize_t len = read(e->fan_fd, buf, sizeof(buf));
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            break;
+        }
+        gint64 now = g_get_monotonic_time();
+
+        const struct fanotify_event_metadata *md = buf;
+        for (; FAN_EVENT_OK(md, len); md = FAN_EVENT_NEXT(md, len)) {
+            if (md->vers != FANOTIFY_METADATA_VERSION) {
+                fprintf(stderr, "[WARN] fanotify metadata version %u, this build knows %u; stopping\n",
+                        (unsigned)md->vers, (unsigned)FANOTIFY_METADATA_VERSION);
+                rt_release_batch(e, md, len);
+                return -3;
+            }
+            if (md->fd < 0) continue;   // Queue overflow notice, nothing to answer
+            if (md->mask & (FAN_OPEN_PERM | FAN_OPEN_EXEC_PERM)) {
+                rt_dispatch(e, md, self, now);
+            } else {
+                close(md->fd);
+            }
+        }
+    }
+    return 0;
+}
+
+static void rt_merge_stats(RealtimeStats *dst, const RealtimeStats *src) {
+    dst->events += src->events;
+    dst->self_events += src->self_events;
+    dst->cache_hits += src->cache_hits;
+    dst->cache_misses += src->cache_misses;
+    dst->queue_overflows += src->queue_overflows;
+    dst->hash_errors += src->hash_errors;
+    dst->denied += src->denied;
+    dst->latency_total_us += src->latency_total_us;
+    if (src->latency_max_us > dst->latency_max_us) dst->latency_max_us = src->latency_max_us;
+    for (int i = 0; i < RT_LATENCY_BUCKETS; ++i) dst->latency_buckets[i] += src->latency_buckets[i];
+    hash_cost_add(&dst->hash_cost, &src->hash_cost);
+}
+
+// --- Public API ---
+void realtime_config_defaults(RealtimeConfig *cfg) {
+    cfg->mount_path = "/";
+    cfg->num_workers = 0;
+    cfg->queue_capacity = 1024;
+    cfg->cache_capacity = 64 * 1024;
+}
+
+void realtime_scan_stop(void) {
+    g_atomic_int_set(&rt_stop, 1);
+}
+
+void realtime_scan_reload(void) {
+    g_atomic_int_set(&rt_reload, 1);
+}
+
+int realtime_scan_run(const char *sigdb_path, const RealtimeConfig *cfg_in, RealtimeStats *out_stats) {
+    RealtimeConfig cfg;
+    if (cfg_in) cfg = *cfg_in;
+    else realtime_config_defaults(&cfg);
+    if (cfg.num_workers == 0) cfg.num_workers = MAX(1, g_get_num_processors());
+    if (cfg.queue_capacity == 0) cfg.queue_capacity = 1024;
+
+    RtEngine e;
+    memset(&e, 0, sizeof(e));
+    e.sigdb_path = sigdb_path;
+    sig_load_report report;
+    if (sigstore_load(sigdb_path, &report) != 0) return -1;
+    if (report.malformed > 0)
+        fprintf(stderr, "[WARN] %zu of %zu signature line(s) malformed and skipped\n", report.malformed, report.lines);
+
+    e.fan_fd = fanotify_init(FAN_CLOEXEC | FAN_CLASS_CONTENT | FAN_NONBLOCK, O_RDONLY | O_LARGEFILE);
+    if (e.fan_fd < 0) {
+        sigstore_shutdown();
+        return -2;
+    }
+    if (fanotify_mark(e.fan_fd, FAN_MARK_ADD | FAN_MARK_MOUNT,
+                      FAN_OPEN_PERM | FAN_OPEN_EXEC_PERM, AT_FDCWD, cfg.mount_path) != 0 &&
+        // Pre-5.0 kernels reject FAN_OPEN_EXEC_PERM; exec still opens the file, so OPEN_PERM covers it
+        fanotify_mark(e.fan_fd, FAN_MARK_ADD | FAN_MARK_MOUNT,
+                      FAN_OPEN_PERM, AT_FDCWD, cfg.mount_path) != 0) {
+        close(e.fan_fd);
+        sigstore_shutdown();
+        return -2;
+    }
+
+    g_atomic_int_set(&rt_stop, 0);
+    g_atomic_int_set(&rt_reload, 0);
+    e.shard_capacity = MAX(1, cfg.cache_capacity / RT_CACHE_SHARDS);
+    for (int i = 0; i < RT_CACHE_SHARDS; ++i) {
+        g_mutex_init(&e.shards[i].lock);
+        e.shards[i].verdicts = g_hash_table_new_full(rt_key_hash, rt_key_equal, g_free, NULL);
+    }
+
+    e.num_workers = cfg.num_workers;
+    e.workers = g_new0(RtWorker, e.num_workers);
+    for (guint i = 0; i < e.num_workers; ++i) {
+        e.workers[i].engine = &e;
+        rt_queue_init(&e.workers[i].queue, cfg.queue_capacity);
+        e.workers[i].thread = g_thread_new("RealtimeWorker", rt_worker_thread, &e.workers[i]);
+    }
+
+    int status = rt_reader_loop(&e);
+
+    // Workers answer whatever is still queued with ALLOW, then exit
+    g_atomic_int_set(&rt_stop, 1);
+    if (e.loader) g_thread_join(e.loader);
+    RealtimeStats total = e.reader_stats;
+    for (guint i = 0; i < e.num_workers; ++i) {
+        g_thread_join(e.workers[i].thread);
+        rt_merge_stats(&total, &e.workers[i].stats);
+        rt_queue_clear(&e.workers[i].queue);
+    }
+    g_free(e.workers);
+    close(e.fan_fd);
+
+    for (int i = 0; i < RT_CACHE_SHARDS; ++i) {
+        g_hash_table_destroy(e.shards[i].verdicts);
+        g_mutex_clear(&e.shards[i].lock);
+    }
+    sigstore_shutdown();
+
+    if (out_stats) *out_stats = total;
+    return status;
+}
+
+// Upper bound (us) of the bucket holding the given percentile
+static guint64 rt_percentile(const RealtimeStats *s, double pct) {
+    guint64 target = (guint64)(s->events * pct);
+    guint64 seen = 0;
+    for (int b = 0; b < RT_LATENCY_BUCKETS; ++b) {
+        seen += s->latency_buckets[b];
+        if (seen > target) return (guint64)1 << b;
+    }
+    return s->latency_max_us;
+}
+
+void realtime_print_stats(FILE *out, const RealtimeStats *s) {
+    guint64 lookups = s->cache_hits + s->cache_misses;
+    fprintf(out, "--- Real-time protection summary ---\n");
+    fprintf(out, "Events answered : %llu (+%llu own opens)\n",
+            (unsigned long long)s->events, (unsigned long long)s->self_events);
+    fprintf(out, "Verdict cache   : %llu hits / %llu misses (%.1f%% hit rate)\n",
+            (unsigned long long)s->cache_hits, (unsigned long long)s->cache_misses,
+            lookups ? 100.0 * (double)s->cache_hits / (double)lookups : 0.0);
+    fprintf(out, "Denied          : %llu\n", (unsigned long long)s->denied);
+    fprintf(out, "Fail-open       : %llu queue full, %llu unreadable\n",
+            (unsigned long long)s->queue_overflows, (unsigned long long)s->hash_errors);
+    if (s->hash_cost.files) hash_cost_print(out, &s->hash_cost);
+    if (s->events == 0) return;
+    fprintf(out, "open() latency  : avg %.1f us, p50 < %llu us, p99 < %llu us, max %llu us\n",
+            (double)s->latency_total_us / (double)s->events,
+            (unsigned long long)rt_percentile(s, 0.50),
+            (unsigned long long)rt_percentile(s, 0.99),
+            (unsigned long long)s->latency_max_us);
+    for (int b = 0; b < RT_LATENCY_BUCKETS; ++b) {
+        if (s->latency_buckets[b] == 0) continue;
+        fprintf(out, "  < %8llu us : %llu\n",
+                (unsigned long long)((guint64)1 << b), (unsigned long long)s->latency_buckets[b]);
+    }
+}
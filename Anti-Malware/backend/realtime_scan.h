@@ -0,0 +1,45 @@
+#ifndef REALTIME_SCAN_H
+#define REALTIME_SCAN_H
+#include <glib.h>
+#include <stdio.h>
+#include "multi_hash.h"
+/* On-access (real-time) protection for Linux built on fanotify permission
+ * events. Every open/exec of a regular file is held by the kernel until we
+ * answer allow/deny; verdicts are cached per (dev, inode, mtime, ctime). */
+
+#define RT_LATENCY_BUCKETS 20   // log2 microsecond buckets: <1us, <2us, ... <2^19us
+
+typedef struct {
+    const char *mount_path;     // Mount to watch ("/" by default)
+    guint num_workers;          // Hashing threads (0 = one per core)
+    guint queue_capacity;       // Bounded queue length per worker
+    guint cache_capacity;       // Max cached verdicts before the cache is recycled
+} RealtimeConfig;
+
+typedef struct {
+    guint64 events;             // Permission events answered
+    guint64 self_events;        // Our own opens, allowed immediately
+    guint64 cache_hits;
+    guint64 cache_misses;
+    guint64 queue_overflows;    // Queue full: allowed without scanning (fail-open)
+    guint64 hash_errors;        // Could not read the file: allowed
+    guint64 denied;
+    guint64 latency_total_us;   // Time the opening process was held
+    guint64 latency_max_us;
+    guint64 latency_buckets[RT_LATENCY_BUCKETS];
+    HashCost hash_cost;         // Per-algorithm hashing time on cache misses
+} RealtimeStats;
+
+void realtime_config_defaults(RealtimeConfig *cfg);
+// Blocks until realtime_scan_stop() is called. Returns 0 on clean shutdown,
+// -1 if the DB could not be loaded, -2 if fanotify is unavailable (needs CAP_SYS_ADMIN),
+// -3 if the kernel sent an unknown event metadata version (pending events are allowed)
+int realtime_scan_run(const char *sigdb_path, const RealtimeConfig *cfg, RealtimeStats *out_stats);
+// Async-signal-safe
+void realtime_scan_stop(void);
+// Async-signal-safe. Re-reads the DB in the background and swaps it in while
+// workers keep scanning; cached verdicts from the old DB stop being served.
+void realtime_scan_reload(void);
+void realtime_print_stats(FILE *out, const RealtimeStats *stats);
+
+#endif
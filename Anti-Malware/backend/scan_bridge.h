@@ -1,6 +1,6 @@
 #ifndef SCAN_BRIDGE_H
 #define SCAN_BRIDGE_H
-#include <gtk/gtk.h>
+#include <glib.h>
 #include <stdbool.h>
 
 typedef struct {
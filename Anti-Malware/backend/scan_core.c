@@ -6,10 +6,33 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#ifdef _WIN32
 #include <windows.h>
 #include <shlobj.h>
 #include <objbase.h>
-#define READ_CHUNK (64 * 1024)
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <limits.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+#endif
+#define READ_CHUNK SCANCORE_READ_CHUNK
+
+WalkLimits walk_limits = { false, 300000, NULL, NULL };
+
+// Records one directory's own listing time; returns its time with subdirectories
+static guint64 dir_time_done(guint64 t0, guint64 children) {
+    if (!walk_limits.dir_times) return 0;
+    guint64 total = hash_clock_ns() - t0;
+    stage_hist_add(walk_limits.dir_times, total - MIN(children, total));
+    return total;
+}
+
+#ifdef _WIN32
 
 // Helper to check if a path exists and is a directory before adding
 static void add_path_safe(GList **list, const char *path) {
@@ -19,22 +42,54 @@ static void add_path_safe(GList **list, const char *path) {
         *list = g_list_append(*list, g_strdup(path));
     }
 }
-// Internal recursive walker
-static void list_path_recursive_internal(const char *base_path, FilePathList *list) {
+// --- Walk Guard ---
+struct WalkGuard {
+    int unused;
+};
+
+WalkGuard *walk_guard_new(const char *root) {
+    (void)root;
+    return g_new0(WalkGuard, 1);
+}
+
+// Junctions, directory symlinks and volume mount points are reparse points:
+// following them can loop ("Application Data") or leave the volume
+bool walk_guard_enter(WalkGuard *g, const char *dir_path) {
+    (void)g;
+    DWORD attr = GetFileAttributesA(dir_path);
+    return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) &&
+           !(attr & FILE_ATTRIBUTE_REPARSE_POINT);
+}
+
+void walk_guard_free(WalkGuard *g) {
+    g_free(g);
+}
+// Seconds since the Unix epoch
+static gint64 filetime_unix(const FILETIME *ft) {
+    guint64 t = ((guint64)ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+    return (gint64)((t - 116444736000000000ULL) / 10000000ULL);
+}
+
+// Internal recursive walker; `cur` is base_path's rule cursor (NULL without rules).
+// Returns the time spent, subdirectories included, when walk_limits.dir_times is set.
+static guint64 list_path_recursive_internal(const char *base_path, const WalkSink *sink, WalkGuard *guard,
+                                            const RuleCursor *cur) {
+    ScanRules *rules = walk_limits.rules;
     WIN32_FIND_DATA find_data;
     char search_path[MAX_PATH];   
+    guint64 t0 = walk_limits.dir_times ? hash_clock_ns() : 0, children = 0;
     // Check if stop was requested
     g_mutex_lock(&global_scan_ctx.mutex);
     if (global_scan_ctx.stop_requested) {
         g_mutex_unlock(&global_scan_ctx.mutex);
-        return;
+        return 0;
     }
     g_mutex_unlock(&global_scan_ctx.mutex);
     // Create search pattern: "C:\Path\*"
     snprintf(search_path, sizeof(search_path), "%s\\*", base_path);
     
     HANDLE h_find = FindFirstFile(search_path, &find_data);
-    if (h_find == INVALID_HANDLE_VALUE) return;
+    if (h_find == INVALID_HANDLE_VALUE) return 0;
 
     do {
         // Skip "." and ".."
@@ -45,41 +100,483 @@ static void list_path_recursive_internal(const char *base_path, FilePathList *li
         snprintf(full_path, sizeof(full_path), "%s\\%s", base_path, find_data.cFileName);
 
         if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-            // Recursive call
-            list_path_recursive_internal(full_path, list);
-        } else {
+            // Recursive call (not through junctions or directory symlinks, not into excluded trees)
+            RuleCursor child;
+            if (find_data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) continue;
+            if (rules && !scan_rules_enter_dir(rules, cur, find_data.cFileName, &child)) continue;
+            children += list_path_recursive_internal(full_path, sink, guard, rules ? &child : NULL);
+        } else if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DEVICE)) {
             // It's a file, add to list
-            list->paths = g_list_append(list->paths, g_strdup(full_path));
-            list->total_files++;
+            guint64 size = ((guint64)find_data.nFileSizeHigh << 32) | find_data.nFileSizeLow;
+            if (rules && scan_rules_want_file(rules, cur, find_data.cFileName, size,
+                                              filetime_unix(&find_data.ftLastWriteTime)) != RULES_SCAN)
+                continue;
+            sink->fn(sink->user, full_path);
         }
 
     } while (FindNextFile(h_find, &find_data) != 0);
 
     FindClose(h_find);
+    return dir_time_done(t0, children);
 }
-// --- SHA-256 Computation ---
-int compute_file_sha256(const char *path, unsigned char out_hash[32]) {
+#else
+// POSIX flavour of the helpers above, used by the Linux real-time daemon
+static void add_path_safe(GList **list, const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        *list = g_list_append(*list, g_strdup(path));
+    }
+}
+// --- Walk Guard ---
+struct WalkGuard {
+    GHashTable *visited;        // FileIdentity of every directory entered
+    GHashTable *devices;        // st_dev -> 1 walkable / 2 pseudo filesystem
+    dev_t root_dev;
+};
+
+#ifdef __linux__
+// Kernel views whose "files" block, never end or are not files at all (statfs f_type)
+static const unsigned long pseudo_fs_magic[] = {
+    0x9fa0,         // proc
+    0x62656572,     // sysfs
+    0x1cd1,         // devpts
+    0x64626720,     // debugfs
+    0x74726163,     // tracefs
+    0x73636673,     // securityfs
+    0x27e0eb,       // cgroup
+    0x63677270,     // cgroup2
+    0x6165676c,     // pstore
+    0xcafe4a11,     // bpf
+    0x62656570,     // configfs
+    0x65735543,     // fusectl
+};
+
+static bool is_pseudo_fs(const char *path) {
+    struct statfs sfs;
+    if (statfs(path, &sfs) != 0) return false;
+    for (size_t i = 0; i < sizeof(pseudo_fs_magic) / sizeof(pseudo_fs_magic[0]); ++i)
+        if ((unsigned long)sfs.f_type == pseudo_fs_magic[i]) return true;
+    return false;
+}
+#else
+static bool is_pseudo_fs(const char *path) {
+    (void)path;
+    return false;
+}
+#endif
+
+WalkGuard *walk_guard_new(const char *root) {
+    WalkGuard *g = g_new0(WalkGuard, 1);
+    g->visited = g_hash_table_new_full(file_identity_hash, file_identity_equal, g_free, NULL);
+    g->devices = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+    struct stat st;
+    g->root_dev = (stat(root, &st) == 0) ? st.st_dev : 0;
+    return g;
+}
+
+bool walk_guard_enter(WalkGuard *g, const char *dir_path) {
+    struct stat st;
+    if (stat(dir_path, &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+    if (walk_limits.one_filesystem && st.st_dev != g->root_dev) return false;
+    // statfs once per device, not per directory
+    gint64 *dev = g_new(gint64, 1);
+    *dev = (gint64)st.st_dev;
+    gpointer kind = g_hash_table_lookup(g->devices, dev);
+    if (!kind) {
+        kind = GINT_TO_POINTER(is_pseudo_fs(dir_path) ? 2 : 1);
+        g_hash_table_insert(g->devices, dev, kind);
+    } else {
+        g_free(dev);
+    }
+    if (GPOINTER_TO_INT(kind) == 2) return false;
+    // A bind mount or a loop back to an ancestor: this directory was already entered
+    FileIdentity *id = g_new(FileIdentity, 1);
+    id->volume = (guint64)st.st_dev;
+    id->index = (guint64)st.st_ino;
+    if (g_hash_table_contains(g->visited, id)) {
+        g_free(id);
+        return false;
+    }
+    g_hash_table_add(g->visited, id);
+    return true;
+}
+
+void walk_guard_free(WalkGuard *g) {
+    if (!g) return;
+    g_hash_table_destroy(g->visited);
+    g_hash_table_destroy(g->devices);
+    g_free(g);
+}
+
+// DT_DIR, DT_REG, or DT_UNKNOWN for everything else. d_type spares an lstat per
+// entry on filesystems that fill it in.
+static unsigned char entry_type(const struct dirent *entry, const char *full_path) {
+#ifdef _DIRENT_HAVE_D_TYPE
+    if (entry->d_type == DT_DIR || entry->d_type == DT_REG) return entry->d_type;
+    if (entry->d_type != DT_UNKNOWN) return DT_UNKNOWN;   // Symlink, FIFO, socket, device
+#else
+    (void)entry;
+#endif
+    // lstat: never follow symlinks out of the tree
+    struct stat st;
+    if (lstat(full_path, &st) != 0) return DT_UNKNOWN;
+    if (S_ISDIR(st.st_mode)) return DT_DIR;
+    if (S_ISREG(st.st_mode)) return DT_REG;
+    return DT_UNKNOWN;
+}
+
+static guint64 list_path_recursive_internal(const char *base_path, const WalkSink *sink, WalkGuard *guard,
+                                            const RuleCursor *cur) {
+    ScanRules *rules = walk_limits.rules;
+    bool need_stat = scan_rules_need_stat(rules);
+    guint64 t0 = walk_limits.dir_times ? hash_clock_ns() : 0, children = 0;
+    g_mutex_lock(&global_scan_ctx.mutex);
+    if (global_scan_ctx.stop_requested) {
+        g_mutex_unlock(&global_scan_ctx.mutex);
+        return 0;
+    }
+    g_mutex_unlock(&global_scan_ctx.mutex);
+
+    DIR *dir = opendir(base_path);
+    if (!dir) return 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        char full_path[PATH_MAX];
+        snprintf(full_path, sizeof(full_path), "%s/%s", base_path, entry->d_name);
+        unsigned char type = entry_type(entry, full_path);
+
+        if (type == DT_DIR) {
+            RuleCursor child;
+            if (rules && !scan_rules_enter_dir(rules, cur, entry->d_name, &child)) continue;
+            if (walk_guard_enter(guard, full_path))
+                children += list_path_recursive_internal(full_path, sink, guard, rules ? &child : NULL);
+        } else if (type == DT_REG) {
+            if (rules) {
+                struct stat st = { 0 };
+                if (need_stat && lstat(full_path, &st) != 0) continue;
+                if (scan_rules_want_file(rules, cur, entry->d_name, (guint64)st.st_size,
+                                         (gint64)st.st_mtime) != RULES_SCAN)
+                    continue;
+            }
+            sink->fn(sink->user, full_path);
+        }
+    }
+    closedir(dir);
+    return dir_time_done(t0, children);
+}
+#endif
+// --- Read Watchdog ---
+#ifdef _WIN32
+#define READ_WATCH_TICK_MS 100
+
+static GMutex watch_lock;
+static GCond watch_added;
+static ReadWatch *watches;      // Active ones, under watch_lock
+static GThread *watchdog;
+
+static void close_thread_handle(gpointer h) {
+    CloseHandle((HANDLE)h);
+}
+// CancelSynchronousIo needs a real handle with THREAD_TERMINATE; one per thread, kept
+static GPrivate thread_handle = G_PRIVATE_INIT(close_thread_handle);
+
+static gpointer watchdog_thread(gpointer data) {
+    (void)data;
+    g_mutex_lock(&watch_lock);
+    for (;;) {
+        while (!watches) g_cond_wait(&watch_added, &watch_lock);
+        gint64 now = g_get_monotonic_time();
+        for (ReadWatch *w = watches; w; w = w->next) {
+            if (now <= w->deadline) continue;
+            // Nothing pending (between two reads) is not an error: the next tick tries again
+            CancelSynchronousIo((HANDLE)w->thread);
+            g_atomic_int_set(&w->fired, 1);
+        }
+        g_cond_wait_until(&watch_added, &watch_lock, now + READ_WATCH_TICK_MS * G_TIME_SPAN_MILLISECOND);
+    }
+    return NULL;
+}
+#endif
+
+void read_watch_begin(ReadWatch *w, guint timeout_ms) {
+    memset(w, 0, sizeof(*w));
+    if (timeout_ms == 0) return;
+    w->deadline = g_get_monotonic_time() + (gint64)timeout_ms * 1000;
+#ifdef _WIN32
+    w->thread = g_private_get(&thread_handle);
+    if (!w->thread) {
+        w->thread = OpenThread(THREAD_TERMINATE, FALSE, GetCurrentThreadId());
+        if (!w->thread) return;     // Unwatched: the deadline still holds between reads
+        g_private_set(&thread_handle, w->thread);
+    }
+    g_mutex_lock(&watch_lock);
+    if (!watchdog) watchdog = g_thread_new("ReadWatchdog", watchdog_thread, NULL);
+    w->next = watches;
+    if (watches) watches->prev = w;
+    watches = w;
+    g_cond_signal(&watch_added);
+    g_mutex_unlock(&watch_lock);
+#endif
+}
+
+gboolean read_watch_expired(const ReadWatch *w) {
+    return w->deadline && (g_atomic_int_get(&w->fired) || g_get_monotonic_time() > w->deadline);
+}
+
+gboolean read_watch_end(ReadWatch *w) {
+    if (!w->deadline) return FALSE;
+#ifdef _WIN32
+    if (w->thread) {
+        // Under the lock: once this returns the watchdog cannot cancel this thread's next I/O
+        g_mutex_lock(&watch_lock);
+        if (w->prev) w->prev->next = w->next;
+        else watches = w->next;
+        if (w->next) w->next->prev = w->prev;
+        g_mutex_unlock(&watch_lock);
+    }
+#endif
+    return read_watch_expired(w);
+}
+
+// --- Hash Computation ---
+// Reading is what the loop took once the sinks and the digests (timed by
+// multi_hash) are taken out, so a chunk costs at most two clock reads
+static void io_cost_done(HashCost *cost, guint64 t_loop, guint64 sink_ticks, guint64 hash_ns0) {
+    guint64 loop_ns = stage_elapsed_ns(t_loop), sink_ns = stage_ticks_ns(sink_ticks), hash_ns = 0;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) hash_ns += cost->ns[a];
+    hash_ns -= hash_ns0;
+    cost->sink_ns += sink_ns;
+    cost->read_ns += (loop_ns > sink_ns + hash_ns) ? loop_ns - sink_ns - hash_ns : 0;
+}
+
+int compute_file_hashes(const char *path, unsigned algos, MultiDigest *out,
+                        const ScanChunkSink *sinks, int n_sinks, HashCost *cost) {
+    // With `cost`, the open, the sinks and the reads are timed on the stage clock
+    if (cost) scan_stats_calibrate();
+    guint64 t_loop = cost ? stage_ticks() : 0, sink_ticks = 0, hash_ns0 = 0;
+    // A file that streams forever or a stalled network share costs at most the
+    // budget: the open and every read are watched, and the loop checks between chunks
+    ReadWatch watch;
+    read_watch_begin(&watch, walk_limits.read_timeout_ms);
+#ifdef _WIN32
     FILE *f = fopen(path, "rb");
-    if (!f) return -1;
+    if (!f) return read_watch_end(&watch) ? SCANCORE_TIMEOUT : -1;
+#else
+    // O_NONBLOCK: a FIFO swapped in since the walk cannot block the open.
+    // Anything but a regular file is refused once opened.
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0) return read_watch_end(&watch) ? SCANCORE_TIMEOUT : -1;
+    struct stat st;
+    FILE *f = (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) ? fdopen(fd, "rb") : NULL;
+    if (!f) {
+        close(fd);
+        read_watch_end(&watch);
+        return -1;
+    }
+#endif
+    if (cost) {
+        guint64 opened = stage_ticks();
+        cost->open_ns += stage_ticks_ns(opened - t_loop);
+        t_loop = opened;
+        for (int a = 0; a < HASH_ALGO_COUNT; ++a) hash_ns0 += cost->ns[a];
+    }
 
     unsigned char buf[READ_CHUNK];
-    sha256_ctx ctx;
-    sha256_init(&ctx);
+    MultiHash mh;
+    multi_hash_init(&mh, algos, cost);
 
     size_t r;
-    while ((r = fread(buf, 1, sizeof(buf), f)) > 0)
-        sha256_update(&ctx, buf, r);
+    guint64 offset = 0;
+    int rc = 0;
+    while ((r = fread(buf, 1, sizeof(buf), f)) > 0) {
+        if (read_watch_expired(&watch)) {
+            rc = SCANCORE_TIMEOUT;
+            break;
+        }
+        // Sinks first: one that only needs the head can stop the read before hashing
+        guint64 ts = (cost && n_sinks > 0) ? stage_ticks() : 0;
+        for (int i = 0; i < n_sinks && rc == 0; ++i) {
+            if (sinks[i].on_chunk(sinks[i].user, offset, buf, r) != 0) rc = SCANCORE_HANDLED;
+        }
+        if (ts) sink_ticks += stage_ticks() - ts;
+        if (rc != 0) break;
+        multi_hash_update(&mh, buf, r);
+        offset += r;
+    }
+    if (cost) io_cost_done(cost, t_loop, sink_ticks, hash_ns0);
+
+    // A read the watchdog cancelled fails like any other: past the deadline that is the timeout
+    gboolean late = read_watch_end(&watch);
+    if (rc == 0 && ferror(f)) rc = late ? SCANCORE_TIMEOUT : -1;
+    if (rc == 0) multi_hash_final(&mh, out);
+    fclose(f);
+    return rc;
+}
+
+int compute_file_sha256_ex(const char *path, unsigned char out_hash[32],
+                           const ScanChunkSink *sinks, int n_sinks) {
+    MultiDigest d;
+    if (compute_file_hashes(path, HASH_BIT(HASH_SHA256), &d, sinks, n_sinks, NULL) != 0) return -1;
+    memcpy(out_hash, d.digest[HASH_SHA256], SHA256_DIGEST_SIZE);
+    return 0;
+}
+
+int compute_file_sha256(const char *path, unsigned char out_hash[32]) {
+    return compute_file_sha256_ex(path, out_hash, NULL, 0);
+}
+// --- File Identity ---
+#ifdef _WIN32
+int get_file_identity(const char *path, FileIdentity *id) {
+    // No read access needed: metadata only, and it works on files opened exclusively
+    HANDLE h = CreateFileA(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (h == INVALID_HANDLE_VALUE) return -1;
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(h, &info);
+    CloseHandle(h);
+    if (!ok) return -1;
+    id->volume = info.dwVolumeSerialNumber;
+    id->index = ((guint64)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    return 0;
+}
+
+int get_file_stamp(const char *path, FileStamp *stamp) {
+    HANDLE h = CreateFileA(path, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (h == INVALID_HANDLE_VALUE) return -1;
+    BY_HANDLE_FILE_INFORMATION info;
+    FILE_BASIC_INFO basic;
+    BOOL ok = GetFileInformationByHandle(h, &info) &&
+              GetFileInformationByHandleEx(h, FileBasicInfo, &basic, sizeof(basic));
+    CloseHandle(h);
+    if (!ok) return -1;
+    stamp->id.volume = info.dwVolumeSerialNumber;
+    stamp->id.index = ((guint64)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    stamp->change = basic.ChangeTime.QuadPart;
+    return 0;
+}
+#else
+int get_file_identity(const char *path, FileIdentity *id) {
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+    id->volume = (guint64)st.st_dev;
+    id->index = (guint64)st.st_ino;
+    return 0;
+}
+
+int get_file_stamp(const char *path, FileStamp *stamp) {
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+    stamp->id.volume = (guint64)st.st_dev;
+    stamp->id.index = (guint64)st.st_ino;
+#ifdef __APPLE__
+    stamp->change = (gint64)st.st_ctimespec.tv_sec * 1000000000 + st.st_ctimespec.tv_nsec;
+#else
+    stamp->change = (gint64)st.st_ctim.tv_sec * 1000000000 + st.st_ctim.tv_nsec;
+#endif
+    return 0;
+}
+#endif
+
+guint file_identity_hash(gconstpointer key) {
+    const FileIdentity *id = (const FileIdentity *)key;
+    guint64 h = id->index * 0x9E3779B97F4A7C15ULL ^ id->volume;
+    return (guint)(h ^ (h >> 32));
+}
 
-    if (ferror(f)) {
-        fclose(f);
+gboolean file_identity_equal(gconstpointer a, gconstpointer b) {
+    const FileIdentity *x = (const FileIdentity *)a, *y = (const FileIdentity *)b;
+    return x->index == y->index && x->volume == y->volume;
+}
+// --- File Mapping ---
+#ifdef _WIN32
+int map_file(const char *path, size_t max_len, FileMap *m) {
+    memset(m, 0, sizeof(*m));
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return -1;
+    LARGE_INTEGER size;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart == 0 ||
+        (guint64)size.QuadPart > max_len) {
+        CloseHandle(file);
+        return -1;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const unsigned char *data = mapping ? (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
         return -1;
     }
+    m->data = data;
+    m->len = (size_t)size.QuadPart;
+    m->file = file;
+    m->mapping = mapping;
+    return 0;
+}
 
-    sha256_final(&ctx, out_hash);
-    fclose(f);
+void unmap_file(FileMap *m) {
+    if (!m->data) return;
+    UnmapViewOfFile(m->data);
+    CloseHandle((HANDLE)m->mapping);
+    CloseHandle((HANDLE)m->file);
+    m->data = NULL;
+}
+#else
+int map_file(const char *path, size_t max_len, FileMap *m) {
+    memset(m, 0, sizeof(*m));
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || (guint64)st.st_size > max_len) {
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);      // The mapping keeps its own reference
+    if (p == MAP_FAILED) return -1;
+    m->data = (const unsigned char *)p;
+    m->len = (size_t)st.st_size;
     return 0;
 }
+
+void unmap_file(FileMap *m) {
+    if (!m->data) return;
+    munmap((void *)m->data, m->len);
+    m->data = NULL;
+}
+#endif
+// --- File Replacement ---
+int replace_file_atomic(const char *tmp, const char *path) {
+#ifdef _WIN32
+    int ok = MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    int ok = rename(tmp, path) == 0;
+#endif
+    if (!ok) remove(tmp);
+    return ok ? 0 : -1;
+}
+
+// --- Path Escaping ---
+// Control characters and '%' as %XX; everything else verbatim
+void append_escaped_path(GString *s, const char *path) {
+    const char *run = path;
+    for (const char *p = path; *p; ++p) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '%') continue;
+        g_string_append_len(s, run, p - run);
+        g_string_append_printf(s, "%%%02X", c);
+        run = p + 1;
+    }
+    g_string_append(s, run);
+}
+
 // --- Quick Scan Path Generator ---
+#ifdef _WIN32
 GList* get_quick_scan_paths(void) {
     GList *list = NULL;
     char path[MAX_PATH];
@@ -115,7 +612,45 @@ GList* get_quick_scan_paths(void) {
 
     return list;
 }
+#else
+GList* get_quick_scan_paths(void) {
+    GList *list = NULL;
+    char path[PATH_MAX];
+    // 1. World-writable drop locations
+    add_path_safe(&list, "/tmp");
+    add_path_safe(&list, "/var/tmp");
+    add_path_safe(&list, "/dev/shm");
+    // 2. User specific folders
+    const char *home = getenv("HOME");
+    if (home) {
+        snprintf(path, sizeof(path), "%s/.config/autostart", home);
+        add_path_safe(&list, path);
+        snprintf(path, sizeof(path), "%s/Desktop", home);
+        add_path_safe(&list, path);
+        snprintf(path, sizeof(path), "%s/Downloads", home);
+        add_path_safe(&list, path);
+    }
+
+    return list;
+}
+#endif
 // --- Recursive Path Lister Entry Point ---
+void walk_files(const char *path_to_scan, const WalkSink *sink) {
+    RuleCursor root;
+    ScanRules *rules = walk_limits.rules;
+    WalkGuard *guard = walk_guard_new(path_to_scan);
+    if ((!rules || scan_rules_begin(rules, path_to_scan, &root)) && walk_guard_enter(guard, path_to_scan))
+        list_path_recursive_internal(path_to_scan, sink, guard, rules ? &root : NULL);
+    walk_guard_free(guard);
+}
+
+// Prepended and reversed once at the end: appending walks the whole list per file
+static void list_add(void *user, const char *path) {
+    FilePathList *list = (FilePathList *)user;
+    list->paths = g_list_prepend(list->paths, g_strdup(path));
+    list->total_files++;
+}
+
 FilePathList* list_files_recursive(const char *path_to_scan) {
     FilePathList *list = malloc(sizeof(FilePathList));
     if (!list) return NULL;
@@ -123,7 +658,9 @@ FilePathList* list_files_recursive(const char *path_to_scan) {
     list->paths = NULL;
     list->total_files = 0;
 
-    list_path_recursive_internal(path_to_scan, list);
+    WalkSink sink = { list_add, list };
+    walk_files(path_to_scan, &sink);
+    list->paths = g_list_reverse(list->paths);
     
     return list;
 }
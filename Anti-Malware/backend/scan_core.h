@@ -1,14 +1,27 @@
 #ifndef SCAN_CORE_H
 #define SCAN_CORE_H
-#include <gtk/gtk.h>
+#include <glib.h>
 #include <sys/stat.h>
 #include <stdbool.h>
+#include "multi_hash.h"
+#include "scan_rules.h"
+#include "scan_stats.h"
 /* Return codes */
 #define SCANCORE_OK          0
 #define SCANCORE_MATCH       1
 #define SCANCORE_HANDLED     2
 #define SCANCORE_FATAL_ERR  -1
 #define SCANCORE_FILE_ERR   -2
+#define SCANCORE_TIMEOUT    -3
+
+// Walker and reader limits (settings.conf)
+typedef struct {
+    bool one_filesystem;        // POSIX: never leave the device of the scan root
+    guint read_timeout_ms;      // Budget to hash one file; 0 = unlimited
+    ScanRules *rules;           // scan_rules.conf for the current scan, NULL = scan everything
+    StageHist *dir_times;       // Listing time per directory for the current scan, NULL = untimed
+} WalkLimits;
+extern WalkLimits walk_limits;
 
 // --- Data Structures ---
 typedef struct {
@@ -18,10 +31,95 @@ typedef struct {
 // --- Function Prototypes ---
 // Gets the hardcoded list of Quick Scan paths (System32, Startup, etc.)
 GList* get_quick_scan_paths(void);
-// Recursive scanner (Phase 1)
+// Recursive scanner (Phase 1). Only regular files are listed; symlinks, devices,
+// FIFOs, sockets and pseudo filesystems (/proc, /sys, ...) are skipped, and so is
+// anything walk_limits.rules excludes (excluded directories are never opened).
 FilePathList* list_files_recursive(const char *path_to_scan);
 void free_filepath_list(FilePathList *list);
+// The same walk without the list: each file goes to `fn` as it is found, in walk
+// order, so the caller decides how many paths are held at once. `path` is the
+// walker's own buffer, valid only for the call.
+typedef void (*WalkFileFn)(void *user, const char *path);
+typedef struct {
+    WalkFileFn fn;
+    void *user;
+} WalkSink;
+void walk_files(const char *path_to_scan, const WalkSink *sink);
+// Directory filter shared by the walkers: a directory is entered at most once per
+// walk (bind mounts, junctions), never on a pseudo filesystem, and with
+// one_filesystem only on the root's device
+typedef struct WalkGuard WalkGuard;
+WalkGuard *walk_guard_new(const char *root);
+bool walk_guard_enter(WalkGuard *g, const char *dir_path);
+void walk_guard_free(WalkGuard *g);
 // Hashing
+#define SCANCORE_READ_CHUNK (64 * 1024)    // compute_file_hashes' buffer, on the caller's stack
+// Extra consumers that see every buffer read for hashing, in file order (same read pass).
+// A non-zero return stops reading the file (compute_file_hashes returns SCANCORE_HANDLED).
+typedef int (*ScanChunkFn)(void *user, guint64 offset, const unsigned char *buf, size_t len);
+typedef struct {
+    ScanChunkFn on_chunk;
+    void *user;
+} ScanChunkSink;
+// Every algorithm in `algos` (HASH_BIT mask) is computed from the one read pass.
+// Returns -1 if the file cannot be read (or is not a regular file once opened),
+// SCANCORE_TIMEOUT when reading takes longer than walk_limits.read_timeout_ms and
+// SCANCORE_HANDLED when a sink stopped the read (`out` is then not filled in).
+int compute_file_hashes(const char *path, unsigned algos, MultiDigest *out,
+                        const ScanChunkSink *sinks, int n_sinks, HashCost *cost);
 int compute_file_sha256(const char *path, unsigned char out_hash[32]);
+// --- Read Watchdog ---
+/* Bounds one pass of blocking opens and reads on the calling thread. Past the
+ * deadline a watchdog thread cancels the thread's pending I/O with
+ * CancelSynchronousIo, again on every tick until the pass ends, so a stalled
+ * share or device fails the read instead of holding the worker. POSIX has no
+ * such call for regular files (a hard NFS mount only yields to SIGKILL): there
+ * the deadline is checked between reads. Lives on the caller's stack. */
+typedef struct ReadWatch ReadWatch;
+struct ReadWatch {
+    gint64 deadline;            // Monotonic us; 0 = not watched
+    volatile gint fired;        // The watchdog cancelled I/O at least once
+    gpointer thread;            // Windows: this thread's handle, for the watchdog
+    ReadWatch *prev, *next;     // Active watches
+};
+// timeout_ms 0 = unlimited
+void read_watch_begin(ReadWatch *w, guint timeout_ms);
+gboolean read_watch_expired(const ReadWatch *w);
+// TRUE when the pass ran out of time; no cancellation reaches the thread afterwards
+gboolean read_watch_end(ReadWatch *w);
+// Same file behind different paths (hardlinks, bind mounts, overlapping scan roots)
+typedef struct {
+    guint64 volume;             // st_dev / volume serial number
+    guint64 index;              // st_ino / NTFS file index
+} FileIdentity;
+int get_file_identity(const char *path, FileIdentity *id);
+// GHashTable callbacks for FileIdentity keys
+guint file_identity_hash(gconstpointer key);
+gboolean file_identity_equal(gconstpointer a, gconstpointer b);
+// Identity plus the last change to the file's data or metadata: POSIX ctime, NTFS
+// ChangeTime. Unlike mtime neither is set back by touch or SetFileTime, so an
+// equal stamp means the file was not rewritten in between.
+typedef struct {
+    FileIdentity id;
+    gint64 change;              // ns since the epoch (POSIX) / FILETIME, 100 ns units (Windows)
+} FileStamp;
+int get_file_stamp(const char *path, FileStamp *stamp);
+// Read-only view of a whole file, for parsers that need random access
+typedef struct {
+    const unsigned char *data;
+    size_t len;
+    void *file;                 // Windows: file and mapping handles
+    void *mapping;
+} FileMap;
+// -1 if the file cannot be opened, is not a regular file, is empty or is larger than max_len
+int map_file(const char *path, size_t max_len, FileMap *m);
+void unmap_file(FileMap *m);
+int compute_file_sha256_ex(const char *path, unsigned char out_hash[32],
+                           const ScanChunkSink *sinks, int n_sinks);
+// Moves a finished `tmp` over `path` in one step, so readers see the old file or the
+// new one, never half of it. On failure `tmp` is removed and `path` is untouched.
+int replace_file_atomic(const char *tmp, const char *path);
+// Appends `path` in the one escaped form scan records and manifests both store
+void append_escaped_path(GString *s, const char *path);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "scan_record.h"
+#include "scan_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define RECORD_OUT_BUFFER (1024 * 1024)
+
+void scan_record_init(ScanRecord *rec, gsize n, unsigned algos) {
+    rec->entries = g_new0(ScanRecordEntry, n);
+    rec->n = n;
+    rec->algos = algos;
+    rec->arena = NULL;
+}
+
+void scan_record_free(ScanRecord *rec) {
+    g_free(rec->entries);
+    g_free(rec->arena);
+    memset(rec, 0, sizeof(*rec));
+}
+
+// --- Writing ---
+int scan_record_write(const ScanRecord *rec, const char *path) {
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return -1;
+    setvbuf(f, NULL, _IOFBF, RECORD_OUT_BUFFER);
+    fprintf(f, "%s\talgos=%u\n", SCAN_RECORD_HEADER, rec->algos);
+    fprintf(f, "# status\tsize\tbytes\topen_ns\tread_ns\thash_ns\tsink_ns\tpath\n");
+    GString *line = g_string_sized_new(256);
+    for (gsize i = 0; i < rec->n; ++i) {
+        const ScanRecordEntry *e = &rec->entries[i];
+        if (!e->path) continue;
+        fprintf(f, "%d\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t", e->status,
+                (unsigned long long)e->size, (unsigned long long)e->bytes,
+                (unsigned long long)e->open_ns, (unsigned long long)e->read_ns,
+                (unsigned long long)e->hash_ns, (unsigned long long)e->sink_ns);
+        g_string_truncate(line, 0);
+        append_escaped_path(line, e->path);
+        g_string_append_c(line, '\n');
+        fwrite(line->str, 1, line->len, f);
+    }
+    g_string_free(line, TRUE);
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        remove(tmp);
+        return -1;
+    }
+    return replace_file_atomic(tmp, path);
+}
+
+// --- Loading ---
+// The mapping is not NUL terminated: every parse stops at `end`
+static gboolean parse_u64(const char **p, const char *end, guint64 *out) {
+    const char *s = *p;
+    guint64 v = 0;
+    while (s < end && *s >= '0' && *s <= '9') v = v * 10 + (guint64)(*s++ - '0');
+    if (s == *p || s >= end || *s != '\t') return FALSE;
+    *out = v;
+    *p = s + 1;
+    return TRUE;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// One line into *e, its path unescaped into the arena at *fill
+static gboolean parse_line(const char *p, const char *eol, ScanRecordEntry *e, char **fill) {
+    gboolean negative = p < eol && *p == '-';
+    if (negative) ++p;
+    guint64 status, v[6];
+    if (!parse_u64(&p, eol, &status)) return FALSE;
+    for (int k = 0; k < 6; ++k) {
+        if (!parse_u64(&p, eol, &v[k])) return FALSE;
+    }
+    if (p >= eol) return FALSE;
+    char *out = *fill;
+    e->path = out;
+    while (p < eol) {
+        int hi, lo;
+        if (*p == '%' && eol - p >= 3 && (hi = hex_digit(p[1])) >= 0 && (lo = hex_digit(p[2])) >= 0) {
+            *out++ = (char)(hi << 4 | lo);
+            p += 3;
+        } else {
+            *out++ = *p++;
+        }
+    }
+    *out++ = '\0';
+    *fill = out;
+    e->status = negative ? -(gint32)status : (gint32)status;
+    e->size = v[0];
+    e->bytes = v[1];
+    e->open_ns = v[2];
+    e->read_ns = v[3];
+    e->hash_ns = v[4];
+    e->sink_ns = v[5];
+    return TRUE;
+}
+
+int scan_record_load(ScanRecord *rec, const char *path) {
+    memset(rec, 0, sizeof(*rec));
+    FileMap m;
+    if (map_file(path, (size_t)-1, &m) != 0) return -1;
+    const char *p = (const char *)m.data, *end = p + m.len;
+    size_t header_len = strlen(SCAN_RECORD_HEADER);
+    if (m.len < header_len || memcmp(p, SCAN_RECORD_HEADER, header_len) != 0) {
+        unmap_file(&m);
+        return -1;
+    }
+    gsize lines = 0;
+    for (const char *q = p; q < end; ++q) lines += (*q == '\n');
+    rec->entries = g_new0(ScanRecordEntry, lines + 1);
+    rec->arena = g_malloc(m.len + 1);   // Unescaping only ever shortens a path
+    char *fill = rec->arena;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        if (*p == '#') {
+            const char *algos = g_strstr_len(p, eol - p, "algos=");
+            if (algos) rec->algos = (unsigned)strtoul(algos + 6, NULL, 10);
+        } else if (eol > p && parse_line(p, eol, &rec->entries[rec->n], &fill)) {
+            rec->n++;
+        }
+        p = eol + 1;
+    }
+    unmap_file(&m);
+    return 0;
+}
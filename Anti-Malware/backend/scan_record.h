@@ -0,0 +1,41 @@
+#ifndef SCAN_RECORD_H
+#define SCAN_RECORD_H
+#include <glib.h>
+/* What a scan read, file by file, and what the reading cost: enough to replay
+ * the CPU side of the scan without the disk (fos-bench replay).
+ *
+ * One line per file read, in the order the walker listed them, tab separated:
+ *     <status>  <size>  <bytes>  <open ns>  <read ns>  <hash ns>  <sink ns>  <path>
+ * status is compute_file_hashes' return code; bytes is what was actually hashed
+ * (a type the scan skips stops after its first buffer). Paths are escaped as in
+ * a manifest (control characters and '%' as %XX). Files answered without a read
+ * (hardlinks already scanned, trusted and unchanged) are not listed. */
+
+#define SCAN_RECORD_HEADER "# fos-scan-record 1"
+
+typedef struct {
+    const char *path;           // NULL: not read by this scan, not written
+    guint64 size;
+    guint64 bytes;
+    guint64 open_ns;
+    guint64 read_ns;            // Waiting for the storage, hashing and sinks excluded
+    guint64 hash_ns;
+    guint64 sink_ns;
+    gint32 status;
+} ScanRecordEntry;
+
+typedef struct {
+    ScanRecordEntry *entries;
+    gsize n;
+    unsigned algos;             // HASH_BIT mask the scan computed
+    char *arena;                // Loaded records: the unescaped paths
+} ScanRecord;
+
+// One slot per listed file; workers fill their own slots, so no lock is needed
+void scan_record_init(ScanRecord *rec, gsize n, unsigned algos);
+int scan_record_write(const ScanRecord *rec, const char *path);
+// -1 if the file cannot be read or is not a scan record
+int scan_record_load(ScanRecord *rec, const char *path);
+void scan_record_free(ScanRecord *rec);
+
+#endif
@@ -0,0 +1,457 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "scan_rules.h"
+#include "multi_hash.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#define RULES_FOLD(c) g_ascii_tolower(c)
+#define RULES_NAME_EQ(a, b) (g_ascii_strcasecmp((a), (b)) == 0)
+#else
+#define RULES_FOLD(c) (c)
+#define RULES_NAME_EQ(a, b) (strcmp((a), (b)) == 0)
+#endif
+
+#define RULES_WORDS (RULES_MAX_STATES / 64)
+#define RULE_EXCLUDE 1
+#define RULE_INCLUDE 2
+
+// Glob automaton position: about to match component pattern `pat`
+enum { PART_LITERAL, PART_PATTERN, PART_ANY_DEPTH, PART_ACCEPT };
+
+typedef struct {
+    char *name;
+    guint32 first_child;
+    guint32 next_sibling;
+    guint8 verdict;             // RULE_EXCLUDE / RULE_INCLUDE for the path ending here
+    guint8 include_below;       // An include prefix lies at or under this node
+} TrieNode;
+
+struct ScanRules {
+    GArray *trie;               // TrieNode; node 0 is the root of every absolute path
+    guint n_states;
+    guint8 kind[RULES_MAX_STATES];
+    char *pat[RULES_MAX_STATES];
+    guint64 any_depth[RULES_WORDS];
+    guint64 accept_exclude[RULES_WORDS];
+    guint64 accept_include[RULES_WORDS];
+    guint64 include_states[RULES_WORDS];    // Positions of include globs, accept excluded
+    guint64 start[RULES_WORDS];
+    bool has_include;           // Any include prefix or glob: paths outside are skipped
+    GHashTable *exclude_ext;    // ".iso" (lowercase) -> itself
+    GHashTable *include_ext;    // NULL = any extension
+    guint64 min_size, max_size; // 0 = no limit
+    gint64 min_age, max_age;    // Seconds, 0 = no limit
+    gint64 now;
+    guint64 fingerprint;
+    guint64 tick;
+    RuleStats stats;
+};
+
+// --- Helpers ---
+static inline void bit_set(guint64 *set, guint s) { set[s >> 6] |= 1ull << (s & 63); }
+
+static inline bool bits_any(const guint64 *a, const guint64 *b) {
+    for (int w = 0; w < RULES_WORDS; ++w)
+        if (a[w] & b[w]) return true;
+    return false;
+}
+
+static bool has_wildcard(const char *s) {
+    return strpbrk(s, "*?[") != NULL;
+}
+
+static bool is_absolute(const char *s) {
+    if (s[0] == '/' || s[0] == '\\') return true;
+    return g_ascii_isalpha(s[0]) && s[1] == ':';
+}
+
+// Path components, either separator. "C:\a\b" -> C:, a, b and "/a/b" -> a, b
+static gchar **split_components(const char *path) {
+    gchar **raw = g_strsplit_set(path, "/\\", -1);
+    guint n = 0;
+    for (guint i = 0; raw[i]; ++i) {
+        if (raw[i][0] == '\0' || strcmp(raw[i], ".") == 0) { g_free(raw[i]); continue; }
+        raw[n++] = raw[i];
+    }
+    raw[n] = NULL;
+    return raw;
+}
+
+// One component against *, ? and [a-z] / [!a-z]; '*' never crosses a separator
+// because components carry none. Backtracks to the last '*' only.
+static bool component_match(const char *p, const char *s) {
+    const char *star_p = NULL, *star_s = NULL;
+    while (*s) {
+        if (*p == '*') {
+            star_p = ++p;
+            star_s = s;
+            continue;
+        }
+        if (*p == '[') {
+            const char *q = p + 1;
+            bool negate = (*q == '!' || *q == '^');
+            if (negate) ++q;
+            bool hit = false;
+            char c = RULES_FOLD(*s);
+            for (bool first = true; *q && (*q != ']' || first); first = false) {
+                char lo = RULES_FOLD(*q), hi = lo;
+                if (q[1] == '-' && q[2] && q[2] != ']') { hi = RULES_FOLD(q[2]); q += 2; }
+                if (c >= lo && c <= hi) hit = true;
+                ++q;
+            }
+            if (*q == ']' && hit != negate) { p = q + 1; ++s; continue; }
+        } else if (*p && (*p == '?' || RULES_FOLD(*p) == RULES_FOLD(*s))) {
+            ++p; ++s;
+            continue;
+        }
+        if (!star_p) return false;
+        p = star_p;
+        s = ++star_s;
+    }
+    while (*p == '*') ++p;
+    return *p == '\0';
+}
+
+// Follows the ** positions: each may also match zero components
+static void close_states(const ScanRules *r, guint64 *set) {
+    for (int w = 0; w < RULES_WORDS; ++w) {
+        guint64 m = set[w] & r->any_depth[w];
+        while (m) {
+            guint s = (guint)w * 64 + (guint)__builtin_ctzll(m);
+            m &= m - 1;
+            bit_set(set, s + 1);    // Never another **: runs are merged at compile time
+        }
+    }
+}
+
+static void advance_states(const ScanRules *r, const guint64 *in, const char *name, guint64 *out) {
+    memset(out, 0, sizeof(guint64) * RULES_WORDS);
+    for (int w = 0; w < RULES_WORDS; ++w) {
+        guint64 m = in[w];
+        while (m) {
+            guint s = (guint)w * 64 + (guint)__builtin_ctzll(m);
+            m &= m - 1;
+            switch (r->kind[s]) {
+            case PART_ANY_DEPTH: bit_set(out, s); break;
+            case PART_LITERAL: if (RULES_NAME_EQ(r->pat[s], name)) bit_set(out, s + 1); break;
+            case PART_PATTERN: if (component_match(r->pat[s], name)) bit_set(out, s + 1); break;
+            default: break;
+            }
+        }
+    }
+    close_states(r, out);
+}
+
+static guint32 trie_child(const ScanRules *r, guint32 node, const char *name) {
+    if (node == RULES_NO_NODE) return RULES_NO_NODE;
+    guint32 c = g_array_index(r->trie, TrieNode, node).first_child;
+    while (c != RULES_NO_NODE) {
+        const TrieNode *n = &g_array_index(r->trie, TrieNode, c);
+        if (RULES_NAME_EQ(n->name, name)) return c;
+        c = n->next_sibling;
+    }
+    return RULES_NO_NODE;
+}
+
+static inline guint8 trie_verdict(const ScanRules *r, guint32 node) {
+    return node == RULES_NO_NODE ? 0 : g_array_index(r->trie, TrieNode, node).verdict;
+}
+
+// --- Compilation ---
+static void add_prefix(ScanRules *r, gchar **comps, guint8 verdict) {
+    guint32 node = 0;
+    for (guint i = 0; comps[i]; ++i) {
+        if (verdict == RULE_INCLUDE) g_array_index(r->trie, TrieNode, node).include_below = 1;
+        guint32 c = trie_child(r, node, comps[i]);
+        if (c == RULES_NO_NODE) {
+            TrieNode n = { g_strdup(comps[i]), RULES_NO_NODE, RULES_NO_NODE, 0, 0 };
+            c = r->trie->len;
+            TrieNode *parent = &g_array_index(r->trie, TrieNode, node);
+            n.next_sibling = parent->first_child;
+            parent->first_child = c;
+            g_array_append_val(r->trie, n);
+        }
+        node = c;
+    }
+    TrieNode *leaf = &g_array_index(r->trie, TrieNode, node);
+    if (verdict == RULE_INCLUDE) leaf->include_below = 1;
+    if (leaf->verdict != RULE_EXCLUDE) leaf->verdict = verdict;     // Exclude wins
+}
+
+static bool add_glob(ScanRules *r, gchar **comps, bool anchored, guint8 verdict) {
+    guint need = (anchored ? 0 : 1) + g_strv_length(comps) + 1;
+    if (r->n_states + need > RULES_MAX_STATES) return false;
+    guint base = r->n_states, s = base;
+    if (!anchored) { r->kind[s] = PART_ANY_DEPTH; bit_set(r->any_depth, s++); }
+    for (guint i = 0; comps[i]; ++i) {
+        if (strcmp(comps[i], "**") == 0) {
+            if (s > base && r->kind[s - 1] == PART_ANY_DEPTH) continue;
+            r->kind[s] = PART_ANY_DEPTH;
+            bit_set(r->any_depth, s++);
+        } else {
+            r->kind[s] = has_wildcard(comps[i]) ? PART_PATTERN : PART_LITERAL;
+            r->pat[s++] = g_strdup(comps[i]);
+        }
+    }
+    r->kind[s] = PART_ACCEPT;
+    bit_set(verdict == RULE_EXCLUDE ? r->accept_exclude : r->accept_include, s);
+    if (verdict == RULE_INCLUDE)
+        for (guint i = base; i < s; ++i) bit_set(r->include_states, i);
+    bit_set(r->start, base);
+    r->n_states = s + 1;
+    return true;
+}
+
+static bool add_path_rule(ScanRules *r, const char *arg, guint8 verdict) {
+    gchar **comps = split_components(arg);
+    bool ok = comps[0] != NULL;
+    if (ok) {
+        if (verdict == RULE_INCLUDE) r->has_include = true;
+        // Absolute and literal: a prefix. Anything else is a glob; relative ones
+        // (including bare names) may start at any depth.
+        if (is_absolute(arg) && !has_wildcard(arg)) add_prefix(r, comps, verdict);
+        else ok = add_glob(r, comps, is_absolute(arg), verdict);
+    }
+    g_strfreev(comps);
+    return ok;
+}
+
+static void add_extensions(GHashTable **set, gchar **args) {
+    if (!*set) *set = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (guint i = 0; args[i]; ++i) {
+        if (!args[i][0]) continue;
+        gchar *ext = g_ascii_strdown(args[i], -1);
+        if (ext[0] != '.') {
+            gchar *dotted = g_strconcat(".", ext, NULL);
+            g_free(ext);
+            ext = dotted;
+        }
+        g_hash_table_add(*set, ext);
+    }
+}
+
+// "512M", "4G", "100" (bytes)
+static bool parse_size(const char *s, guint64 *out) {
+    char *end;
+    guint64 v = g_ascii_strtoull(s, &end, 10);
+    if (end == s) return false;
+    switch (g_ascii_toupper(*end)) {
+    case 'K': v <<= 10; ++end; break;
+    case 'M': v <<= 20; ++end; break;
+    case 'G': v <<= 30; ++end; break;
+    case 'T': v <<= 40; ++end; break;
+    default: break;
+    }
+    if (g_ascii_toupper(*end) == 'B') ++end;
+    *out = v;
+    return *end == '\0';
+}
+
+// "365d", "12h", "10m", "30s" (bare numbers are days)
+static bool parse_age(const char *s, gint64 *out) {
+    char *end;
+    gint64 v = g_ascii_strtoll(s, &end, 10);
+    if (end == s || v < 0) return false;
+    switch (*end) {
+    case 's': break;
+    case 'm': v *= 60; break;
+    case 'h': v *= 3600; break;
+    case '\0': case 'd': v *= 86400; break;
+    case 'w': v *= 7 * 86400; break;
+    default: return false;
+    }
+    *out = v;
+    return *end == '\0' || end[1] == '\0';
+}
+
+static bool parse_line(ScanRules *r, char *line) {
+    gchar **argv = g_strsplit_set(g_strstrip(line), " \t", -1);
+    guint n = 0;
+    for (guint i = 0; argv[i]; ++i) {
+        if (argv[i][0] == '\0') { g_free(argv[i]); continue; }
+        argv[n++] = argv[i];
+    }
+    argv[n] = NULL;
+
+    bool ok = true;
+    const char *key = argv[0];
+    if (n < 2) {
+        ok = false;
+    } else if (strcmp(key, "exclude") == 0 || strcmp(key, "include") == 0) {
+        // Paths may contain spaces: the argument is the rest of the line
+        const char *arg = g_strstrip(line + strlen(key));
+        ok = add_path_rule(r, arg, key[0] == 'e' ? RULE_EXCLUDE : RULE_INCLUDE);
+    } else if (strcmp(key, "exclude_ext") == 0) {
+        add_extensions(&r->exclude_ext, argv + 1);
+    } else if (strcmp(key, "include_ext") == 0) {
+        add_extensions(&r->include_ext, argv + 1);
+    } else if (strcmp(key, "max_size") == 0) {
+        ok = n == 2 && parse_size(argv[1], &r->max_size);
+    } else if (strcmp(key, "min_size") == 0) {
+        ok = n == 2 && parse_size(argv[1], &r->min_size);
+    } else if (strcmp(key, "max_age") == 0) {
+        ok = n == 2 && parse_age(argv[1], &r->max_age);
+    } else if (strcmp(key, "min_age") == 0) {
+        ok = n == 2 && parse_age(argv[1], &r->min_age);
+    } else {
+        ok = false;
+    }
+    g_strfreev(argv);
+    return ok;
+}
+
+ScanRules *scan_rules_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+
+    ScanRules *r = g_new0(ScanRules, 1);
+    r->trie = g_array_new(FALSE, TRUE, sizeof(TrieNode));
+    TrieNode root = { NULL, RULES_NO_NODE, RULES_NO_NODE, 0, 0 };
+    g_array_append_val(r->trie, root);
+    r->fingerprint = 14695981039346656037ULL;
+
+    char line[1024];
+    int lineno = 0, rules = 0;
+    while (fgets(line, sizeof(line), f)) {
+        ++lineno;
+        for (const unsigned char *p = (const unsigned char *)line; *p; ++p)
+            r->fingerprint = (r->fingerprint ^ *p) * 1099511628211ULL;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        g_strstrip(line);
+        if (!line[0]) continue;
+        if (parse_line(r, line)) ++rules;
+        else printf("[WARN] %s:%d: ignoring rule '%s'\n", path, lineno, line);
+    }
+    fclose(f);
+
+    if (rules == 0) {
+        scan_rules_free(r);
+        return NULL;
+    }
+    close_states(r, r->start);
+    r->now = (gint64)time(NULL);
+    return r;
+}
+
+void scan_rules_free(ScanRules *r) {
+    if (!r) return;
+    for (guint i = 0; i < r->trie->len; ++i) g_free(g_array_index(r->trie, TrieNode, i).name);
+    g_array_free(r->trie, TRUE);
+    for (guint s = 0; s < r->n_states; ++s) g_free(r->pat[s]);
+    if (r->exclude_ext) g_hash_table_destroy(r->exclude_ext);
+    if (r->include_ext) g_hash_table_destroy(r->include_ext);
+    g_free(r);
+}
+
+guint64 scan_rules_fingerprint(const ScanRules *r) {
+    return r ? r->fingerprint : 0;
+}
+
+bool scan_rules_need_stat(const ScanRules *r) {
+    return r && (r->min_size || r->max_size || r->min_age || r->max_age);
+}
+
+// --- Evaluation ---
+static bool step_dir(ScanRules *r, const RuleCursor *dir, const char *name, RuleCursor *child) {
+    child->node = trie_child(r, dir->node, name);
+    guint8 verdict = trie_verdict(r, child->node);
+    if (verdict == RULE_EXCLUDE) return false;
+    advance_states(r, dir->states, name, child->states);
+    if (bits_any(child->states, r->accept_exclude)) return false;
+
+    child->in_scope = dir->in_scope || verdict == RULE_INCLUDE ||
+                      bits_any(child->states, r->accept_include);
+    if (child->in_scope) return true;
+    // Outside every include: keep going only toward an include prefix, or while
+    // an include glob can still match something below
+    if (child->node != RULES_NO_NODE &&
+        g_array_index(r->trie, TrieNode, child->node).include_below) return true;
+    return bits_any(child->states, r->include_states);
+}
+
+bool scan_rules_begin(ScanRules *r, const char *root, RuleCursor *out) {
+    memset(out, 0, sizeof(*out));
+    memcpy(out->states, r->start, sizeof(out->states));
+    out->node = is_absolute(root) ? 0 : RULES_NO_NODE;
+    out->in_scope = !r->has_include;
+
+    gchar **comps = split_components(root);
+    bool ok = true;
+    for (guint i = 0; comps[i] && ok; ++i) {
+        RuleCursor next;
+        ok = step_dir(r, out, comps[i], &next);
+        *out = next;
+    }
+    g_strfreev(comps);
+    return ok;
+}
+
+bool scan_rules_enter_dir(ScanRules *r, const RuleCursor *dir, const char *name, RuleCursor *child) {
+    bool sample = (r->tick++ % RULES_SAMPLE_EVERY) == 0;
+    guint64 t0 = sample ? hash_clock_ns() : 0;
+    bool ok = step_dir(r, dir, name, child);
+    if (!ok) r->stats.dirs_pruned++;
+    r->stats.paths_checked++;
+    if (sample) { r->stats.sampled_ns += hash_clock_ns() - t0; r->stats.sampled++; }
+    return ok;
+}
+
+static RuleVerdict file_wanted(ScanRules *r, const RuleCursor *dir, const char *name,
+                               guint64 size, gint64 mtime) {
+    const char *dot = strrchr(name, '.');
+    if ((r->exclude_ext || r->include_ext) && dot && dot != name) {
+        char ext[32];
+        size_t len = strlen(dot);
+        if (len < sizeof(ext)) {
+            for (size_t i = 0; i <= len; ++i) ext[i] = g_ascii_tolower(dot[i]);
+            if (r->exclude_ext && g_hash_table_contains(r->exclude_ext, ext)) return RULES_SKIP;
+            if (r->include_ext && !g_hash_table_contains(r->include_ext, ext)) return RULES_SKIP;
+        } else if (r->include_ext) {
+            return RULES_SKIP;
+        }
+    } else if (r->include_ext) {
+        return RULES_SKIP;
+    }
+
+    if (r->max_size && size > r->max_size) return RULES_SKIP;
+    if (r->min_size && size < r->min_size) return RULES_SKIP;
+    gint64 age = r->now - mtime;
+    if (r->max_age && age > r->max_age) return RULES_SKIP;
+    if (r->min_age && age < r->min_age) return RULES_TOO_NEW;
+
+    guint32 node = trie_child(r, dir->node, name);
+    guint8 verdict = trie_verdict(r, node);
+    if (verdict == RULE_EXCLUDE) return RULES_SKIP;
+    guint64 states[RULES_WORDS];
+    advance_states(r, dir->states, name, states);
+    if (bits_any(states, r->accept_exclude)) return RULES_SKIP;
+    bool in = dir->in_scope || verdict == RULE_INCLUDE || bits_any(states, r->accept_include);
+    return in ? RULES_SCAN : RULES_SKIP;
+}
+
+RuleVerdict scan_rules_want_file(ScanRules *r, const RuleCursor *dir, const char *name,
+                                 guint64 size, gint64 mtime) {
+    bool sample = (r->tick++ % RULES_SAMPLE_EVERY) == 0;
+    guint64 t0 = sample ? hash_clock_ns() : 0;
+    RuleVerdict v = file_wanted(r, dir, name, size, mtime);
+    if (v != RULES_SCAN) r->stats.files_skipped++;
+    r->stats.paths_checked++;
+    if (sample) { r->stats.sampled_ns += hash_clock_ns() - t0; r->stats.sampled++; }
+    return v;
+}
+
+const RuleStats *scan_rules_stats(const ScanRules *r) {
+    return &r->stats;
+}
+
+void scan_rules_print_stats(FILE *out, const ScanRules *r) {
+    const RuleStats *st = &r->stats;
+    // ns per evaluation == ms per million paths
+    double per_million = st->sampled ? (double)st->sampled_ns / (double)st->sampled : 0.0;
+    fprintf(out, "[SCAN] Rules: %llu path(s) checked, %llu director%s pruned, %llu file(s) skipped, "
+                 "%.1f ms per million paths\n",
+            (unsigned long long)st->paths_checked, (unsigned long long)st->dirs_pruned,
+            st->dirs_pruned == 1 ? "y" : "ies", (unsigned long long)st->files_skipped, per_million);
+}
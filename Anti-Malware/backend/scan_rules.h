@@ -0,0 +1,65 @@
+#ifndef SCAN_RULES_H
+#define SCAN_RULES_H
+#include <glib.h>
+#include <stdbool.h>
+#include <stdio.h>
+/* Exclusion / inclusion rules for scan targets (scan_rules.conf), compiled once
+ * per scan into a trie of directory prefixes and a glob automaton over path
+ * components. The walkers carry a RuleCursor down the tree so each directory
+ * or file costs one step from its parent, never a full-path match, and an
+ * excluded directory is never opened.
+ *
+ *   exclude C:\VMs              absolute path without wildcards: prefix
+ *   exclude **\node_modules     glob; * ? [a-z] within a component, ** across
+ *   exclude .git                bare name: that name at any depth
+ *   include C:\Users            once any include exists, only matching paths
+ *   exclude_ext .iso .vmdk      are scanned (exclude always wins)
+ *   include_ext .exe .dll
+ *   max_size 512M   min_size 1   max_age 365d   min_age 10m
+ */
+
+#define RULES_MAX_STATES 256            // Glob automaton positions across all globs
+
+typedef struct ScanRules ScanRules;
+
+// Position of one directory in the compiled rules; small enough to copy per level
+typedef struct {
+    guint32 node;                       // Prefix trie node, RULES_NO_NODE once off every prefix
+    gboolean in_scope;                  // Inside an include prefix/glob (or none exist)
+    guint64 states[RULES_MAX_STATES / 64];
+} RuleCursor;
+#define RULES_NO_NODE G_MAXUINT32
+
+typedef struct {
+    guint64 dirs_pruned;                // Subtrees never descended
+    guint64 files_skipped;
+    guint64 paths_checked;              // Directories + files evaluated
+    guint64 sampled;                    // Evaluations timed (1 in RULES_SAMPLE_EVERY)
+    guint64 sampled_ns;
+} RuleStats;
+#define RULES_SAMPLE_EVERY 16
+
+// NULL when the file is missing or holds no rules. Unparseable lines are
+// reported with [WARN] and ignored.
+ScanRules *scan_rules_load(const char *path);
+void scan_rules_free(ScanRules *r);
+// Identifies the rule text; incremental scans walk in full when it changes
+guint64 scan_rules_fingerprint(const ScanRules *r);
+// Files need size/mtime (POSIX walkers lstat only then)
+bool scan_rules_need_stat(const ScanRules *r);
+
+// Cursor for the scan root; false if the root itself is excluded
+bool scan_rules_begin(ScanRules *r, const char *root, RuleCursor *out);
+// Step into subdirectory `name` of `dir`; false = prune the whole subtree
+bool scan_rules_enter_dir(ScanRules *r, const RuleCursor *dir, const char *name, RuleCursor *child);
+// File `name` in `dir`. mtime in Unix seconds; size/mtime are ignored unless
+// scan_rules_need_stat. RULES_TOO_NEW is a skip that min_age will lift later, so
+// incremental walks must list the directory again.
+typedef enum { RULES_SKIP = 0, RULES_SCAN, RULES_TOO_NEW } RuleVerdict;
+RuleVerdict scan_rules_want_file(ScanRules *r, const RuleCursor *dir, const char *name,
+                                 guint64 size, gint64 mtime);
+
+const RuleStats *scan_rules_stats(const ScanRules *r);
+void scan_rules_print_stats(FILE *out, const ScanRules *r);
+
+#endif
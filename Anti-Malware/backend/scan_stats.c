@@ -0,0 +1,157 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "scan_stats.h"
+#include "scan_core.h"
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define CALIBRATE_NS (5 * 1000 * 1000)  // Long enough for ~0.1% on a coarse clock
+
+double stage_tick_ns = 1.0;
+
+static const char *stage_names[STAGE_COUNT] = {
+    "walk-dir", "claim", "identity", "open", "read", "hash", "sinks",
+    "lookup", "engines", "quarantine", "lock-wait", "file"
+};
+
+const char *scan_stage_name(ScanStage s) {
+    return (s < STAGE_COUNT) ? stage_names[s] : "?";
+}
+
+void scan_stats_calibrate(void) {
+    static gsize done = 0;
+    if (!g_once_init_enter(&done)) return;
+#if defined(__x86_64__) || defined(__i386__)
+    guint64 n0 = hash_clock_ns(), t0 = stage_ticks(), n1;
+    while ((n1 = hash_clock_ns()) - n0 < CALIBRATE_NS) {}
+    guint64 t1 = stage_ticks();
+    if (t1 > t0) stage_tick_ns = (double)(n1 - n0) / (double)(t1 - t0);
+#endif
+    g_once_init_leave(&done, 1);
+}
+
+void stage_hist_merge(StageHist *dst, const StageHist *src) {
+    if (src->count == 0) return;
+    dst->count += src->count;
+    dst->sum_ns += src->sum_ns;
+    if (src->max_ns > dst->max_ns) dst->max_ns = src->max_ns;
+    for (int b = 0; b < STAGE_BUCKETS; ++b) dst->bucket[b] += src->bucket[b];
+}
+
+void scan_stats_merge(ScanStats *dst, const ScanStats *src) {
+    for (int s = 0; s < STAGE_COUNT; ++s) stage_hist_merge(&dst->stage[s], &src->stage[s]);
+}
+
+// Smallest value that falls into bucket b, and the bucket's width
+static guint64 bucket_low(int b, guint64 *width) {
+    if (b < (1 << STAGE_SUB_BITS)) {
+        *width = 1;
+        return (guint64)b;
+    }
+    int shift = (b >> STAGE_SUB_BITS) - 1;
+    *width = 1ull << shift;
+    return ((guint64)((1 << STAGE_SUB_BITS) + (b & ((1 << STAGE_SUB_BITS) - 1)))) << shift;
+}
+
+guint64 stage_hist_quantile(const StageHist *h, double q) {
+    if (h->count == 0) return 0;
+    guint64 rank = (guint64)(q * (double)h->count);
+    if (rank >= h->count) rank = h->count - 1;
+    guint64 seen = 0;
+    for (int b = 0; b < STAGE_BUCKETS; ++b) {
+        seen += h->bucket[b];
+        if (seen > rank) {
+            guint64 width, low = bucket_low(b, &width);
+            guint64 mid = low + width / 2;
+            return MIN(mid, h->max_ns);
+        }
+    }
+    return h->max_ns;
+}
+
+void scan_stats_print(FILE *out, const ScanStats *st, guint64 wall_ns, guint threads) {
+    // Share of the time the workers had between them; the walk runs before them, alone
+    double worker_ns = (double)wall_ns * (double)MAX(threads, 1);
+    fprintf(out, "Stages: %.2f s wall on %u thread(s), latency in us\n", (double)wall_ns / 1e9, threads);
+    fprintf(out, "  %-10s %9s %9s %6s %9s %9s %9s %9s %9s\n",
+            "stage", "count", "total s", "share", "mean", "p50", "p90", "p99", "max");
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        const StageHist *h = &st->stage[s];
+        if (h->count == 0) continue;
+        double share = (s == STAGE_WALK_DIR) ? 0.0 : 100.0 * (double)h->sum_ns / worker_ns;
+        fprintf(out, "  %-10s %9llu %9.3f %5.1f%% %9.1f %9.1f %9.1f %9.1f %9.1f\n", stage_names[s],
+                (unsigned long long)h->count, (double)h->sum_ns / 1e9, worker_ns > 0 ? share : 0.0,
+                (double)h->sum_ns / 1e3 / (double)h->count,
+                (double)stage_hist_quantile(h, 0.50) / 1e3, (double)stage_hist_quantile(h, 0.90) / 1e3,
+                (double)stage_hist_quantile(h, 0.99) / 1e3, (double)h->max_ns / 1e3);
+    }
+}
+
+// --- JSON ---
+/* JSON wants UTF-8, but paths on Windows come in the ANSI code page: anything not
+ * UTF-8 already is converted from the locale first. A byte neither reading accepts
+ * is written as \u00XX (its Latin-1 reading), so the output always parses. */
+void json_write_string(FILE *f, const char *s) {
+    gchar *utf8 = g_utf8_validate(s, -1, NULL) ? NULL : g_locale_to_utf8(s, -1, NULL, NULL, NULL);
+    const char *p = utf8 ? utf8 : s;
+    fputc('"', f);
+    while (*p) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x80) {
+            gunichar u = g_utf8_get_char_validated(p, -1);
+            if (u == (gunichar)-1 || u == (gunichar)-2) {
+                fprintf(f, "\\u%04x", c);
+                p++;
+            } else {
+                const char *next = g_utf8_next_char(p);
+                fwrite(p, 1, (size_t)(next - p), f);
+                p = next;
+            }
+            continue;
+        }
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+        p++;
+    }
+    fputc('"', f);
+    g_free(utf8);
+}
+
+// Non-empty buckets only, as [low_ns, width_ns, count]
+static void json_hist(FILE *f, const StageHist *h) {
+    fprintf(f, "{\"count\": %llu, \"sum_ns\": %llu, \"max_ns\": %llu, \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"buckets\": [",
+            (unsigned long long)h->count, (unsigned long long)h->sum_ns, (unsigned long long)h->max_ns,
+            (unsigned long long)stage_hist_quantile(h, 0.50), (unsigned long long)stage_hist_quantile(h, 0.90),
+            (unsigned long long)stage_hist_quantile(h, 0.99), (unsigned long long)stage_hist_quantile(h, 0.999));
+    gboolean first = TRUE;
+    for (int b = 0; b < STAGE_BUCKETS; ++b) {
+        if (h->bucket[b] == 0) continue;
+        guint64 width, low = bucket_low(b, &width);
+        fprintf(f, "%s[%llu, %llu, %llu]", first ? "" : ", ", (unsigned long long)low,
+                (unsigned long long)width, (unsigned long long)h->bucket[b]);
+        first = FALSE;
+    }
+    fprintf(f, "]}");
+}
+
+int scan_stats_write_json(const char *path, const ScanStats *st, guint64 wall_ns, guint threads) {
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return -1;
+    fprintf(f, "{\"wall_ns\": %llu, \"threads\": %u, \"tick_ns\": %.6f, \"stages\": {",
+            (unsigned long long)wall_ns, threads, stage_tick_ns);
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        fprintf(f, "%s\n  \"%s\": ", s ? "," : "", stage_names[s]);
+        json_hist(f, &st->stage[s]);
+    }
+    fprintf(f, "\n}}\n");
+    int ok = fclose(f) == 0;
+    if (!ok) {
+        remove(tmp);
+        return -1;
+    }
+    return replace_file_atomic(tmp, path);
+}
@@ -0,0 +1,109 @@
+#ifndef SCAN_STATS_H
+#define SCAN_STATS_H
+#include <glib.h>
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "multi_hash.h"
+#include "scan_trace.h"
+/* Where a scan's time goes: a latency histogram per pipeline stage, kept per
+ * worker thread and merged once at the end.
+ *
+ * Histograms are log-linear (HDR style): values below 2^STAGE_SUB_BITS ns get a
+ * bucket each, above that every power of two is split into 2^STAGE_SUB_BITS
+ * buckets, so any recorded value is known to within ~3% from 1 ns to centuries.
+ * Recording is a bit scan and an increment; the worker stages are timed with the
+ * TSC where there is one (calibrated against the monotonic clock once). */
+
+typedef enum {
+    STAGE_WALK_DIR = 0,         // Listing one directory (its subdirectories excluded)
+    STAGE_CLAIM,                // Taking the next path off the shared list
+    STAGE_IDENTITY,             // stat, file identity and the hardlink table
+    STAGE_OPEN,
+    STAGE_READ,                 // Every read of one file
+    STAGE_HASH,                 // Every digest, every buffer of one file
+    STAGE_SINKS,                // Type, content patterns, heuristics, similarity on the read pass
+    STAGE_LOOKUP,               // Signature index and allowlist
+    STAGE_ENGINES,              // Archives, structure, similarity lookup, heuristic score
+    STAGE_QUARANTINE,
+    STAGE_LOCK_WAIT,            // Waiting for global_scan_ctx.mutex
+    STAGE_FILE,                 // One file end to end
+    STAGE_COUNT
+} ScanStage;
+
+#define STAGE_SUB_BITS  5
+#define STAGE_BUCKETS   ((64 - STAGE_SUB_BITS + 1) << STAGE_SUB_BITS)
+
+typedef struct {
+    guint64 count;
+    guint64 sum_ns;
+    guint64 max_ns;
+    guint64 bucket[STAGE_BUCKETS];
+} StageHist;
+
+typedef struct {
+    StageHist stage[STAGE_COUNT];
+    ScanTrace *trace;           // This thread's timeline, NULL when not tracing
+} ScanStats;
+
+static inline guint stage_bucket(guint64 ns) {
+    if (ns < (1u << STAGE_SUB_BITS)) return (guint)ns;
+    guint msb = 63 - (guint)__builtin_clzll(ns);
+    guint shift = msb - STAGE_SUB_BITS;
+    return ((shift + 1) << STAGE_SUB_BITS) + (guint)((ns >> shift) & ((1u << STAGE_SUB_BITS) - 1));
+}
+
+static inline void stage_hist_add(StageHist *h, guint64 ns) {
+    h->count++;
+    h->sum_ns += ns;
+    if (ns > h->max_ns) h->max_ns = ns;
+    h->bucket[stage_bucket(ns)]++;
+}
+
+// Raw ticks: the TSC on x86, nanoseconds elsewhere
+static inline guint64 stage_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return (guint64)__rdtsc();
+#else
+    return hash_clock_ns();
+#endif
+}
+
+extern double stage_tick_ns;    // Set by scan_stats_calibrate
+
+static inline guint64 stage_ticks_ns(guint64 ticks) {
+    return (guint64)((double)ticks * stage_tick_ns);
+}
+
+static inline guint64 stage_elapsed_ns(guint64 t0) {
+    return stage_ticks_ns(stage_ticks() - t0);
+}
+
+// A stage that ran from t0 to t1 (ticks)
+static inline void stage_record(ScanStats *st, ScanStage s, guint64 t0, guint64 t1) {
+    stage_hist_add(&st->stage[s], stage_ticks_ns(t1 - t0));
+    if (st->trace) scan_trace_span(st->trace, s, t0, t1, NULL);
+}
+
+// Ends one stage and starts the next on the same clock read
+static inline void stage_lap(ScanStats *st, ScanStage s, guint64 *t) {
+    guint64 now = stage_ticks();
+    stage_record(st, s, *t, now);
+    *t = now;
+}
+
+// Measures the tick rate once per process (a few milliseconds); cheap after that
+void scan_stats_calibrate(void);
+const char *scan_stage_name(ScanStage s);
+void stage_hist_merge(StageHist *dst, const StageHist *src);
+void scan_stats_merge(ScanStats *dst, const ScanStats *src);
+// Value at quantile q (0..1), to the precision of its bucket
+guint64 stage_hist_quantile(const StageHist *h, double q);
+// wall_ns: the scan's own wall time; threads: workers sharing it
+void scan_stats_print(FILE *out, const ScanStats *st, guint64 wall_ns, guint threads);
+int scan_stats_write_json(const char *path, const ScanStats *st, guint64 wall_ns, guint threads);
+// `s` as a quoted JSON string, always valid UTF-8 (see scan_stats.c)
+void json_write_string(FILE *f, const char *s);
+
+#endif
@@ -0,0 +1,124 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "scan_trace.h"
+#include "scan_stats.h"
+#include "scan_core.h"
+#include "mem_budget.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define TRACE_OUT_BUFFER (1024 * 1024)
+
+struct ScanTraceSession {
+    GMutex lock;                // Only taken to add a thread
+    GPtrArray *threads;         // ScanTrace *
+    guint64 origin;             // Stage clock at the start; timestamps are relative to it
+};
+
+ScanTraceSession *scan_trace_session_new(void) {
+    scan_stats_calibrate();
+    ScanTraceSession *ts = g_new0(ScanTraceSession, 1);
+    g_mutex_init(&ts->lock);
+    ts->threads = g_ptr_array_new();
+    ts->origin = stage_ticks();
+    return ts;
+}
+
+ScanTrace *scan_trace_thread(ScanTraceSession *ts, const char *name) {
+    ScanTrace *tr = g_new0(ScanTrace, 1);
+    g_mutex_lock(&ts->lock);
+    tr->tid = ts->threads->len + 1;
+    g_ptr_array_add(ts->threads, tr);
+    g_mutex_unlock(&ts->lock);
+    snprintf(tr->name, sizeof(tr->name), "%s %u", name, tr->tid);
+    return tr;
+}
+
+TraceSpan *scan_trace_grow(ScanTrace *tr) {
+    if (tr->spans >= TRACE_MAX_SPANS) {
+        tr->dropped++;
+        return NULL;
+    }
+    TraceChunk *c = g_try_new(TraceChunk, 1);
+    if (!c) {
+        tr->dropped++;
+        return NULL;
+    }
+    c->next = NULL;
+    c->used = 1;
+    if (tr->tail) tr->tail->next = c;
+    else tr->head = c;
+    tr->tail = c;
+    tr->spans += TRACE_CHUNK;   // Counted by the chunk: the limit is checked per allocation
+    mem_account(MEM_TRACE, sizeof(TraceChunk));
+    return &c->span[0];
+}
+
+void scan_trace_session_free(ScanTraceSession *ts) {
+    if (!ts) return;
+    for (guint i = 0; i < ts->threads->len; ++i) {
+        ScanTrace *tr = g_ptr_array_index(ts->threads, i);
+        for (TraceChunk *c = tr->head, *next; c; c = next) {
+            next = c->next;
+            g_free(c);
+            mem_account(MEM_TRACE, -(gint64)sizeof(TraceChunk));
+        }
+        g_free(tr);
+    }
+    g_ptr_array_free(ts->threads, TRUE);
+    g_mutex_clear(&ts->lock);
+    g_free(ts);
+}
+
+// --- Writing ---
+// Microseconds since the session started, as the trace format wants them
+static double trace_us(const ScanTraceSession *ts, guint64 ticks) {
+    return ticks > ts->origin ? (double)(ticks - ts->origin) * stage_tick_ns / 1e3 : 0.0;
+}
+
+int scan_trace_write(ScanTraceSession *ts, const char *path, guint64 *spans, guint64 *dropped) {
+    *spans = *dropped = 0;
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return -1;
+    setvbuf(f, NULL, _IOFBF, TRACE_OUT_BUFFER);
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"scan\"}}");
+    for (guint i = 0; i < ts->threads->len; ++i) {
+        const ScanTrace *tr = g_ptr_array_index(ts->threads, i);
+        fprintf(f, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": ", tr->tid);
+        json_write_string(f, tr->name);
+        fprintf(f, "}}");
+        for (const TraceChunk *c = tr->head; c; c = c->next) {
+            for (guint32 k = 0; k < c->used; ++k) {
+                const TraceSpan *sp = &c->span[k];
+                double ts_us = trace_us(ts, sp->start);
+                double dur_us = sp->end > sp->start ? (double)(sp->end - sp->start) * stage_tick_ns / 1e3 : 0.0;
+                fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f",
+                        scan_stage_name((ScanStage)sp->stage), tr->tid, ts_us, dur_us);
+                if (sp->path) {
+                    fprintf(f, ", \"args\": {\"path\": ");
+                    json_write_string(f, sp->path);
+                    fprintf(f, "}");
+                } else if (sp->stage == STAGE_READ) {
+                    fprintf(f, ", \"args\": {\"read_us\": %u, \"hash_us\": %u, \"sinks_us\": %u}",
+                            sp->arg_us[0], sp->arg_us[1], sp->arg_us[2]);
+                }
+                fprintf(f, "}");
+                (*spans)++;
+            }
+        }
+        *dropped += tr->dropped;
+    }
+    fprintf(f, "\n]}\n");
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        remove(tmp);
+        return -1;
+    }
+    return replace_file_atomic(tmp, path);
+}
@@ -0,0 +1,60 @@
+#ifndef SCAN_TRACE_H
+#define SCAN_TRACE_H
+#include <glib.h>
+/* Scan timelines: every stage of every file as a span on its thread, written as
+ * Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ * Each thread appends to its own chunked buffer, so recording takes no lock and
+ * never moves what is already recorded; the session only lists the buffers and
+ * reads them once the threads are done. Stage numbers are ScanStage. */
+
+#define TRACE_CHUNK       4096      // Spans per allocation
+#define TRACE_MAX_SPANS   (1u << 21) // Per thread (80 MB); later spans are counted, not kept
+
+typedef struct {
+    guint64 start, end;         // Stage clock ticks
+    const char *path;           // File spans: the path, which must outlive the session
+    guint32 stage;
+    guint32 arg_us[3];          // Read spans: reading, hashing and sinks inside the span
+} TraceSpan;
+
+typedef struct TraceChunk {
+    struct TraceChunk *next;
+    guint32 used;
+    TraceSpan span[TRACE_CHUNK];
+} TraceChunk;
+
+typedef struct {
+    TraceChunk *head, *tail;
+    guint64 spans;              // Room allocated so far, against TRACE_MAX_SPANS
+    guint64 dropped;
+    guint tid;
+    char name[32];
+} ScanTrace;
+
+typedef struct ScanTraceSession ScanTraceSession;
+
+ScanTraceSession *scan_trace_session_new(void);
+// One buffer per thread, shown as "<name> <n>" in the viewer; owned by the session
+ScanTrace *scan_trace_thread(ScanTraceSession *ts, const char *name);
+// Spans of every thread, relative to the session's start. -1 if it cannot be written.
+int scan_trace_write(ScanTraceSession *ts, const char *path, guint64 *spans, guint64 *dropped);
+void scan_trace_session_free(ScanTraceSession *ts);
+
+TraceSpan *scan_trace_grow(ScanTrace *tr);
+
+// NULL when the buffer is full; the caller fills in what it has beyond the basics
+static inline TraceSpan *scan_trace_span(ScanTrace *tr, guint32 stage, guint64 start, guint64 end,
+                                         const char *path) {
+    TraceSpan *sp = (tr->tail && tr->tail->used < TRACE_CHUNK) ? &tr->tail->span[tr->tail->used++]
+                                                              : scan_trace_grow(tr);
+    if (!sp) return NULL;
+    sp->start = start;
+    sp->end = end;
+    sp->path = path;
+    sp->stage = stage;
+    sp->arg_us[0] = sp->arg_us[1] = sp->arg_us[2] = 0;
+    return sp;
+}
+
+#endif
@@ -0,0 +1,349 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "seen_index.h"
+#include "scan_core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define SEEN_MAGIC "FOSSEEN2"
+#define SEEN_MAGIC_V1 "FOSSEEN1"    // Entries without a stamp
+#define SEEN_DIGEST 32
+#define SEEN_SPILL_SUFFIX ".spill"
+#define SEEN_PATH_MAX 65536         // Longest path a spill record may carry
+
+// --- Internal Structs ---
+typedef struct {
+    unsigned char sha256[SEEN_DIGEST];
+    guint32 path;               // Offset into seen_index.paths
+    guint32 file_type;          // FileType when hashed
+    gint64 mtime;
+    guint64 size;
+    FileStamp stamp;            // All zero when unknown
+} SeenEntry;
+
+typedef struct {
+    char magic[8];
+    guint64 count;
+    guint64 paths_len;
+} SeenHeader;
+
+struct seen_index {
+    SeenEntry *entries;
+    size_t count;
+    size_t cap;
+    char *paths;                // NUL-separated
+    size_t paths_len;
+    size_t paths_cap;
+    gboolean sorted;            // By digest, as written to disk
+    GMutex lock;
+};
+
+static int entry_cmp(const void *a, const void *b) {
+    return memcmp(((const SeenEntry *)a)->sha256, ((const SeenEntry *)b)->sha256, SEEN_DIGEST);
+}
+
+static void seen_sort(seen_index *ix) {
+    if (!ix->sorted && ix->count > 1) qsort(ix->entries, ix->count, sizeof(SeenEntry), entry_cmp);
+    ix->sorted = TRUE;
+}
+
+// Appends one entry with its own copy of the path; -1 when out of memory
+static int seen_append(seen_index *ix, const SeenEntry *e, const char *path) {
+    size_t n = strlen(path) + 1;
+    if (ix->paths_len + n > G_MAXUINT32) return -1;
+    if (ix->count == ix->cap) {
+        size_t new_cap = ix->cap ? ix->cap * 2 : 1024;
+        SeenEntry *entries = realloc(ix->entries, new_cap * sizeof(SeenEntry));
+        if (!entries) return -1;
+        ix->entries = entries;
+        ix->cap = new_cap;
+    }
+    if (ix->paths_len + n > ix->paths_cap) {
+        size_t new_cap = ix->paths_cap ? ix->paths_cap * 2 : 64 * 1024;
+        while (new_cap < ix->paths_len + n) new_cap *= 2;
+        char *paths = realloc(ix->paths, new_cap);
+        if (!paths) return -1;
+        ix->paths = paths;
+        ix->paths_cap = new_cap;
+    }
+    SeenEntry *dst = &ix->entries[ix->count++];
+    *dst = *e;
+    dst->path = (guint32)ix->paths_len;
+    memcpy(ix->paths + ix->paths_len, path, n);
+    ix->paths_len += n;
+    ix->sorted = FALSE;
+    return 0;
+}
+
+// --- Lifetime ---
+seen_index *seen_index_new(void) {
+    seen_index *ix = calloc(1, sizeof(seen_index));
+    if (!ix) return NULL;
+    g_mutex_init(&ix->lock);
+    ix->sorted = TRUE;
+    return ix;
+}
+
+seen_index *seen_index_load(const char *path) {
+    seen_index *ix = seen_index_new();
+    if (!ix) return NULL;
+    FILE *f = fopen(path, "rb");
+    if (!f) return ix;
+    SeenHeader h;
+    memset(&h, 0, sizeof(h));
+    gboolean ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, SEEN_MAGIC, 8) == 0 &&
+                  h.count < ((guint64)1 << 32) && h.paths_len <= G_MAXUINT32;
+    if (ok) {
+        ix->entries = malloc(h.count ? (size_t)h.count * sizeof(SeenEntry) : 1);
+        ix->paths = malloc(h.paths_len ? (size_t)h.paths_len : 1);
+        ok = ix->entries && ix->paths &&
+             fread(ix->entries, sizeof(SeenEntry), (size_t)h.count, f) == h.count &&
+             fread(ix->paths, 1, (size_t)h.paths_len, f) == h.paths_len;
+    }
+    fclose(f);
+    if (!ok && memcmp(h.magic, SEEN_MAGIC_V1, 8) == 0) {
+        printf("[SCAN] %s predates file stamps; starting a new seen-file index\n", path);
+        free(ix->entries);
+        free(ix->paths);
+        ix->entries = NULL;
+        ix->paths = NULL;
+        return ix;
+    }
+    // Every path offset must land on a string inside the table
+    for (size_t i = 0; ok && i < h.count; ++i)
+        ok = ix->entries[i].path < h.paths_len && (ix->entries[i].path == 0 || ix->paths[ix->entries[i].path - 1] == '\0');
+    if (ok && h.paths_len > 0) ok = ix->paths[h.paths_len - 1] == '\0';
+    if (!ok) {
+        printf("[WARN] %s is damaged; starting a new seen-file index\n", path);
+        free(ix->entries);
+        free(ix->paths);
+        ix->entries = NULL;
+        ix->paths = NULL;
+        return ix;
+    }
+    ix->count = ix->cap = (size_t)h.count;
+    ix->paths_len = ix->paths_cap = (size_t)h.paths_len;
+    ix->sorted = TRUE;
+    return ix;
+}
+
+void seen_index_free(seen_index *ix) {
+    if (!ix) return;
+    free(ix->entries);
+    free(ix->paths);
+    g_mutex_clear(&ix->lock);
+    free(ix);
+}
+
+size_t seen_index_count(const seen_index *ix) {
+    return ix->count;
+}
+
+size_t seen_index_bytes(seen_index *ix) {
+    g_mutex_lock(&ix->lock);
+    size_t n = ix->cap * sizeof(SeenEntry) + ix->paths_cap;
+    g_mutex_unlock(&ix->lock);
+    return n;
+}
+
+// --- Recording ---
+void seen_index_add(seen_index *ix, const unsigned char sha256[32], const char *path,
+                    gint64 mtime, guint64 size, guint32 file_type, const FileStamp *stamp) {
+    SeenEntry e;
+    memset(&e, 0, sizeof(e));
+    memcpy(e.sha256, sha256, SEEN_DIGEST);
+    e.file_type = file_type;
+    e.mtime = mtime;
+    e.size = size;
+    if (stamp) e.stamp = *stamp;
+    g_mutex_lock(&ix->lock);
+    seen_append(ix, &e, path);  // Out of memory only costs retro-hunt coverage
+    g_mutex_unlock(&ix->lock);
+}
+
+static int seen_write(const seen_index *ix, const char *path) {
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return -1;
+    SeenHeader h;
+    memcpy(h.magic, SEEN_MAGIC, 8);
+    h.count = ix->count;
+    h.paths_len = ix->paths_len;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(ix->entries, sizeof(SeenEntry), ix->count, f) == ix->count &&
+             fwrite(ix->paths, 1, ix->paths_len, f) == ix->paths_len;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        remove(tmp);
+        return -1;
+    }
+    return replace_file_atomic(tmp, path);
+}
+
+void seen_index_foreach(seen_index *ix, SeenEntryFn fn, void *user) {
+    g_mutex_lock(&ix->lock);
+    seen_sort(ix);
+    for (size_t i = 0; i < ix->count; ++i) {
+        const SeenEntry *e = &ix->entries[i];
+        gboolean stamped = e->stamp.change != 0 || e->stamp.id.index != 0;
+        fn(user, e->sha256, ix->paths + e->path, e->mtime, e->size, e->file_type, stamped ? &e->stamp : NULL);
+    }
+    g_mutex_unlock(&ix->lock);
+}
+
+// --- Spill ---
+// Records appended in order: a SeenEntry whose `path` holds the path's length with its
+// NUL, then the path. A record cut short by a crash ends the file.
+static char *spill_path(const char *path) {
+    return g_strconcat(path, SEEN_SPILL_SUFFIX, NULL);
+}
+
+static seen_index *spill_load(const char *path) {
+    seen_index *ix = seen_index_new();
+    if (!ix) return NULL;
+    char *spill = spill_path(path);
+    FILE *f = fopen(spill, "rb");
+    g_free(spill);
+    if (!f) return ix;
+    char *p = malloc(SEEN_PATH_MAX);
+    SeenEntry e;
+    while (p && fread(&e, sizeof(e), 1, f) == 1) {
+        if (e.path == 0 || e.path > SEEN_PATH_MAX || fread(p, 1, e.path, f) != e.path || p[e.path - 1] != '\0') break;
+        if (seen_append(ix, &e, p) != 0) break;
+    }
+    free(p);
+    fclose(f);
+    return ix;
+}
+
+int seen_index_spill(seen_index *recent, const char *path) {
+    // Take the buffers and let the workers start a new batch
+    g_mutex_lock(&recent->lock);
+    SeenEntry *entries = recent->entries;
+    char *paths = recent->paths;
+    size_t count = recent->count;
+    recent->entries = NULL;
+    recent->paths = NULL;
+    recent->count = recent->cap = 0;
+    recent->paths_len = recent->paths_cap = 0;
+    recent->sorted = TRUE;
+    g_mutex_unlock(&recent->lock);
+
+    char *spill = spill_path(path);
+    FILE *f = fopen(spill, "ab");
+    g_free(spill);
+    int ok = f != NULL;
+    for (size_t i = 0; ok && i < count; ++i) {
+        SeenEntry e = entries[i];
+        const char *p = paths + e.path;
+        e.path = (guint32)strlen(p) + 1;
+        ok = fwrite(&e, sizeof(e), 1, f) == 1 && fwrite(p, 1, e.path, f) == e.path;
+    }
+    if (f && fclose(f) != 0) ok = 0;
+    if (!ok) {
+        // What made it to the file is merged at commit anyway; the rest goes back to memory
+        g_mutex_lock(&recent->lock);
+        for (size_t i = 0; i < count; ++i) seen_append(recent, &entries[i], paths + entries[i].path);
+        g_mutex_unlock(&recent->lock);
+    }
+    free(entries);
+    free(paths);
+    return ok ? 0 : -1;
+}
+
+// --- Commit ---
+int seen_index_commit(seen_index *recent, const char *path) {
+    seen_index *stored = seen_index_load(path);
+    seen_index *spilled = spill_load(path);
+    seen_index *merged = seen_index_new();
+    if (!stored || !spilled || !merged) {
+        seen_index_free(stored);
+        seen_index_free(spilled);
+        seen_index_free(merged);
+        return -1;
+    }
+    // Newest first: this scan's last batch, its spilled batches from the last one
+    // back, then the stored index. A path already taken supersedes its older
+    // entries; the path table is rebuilt so strings of dropped entries do not pile up.
+    GHashTable *fresh = g_hash_table_new(g_str_hash, g_str_equal);
+    int rc = 0;
+    for (size_t i = 0; i < recent->count; ++i) {
+        const char *p = recent->paths + recent->entries[i].path;
+        if (g_hash_table_contains(fresh, p)) continue;
+        g_hash_table_add(fresh, (gpointer)p);
+        if (seen_append(merged, &recent->entries[i], p) != 0) rc = -1;
+    }
+    for (size_t i = spilled->count; rc == 0 && i-- > 0;) {
+        const char *p = spilled->paths + spilled->entries[i].path;
+        if (g_hash_table_contains(fresh, p)) continue;
+        g_hash_table_add(fresh, (gpointer)p);
+        if (seen_append(merged, &spilled->entries[i], p) != 0) rc = -1;
+    }
+    for (size_t i = 0; rc == 0 && i < stored->count; ++i) {
+        const char *p = stored->paths + stored->entries[i].path;
+        if (g_hash_table_contains(fresh, p)) continue;
+        if (seen_append(merged, &stored->entries[i], p) != 0) rc = -1;
+    }
+    g_hash_table_destroy(fresh);
+    seen_index_free(stored);
+    seen_index_free(spilled);
+    if (rc == 0) {
+        seen_sort(merged);
+        rc = seen_write(merged, path);
+    }
+    seen_index_free(merged);
+    if (rc == 0) {
+        char *spill = spill_path(path);
+        remove(spill);
+        g_free(spill);
+    }
+    return rc;
+}
+
+// --- Retro-hunt ---
+typedef struct {
+    seen_index *ix;
+    size_t cursor;              // New digests arrive in ascending order: walk forward once
+    size_t hits;
+    SeenHitFn on_hit;
+    void *user;
+} RetroWalk;
+
+// Same bytes as when hashed? Metadata only; the file is not opened. Size and mtime
+// survive a rewrite that puts the mtime back (touch -r, cp -p, a restore): the
+// identity and change time do not, so an entry recorded without a stamp is no hit.
+static gboolean entry_unchanged(const SeenEntry *e, const char *path) {
+    if (e->stamp.change == 0 && e->stamp.id.index == 0) return FALSE;
+    struct stat st;
+    FileStamp now;
+    if (stat(path, &st) != 0 || get_file_stamp(path, &now) != 0) return FALSE;
+    return (guint64)st.st_size == e->size && (gint64)st.st_mtime == e->mtime &&
+           now.id.volume == e->stamp.id.volume && now.id.index == e->stamp.id.index &&
+           now.change == e->stamp.change;
+}
+
+static void retro_visit(void *user, const unsigned char *digest, const char *label) {
+    RetroWalk *w = (RetroWalk *)user;
+    seen_index *ix = w->ix;
+    while (w->cursor < ix->count && memcmp(ix->entries[w->cursor].sha256, digest, SEEN_DIGEST) < 0) w->cursor++;
+    for (size_t i = w->cursor; i < ix->count && memcmp(ix->entries[i].sha256, digest, SEEN_DIGEST) == 0; ++i) {
+        const char *path = ix->paths + ix->entries[i].path;
+        if (!entry_unchanged(&ix->entries[i], path)) continue;
+        w->hits++;
+        w->on_hit(w->user, path, label, ix->entries[i].file_type);
+    }
+}
+
+size_t seen_index_retro_hunt(seen_index *ix, const sig_db *before, const sig_db *after,
+                             SeenHitFn on_hit, void *user) {
+    seen_sort(ix);
+    if (ix->count == 0) return 0;
+    RetroWalk w = { ix, 0, 0, on_hit, user };
+    sigdb_diff(before, after, HASH_SHA256, retro_visit, &w);
+    return w.hits;
+}
@@ -0,0 +1,47 @@
+#ifndef SEEN_INDEX_H
+#define SEEN_INDEX_H
+#include <glib.h>
+#include "sig_db.h"
+#include "scan_core.h"
+/* Persistent record of every file the scanner hashed: SHA-256 -> path, size,
+ * mtime, file type and the file's stamp (identity and change time). After a signature update only the newly added digests are
+ * checked against it (retro-hunt), so files already on disk are flagged
+ * without being read again. */
+
+typedef struct seen_index seen_index;
+
+// Called for every recorded file that matches a new signature and is unchanged on disk
+typedef void (*SeenHitFn)(void *user, const char *path, const char *label, guint32 file_type);
+
+seen_index *seen_index_new(void);
+// Missing or unreadable files give an empty index (it is only a cache)
+seen_index *seen_index_load(const char *path);
+void seen_index_free(seen_index *ix);
+size_t seen_index_count(const seen_index *ix);
+// Allocated for entries and paths; thread-safe
+size_t seen_index_bytes(seen_index *ix);
+
+// Thread-safe; scan workers call it after hashing a clean file
+// `stamp` as taken before the read; NULL when unknown
+void seen_index_add(seen_index *ix, const unsigned char sha256[32], const char *path,
+                    gint64 mtime, guint64 size, guint32 file_type, const FileStamp *stamp);
+// Merges `recent` and whatever was spilled into the index stored at `path` (a path
+// seen again replaces its old entry), rewrites the file and removes the spill
+int seen_index_commit(seen_index *recent, const char *path);
+// Appends what `recent` holds to <path>.spill and empties it, for a scan too large to
+// hold its clean files. Workers keep adding meanwhile: the lock only covers taking
+// the buffers. Nothing is merged until seen_index_commit.
+int seen_index_spill(seen_index *recent, const char *path);
+
+// Visits every recorded file, in digest order; stamp is NULL when none was recorded
+typedef void (*SeenEntryFn)(void *user, const unsigned char sha256[32], const char *path,
+                            gint64 mtime, guint64 size, guint32 file_type, const FileStamp *stamp);
+void seen_index_foreach(seen_index *ix, SeenEntryFn fn, void *user);
+
+// Intersects the SHA-256 digests `after` adds over `before` (NULL = all) with the index.
+// Files whose size, mtime, identity or change time differ from when they were hashed,
+// and entries recorded without a stamp, are skipped. Returns the hits.
+size_t seen_index_retro_hunt(seen_index *ix, const sig_db *before, const sig_db *after,
+                             SeenHitFn on_hit, void *user);
+
+#endif
@@ -0,0 +1,79 @@
+#include "sha1.h"
+#include <string.h>
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_transf(sha1_ctx *ctx, const unsigned char *blk) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = ((uint32_t)blk[4*i] << 24) | ((uint32_t)blk[4*i+1] << 16)
+             | ((uint32_t)blk[4*i+2] << 8) | (uint32_t)blk[4*i+3];
+    }
+    for (int i = 16; i < 80; ++i) w[i] = ROTL32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+    uint32_t a = ctx->h[0], b = ctx->h[1], c = ctx->h[2], d = ctx->h[3], e = ctx->h[4];
+    // One loop per round function keeps the selection out of the hot path
+#define SHA1_STEP(f, k) do {                                   \
+        uint32_t t = ROTL32(a, 5) + (f) + e + (k) + w[i];      \
+        e = d; d = c; c = ROTL32(b, 30); b = a; a = t;         \
+    } while (0)
+    int i = 0;
+    for (; i < 20; ++i) SHA1_STEP((b & c) | (~b & d), 0x5a827999);
+    for (; i < 40; ++i) SHA1_STEP(b ^ c ^ d, 0x6ed9eba1);
+    for (; i < 60; ++i) SHA1_STEP((b & c) | (b & d) | (c & d), 0x8f1bbcdc);
+    for (; i < 80; ++i) SHA1_STEP(b ^ c ^ d, 0xca62c1d6);
+#undef SHA1_STEP
+    ctx->h[0] += a;
+    ctx->h[1] += b;
+    ctx->h[2] += c;
+    ctx->h[3] += d;
+    ctx->h[4] += e;
+}
+
+void sha1_init(sha1_ctx *ctx) {
+    ctx->h[0] = 0x67452301;
+    ctx->h[1] = 0xefcdab89;
+    ctx->h[2] = 0x98badcfe;
+    ctx->h[3] = 0x10325476;
+    ctx->h[4] = 0xc3d2e1f0;
+    ctx->len = 0;
+    ctx->tot_len = 0;
+}
+
+void sha1_update(sha1_ctx *ctx, const unsigned char *message, size_t len) {
+    ctx->tot_len += len;
+    if (ctx->len) {
+        size_t take = SHA1_BLOCK_SIZE - ctx->len;
+        if (take > len) take = len;
+        memcpy(ctx->block + ctx->len, message, take);
+        ctx->len += take;
+        message += take;
+        len -= take;
+        if (ctx->len < SHA1_BLOCK_SIZE) return;
+        sha1_transf(ctx, ctx->block);
+        ctx->len = 0;
+    }
+    while (len >= SHA1_BLOCK_SIZE) {
+        sha1_transf(ctx, message);
+        message += SHA1_BLOCK_SIZE;
+        len -= SHA1_BLOCK_SIZE;
+    }
+    memcpy(ctx->block, message, len);
+    ctx->len = len;
+}
+
+void sha1_final(sha1_ctx *ctx, unsigned char digest[SHA1_DIGEST_SIZE]) {
+    uint64_t bits = ctx->tot_len * 8;
+    unsigned char pad[SHA1_BLOCK_SIZE * 2];
+    size_t pad_len = (ctx->len < 56) ? 56 - ctx->len : 120 - ctx->len;
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (int i = 0; i < 8; ++i) pad[pad_len + i] = (unsigned char)(bits >> (56 - 8 * i));  // Big endian
+    sha1_update(ctx, pad, pad_len + 8);
+    for (int i = 0; i < 5; ++i) {
+        digest[4*i]     = (unsigned char)(ctx->h[i] >> 24);
+        digest[4*i + 1] = (unsigned char)(ctx->h[i] >> 16);
+        digest[4*i + 2] = (unsigned char)(ctx->h[i] >> 8);
+        digest[4*i + 3] = (unsigned char)(ctx->h[i]);
+    }
+}
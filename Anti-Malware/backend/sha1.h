@@ -0,0 +1,21 @@
+#ifndef SHA1_H
+#define SHA1_H
+#include <stdint.h>
+#include <stddef.h>
+/* SHA-1 (FIPS 180-4). Only for matching the SHA-1 column of threat-intel feeds. */
+
+#define SHA1_DIGEST_SIZE 20
+#define SHA1_BLOCK_SIZE  64
+
+typedef struct {
+    uint64_t tot_len;
+    size_t len;
+    unsigned char block[SHA1_BLOCK_SIZE];
+    uint32_t h[5];
+} sha1_ctx;
+
+void sha1_init(sha1_ctx *ctx);
+void sha1_update(sha1_ctx *ctx, const unsigned char *message, size_t len);
+void sha1_final(sha1_ctx *ctx, unsigned char digest[SHA1_DIGEST_SIZE]);
+
+#endif
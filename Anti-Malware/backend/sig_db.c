@@ -0,0 +1,975 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "sig_db.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIG_HEX_SSE2 1
+#endif
+
+#define SIG_LABEL_ID_SIZE sizeof(uint32_t)
+#define SIG_MIN_CHUNK (1024 * 1024)     // Below this a chunk is not worth a thread
+#define SIG_MAX_THREADS 64
+#define SIG_LINE_SKIP -2                // Blank line or comment
+#define SIG_LINE_BAD  -1                // Counted as malformed
+
+// --- Hex Helpers ---
+// -1 for anything that is not a hex digit. Constant, so parser threads share it
+// without any initialisation order to get right.
+static const signed char hex_table[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+#ifdef SIG_HEX_SSE2
+// 32 hex digits -> 16 bytes. Returns -1 if any input byte is not a hex digit.
+static int hex32_sse2(const char *hex, unsigned char *out) {
+    const __m128i c0 = _mm_set1_epi8('0' - 1), c9 = _mm_set1_epi8('9' + 1);
+    const __m128i ca = _mm_set1_epi8('a' - 1), cf = _mm_set1_epi8('f' + 1);
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i ten_a = _mm_set1_epi8('a' - 10);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i lo_mask = _mm_set1_epi16(0x00FF);
+    __m128i nib[2];
+    for (int h = 0; h < 2; ++h) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(hex + 16 * h));
+        __m128i l = _mm_or_si128(v, lower);
+        // Signed compares: bytes >= 0x80 are negative and fall out of both ranges
+        __m128i is_dig = _mm_and_si128(_mm_cmpgt_epi8(v, c0), _mm_cmplt_epi8(v, c9));
+        __m128i is_alp = _mm_and_si128(_mm_cmpgt_epi8(l, ca), _mm_cmplt_epi8(l, cf));
+        if (_mm_movemask_epi8(_mm_or_si128(is_dig, is_alp)) != 0xFFFF) return -1;
+        nib[h] = _mm_or_si128(_mm_and_si128(is_dig, _mm_sub_epi8(v, zero)),
+                              _mm_and_si128(is_alp, _mm_sub_epi8(l, ten_a)));
+        // Each 16-bit lane holds (high nibble, low nibble) in memory order
+        nib[h] = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nib[h], lo_mask), 4),
+                              _mm_srli_epi16(nib[h], 8));
+    }
+    _mm_storeu_si128((__m128i *)out, _mm_packus_epi16(nib[0], nib[1]));
+    return 0;
+}
+#endif
+
+static int hex_to_bytes(const char *hex, unsigned char *out, size_t n) {
+    size_t i = 0;
+#ifdef SIG_HEX_SSE2
+    for (; i + 16 <= n; i += 16)
+        if (hex32_sse2(hex + 2 * i, out + i) != 0) return -1;
+#endif
+    int bad = 0;
+    for (; i < n; ++i) {
+        int hi = hex_table[(unsigned char)hex[2*i]];
+        int lo = hex_table[(unsigned char)hex[2*i+1]];
+        bad |= hi | lo;         // Any -1 sets the sign bit; checked once per digest
+        out[i] = (unsigned char)((hi << 4) | (lo & 0xF));
+    }
+    return bad < 0 ? -1 : 0;
+}
+
+static int is_sep(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r' || c == '\n';
+}
+
+static size_t sig_stride(HashAlgo algo) {
+    return hash_digest_len(algo) + SIG_LABEL_ID_SIZE;
+}
+
+// --- Label Interning ---
+// Open addressing over label ids (+1, 0 = empty). Only lives while loading.
+typedef struct {
+    uint32_t *slots;
+    size_t cap;
+    size_t used;
+} sig_intern;
+
+static uint32_t label_hash(const char *s, size_t n) {
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)s[i]) * 16777619u;
+    return h;
+}
+
+static int intern_grow(sig_db *db, sig_intern *t) {
+    size_t new_cap = t->cap ? t->cap * 2 : 64;
+    uint32_t *slots = calloc(new_cap, sizeof(uint32_t));
+    if (!slots) return -1;
+    for (size_t i = 0; i < t->cap; ++i) {
+        if (!t->slots[i]) continue;
+        const char *s = db->labels + (t->slots[i] - 1);
+        size_t k = label_hash(s, strlen(s)) & (new_cap - 1);
+        while (slots[k]) k = (k + 1) & (new_cap - 1);
+        slots[k] = t->slots[i];
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->cap = new_cap;
+    return 0;
+}
+
+static int sigdb_intern(sig_db *db, sig_intern *t, const char *s, size_t n, uint32_t *id) {
+    if ((t->used + 1) * 2 > t->cap && intern_grow(db, t) != 0) return -1;
+    size_t k = label_hash(s, n) & (t->cap - 1);
+    for (; t->slots[k]; k = (k + 1) & (t->cap - 1)) {
+        const char *have = db->labels + (t->slots[k] - 1);
+        if (strncmp(have, s, n) == 0 && have[n] == '\0') {
+            *id = t->slots[k] - 1;
+            return 0;
+        }
+    }
+    // New label: append to the string table (few distinct labels, so few reallocs)
+    if (db->labels_len + n + 1 > db->labels_cap) {
+        size_t new_cap = db->labels_cap ? db->labels_cap * 2 : 256;
+        while (new_cap < db->labels_len + n + 1) new_cap *= 2;
+        char *labels = realloc(db->labels, new_cap);
+        if (!labels) return -1;
+        db->labels = labels;
+        db->labels_cap = new_cap;
+    }
+    *id = (uint32_t)db->labels_len;
+    memcpy(db->labels + db->labels_len, s, n);
+    db->labels[db->labels_len + n] = '\0';
+    db->labels_len += n + 1;
+    t->slots[k] = *id + 1;
+    t->used++;
+    return 0;
+}
+
+// --- Feed Mapping ---
+typedef struct {
+    const char *data;
+    size_t len;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} sig_feed_map;
+
+// Maps the feed read-only; the page cache is the only copy of the text
+static int map_feed(sig_feed_map *m, const char *path) {
+    memset(m, 0, sizeof(*m));
+#ifdef _WIN32
+    m->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                          FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m->file == INVALID_HANDLE_VALUE) return -1;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m->file, &size)) {
+        CloseHandle(m->file);
+        return -1;
+    }
+    m->len = (size_t)size.QuadPart;
+    if (m->len == 0) return 0;      // Empty files cannot be mapped
+    m->mapping = CreateFileMappingA(m->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m->mapping) m->data = (const char *)MapViewOfFile(m->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m->data) {
+        if (m->mapping) CloseHandle(m->mapping);
+        CloseHandle(m->file);
+        return -1;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    m->len = (size_t)st.st_size;
+    if (m->len > 0) {
+        void *p = mmap(NULL, m->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(p, m->len, MADV_SEQUENTIAL);
+        m->data = (const char *)p;
+    }
+    close(fd);      // The mapping keeps its own reference
+#endif
+    return 0;
+}
+
+static void unmap_feed(sig_feed_map *m) {
+#ifdef _WIN32
+    if (m->data) UnmapViewOfFile(m->data);
+    if (m->mapping) CloseHandle(m->mapping);
+    CloseHandle(m->file);
+#else
+    if (m->data) munmap((void *)m->data, m->len);
+#endif
+}
+
+// --- Feed Parsing ---
+// Splits one line into its hex token and optional label. Returns the algorithm,
+// SIG_LINE_SKIP or SIG_LINE_BAD. Only the four digest lengths are probed; a
+// separator inside the token is caught by hex decoding.
+static int parse_line(const char *line, size_t len, const char **label, size_t *label_len) {
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t')) len--;
+    if (len == 0 || line[0] == '#') return SIG_LINE_SKIP;
+    int algo = SIG_LINE_BAD;
+    size_t hex_len = 0;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) {
+        size_t l = hash_digest_len((HashAlgo)a) * 2;
+        if (l <= len && (l == len || is_sep(line[l])) && (hex_len == 0 || l < hex_len)) {
+            hex_len = l;
+            algo = a;
+        }
+    }
+    if (algo < 0 || !label) return algo;
+
+    size_t p = hex_len;
+    while (p < len && is_sep(line[p])) p++;
+    *label = line + p;
+    *label_len = len - p;
+    return algo;
+}
+
+static const char *next_line(const char *p, const char *end, size_t *len) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    if (!nl) nl = end;
+    *len = (size_t)(nl - p);
+    return (nl < end) ? nl + 1 : end;
+}
+
+// One newline-aligned slice of the feed, parsed by its own thread
+typedef struct {
+    sig_db *db;
+    const char *begin;
+    const char *end;
+    size_t counts[HASH_ALGO_COUNT];     // Pass 1: candidate lines
+    unsigned char *out[HASH_ALGO_COUNT];// Pass 2: this chunk's region of each index
+    size_t written[HASH_ALGO_COUNT];
+    size_t lines;
+    size_t malformed;
+    sig_intern *intern;
+    GMutex *intern_lock;
+    uint32_t generic_id;
+    int failed;
+} sig_chunk;
+
+static gpointer chunk_count(gpointer data) {
+    sig_chunk *c = (sig_chunk *)data;
+    for (const char *p = c->begin; p < c->end; ) {
+        size_t len;
+        const char *line = p;
+        p = next_line(p, c->end, &len);
+        int algo = parse_line(line, len, NULL, NULL);
+        if (algo >= 0) c->counts[algo]++;
+    }
+    return NULL;
+}
+
+static gpointer chunk_decode(gpointer data) {
+    sig_chunk *c = (sig_chunk *)data;
+    // Feeds come grouped by family, so remember the last label instead of locking per line
+    const char *last_label = NULL;
+    size_t last_len = 0;
+    uint32_t last_id = c->generic_id;
+
+    for (const char *p = c->begin; p < c->end && !c->failed; ) {
+        size_t len, label_len = 0;
+        const char *line = p, *label = NULL;
+        p = next_line(p, c->end, &len);
+        int algo = parse_line(line, len, &label, &label_len);
+        if (algo == SIG_LINE_SKIP) continue;
+        c->lines++;
+        if (algo < 0) {
+            c->malformed++;
+            continue;
+        }
+        size_t dlen = hash_digest_len((HashAlgo)algo);
+        unsigned char *rec = c->out[algo] + c->written[algo] * sig_stride((HashAlgo)algo);
+        if (hex_to_bytes(line, rec, dlen) != 0) {
+            c->malformed++;
+            continue;
+        }
+        uint32_t id = c->generic_id;
+        if (label_len > 0) {
+            if (!last_label || last_len != label_len || memcmp(last_label, label, label_len) != 0) {
+                g_mutex_lock(c->intern_lock);
+                if (sigdb_intern(c->db, c->intern, label, label_len, &last_id) != 0) c->failed = 1;
+                g_mutex_unlock(c->intern_lock);
+                last_label = label;
+                last_len = label_len;
+            }
+            id = last_id;
+        }
+        memcpy(rec + dlen, &id, SIG_LABEL_ID_SIZE);
+        c->written[algo]++;
+    }
+    return NULL;
+}
+
+// Runs fn over n jobs of job_size bytes each, job 0 on the calling thread
+static void run_jobs(void *jobs, size_t job_size, int n, GThreadFunc fn) {
+    GThread *threads[SIG_MAX_THREADS];
+    for (int i = 1; i < n; ++i) threads[i] = g_thread_new("sigdb-load", fn, (char *)jobs + i * job_size);
+    fn(jobs);
+    for (int i = 1; i < n; ++i) g_thread_join(threads[i]);
+}
+
+// --- Sorting ---
+// Digests are uniformly distributed, so one counting pass on the first two bytes
+// leaves ~n/65536 records per bucket, which insertion sort finishes in cache.
+// Every phase is split across the loader threads.
+#define SIG_BUCKETS 65536
+
+typedef struct {
+    const sig_index *ix;
+    size_t stride;
+    size_t dlen;
+    unsigned char *tmp;
+    size_t from, to;            // Records histogrammed / scattered by this job
+    uint32_t *pos;              // SIG_BUCKETS counters, then write cursors
+    const size_t *start;        // Global bucket starts (SIG_BUCKETS + 1)
+    size_t b_from, b_to;        // Buckets sorted by this job
+} sig_sort_job;
+
+static size_t bucket_of(const unsigned char *rec) {
+    return (size_t)rec[0] << 8 | rec[1];
+}
+
+static gpointer sort_histogram(gpointer data) {
+    sig_sort_job *j = (sig_sort_job *)data;
+    memset(j->pos, 0, SIG_BUCKETS * sizeof(uint32_t));
+    for (size_t i = j->from; i < j->to; ++i) j->pos[bucket_of(j->ix->recs + i * j->stride)]++;
+    return NULL;
+}
+
+static gpointer sort_scatter(gpointer data) {
+    sig_sort_job *j = (sig_sort_job *)data;
+    for (size_t i = j->from; i < j->to; ++i) {
+        const unsigned char *r = j->ix->recs + i * j->stride;
+        memcpy(j->tmp + (size_t)j->pos[bucket_of(r)]++ * j->stride, r, j->stride);
+    }
+    return NULL;
+}
+
+static gpointer sort_buckets(gpointer data) {
+    sig_sort_job *j = (sig_sort_job *)data;
+    unsigned char hold[HASH_MAX_DIGEST + SIG_LABEL_ID_SIZE];
+    for (size_t b = j->b_from; b < j->b_to; ++b) {
+        unsigned char *base = j->tmp + j->start[b] * j->stride;
+        size_t n = j->start[b + 1] - j->start[b];
+        for (size_t i = 1; i < n; ++i) {
+            unsigned char *r = base + i * j->stride;
+            size_t k = i;
+            // The first two bytes are equal within a bucket
+            while (k > 0 && memcmp(base + (k - 1) * j->stride + 2, r + 2, j->dlen - 2) > 0) k--;
+            if (k == i) continue;
+            memcpy(hold, r, j->stride);
+            memmove(base + (k + 1) * j->stride, base + k * j->stride, (i - k) * j->stride);
+            memcpy(base + k * j->stride, hold, j->stride);
+        }
+    }
+    return NULL;
+}
+
+static int sort_index(sig_index *ix, HashAlgo algo, unsigned char *tmp, int n_jobs) {
+    if (ix->count < 2) return 0;
+    sig_sort_job jobs[SIG_MAX_THREADS];
+    size_t *start = calloc(SIG_BUCKETS + 1, sizeof(size_t));
+    uint32_t *pos = malloc((size_t)n_jobs * SIG_BUCKETS * sizeof(uint32_t));
+    if (!start || !pos || ix->count > UINT32_MAX) {
+        free(start);
+        free(pos);
+        return -1;
+    }
+    for (int i = 0; i < n_jobs; ++i) {
+        jobs[i].ix = ix;
+        jobs[i].stride = sig_stride(algo);
+        jobs[i].dlen = hash_digest_len(algo);
+        jobs[i].tmp = tmp;
+        jobs[i].from = ix->count * (size_t)i / (size_t)n_jobs;
+        jobs[i].to = ix->count * (size_t)(i + 1) / (size_t)n_jobs;
+        jobs[i].pos = pos + (size_t)i * SIG_BUCKETS;
+        jobs[i].start = start;
+        jobs[i].b_from = SIG_BUCKETS * (size_t)i / (size_t)n_jobs;
+        jobs[i].b_to = SIG_BUCKETS * (size_t)(i + 1) / (size_t)n_jobs;
+    }
+    // 1. Per-job histograms -> bucket starts and per-job write cursors (stable order)
+    run_jobs(jobs, sizeof(jobs[0]), n_jobs, sort_histogram);
+    size_t run = 0;
+    for (size_t b = 0; b < SIG_BUCKETS; ++b) {
+        start[b] = run;
+        for (int i = 0; i < n_jobs; ++i) {
+            uint32_t c = jobs[i].pos[b];
+            jobs[i].pos[b] = (uint32_t)run;
+            run += c;
+        }
+    }
+    start[SIG_BUCKETS] = run;
+    // 2. Scatter into buckets, 3. finish each bucket
+    run_jobs(jobs, sizeof(jobs[0]), n_jobs, sort_scatter);
+    run_jobs(jobs, sizeof(jobs[0]), n_jobs, sort_buckets);
+
+    // Copy back, collapsing duplicate digests to one entry
+    size_t stride = sig_stride(algo), dlen = hash_digest_len(algo);
+    size_t out = 0;
+    for (size_t i = 0; i < ix->count; ++i) {
+        const unsigned char *r = tmp + i * stride;
+        if (out > 0 && memcmp(r, ix->recs + (out - 1) * stride, dlen) == 0) continue;
+        memcpy(ix->recs + out * stride, r, stride);
+        out++;
+    }
+    ix->count = out;
+    free(pos);
+    free(start);
+    return 0;
+}
+
+// --- Growable Indexes ---
+// Records appended one line at a time (deltas, streamed downloads)
+typedef struct {
+    sig_index ix;
+    size_t cap;
+} sig_vec;
+
+static unsigned char *vec_push(sig_vec *v, size_t stride) {
+    if (v->ix.count == v->cap) {
+        size_t new_cap = v->cap ? v->cap * 2 : 256;
+        unsigned char *recs = realloc(v->ix.recs, new_cap * stride);
+        if (!recs) return NULL;
+        v->ix.recs = recs;
+        v->cap = new_cap;
+    }
+    return v->ix.recs + v->ix.count++ * stride;
+}
+
+// --- Standard SigDB Functions ---
+int sigdb_load_ex(sig_db *db, const char *sigdb_path, sig_load_report *report) {
+    memset(db, 0, sizeof(sig_db));
+    if (report) memset(report, 0, sizeof(*report));
+    sig_feed_map map;
+    if (map_feed(&map, sigdb_path) != 0) return -1;
+    const char *end = map.data + map.len;
+
+    // 1. Newline-aligned chunks, one per core (but not smaller than SIG_MIN_CHUNK)
+    int n_chunks = (int)MIN((guint)SIG_MAX_THREADS, MAX(1u, g_get_num_processors()));
+    n_chunks = (int)MIN((size_t)n_chunks, MAX((size_t)1, map.len / SIG_MIN_CHUNK));
+    sig_chunk chunks[SIG_MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    const char *cut = map.data;
+    for (int i = 0; i < n_chunks; ++i) {
+        const char *stop = (i == n_chunks - 1) ? end : map.data + map.len / n_chunks * (i + 1);
+        if (stop < cut) stop = cut;
+        const char *nl = (stop < end) ? memchr(stop, '\n', (size_t)(end - stop)) : NULL;
+        stop = nl ? nl + 1 : end;
+        chunks[i].begin = cut;
+        chunks[i].end = stop;
+        cut = stop;
+    }
+
+    // 2. Count candidates per chunk, then give every chunk its own region of each index
+    run_jobs(chunks, sizeof(chunks[0]), n_chunks, chunk_count);
+    size_t arena_size = 0;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a)
+        for (int i = 0; i < n_chunks; ++i) arena_size += chunks[i].counts[a] * sig_stride((HashAlgo)a);
+    db->arena = malloc(arena_size ? arena_size : 1);
+    if (!db->arena) {
+        unmap_feed(&map);
+        return -1;
+    }
+    unsigned char *slot = db->arena;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) {
+        db->idx[a].recs = slot;
+        for (int i = 0; i < n_chunks; ++i) {
+            chunks[i].out[a] = slot;
+            slot += chunks[i].counts[a] * sig_stride((HashAlgo)a);
+        }
+    }
+
+    // 3. Decode in parallel; labels go through one shared intern table
+    sig_intern intern = { NULL, 0, 0 };
+    GMutex intern_lock;
+    g_mutex_init(&intern_lock);
+    uint32_t generic_id = 0;
+    int rc = sigdb_intern(db, &intern, GENERIC_LABEL, strlen(GENERIC_LABEL), &generic_id);
+    for (int i = 0; i < n_chunks; ++i) {
+        chunks[i].db = db;
+        chunks[i].intern = &intern;
+        chunks[i].intern_lock = &intern_lock;
+        chunks[i].generic_id = generic_id;
+    }
+    if (rc == 0) run_jobs(chunks, sizeof(chunks[0]), n_chunks, chunk_decode);
+    g_mutex_clear(&intern_lock);
+    free(intern.slots);
+    unmap_feed(&map);
+
+    // 4. Close the gaps left by malformed lines inside each chunk's region
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) {
+        size_t stride = sig_stride((HashAlgo)a);
+        for (int i = 0; i < n_chunks; ++i) {
+            unsigned char *dst = db->idx[a].recs + db->idx[a].count * stride;
+            if (dst != chunks[i].out[a]) memmove(dst, chunks[i].out[a], chunks[i].written[a] * stride);
+            db->idx[a].count += chunks[i].written[a];
+        }
+    }
+    size_t lines = 0, malformed = 0, loaded = 0;
+    for (int i = 0; i < n_chunks; ++i) {
+        lines += chunks[i].lines;
+        malformed += chunks[i].malformed;
+        if (chunks[i].failed) rc = -1;
+    }
+
+    // 5. Sort so every lookup is O(log n); one scratch buffer serves all indexes
+    unsigned char *tmp = (rc == 0) ? malloc(arena_size ? arena_size : 1) : NULL;
+    if (!tmp) rc = -1;
+    for (int a = 0; rc == 0 && a < HASH_ALGO_COUNT; ++a) {
+        loaded += db->idx[a].count;
+        rc = sort_index(&db->idx[a], (HashAlgo)a, tmp, n_chunks);
+    }
+    free(tmp);
+    if (rc != 0) {
+        sigdb_free(db);
+        return -1;
+    }
+    if (report) {
+        report->lines = lines;
+        report->malformed = malformed;
+        report->duplicates = loaded - sigdb_count(db);
+        report->threads = (unsigned)n_chunks;
+    }
+    return 0;
+}
+
+int sigdb_load(sig_db *db, const char *sigdb_path) {
+    return sigdb_load_ex(db, sigdb_path, NULL);
+}
+
+void sigdb_free(sig_db *db) {
+    if (db) {
+        free(db->arena);
+        free(db->labels);
+        memset(db, 0, sizeof(sig_db));
+    }
+}
+
+size_t sigdb_count(const sig_db *db) {
+    size_t n = 0;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) n += db->idx[a].count;
+    return n;
+}
+
+size_t sigdb_bytes(const sig_db *db) {
+    size_t n = db->labels_cap;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) n += db->idx[a].count * sig_stride((HashAlgo)a);
+    return n;
+}
+
+unsigned sigdb_algos(const sig_db *db) {
+    unsigned mask = 0;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a)
+        if (db->idx[a].count) mask |= HASH_BIT(a);
+    return mask;
+}
+
+const char *sigdb_lookup(const sig_db *db, HashAlgo algo, const unsigned char *digest) {
+    if (algo >= HASH_ALGO_COUNT) return NULL;
+    const sig_index *ix = &db->idx[algo];
+    size_t len = hash_digest_len(algo);
+    size_t stride = sig_stride(algo);
+    size_t lo = 0, hi = ix->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const unsigned char *rec = ix->recs + mid * stride;
+        int c = memcmp(digest, rec, len);
+        if (c == 0) {
+            uint32_t id;
+            memcpy(&id, rec + len, SIG_LABEL_ID_SIZE);
+            return db->labels + id;
+        }
+        if (c < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return NULL;
+}
+
+const char *sigdb_match(const sig_db *db, const MultiDigest *d, HashAlgo *which) {
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) {
+        if (!(d->algos & HASH_BIT(a))) continue;
+        const char *label = sigdb_lookup(db, (HashAlgo)a, d->digest[a]);
+        if (label) {
+            if (which) *which = (HashAlgo)a;
+            return label;
+        }
+    }
+    return NULL;
+}
+
+size_t sigdb_diff(const sig_db *before, const sig_db *after, HashAlgo algo, SigDigestFn fn, void *user) {
+    if (algo >= HASH_ALGO_COUNT) return 0;
+    size_t stride = sig_stride(algo), dlen = hash_digest_len(algo);
+    const sig_index *old = before ? &before->idx[algo] : NULL;
+    size_t j = 0, visited = 0;
+    for (size_t i = 0; i < after->idx[algo].count; ++i) {
+        const unsigned char *rec = after->idx[algo].recs + i * stride;
+        // Both indexes are sorted: one forward walk finds what is new
+        while (old && j < old->count && memcmp(old->recs + j * stride, rec, dlen) < 0) j++;
+        if (old && j < old->count && memcmp(old->recs + j * stride, rec, dlen) == 0) continue;
+        uint32_t id;
+        memcpy(&id, rec + dlen, SIG_LABEL_ID_SIZE);
+        fn(user, rec, after->labels + id);
+        visited++;
+    }
+    return visited;
+}
+
+// --- Streaming Build ---
+#define SIG_MAX_LINE 4096               // Longer lines are counted as malformed
+
+struct sig_builder {
+    sig_db db;                          // Labels accumulate here; the arena comes at finish
+    sig_intern intern;
+    uint32_t generic_id;
+    sig_vec recs[HASH_ALGO_COUNT];
+    char carry[SIG_MAX_LINE];           // Line split across two pieces
+    size_t carry_len;
+    gboolean carry_overflow;
+    gboolean has_last;                  // Labels come grouped by family: remember the last one
+    uint32_t last_id;
+    size_t last_len;
+    sig_load_report report;
+    int failed;
+};
+
+sig_builder *sigdb_builder_new(void) {
+    sig_builder *b = calloc(1, sizeof(sig_builder));
+    if (!b) return NULL;
+    if (sigdb_intern(&b->db, &b->intern, GENERIC_LABEL, strlen(GENERIC_LABEL), &b->generic_id) != 0) {
+        sigdb_builder_free(b);
+        return NULL;
+    }
+    return b;
+}
+
+static void builder_line(sig_builder *b, const char *line, size_t len) {
+    const char *label = NULL;
+    size_t label_len = 0;
+    int algo = parse_line(line, len, &label, &label_len);
+    if (algo == SIG_LINE_SKIP) return;
+    b->report.lines++;
+    if (algo < 0) {
+        b->report.malformed++;
+        return;
+    }
+    size_t dlen = hash_digest_len((HashAlgo)algo);
+    unsigned char *rec = vec_push(&b->recs[algo], sig_stride((HashAlgo)algo));
+    if (!rec) {
+        b->failed = 1;
+        return;
+    }
+    if (hex_to_bytes(line, rec, dlen) != 0) {
+        b->recs[algo].ix.count--;
+        b->report.malformed++;
+        return;
+    }
+    uint32_t id = b->generic_id;
+    if (label_len > 0) {
+        if (!b->has_last || b->last_len != label_len || memcmp(b->db.labels + b->last_id, label, label_len) != 0) {
+            if (sigdb_intern(&b->db, &b->intern, label, label_len, &b->last_id) != 0) b->failed = 1;
+            b->has_last = TRUE;
+            b->last_len = label_len;
+        }
+        id = b->last_id;
+    }
+    memcpy(rec + dlen, &id, SIG_LABEL_ID_SIZE);
+}
+
+// Completes the line held in carry; `more` is its continuation up to the newline
+static void builder_carry(sig_builder *b, const char *more, size_t n) {
+    if (b->carry_len + n > sizeof(b->carry)) b->carry_overflow = TRUE;
+    if (b->carry_overflow) {
+        b->report.lines++;
+        b->report.malformed++;
+    } else {
+        if (n) memcpy(b->carry + b->carry_len, more, n);
+        builder_line(b, b->carry, b->carry_len + n);
+    }
+    b->carry_len = 0;
+    b->carry_overflow = FALSE;
+}
+
+int sigdb_builder_feed(sig_builder *b, const char *text, size_t len) {
+    const char *end = text + len;
+    for (const char *p = text; p < end && !b->failed; ) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        size_t n = (size_t)((nl ? nl : end) - p);
+        if (!nl) {
+            // Unfinished line: keep it for the next piece
+            if (b->carry_len + n > sizeof(b->carry)) b->carry_overflow = TRUE;
+            else memcpy(b->carry + b->carry_len, p, n);
+            b->carry_len += b->carry_overflow ? 0 : n;
+            break;
+        }
+        if (b->carry_len > 0 || b->carry_overflow) builder_carry(b, p, n);
+        else builder_line(b, p, n);
+        p = nl + 1;
+    }
+    return b->failed ? -1 : 0;
+}
+
+int sigdb_builder_finish(sig_builder *b, sig_db *db, sig_load_report *report) {
+    // A feed without a trailing newline still counts its last line
+    if (b->carry_len > 0 || b->carry_overflow) builder_carry(b, NULL, 0);
+    int rc = b->failed ? -1 : 0;
+
+    // 1. Move every index into one arena, freeing each growable copy as it goes
+    size_t arena_size = 0, loaded = 0;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) {
+        arena_size += b->recs[a].ix.count * sig_stride((HashAlgo)a);
+        loaded += b->recs[a].ix.count;
+    }
+    if (rc == 0 && !(b->db.arena = malloc(arena_size ? arena_size : 1))) rc = -1;
+    unsigned char *slot = b->db.arena;
+    for (int a = 0; rc == 0 && a < HASH_ALGO_COUNT; ++a) {
+        size_t bytes = b->recs[a].ix.count * sig_stride((HashAlgo)a);
+        if (bytes) memcpy(slot, b->recs[a].ix.recs, bytes);
+        b->db.idx[a].recs = slot;
+        b->db.idx[a].count = b->recs[a].ix.count;
+        slot += bytes;
+        free(b->recs[a].ix.recs);
+        memset(&b->recs[a], 0, sizeof(b->recs[a]));
+    }
+
+    // 2. The only step that waits for the last byte: the parallel sort
+    int n_jobs = (int)MIN((guint)SIG_MAX_THREADS, MAX(1u, g_get_num_processors()));
+    n_jobs = (int)MIN((size_t)n_jobs, MAX((size_t)1, loaded / SIG_BUCKETS));
+    unsigned char *tmp = (rc == 0) ? malloc(arena_size ? arena_size : 1) : NULL;
+    if (!tmp) rc = -1;
+    for (int a = 0; rc == 0 && a < HASH_ALGO_COUNT; ++a)
+        rc = sort_index(&b->db.idx[a], (HashAlgo)a, tmp, n_jobs);
+    free(tmp);
+
+    if (rc == 0) {
+        *db = b->db;
+        memset(&b->db, 0, sizeof(b->db));
+        if (report) {
+            *report = b->report;
+            report->duplicates = loaded - sigdb_count(db);
+            report->threads = (unsigned)n_jobs;
+        }
+    }
+    sigdb_builder_free(b);
+    return rc;
+}
+
+void sigdb_builder_free(sig_builder *b) {
+    if (!b) return;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) free(b->recs[a].ix.recs);
+    free(b->intern.slots);
+    sigdb_free(&b->db);
+    free(b);
+}
+
+// --- Delta Updates ---
+// Registers labels copied from the base so their ids (offsets) stay valid
+static int intern_seed(sig_db *db, sig_intern *t) {
+    for (size_t off = 0; off < db->labels_len; ) {
+        size_t n = strlen(db->labels + off);
+        if ((t->used + 1) * 2 > t->cap && intern_grow(db, t) != 0) return -1;
+        size_t k = label_hash(db->labels + off, n) & (t->cap - 1);
+        while (t->slots[k]) k = (k + 1) & (t->cap - 1);
+        t->slots[k] = (uint32_t)off + 1;
+        t->used++;
+        off += n + 1;
+    }
+    return 0;
+}
+
+static guint64 header_value(const char *line, size_t len, const char *key) {
+    size_t klen = strlen(key);
+    if (len <= klen || strncmp(line, key, klen) != 0) return 0;
+    return g_ascii_strtoull(line + klen, NULL, 10);
+}
+
+// Parses the delta into sorted add/remove lists; labels are interned into out
+static int parse_delta(sig_db *out, const char *data, size_t len, sig_vec *add, sig_vec *del,
+                       sig_delta_report *report) {
+    sig_intern intern = { NULL, 0, 0 };
+    uint32_t generic_id;
+    int rc = intern_seed(out, &intern);
+    if (rc == 0) rc = sigdb_intern(out, &intern, GENERIC_LABEL, strlen(GENERIC_LABEL), &generic_id);
+
+    const char *end = data + len;
+    for (const char *p = data; rc == 0 && p < end; ) {
+        size_t n, label_len = 0;
+        const char *line = p, *label = NULL;
+        p = next_line(p, end, &n);
+        if (n > 0 && line[0] == '#') {
+            guint64 v;
+            if ((v = header_value(line, n, "# from:")) != 0) report->from_version = v;
+            if ((v = header_value(line, n, "# to:")) != 0) report->to_version = v;
+            continue;
+        }
+        sig_vec *dst = add;
+        if (n > 0 && (line[0] == '+' || line[0] == '-')) {
+            if (line[0] == '-') dst = del;
+            line++;
+            n--;
+        }
+        int algo = parse_line(line, n, &label, &label_len);
+        if (algo == SIG_LINE_SKIP) continue;
+        if (algo < 0) {
+            report->malformed++;
+            continue;
+        }
+        size_t dlen = hash_digest_len((HashAlgo)algo);
+        unsigned char *rec = vec_push(&dst[algo], sig_stride((HashAlgo)algo));
+        if (!rec) {
+            rc = -1;
+            break;
+        }
+        if (hex_to_bytes(line, rec, dlen) != 0) {
+            dst[algo].ix.count--;
+            report->malformed++;
+            continue;
+        }
+        uint32_t id = generic_id;
+        if (label_len > 0 && sigdb_intern(out, &intern, label, label_len, &id) != 0) rc = -1;
+        memcpy(rec + dlen, &id, SIG_LABEL_ID_SIZE);
+    }
+    free(intern.slots);
+
+    for (int a = 0; rc == 0 && a < HASH_ALGO_COUNT; ++a) {
+        size_t most = MAX(add[a].ix.count, del[a].ix.count);
+        if (most < 2) continue;
+        unsigned char *tmp = malloc(most * sig_stride((HashAlgo)a));
+        if (!tmp) return -1;
+        rc = sort_index(&add[a].ix, (HashAlgo)a, tmp, 1);
+        if (rc == 0) rc = sort_index(&del[a].ix, (HashAlgo)a, tmp, 1);
+        free(tmp);
+    }
+    return rc;
+}
+
+// One sorted pass over base, additions and removals; returns the records written
+static size_t merge_index(const sig_index *base, const sig_index *add, const sig_index *del,
+                          HashAlgo algo, unsigned char *out, sig_delta_report *report) {
+    size_t stride = sig_stride(algo), dlen = hash_digest_len(algo);
+    size_t i = 0, j = 0, k = 0, n = 0;
+    while (i < base->count || j < add->count) {
+        const unsigned char *b = (i < base->count) ? base->recs + i * stride : NULL;
+        const unsigned char *a = (j < add->count) ? add->recs + j * stride : NULL;
+        int c = !a ? -1 : !b ? 1 : memcmp(b, a, dlen);
+        const unsigned char *rec = (c <= 0) ? b : a;
+        if (c <= 0) i++;
+        if (c >= 0) j++;
+
+        while (k < del->count && memcmp(del->recs + k * stride, rec, dlen) < 0) k++;
+        if (k < del->count && memcmp(del->recs + k * stride, rec, dlen) == 0) {
+            if (c <= 0) report->removed++;
+            continue;
+        }
+        if (c == 0 && memcmp(b + dlen, a + dlen, SIG_LABEL_ID_SIZE) != 0) {
+            rec = a;
+            report->relabeled++;
+        }
+        if (c > 0) report->added++;
+        memcpy(out + n++ * stride, rec, stride);
+    }
+    return n;
+}
+
+int sigdb_apply_delta(const sig_db *base, guint64 base_version, const char *delta_path,
+                      sig_db *out, sig_delta_report *report) {
+    sig_delta_report local;
+    if (!report) report = &local;
+    memset(report, 0, sizeof(*report));
+    memset(out, 0, sizeof(*out));
+    sig_feed_map map;
+    if (map_feed(&map, delta_path) != 0) return -1;
+
+    // Same label offsets as the base, so base records are copied without remapping
+    out->labels = malloc(base->labels_len ? base->labels_len : 1);
+    if (!out->labels) {
+        unmap_feed(&map);
+        return -1;
+    }
+    memcpy(out->labels, base->labels, base->labels_len);
+    out->labels_len = out->labels_cap = base->labels_len;
+
+    sig_vec add[HASH_ALGO_COUNT], del[HASH_ALGO_COUNT];
+    memset(add, 0, sizeof(add));
+    memset(del, 0, sizeof(del));
+    int rc = parse_delta(out, map.data, map.len, add, del, report);
+    unmap_feed(&map);
+    if (rc == 0 && report->from_version > base_version) rc = SIG_DELTA_GAP;
+
+    size_t arena_size = 0;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a)
+        arena_size += (base->idx[a].count + add[a].ix.count) * sig_stride((HashAlgo)a);
+    if (rc == 0 && !(out->arena = malloc(arena_size ? arena_size : 1))) rc = -1;
+
+    unsigned char *slot = out->arena;
+    for (int a = 0; rc == 0 && a < HASH_ALGO_COUNT; ++a) {
+        out->idx[a].recs = slot;
+        out->idx[a].count = merge_index(&base->idx[a], &add[a].ix, &del[a].ix, (HashAlgo)a, slot, report);
+        slot += out->idx[a].count * sig_stride((HashAlgo)a);
+    }
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) {
+        free(add[a].ix.recs);
+        free(del[a].ix.recs);
+    }
+    if (rc != 0) sigdb_free(out);
+    return rc;
+}
+
+int sigdb_save(const sig_db *db, const char *path) {
+    static const char digits[] = "0123456789abcdef";
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+    fprintf(f, "# Written by FOS-Antivirus from %zu signatures\n", sigdb_count(db));
+    char line[2 * HASH_MAX_DIGEST + 512];
+    int rc = 0;
+    for (int a = 0; rc == 0 && a < HASH_ALGO_COUNT; ++a) {
+        size_t stride = sig_stride((HashAlgo)a), dlen = hash_digest_len((HashAlgo)a);
+        for (size_t i = 0; i < db->idx[a].count; ++i) {
+            const unsigned char *rec = db->idx[a].recs + i * stride;
+            for (size_t b = 0; b < dlen; ++b) {
+                line[2*b] = digits[rec[b] >> 4];
+                line[2*b+1] = digits[rec[b] & 0xF];
+            }
+            size_t n = 2 * dlen;
+            uint32_t id;
+            memcpy(&id, rec + dlen, SIG_LABEL_ID_SIZE);
+            const char *label = db->labels + id;
+            if (strcmp(label, GENERIC_LABEL) != 0) {
+                // Overlong labels are cut rather than split across lines
+                size_t l = MIN(strlen(label), sizeof(line) - n - 2);
+                line[n++] = ' ';
+                memcpy(line + n, label, l);
+                n += l;
+            }
+            line[n++] = '\n';
+            if (fwrite(line, 1, n, f) != n) {
+                rc = -1;
+                break;
+            }
+        }
+    }
+    if (fclose(f) != 0) rc = -1;
+    return rc;
+}
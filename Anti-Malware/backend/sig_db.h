@@ -0,0 +1,89 @@
+#ifndef SIG_DB_H
+#define SIG_DB_H
+#include <stddef.h>
+#include <stdint.h>
+#include "multi_hash.h"
+
+#define GENERIC_LABEL "MalwareBazaar_Threat"
+
+// --- Signature Structs ---
+// One sorted index per digest algorithm. A record is the packed digest
+// (hash_digest_len() bytes) followed by a 4-byte label id: 36 bytes for SHA-256.
+typedef struct {
+    unsigned char *recs;    // Points into sig_db.arena
+    size_t count;
+} sig_index;
+
+typedef struct {
+    unsigned char *arena;   // Every index's records in one allocation
+    char *labels;           // Interned labels, NUL separated; a label id is its offset
+    size_t labels_len;
+    size_t labels_cap;
+    sig_index idx[HASH_ALGO_COUNT];
+} sig_db;
+
+// What sigdb_load_ex saw in the feed
+typedef struct {
+    size_t lines;           // Non-blank, non-comment lines
+    size_t malformed;       // Lines that are not a valid digest; skipped
+    size_t duplicates;      // Valid digests already present in the feed
+    unsigned threads;       // Parser threads used
+} sig_load_report;
+
+// What sigdb_apply_delta changed
+typedef struct {
+    size_t added;           // Digests that were not in the base
+    size_t removed;         // Base digests dropped by '-' lines
+    size_t relabeled;       // Base digests whose label changed
+    size_t malformed;
+    guint64 from_version;   // "# from: N" header, 0 if absent
+    guint64 to_version;     // "# to: N" header, 0 if absent
+} sig_delta_report;
+
+#define SIG_DELTA_GAP -2    // The delta starts after base_version; a full download is needed
+
+// --- Function Prototypes ---
+// Loads a text feed and sorts it for lookup. One digest per line, optionally followed
+// by a family label ("<hex> Emotet" or "<hex>,Emotet"); '#' starts a comment.
+// MD5, SHA-1, SHA-256 and SHA-512 lines may be mixed; the hex length picks the index.
+// The file is memory-mapped and parsed on all cores; every line is validated.
+int sigdb_load(sig_db *db, const char *sigdb_path);
+int sigdb_load_ex(sig_db *db, const char *sigdb_path, sig_load_report *report);
+void sigdb_free(sig_db *db);
+size_t sigdb_count(const sig_db *db);
+// What the records and the label table occupy
+size_t sigdb_bytes(const sig_db *db);
+// HASH_BIT mask of algorithms that have at least one signature (what is worth computing)
+unsigned sigdb_algos(const sig_db *db);
+// Binary search in one index; returns the label or NULL when the digest is not a known threat
+const char *sigdb_lookup(const sig_db *db, HashAlgo algo, const unsigned char *digest);
+// Tries every digest present in `d`; `which` (may be NULL) receives the matching algorithm
+const char *sigdb_match(const sig_db *db, const MultiDigest *d, HashAlgo *which);
+
+// Visits, in ascending order, every `algo` digest of `after` that `before` lacks
+// (before may be NULL: all of them). Returns how many were visited.
+typedef void (*SigDigestFn)(void *user, const unsigned char *digest, const char *label);
+size_t sigdb_diff(const sig_db *before, const sig_db *after, HashAlgo algo, SigDigestFn fn, void *user);
+
+// --- Streaming Build ---
+// Builds the same index as sigdb_load_ex from text that arrives in pieces (a
+// download), split anywhere. Lines are parsed as they come; only the final sort
+// waits for the last piece.
+typedef struct sig_builder sig_builder;
+sig_builder *sigdb_builder_new(void);
+int sigdb_builder_feed(sig_builder *b, const char *text, size_t len);
+// Frees the builder. Fails without touching *db if memory ran out while feeding.
+int sigdb_builder_finish(sig_builder *b, sig_db *db, sig_load_report *report);
+void sigdb_builder_free(sig_builder *b);
+
+// --- Delta Updates ---
+// A delta is a feed whose lines may carry a '+' (add, the default) or '-' (remove)
+// prefix, plus optional "# from: N" / "# to: N" headers (versions are Unix times of
+// the snapshots). Builds *out as base with the delta merged in; base is untouched,
+// so it may stay published while the merge runs. Removals win over additions.
+int sigdb_apply_delta(const sig_db *base, guint64 base_version, const char *delta_path,
+                      sig_db *out, sig_delta_report *report);
+// Writes the index as a feed sigdb_load reads back ("<hex> <label>" per line)
+int sigdb_save(const sig_db *db, const char *path);
+
+#endif
@@ -0,0 +1,130 @@
+#include "sig_store.h"
+#include <string.h>
+
+// --- Internal Structs ---
+// One cache line per reader so readers never contend with each other
+typedef struct {
+    volatile gint epoch;        // Epoch seen by the active lookup, 0 = quiescent
+    volatile gint in_use;
+    char pad[64 - 2 * sizeof(gint)];
+} SigReaderSlot;
+
+typedef struct {
+    sig_db db;
+    guint generation;
+} SigGeneration;
+
+static SigReaderSlot reader_slots[SIGSTORE_MAX_READERS];
+static SigGeneration *volatile current = NULL;
+static volatile gint global_epoch = 1;
+static volatile gint generation_counter = 0;
+static volatile gint published_generation = 0;  // Mirrors current->generation
+static GMutex publish_lock;     // Static GMutex needs no init
+
+// --- Readers ---
+int sigstore_reader_register(SigReader *r) {
+    for (int i = 0; i < SIGSTORE_MAX_READERS; ++i) {
+        if (g_atomic_int_compare_and_exchange(&reader_slots[i].in_use, 0, 1)) {
+            g_atomic_int_set(&reader_slots[i].epoch, 0);
+            r->slot = i;
+            return 0;
+        }
+    }
+    r->slot = -1;
+    return -1;
+}
+
+void sigstore_reader_unregister(SigReader *r) {
+    if (r->slot < 0) return;
+    g_atomic_int_set(&reader_slots[r->slot].epoch, 0);
+    g_atomic_int_set(&reader_slots[r->slot].in_use, 0);
+    r->slot = -1;
+}
+
+const sig_db *sigstore_acquire_ex(SigReader *r, guint *generation) {
+    if (generation) *generation = 0;
+    if (r->slot < 0) return NULL;
+    // Announce the epoch first, then read the pointer: a publisher that bumped
+    // the epoch before our announcement had already swapped the pointer.
+    g_atomic_int_set(&reader_slots[r->slot].epoch, g_atomic_int_get(&global_epoch));
+    SigGeneration *gen = g_atomic_pointer_get(&current);
+    if (!gen) return NULL;
+    if (generation) *generation = gen->generation;
+    return &gen->db;
+}
+
+const sig_db *sigstore_acquire(SigReader *r) {
+    return sigstore_acquire_ex(r, NULL);
+}
+
+void sigstore_release(SigReader *r) {
+    if (r->slot >= 0) g_atomic_int_set(&reader_slots[r->slot].epoch, 0);
+}
+
+guint sigstore_generation(void) {
+    // Not read through `current`: without a reader slot it may be freed under us
+    return (guint)g_atomic_int_get(&published_generation);
+}
+
+// --- Publishing ---
+// Waits until every reader is quiescent or has announced the new epoch
+static void wait_for_readers(gint new_epoch) {
+    for (int i = 0; i < SIGSTORE_MAX_READERS; ++i) {
+        int spins = 0;
+        for (;;) {
+            gint e = g_atomic_int_get(&reader_slots[i].epoch);
+            if (e == 0 || e == new_epoch) break;
+            // A lookup is a binary search; yield before sleeping
+            if (++spins < 1000) g_thread_yield();
+            else g_usleep(50);
+        }
+    }
+}
+
+void sigstore_publish(sig_db *db) {
+    SigGeneration *gen = g_new0(SigGeneration, 1);
+    gen->db = *db;
+    memset(db, 0, sizeof(*db));
+
+    g_mutex_lock(&publish_lock);
+    gen->generation = (guint)g_atomic_int_add(&generation_counter, 1) + 1;
+    SigGeneration *old = g_atomic_pointer_get(&current);
+    g_atomic_pointer_set(&current, gen);
+    g_atomic_int_set(&published_generation, (gint)gen->generation);
+    // Skip 0, which marks a quiescent reader
+    gint new_epoch = g_atomic_int_get(&global_epoch) + 1;
+    if (new_epoch == 0) new_epoch = 1;
+    g_atomic_int_set(&global_epoch, new_epoch);
+    wait_for_readers(new_epoch);
+    g_mutex_unlock(&publish_lock);
+
+    if (old) {
+        sigdb_free(&old->db);
+        g_free(old);
+    }
+}
+
+int sigstore_load(const char *sigdb_path, sig_load_report *report) {
+    sig_db db;
+    if (sigdb_load_ex(&db, sigdb_path, report) != 0) return -1;
+    sigstore_publish(&db);
+    return 0;
+}
+
+int sigstore_ensure(const char *sigdb_path, sig_load_report *report) {
+    if (report) memset(report, 0, sizeof(*report));
+    if (g_atomic_pointer_get(&current)) return 0;
+    return sigstore_load(sigdb_path, report);
+}
+
+void sigstore_shutdown(void) {
+    g_mutex_lock(&publish_lock);
+    SigGeneration *old = g_atomic_pointer_get(&current);
+    g_atomic_pointer_set(&current, NULL);
+    g_atomic_int_set(&published_generation, 0);
+    g_mutex_unlock(&publish_lock);
+    if (old) {
+        sigdb_free(&old->db);
+        g_free(old);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SIG_STORE_H
+#define SIG_STORE_H
+#include <glib.h>
+#include "sig_db.h"
+/* The one signature DB every scanner reads, swappable while scans run.
+ * Readers bracket each lookup with sigstore_acquire/sigstore_release: two
+ * atomic stores, never a lock. sigstore_publish swaps the pointer, waits
+ * until no reader can still see the previous generation (epoch grace
+ * period), then frees it. Lookups in flight finish on the old index. */
+
+#define SIGSTORE_MAX_READERS 256
+
+typedef struct {
+    int slot;                   // -1 when not registered
+} SigReader;
+
+// One per thread that looks up signatures. Returns -1 if every slot is taken.
+int sigstore_reader_register(SigReader *r);
+void sigstore_reader_unregister(SigReader *r);
+
+// NULL until something has been published. Valid until sigstore_release; not reentrant.
+const sig_db *sigstore_acquire(SigReader *r);
+// Same, and reports which generation the returned index belongs to (0 with NULL)
+const sig_db *sigstore_acquire_ex(SigReader *r, guint *generation);
+void sigstore_release(SigReader *r);
+
+// Latest published generation; 0 = nothing published yet. Safe without a reader.
+guint sigstore_generation(void);
+
+// Takes ownership of *db (left empty). Blocks only the publisher, and only
+// until lookups on the previous generation have drained.
+void sigstore_publish(sig_db *db);
+// Loads a feed and publishes it. On failure the current generation stays.
+int sigstore_load(const char *sigdb_path, sig_load_report *report);
+// Loads only if nothing is published yet
+int sigstore_ensure(const char *sigdb_path, sig_load_report *report);
+// Frees the current generation; no reader may be active
+void sigstore_shutdown(void);
+
+#endif
@@ -2,25 +2,73 @@
 #include "signature_scan.h"
 #include "scan_bridge.h"
 #include "scan_core.h"
+#include "sig_db.h"
+#include "sig_store.h"
+#include "archive_scan.h"
+#include "content_sig.h"
+#include "feed_stream.h"
+#include "seen_index.h"
+#include "dir_state.h"
+#include "file_type.h"
+#include "feature_extract.h"
+#include "heuristic_engine.h"
+#include "fuzzy_hash.h"
+#include "allowlist.h"
+#include "scan_stats.h"
+#include "scan_trace.h"
+#include "scan_record.h"
+#include "mem_budget.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <errno.h>
 #include <stdint.h>
+#include <sys/stat.h>
 #include <windows.h>
 #include <urlmon.h>
 #pragma comment(lib, "urlmon.lib")
-#define SHA256_SIZE 32
-#define HEXLEN (SHA256_SIZE * 2)
-#define GENERIC_LABEL "MalwareBazaar_Threat"
 #define QUARANTINE_DIR "Quarantine"
 #define HISTORY_LOG "history.log"
+#define CONTENT_DB "content_sigs.db" // Optional byte-pattern signatures
+#define SEEN_DB "seen_hashes.db"    // Clean files by SHA-256, for retro-hunts after updates
+#define RULES_FILE "scan_rules.conf" // Optional exclusion / inclusion rules for the walkers
+#define FEATURE_DB "feature_sigs.db" // Optional imphash / section-hash signatures
+#define FEATURE_MAX_MAP (256u * 1024 * 1024) // Larger executables are not parsed
+#define FUZZY_DB "fuzzy_sigs.db"   // Optional similarity digests of known samples
+#define FUZZY_SKIP_TYPES (FTYPE_BIT(FTYPE_MEDIA) | FTYPE_BIT(FTYPE_ZIP) | FTYPE_BIT(FTYPE_ARCHIVE)) // Compressed: no similarity survives
+#define ALLOWLIST_DB "allowlist.db" // Optional known-good digests (NSRL export or hash list)
+#define ALLOWLIST_BASELINE "allowlist_baseline.db" // Written on the golden image
+#define SCAN_STATS_JSON "scan_stats.json" // Stage histograms of the last scan, with scan_stats_json=1
+#define SCAN_TRACE_JSON "scan_trace.json" // Timeline of the last scan, with scan_trace=1
+#define SCAN_RECORD_FILE "scan_record.tsv" // Files the last scan read and their I/O times, with scan_record=1
+#define PATH_QUEUE_CAP (64 * 1024) // Paths listed ahead of the workers when the walk is streamed
+#define PATH_QUEUE_TIGHT 256       // ... while memory is tight
+#define MEM_CHECK_EVERY 256        // Files claimed between two looks at the seen index
+#define FILE_TABLE_SLOT (4 * sizeof(gpointer)) // GHashTable key, value and hash per entry
+#define QUICK_SCAN_TYPES (FTYPE_EXECUTABLE | FTYPE_BIT(FTYPE_INSTALLER) | FTYPE_BIT(FTYPE_SCRIPT)) // Read to the end by Quick Scan
+#define CONTENT_SKIP_TYPES FTYPE_BIT(FTYPE_MEDIA) // Hashed, but not run through the content patterns
+#define FULL_URL "https://bazaar.abuse.ch/export/txt/sha256/full/"
+#define DELTA_URL "https://bazaar.abuse.ch/export/txt/sha256/recent/" // Additions of the last 48 h
+#define DELTA_FILE "signatures.delta"
+#define DELTA_MAX_AGE (24 * 60 * 60) // Seconds; an older local DB may have missed entries
+#define UPDATE_CHUNK (64 * 1024)
 #define XOR_KEY 0x5A 
 #define Q_MAGIC 0xDEADCAFE // Magic number to identify our files
 
 // Global progress variable definition
 volatile int update_progress = 0;
+int retro_hunt_quarantine = 0;
+int incremental_scan = 0;
+int heuristic_threshold = HEUR_DEFAULT_THRESHOLD;
+int fuzzy_threshold = FUZZY_DEFAULT_THRESHOLD;
+int golden_image = 0;
+int scan_stats_json = 0;
+int scan_trace = 0;
+int scan_record = 0;
+int memory_limit_mb = 0;
+ScanStats *scan_stats_out = NULL;
+guint64 scan_stats_out_ns = 0;
 // Every file in the quarantine folder will start with this struct.
 typedef struct {
     uint32_t magic;         // verification bytes
@@ -28,18 +76,6 @@ typedef struct {
     uint32_t path_len;      // length of original path string
     char threat_name[64];   // name of the virus
 } QuarantineHeader;
-// --- Signature Structs ---
-typedef struct {
-    unsigned char hash[SHA256_SIZE];
-    char *label;
-} sig_entry;
-
-typedef struct {
-    sig_entry *items;
-    size_t count;
-    size_t cap;
-} sig_db;
-
 // --- Helpers ---
 static void log_to_history(const char *display_name, const char *orig, const char *q_path) {
     FILE *f = fopen(HISTORY_LOG, "a");
@@ -53,7 +89,7 @@ static void log_to_history(const char *display_name, const char *orig, const cha
     fclose(f);
 }
 // --- CORE: Quarantine Function ---
-static int quarantine_file(const char *src_path, const char *threat_label) {
+int quarantine_file(const char *src_path, const char *threat_label) {
     CreateDirectoryA(QUARANTINE_DIR, NULL);
     // 1. Generate Unique Name (Timestamp + Hash-ish)
     // Using current ticks ensures we never overwrite a file, even if names are same
@@ -134,150 +170,924 @@ int restore_file_from_quarantine(const char *q_path, const char *dest_path_overr
     DeleteFileA(q_path);
     return 0;
 }
-// --- Standard SigDB Functions (Unchanged) ---
-static int hexnibble(char c) {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return 10 + (c - 'a');
-    if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
-    return -1;
+// --- Scanning Callback ---
+// Executables parsed for feature_sigs.db
+typedef struct {
+    guint64 pe, elf, malformed;
+    guint64 bytes, ns;
+} FxStats;
+
+// Heuristic engine, next to the SHA-256 time it is measured against
+typedef struct {
+    guint64 files, flagged;
+    guint64 bytes, ns;
+} HeurStats;
+
+// Similarity digests: the update rides the hashing read, the lookup follows it
+typedef struct {
+    guint64 files, matched;
+    guint64 bytes, ns;
+    FuzzyQueryStats query;
+} FuzzyStats;
+
+// Known-good files: not read at all, or read but spared the engines
+typedef struct {
+    guint64 unread, unread_bytes;
+    guint64 hashed, hashed_bytes;
+} AllowStats;
+
+typedef struct {
+    content_db *content;        // Byte-pattern signatures, NULL when none are installed
+    unsigned hash_algos;        // Digests worth computing for this DB (HASH_BIT mask)
+    FilePathList *file_list;    // The list of all files to process (From scan_core.h)
+    gint current_index;         // Shared atomic counter for file list consumption
+    HashCost hash_cost;         // Merged from the workers under global_scan_ctx.mutex
+    seen_index *seen;           // Clean files of this scan, merged into SEEN_DB at the end
+    dir_state *dirs;            // Incremental scans: directory markers to commit, else NULL
+    GHashTable *files;          // FileIdentity -> FileSeen, under files_lock
+    GMutex files_lock;
+    guint64 alias_count;        // Paths answered from another path's scan
+    guint64 alias_bytes;
+    guint64 bytes_hashed;       // Merged from the workers under global_scan_ctx.mutex
+    unsigned types;             // FTYPE_BIT mask of files read to the end; others are skipped
+    guint64 type_skipped;
+    FileTypeCost type_cost;     // Merged from the workers under global_scan_ctx.mutex
+    fx_db *features;            // Structural signatures, NULL when none are installed
+    FxStats fx_stats;           // Merged from the workers under global_scan_ctx.mutex
+    int heur_threshold;         // Score that flags a file, 0 = heuristics off
+    HeurStats heur_stats;       // Merged from the workers under global_scan_ctx.mutex
+    fuzzy_db *fuzzy;            // Similarity index, NULL when none is installed or fuzzy_threshold is 0
+    int fuzzy_threshold;        // Largest distance reported as a variant
+    FuzzyStats fuzzy_stats;     // Merged from the workers under global_scan_ctx.mutex
+    allowlist *allow;           // Known-good digests and files, NULL when none are installed
+    AllowStats allow_stats;     // Merged from the workers under global_scan_ctx.mutex
+    ScanStats *stats;           // Stage latencies, merged from the workers under global_scan_ctx.mutex
+    ScanTraceSession *trace;    // Timeline of this scan, NULL unless scan_trace is set
+    ScanRecord *record;         // One slot per listed file, NULL unless scan_record is set
+    struct PathQueue *queue;    // Streamed walk (memory_limit_mb), else NULL and file_list is used
+    gboolean overlapping_roots; // Several roots: any path may be listed twice
+    gint untracked;             // Single-link files kept out of `files` while memory was tight
+    gint spilling;              // A worker is appending `seen` to SEEN_DB's spill file
+    gint seen_spills;
+    gint reader_failures;       // Workers that found no free signature reader slot
+} scan_ctx;
+
+// First bytes of the file, captured while hashing (no extra read) and classified
+typedef struct {
+    unsigned char bytes[FTYPE_HEAD];
+    size_t len;
+    FileType type;
+    const char *path;           // Extension tie-break for text
+    unsigned types;             // Stop reading anything else
+} file_head;
+
+typedef struct {
+    const file_head *head;
+    content_scan *cs;
+} content_route;
+
+typedef struct {
+    SigReader *reader;          // The worker's slot in the signature store
+    char match[128];            // Copied out: the label dies with its generation
+    char member[256];
+} archive_match;
+
+// First sink: the type is known before any engine sees the first buffer
+static int capture_head(void *user, guint64 offset, const unsigned char *buf, size_t len) {
+    file_head *head = (file_head *)user;
+    if (offset != 0) return 0;
+    head->len = MIN(len, sizeof(head->bytes));
+    memcpy(head->bytes, buf, head->len);
+    head->type = file_type_classify(head->bytes, head->len, head->path);
+    return (FTYPE_BIT(head->type) & head->types) ? 0 : 1;
 }
-static int hex_to_bytes(const char *hex, unsigned char out[SHA256_SIZE]) {
-    for (int i = 0; i < SHA256_SIZE; ++i) {
-        int hi = hexnibble(hex[2*i]);
-        int lo = hexnibble(hex[2*i+1]);
-        if (hi < 0 || lo < 0) return -1;
-        out[i] = (hi << 4) | lo;
-    }
+
+static int route_content(void *user, guint64 offset, const unsigned char *buf, size_t len) {
+    content_route *route = (content_route *)user;
+    if (FTYPE_BIT(route->head->type) & CONTENT_SKIP_TYPES) return 0;
+    return content_scan_chunk(route->cs, offset, buf, len);
+}
+
+typedef struct {
+    const file_head *head;
+    heur_scan *hs;
+    HeurStats *stats;
+} heur_route;
+
+static int route_heuristics(void *user, guint64 offset, const unsigned char *buf, size_t len) {
+    heur_route *route = (heur_route *)user;
+    (void)offset;
+    if (!(FTYPE_BIT(route->head->type) & HEUR_TYPES)) return 0;
+    guint64 t0 = hash_clock_ns();
+    heur_scan_feed(route->hs, route->head->type, buf, len);
+    route->stats->ns += hash_clock_ns() - t0;
+    route->stats->bytes += len;
     return 0;
 }
-static int hash_equals(const unsigned char h1[SHA256_SIZE], const unsigned char h2[SHA256_SIZE]) {
-    return memcmp(h1, h2, SHA256_SIZE) == 0;
+
+typedef struct {
+    const file_head *head;
+    fuzzy_state *fs;
+    FuzzyStats *stats;
+} fuzzy_route;
+
+static int route_fuzzy(void *user, guint64 offset, const unsigned char *buf, size_t len) {
+    fuzzy_route *route = (fuzzy_route *)user;
+    (void)offset;
+    if (FTYPE_BIT(route->head->type) & FUZZY_SKIP_TYPES) return 0;
+    guint64 t0 = hash_clock_ns();
+    fuzzy_update(route->fs, buf, len);
+    route->stats->ns += hash_clock_ns() - t0;
+    route->stats->bytes += len;
+    return 0;
 }
-static int sigdb_add(sig_db *db, const unsigned char hash[SHA256_SIZE], const char *label) {
-    if (db->count >= db->cap) {
-        size_t new_cap = (db->cap == 0) ? 64 : db->cap * 2;
-        sig_entry *new_items = realloc(db->items, new_cap * sizeof(sig_entry));
-        if (!new_items) return -1;
-        db->items = new_items;
-        db->cap = new_cap;
+
+static int on_archive_member(void *user, const char *member_path, const MultiDigest *digest) {
+    archive_match *am = (archive_match *)user;
+    const sig_db *db = sigstore_acquire(am->reader);
+    const char *label = db ? sigdb_match(db, digest, NULL) : NULL;
+    if (label) {
+        snprintf(am->match, sizeof(am->match), "%s", label);
+        snprintf(am->member, sizeof(am->member), "%s", member_path);
     }
-    memcpy(db->items[db->count].hash, hash, SHA256_SIZE);
-    db->items[db->count].label = strdup(label);
-    db->count++;
-    return 0;
+    sigstore_release(am->reader);
+    return label != NULL; // One infected member is enough to quarantine the container
+}
+
+// Structure of a PE/ELF. The file is mapped again: the parser needs random access.
+// FALSE if it could not be mapped or is neither format.
+static gboolean parse_features(const char *path, gboolean hash_sections, FileFeatures *ff, FxStats *st) {
+    FileMap m;
+    if (map_file(path, FEATURE_MAX_MAP, &m) != 0) return FALSE;
+    guint64 t0 = hash_clock_ns();
+    int rc = fx_parse(m.data, m.len, hash_sections, ff);
+    st->ns += hash_clock_ns() - t0;
+    st->bytes += m.len;
+    unmap_file(&m);
+    if (rc == FX_NOT_EXEC) return FALSE;
+    if (ff->format == FX_PE) st->pe++;
+    else if (ff->format == FX_ELF) st->elf++;
+    if (rc == FX_MALFORMED) st->malformed++;
+    return TRUE;
+}
+
+// Imports and sections of a PE/ELF the hash and content engines passed; a repacked
+// variant keeps them
+static gboolean match_features(const fx_db *db, const FileFeatures *ff, char *label, size_t label_len) {
+    char why[32];
+    const char *hit = fx_db_match(db, ff, why, sizeof(why));
+    if (!hit) return FALSE;
+    snprintf(label, label_len, "%s (%s)", hit, why);
+    return TRUE;
+}
+
+// Waits for the shared context are a stage of their own: every worker passes through here
+static void lock_scan_ctx(ScanStats *ws) {
+    guint64 t0 = stage_ticks();
+    g_mutex_lock(&global_scan_ctx.mutex);
+    stage_record(ws, STAGE_LOCK_WAIT, t0, stage_ticks());
+}
+
+static void report_threat(ScanStats *ws, const char *path, const char *shown_path, const char *label, FileType type) {
+    // Threat found! Update UI context (thread-safe)
+    lock_scan_ctx(ws);
+    global_scan_ctx.threats_found++;
+    snprintf(global_scan_ctx.last_threat, 255, "%s", label);
+    g_mutex_unlock(&global_scan_ctx.mutex);
+
+    printf("\n[ALERT] THREAT FOUND: %s [%s]\n", shown_path, file_type_name(type));
+    // Quarantine the file on disk (the whole archive for an infected member)
+    guint64 t0 = stage_ticks();
+    quarantine_file(path, label);
+    stage_record(ws, STAGE_QUARANTINE, t0, stage_ticks());
+}
+
+// Heuristic hits are reported, never quarantined: a score is not a verdict
+static void report_suspicious(ScanStats *ws, const char *path, const char *label, FileType type) {
+    lock_scan_ctx(ws);
+    global_scan_ctx.threats_found++;
+    snprintf(global_scan_ctx.last_threat, 255, "%s", label);
+    g_mutex_unlock(&global_scan_ctx.mutex);
+
+    printf("\n[ALERT] SUSPICIOUS: %s [%s] %s\n", path, file_type_name(type), label);
+}
+
+// --- File Identity Dedup ---
+// One scan of each (volume, file index); every other path to it reuses the verdict
+typedef enum { FILE_PENDING, FILE_CLEAN, FILE_THREAT, FILE_UNREAD, FILE_SKIPPED, FILE_SUSPICIOUS } FileVerdict;
+
+typedef struct {
+    FileIdentity id;            // Hash key
+    FileVerdict verdict;
+    FileType type;
+    char label[128];
+    unsigned char sha256[32];
+    gint64 mtime;               // As hashed, for the seen-file index (0 size/mtime = unknown)
+    guint64 size;
+    gboolean have_stat;
+    FileStamp stamp;            // Identity and change time before the read
+    gboolean have_stamp;
+    char *path;                 // First path scanned; overlapping roots list it again
+    GSList *aliases;            // Paths that showed up while the first one was being scanned
+} FileSeen;
+
+static void file_seen_free(gpointer data) {
+    FileSeen *fs = (FileSeen *)data;
+    g_slist_free_full(fs->aliases, g_free);
+    g_free(fs->path);
+    g_free(fs);
 }
-static int sigdb_load(sig_db *db, const char *sigdb_path) {
-    memset(db, 0, sizeof(sig_db));
-    FILE *f = fopen(sigdb_path, "r");
-    if (!f) return -1;
-    char line[128];
-    while (fgets(line, sizeof(line), f)) {
-        line[strcspn(line, "\r\n")] = 0;
-        if (line[0] == 0 || line[0] == '#') continue;
-        unsigned char hash[SHA256_SIZE];
-        if (hex_to_bytes(line, hash) == 0) sigdb_add(db, hash, GENERIC_LABEL);
+
+// Records what a scanned path turned out to be. shown_path differs for archive members.
+static void apply_verdict(scan_ctx *ctx, ScanStats *ws, const char *path, const char *shown_path, const FileSeen *fs) {
+    if (fs->verdict == FILE_CLEAN || fs->verdict == FILE_SUSPICIOUS) {
+        // Suspicious files stay in the seen index so a later signature can confirm them
+        if (fs->verdict == FILE_SUSPICIOUS) report_suspicious(ws, shown_path, fs->label, fs->type);
+        if (fs->have_stat)
+            seen_index_add(ctx->seen, fs->sha256, path, fs->mtime, fs->size, fs->type,
+                           fs->have_stamp ? &fs->stamp : NULL);
+        return;
     }
-    fclose(f);
-    return 0;
+    if (fs->verdict == FILE_SKIPPED) return;    // Not a type this scan reads
+    if (fs->verdict == FILE_THREAT) report_threat(ws, path, shown_path, fs->label, fs->type);
+    // Unread, or quarantine may have failed: do not let the next incremental scan skip it
+    if (ctx->dirs) dir_state_forget(ctx->dirs, path);
+}
+
+// The read pass on the timeline: the open as timed, then one span in which reads,
+// sinks and digests take turns per chunk, with their shares as arguments
+static void trace_read_pass(ScanTrace *tr, guint64 t0, const HashCost *before, const HashCost *after) {
+    guint64 now = stage_ticks(), hash_ns = 0;
+    for (int a = 0; a < HASH_ALGO_COUNT; ++a) hash_ns += after->ns[a] - before->ns[a];
+    guint64 opened = t0 + (guint64)((double)(after->open_ns - before->open_ns) / stage_tick_ns);
+    if (opened > now) opened = now;
+    scan_trace_span(tr, STAGE_OPEN, t0, opened, NULL);
+    TraceSpan *sp = scan_trace_span(tr, STAGE_READ, opened, now, NULL);
+    if (!sp) return;
+    sp->arg_us[0] = (guint32)((after->read_ns - before->read_ns) / 1000);
+    sp->arg_us[1] = (guint32)(hash_ns / 1000);
+    sp->arg_us[2] = (guint32)((after->sink_ns - before->sink_ns) / 1000);
+}
+
+// --- Streaming Enumeration ---
+// With memory_limit_mb the walk runs alongside the workers and hands them paths
+// through a bounded queue, so a large tree is never held in memory whole
+typedef struct PathQueue {
+    GQueue paths;               // Owned copies, in walk order
+    GMutex lock;
+    GCond not_empty;
+    GCond not_full;
+    gboolean closed;            // The walk is over: workers drain what is left, then stop
+    guint peak;                 // Longest the queue got
+    guint64 held_back;          // Paths the walker had to wait to queue
+    guint64 held_back_tight;    // ... because memory was tight
+    gint64 wait_us;             // Walker time spent waiting, inside its directory times
+} PathQueue;
+
+static guint64 path_bytes(const char *path) {
+    return strlen(path) + 1 + sizeof(GList);
 }
-static void sigdb_free(sig_db *db) {
-    if (db) {
-        for (size_t i = 0; i < db->count; ++i) free(db->items[i].label);
-        free(db->items);
-        memset(db, 0, sizeof(sig_db));
+
+static void path_queue_init(PathQueue *q) {
+    memset(q, 0, sizeof(*q));
+    g_queue_init(&q->paths);
+    g_mutex_init(&q->lock);
+    g_cond_init(&q->not_empty);
+    g_cond_init(&q->not_full);
+}
+
+// A stopped scan may leave paths behind
+static void path_queue_clear(PathQueue *q) {
+    char *path;
+    while ((path = g_queue_pop_head(&q->paths)) != NULL) {
+        mem_account(MEM_PATHS, -(gint64)path_bytes(path));
+        g_free(path);
     }
+    g_cond_clear(&q->not_full);
+    g_cond_clear(&q->not_empty);
+    g_mutex_clear(&q->lock);
+}
+
+// WalkFileFn. Waits while the queue is full, which is shorter while memory is tight;
+// after a stop request the rest of the walk is dropped.
+static void path_queue_push(void *user, const char *path) {
+    PathQueue *q = (PathQueue *)user;
+    gboolean tight = FALSE;
+    gint64 waited = 0;
+    g_mutex_lock(&q->lock);
+    while (1) {
+        tight = mem_tight();
+        if (q->paths.length < (tight ? PATH_QUEUE_TIGHT : PATH_QUEUE_CAP)) break;
+        g_mutex_lock(&global_scan_ctx.mutex);
+        gboolean stop = global_scan_ctx.stop_requested;
+        g_mutex_unlock(&global_scan_ctx.mutex);
+        if (stop) {
+            g_mutex_unlock(&q->lock);
+            return;
+        }
+        if (!waited) {
+            waited = g_get_monotonic_time();
+            q->held_back++;
+            if (tight) q->held_back_tight++;
+        }
+        // Bounded, so a stop request is seen while no worker takes anything
+        g_cond_wait_until(&q->not_full, &q->lock, g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND);
+    }
+    if (waited) q->wait_us += g_get_monotonic_time() - waited;
+    g_queue_push_tail(&q->paths, g_strdup(path));
+    if (q->paths.length > q->peak) q->peak = q->paths.length;
+    g_cond_signal(&q->not_empty);
+    g_mutex_unlock(&q->lock);
+    mem_account(MEM_PATHS, (gint64)path_bytes(path));
 }
-// --- Scanning Callback ---
-typedef struct {
-    sig_db *db;                 // Pointer to the loaded database (Original)
-    FilePathList *file_list;    // The list of all files to process (From scan_core.h)
-    gint current_index;         // Shared atomic counter for file list consumption
-} scan_ctx;
 
-extern int hash_equals(const unsigned char *a, const unsigned char *b);
+static void path_queue_close(PathQueue *q) {
+    g_mutex_lock(&q->lock);
+    q->closed = TRUE;
+    g_cond_broadcast(&q->not_empty);
+    g_mutex_unlock(&q->lock);
+}
+
+// The next path for a worker to own, NULL once the walk is over and the queue empty
+static char *path_queue_pop(PathQueue *q) {
+    g_mutex_lock(&q->lock);
+    while (q->paths.length == 0 && !q->closed) g_cond_wait(&q->not_empty, &q->lock);
+    char *path = g_queue_pop_head(&q->paths);
+    if (path) g_cond_signal(&q->not_full);
+    g_mutex_unlock(&q->lock);
+    if (path) mem_account(MEM_PATHS, -(gint64)path_bytes(path));
+    return path;
+}
+
+// Samples RSS and measures the scan's clean-file index, which is spilled next to
+// SEEN_DB when memory is tight and it holds a good share of the limit; one worker
+// at a time does that
+static void mem_checkpoint(scan_ctx *ctx) {
+    mem_sample_rss();
+    size_t bytes = seen_index_bytes(ctx->seen);
+    mem_set(MEM_SEEN, bytes);
+    if (!mem_tight() || bytes < mem_limit() / 8) return;
+    if (!g_atomic_int_compare_and_exchange(&ctx->spilling, 0, 1)) return;
+    if (seen_index_spill(ctx->seen, SEEN_DB) == 0) {
+        g_atomic_int_inc(&ctx->seen_spills);
+        mem_set(MEM_SEEN, seen_index_bytes(ctx->seen));
+    } else {
+        printf("[WARN] Could not spill clean files next to %s; they stay in memory\n", SEEN_DB);
+    }
+    g_atomic_int_set(&ctx->spilling, 0);
+}
 
 static gpointer worker_thread_scan(gpointer data) {
     scan_ctx *ctx = (scan_ctx *)data;
+    HashCost cost = { 0 };      // Thread-local, merged once at the end
+    FileTypeCost type_cost;
+    memset(&type_cost, 0, sizeof(type_cost));
+    FxStats fx_stats = { 0 };
+    HeurStats heur_stats = { 0 };
+    FuzzyStats fuzzy_stats;
+    memset(&fuzzy_stats, 0, sizeof(fuzzy_stats));
+    AllowStats allow_stats = { 0 };
+    ScanStats *ws = g_new0(ScanStats, 1);   // Thread-local histograms
+    if (ctx->trace) ws->trace = scan_trace_thread(ctx->trace, "worker");
+    FileFeatures *features = (ctx->features || ctx->heur_threshold > 0) ? g_new(FileFeatures, 1) : NULL;
+    // The read buffer lives on this thread's stack, inside compute_file_hashes
+    gint64 buffers = SCANCORE_READ_CHUNK + sizeof(ScanStats) + (features ? sizeof(FileFeatures) : 0);
+    guint64 hashed = 0, skipped = 0;
+    SigReader reader;
+    if (sigstore_reader_register(&reader) != 0) {
+        // Without a reader this worker would miss every signature; the walker may
+        // also be waiting for room in the queue. Stop the scan so nothing hangs
+        // and nothing is reported clean unchecked.
+        printf("[WARN] No free signature reader slot (%d in use); stopping the scan\n", SIGSTORE_MAX_READERS);
+        g_atomic_int_inc(&ctx->reader_failures);
+        g_mutex_lock(&global_scan_ctx.mutex);
+        global_scan_ctx.stop_requested = true;
+        g_mutex_unlock(&global_scan_ctx.mutex);
+        g_free(features);
+        g_free(ws);
+        return NULL;
+    }
+    mem_account(MEM_BUFFERS, buffers);
+    char *streamed = NULL;      // Path owned by this worker, from ctx->queue
     // Loop until the global index exceeds the total number of files
     while (1) {
         // Atomically increment and fetch the index for this file
         // We fetch the index BEFORE incrementing, so index = 0, 1, 2, ...
+        guint64 t_file = stage_ticks();
         gint file_index = g_atomic_int_add(&ctx->current_index, 1);
-        
-        if (file_index >= ctx->file_list->total_files) {
-            break; // All files have been claimed/processed
+        if (file_index % MEM_CHECK_EVERY == 0) mem_checkpoint(ctx);
+        char *path;
+        if (ctx->queue) {
+            g_free(streamed);
+            path = streamed = path_queue_pop(ctx->queue);
+            if (!path) break;   // Walk finished and every path claimed
+        } else {
+            if (file_index >= ctx->file_list->total_files) {
+                break; // All files have been claimed/processed
+            }
+            // Get the file path using the index.
+            path = (char*)g_list_nth_data(ctx->file_list->paths, file_index);
         }
-        // Get the file path using the index.
-        char *path = (char*)g_list_nth_data(ctx->file_list->paths, file_index);
+        // Each stage ends on the clock read that starts the next
+        guint64 t_stage = t_file;
+        stage_lap(ws, STAGE_CLAIM, &t_stage);
         
         if (path) {   
             // 1. Thread-safe check for stop request and UI update
             g_mutex_lock(&global_scan_ctx.mutex);
+            stage_lap(ws, STAGE_LOCK_WAIT, &t_stage);
             if (global_scan_ctx.stop_requested) {
                 g_mutex_unlock(&global_scan_ctx.mutex);
-                return NULL; 
+                break;
             }
             // Update UI context
             snprintf(global_scan_ctx.current_file, 255, "%s", path);
-            global_scan_ctx.files_scanned++;
             g_mutex_unlock(&global_scan_ctx.mutex);
 
-            unsigned char hash[SHA256_SIZE];
-            // 2. Compute the hash
-            if (compute_file_sha256(path, hash) != 0) {
-                // Failed to hash (e.g., file locked/permission), continue to next file
-                continue; 
+            // Size and mtime as hashed, so a retro-hunt can tell the file has not changed since
+            struct stat st;
+            FileSeen result;
+            memset(&result, 0, sizeof(result));
+            result.have_stat = (stat(path, &st) == 0);
+            if (result.have_stat) {
+                result.mtime = (gint64)st.st_mtime;
+                result.size = (guint64)st.st_size;
+            }
+            // Taken before the read: a write during it moves the change time past the stamp
+            result.have_stamp = result.have_stat && get_file_stamp(path, &result.stamp) == 0;
+            // 2. Hardlinks and overlapping roots: read each file once per scan
+            // While memory is tight a file with one link, under one root, cannot come
+            // up again and stays out of the table (Windows stat reports one link always)
+            FileSeen *owned = NULL;
+            FileIdentity id = result.stamp.id;
+            gboolean track = ctx->overlapping_roots || (result.have_stat && st.st_nlink > 1) || !mem_tight();
+            if (!track) g_atomic_int_inc(&ctx->untracked);
+            if (track && result.have_stamp) {
+                g_mutex_lock(&ctx->files_lock);
+                FileSeen *fs = g_hash_table_lookup(ctx->files, &id);
+                if (!fs) {
+                    owned = g_new0(FileSeen, 1);
+                    owned->id = id;
+                    owned->verdict = FILE_PENDING;
+                    owned->path = g_strdup(path);
+                    g_hash_table_insert(ctx->files, &owned->id, owned);
+                    mem_account(MEM_FILE_TABLE, (gint64)(sizeof(FileSeen) + strlen(path) + 1 + FILE_TABLE_SLOT));
+                } else if (strcmp(fs->path, path) == 0) {
+                    g_mutex_unlock(&ctx->files_lock);
+                    continue;   // The very same path, listed by two roots: counted once
+                } else {
+                    ctx->alias_count++;
+                    ctx->alias_bytes += result.size;
+                }
+                g_atomic_int_inc(&global_scan_ctx.files_scanned);
+                if (fs && fs->verdict == FILE_PENDING) {
+                    fs->aliases = g_slist_prepend(fs->aliases, g_strdup(path));
+                    g_mutex_unlock(&ctx->files_lock);
+                    continue;   // Reported by the worker scanning the first copy
+                }
+                if (fs) {
+                    FileSeen known = *fs;
+                    g_mutex_unlock(&ctx->files_lock);
+                    apply_verdict(ctx, ws, path, path, &known);
+                    continue;
+                }
+                g_mutex_unlock(&ctx->files_lock);
+            } else {
+                g_atomic_int_inc(&global_scan_ctx.files_scanned);
+            }
+            stage_lap(ws, STAGE_IDENTITY, &t_stage);
+
+            MultiDigest digest;
+            file_head head;
+            head.len = 0;
+            head.type = FTYPE_UNKNOWN;
+            head.path = path;
+            head.types = ctx->types;
+            content_scan cs;
+            content_scan_init(&cs, ctx->content);
+            content_route route = { &head, &cs };
+            heur_scan hs;
+            heur_scan_init(&hs);
+            heur_route hroute = { &head, &hs, &heur_stats };
+            fuzzy_state fz;
+            fuzzy_state_init(&fz);
+            fuzzy_route froute = { &head, &fz, &fuzzy_stats };
+            ScanChunkSink sinks[4] = { { capture_head, &head } };
+            size_t n_sinks = 1;
+            if (ctx->content) sinks[n_sinks++] = (ScanChunkSink){ route_content, &route };
+            if (ctx->heur_threshold > 0) sinks[n_sinks++] = (ScanChunkSink){ route_heuristics, &hroute };
+            if (ctx->fuzzy) sinks[n_sinks++] = (ScanChunkSink){ route_fuzzy, &froute };
+            const char *shown_path = path;
+            guint64 t0 = hash_clock_ns();
+            // 3. Allowlisted and unchanged since it was last hashed: the recorded SHA-256
+            // stands in, and the file is not read at all
+            guint32 recorded_type = FTYPE_UNKNOWN;
+            gboolean unread_trust = ctx->allow && result.have_stamp &&
+                                    allowlist_match_file(ctx->allow, &result.stamp, result.size, result.mtime,
+                                                         digest.digest[HASH_SHA256], &recorded_type);
+            int hash_rc = 0;
+            HashCost before = cost;
+            if (unread_trust) {
+                digest.algos = HASH_BIT(HASH_SHA256);
+                head.type = recorded_type < FTYPE_COUNT ? (FileType)recorded_type : FTYPE_UNKNOWN;
+            } else {
+                // Compute every digest the DB uses; the type is known after the first buffer
+                // and decides whether the rest is read and which engines see it
+                hash_rc = compute_file_hashes(path, ctx->hash_algos, &digest, sinks, n_sinks, &cost);
+                if (cost.open_ns != before.open_ns) {
+                    // Opened: the read pass split from the cost counters, in their ns
+                    guint64 hash_ns = 0;
+                    for (int a = 0; a < HASH_ALGO_COUNT; ++a) hash_ns += cost.ns[a] - before.ns[a];
+                    stage_hist_add(&ws->stage[STAGE_OPEN], cost.open_ns - before.open_ns);
+                    stage_hist_add(&ws->stage[STAGE_READ], cost.read_ns - before.read_ns);
+                    stage_hist_add(&ws->stage[STAGE_HASH], hash_ns);
+                    if (n_sinks > 0) stage_hist_add(&ws->stage[STAGE_SINKS], cost.sink_ns - before.sink_ns);
+                    if (ws->trace) trace_read_pass(ws->trace, t_stage, &before, &cost);
+                    if (ctx->record) {
+                        ScanRecordEntry *e = &ctx->record->entries[file_index];
+                        e->path = path;
+                        e->size = result.size;
+                        e->bytes = cost.bytes - before.bytes;
+                        e->open_ns = cost.open_ns - before.open_ns;
+                        e->read_ns = cost.read_ns - before.read_ns;
+                        e->hash_ns = hash_ns;
+                        e->sink_ns = cost.sink_ns - before.sink_ns;
+                        e->status = hash_rc;
+                    }
+                }
             }
-            // 3. Check against database
-            for (size_t i = 0; i < ctx->db->count; ++i) {
-                if (hash_equals(hash, ctx->db->items[i].hash)) {       
-                    // Threat found! Update UI context (thread-safe)
-                    g_mutex_lock(&global_scan_ctx.mutex);
-                    global_scan_ctx.threats_found++;
-                    snprintf(global_scan_ctx.last_threat, 255, "%s", ctx->db->items[i].label);
-                    g_mutex_unlock(&global_scan_ctx.mutex);
-
-                    printf("\n[ALERT] THREAT FOUND: %s\n", path);
-                    // 4. Quarantine
-                    if (quarantine_file(path, ctx->db->items[i].label) == 0) {
-                        // File successfully handled/quarantined
-                        // Since we found a match, stop checking this file against the rest of the DB
-                        break; 
+            result.type = head.type;
+            if (hash_rc == SCANCORE_HANDLED) {
+                result.verdict = FILE_SKIPPED;
+                skipped++;
+            } else if (hash_rc != 0) {
+                // Failed to hash (e.g., file locked/permission), continue to next file
+                if (hash_rc == SCANCORE_TIMEOUT) {
+                    printf("[WARN] Gave up reading %s after %u s\n", path, walk_limits.read_timeout_ms / 1000);
+                }
+                result.verdict = FILE_UNREAD;
+            } else {
+                if (!unread_trust) hashed += result.size;
+                // 4. Check against database (one sorted index per algorithm). Only the
+                // lookup pins a generation, so an update can swap the index mid-scan.
+                t_stage = stage_ticks();
+                const char *content_match = content_scan_result(&cs);
+                if (!content_match && !content_scan_complete(&cs)) {
+                    printf("[WARN] %s: over %d content pattern hits waited at a chunk boundary; the rest were not checked\n",
+                           path, CONTENT_PENDING_LIMIT);
+                }
+                char match[128] = "";
+                const sig_db *db = sigstore_acquire(&reader);
+                const char *label = db ? sigdb_match(db, &digest, NULL) : NULL;
+                if (label) snprintf(match, sizeof(match), "%s", label);
+                sigstore_release(&reader);
+                // Known-good files skip every engine below; only an exact signature
+                // outranks the allowlist
+                gboolean trusted = !match[0] && (unread_trust || allowlist_match_digest(ctx->allow, &digest));
+                if (trusted) {
+                    content_match = NULL;
+                    if (unread_trust) {
+                        allow_stats.unread++;
+                        // Other types would only have had their first buffer read
+                        if (FTYPE_BIT(head.type) & ctx->types) allow_stats.unread_bytes += result.size;
+                    } else {
+                        allow_stats.hashed++;
+                        allow_stats.hashed_bytes += result.size;
                     }
                 }
+                stage_lap(ws, STAGE_LOOKUP, &t_stage);
+                archive_match am = { &reader, "", "" };
+                if (!match[0] && !content_match && !trusted && archive_is_zip(head.bytes, head.len)) {
+                    // 5. Look inside ZIP containers, member by member
+                    if (archive_scan_zip(path, &archive_limits, ctx->hash_algos, on_archive_member, &am, NULL) ==
+                        ARCHIVE_TIMEOUT)
+                        printf("[WARN] Gave up reading archive %s after %u s\n", path,
+                               walk_limits.read_timeout_ms / 1000);
+                }
+                // 6. Executables: imphash and section hashes
+                char fx_match[128] = "";
+                gboolean unmatched = !match[0] && !content_match && !am.match[0] && !trusted;
+                gboolean is_exec = (head.type == FTYPE_PE || head.type == FTYPE_ELF);
+                gboolean parsed = FALSE;
+                if (unmatched && ctx->features && is_exec) {
+                    parsed = parse_features(path, TRUE, features, &fx_stats);
+                    if (parsed) match_features(ctx->features, features, fx_match, sizeof(fx_match));
+                }
+                // 7. Near-copies of known samples: a patched or recompiled variant
+                char fuzzy_match[128] = "";
+                if (unmatched && !fx_match[0] && ctx->fuzzy && !(FTYPE_BIT(head.type) & FUZZY_SKIP_TYPES)) {
+                    FuzzyDigest fd;
+                    int distance = 0;
+                    if (fuzzy_final(&fz, &fd) == 0) {
+                        fuzzy_stats.files++;
+                        const char *similar = fuzzy_db_query(ctx->fuzzy, &fd, ctx->fuzzy_threshold, &distance,
+                                                             &fuzzy_stats.query);
+                        if (similar) {
+                            snprintf(fuzzy_match, sizeof(fuzzy_match), "%s (TLSH distance %d)", similar, distance);
+                            fuzzy_stats.matched++;
+                        }
+                    }
+                }
+                // 8. Heuristics for what no signature knows. Headers are parsed only
+                // when the byte-level score is already halfway to the threshold.
+                heur_result hr = { 0 };
+                if (unmatched && !fx_match[0] && !fuzzy_match[0] && ctx->heur_threshold > 0 && (FTYPE_BIT(head.type) & HEUR_TYPES)) {
+                    heur_scan_finish(&hs);
+                    heur_score(&hs, parsed ? features : NULL, &hr);
+                    if (!parsed && is_exec && hr.score * 2 >= ctx->heur_threshold && hr.score < ctx->heur_threshold &&
+                        parse_features(path, FALSE, features, &fx_stats)) {
+                        heur_score(&hs, features, &hr);
+                    }
+                    heur_stats.files++;
+                }
+                stage_lap(ws, STAGE_ENGINES, &t_stage);
+                result.verdict = FILE_THREAT;
+                if (match[0]) {
+                    snprintf(result.label, sizeof(result.label), "%s", match);
+                } else if (content_match) {
+                    snprintf(result.label, sizeof(result.label), "%s", content_match);
+                } else if (am.match[0]) {
+                    snprintf(result.label, sizeof(result.label), "%s", am.match);
+                    shown_path = am.member;
+                } else if (fx_match[0]) {
+                    snprintf(result.label, sizeof(result.label), "%s", fx_match);
+                } else if (fuzzy_match[0]) {
+                    snprintf(result.label, sizeof(result.label), "%s", fuzzy_match);
+                } else if (ctx->heur_threshold > 0 && hr.score >= ctx->heur_threshold) {
+                    char why[96];
+                    snprintf(result.label, sizeof(result.label), "Heuristic score %d: %s", hr.score,
+                             heur_describe(&hr, why, sizeof(why)));
+                    result.verdict = FILE_SUSPICIOUS;
+                    heur_stats.flagged++;
+                } else {
+                    result.verdict = FILE_CLEAN;
+                }
+                memcpy(result.sha256, digest.digest[HASH_SHA256], sizeof(result.sha256));
+                if (!unread_trust) {
+                    type_cost.files[head.type]++;
+                    type_cost.bytes[head.type] += result.size;
+                    type_cost.ns[head.type] += hash_clock_ns() - t0;
+                }
             }
+            content_scan_free(&cs);
+            apply_verdict(ctx, ws, path, shown_path, &result);
+            if (owned) {
+                // Publish the verdict, then settle the aliases that queued up meanwhile
+                g_mutex_lock(&ctx->files_lock);
+                GSList *aliases = owned->aliases;
+                result.id = owned->id;
+                result.path = owned->path;
+                *owned = result;
+                g_mutex_unlock(&ctx->files_lock);
+                for (GSList *a = aliases; a; a = a->next)
+                    apply_verdict(ctx, ws, (const char *)a->data, (const char *)a->data, &result);
+                g_slist_free_full(aliases, g_free);
+            }
+            guint64 t_done = stage_ticks();
+            stage_hist_add(&ws->stage[STAGE_FILE], stage_ticks_ns(t_done - t_file));
+            // Streamed paths are freed long before the trace is written
+            if (ws->trace) scan_trace_span(ws->trace, STAGE_FILE, t_file, t_done, ctx->queue ? NULL : path);
         }
     }
+    g_free(streamed);
+    mem_account(MEM_BUFFERS, -buffers);
+    sigstore_reader_unregister(&reader);
+    g_free(features);
+    g_mutex_lock(&global_scan_ctx.mutex);
+    scan_stats_merge(ctx->stats, ws);
+    hash_cost_add(&ctx->hash_cost, &cost);
+    ctx->fx_stats.pe += fx_stats.pe;
+    ctx->fx_stats.elf += fx_stats.elf;
+    ctx->fx_stats.malformed += fx_stats.malformed;
+    ctx->fx_stats.bytes += fx_stats.bytes;
+    ctx->fx_stats.ns += fx_stats.ns;
+    ctx->heur_stats.files += heur_stats.files;
+    ctx->heur_stats.flagged += heur_stats.flagged;
+    ctx->heur_stats.bytes += heur_stats.bytes;
+    ctx->heur_stats.ns += heur_stats.ns;
+    ctx->fuzzy_stats.files += fuzzy_stats.files;
+    ctx->fuzzy_stats.matched += fuzzy_stats.matched;
+    ctx->fuzzy_stats.bytes += fuzzy_stats.bytes;
+    ctx->fuzzy_stats.ns += fuzzy_stats.ns;
+    ctx->fuzzy_stats.query.queries += fuzzy_stats.query.queries;
+    ctx->fuzzy_stats.query.candidates += fuzzy_stats.query.candidates;
+    ctx->fuzzy_stats.query.ns += fuzzy_stats.query.ns;
+    ctx->allow_stats.unread += allow_stats.unread;
+    ctx->allow_stats.unread_bytes += allow_stats.unread_bytes;
+    ctx->allow_stats.hashed += allow_stats.hashed;
+    ctx->allow_stats.hashed_bytes += allow_stats.hashed_bytes;
+    file_type_cost_add(&ctx->type_cost, &type_cost);
+    ctx->bytes_hashed += hashed;
+    ctx->type_skipped += skipped;
+    g_mutex_unlock(&global_scan_ctx.mutex);
+    g_free(ws);
     return NULL;
 }
 
-int signature_scan(const char *sigdb_path, const char *path_to_scan) {
-    sig_db db;
+// Incremental mode is only offered for a single root (one marker file per root)
+// `types`: FTYPE_BIT mask of files read to the end; anything else stops after its first buffer
+static int scan_roots(const char *sigdb_path, GList *roots, int incremental, unsigned types) {
     scan_ctx ctx;
     int scan_result = -1;
+    ctx.content = NULL;
+    ctx.seen = NULL;
+    ctx.dirs = NULL;
+    ctx.files = NULL;
+    ctx.features = NULL;
+    ctx.fuzzy = NULL;
+    ctx.allow = NULL;
+    ctx.stats = NULL;
+    ctx.trace = NULL;
+    ctx.record = NULL;
+    ctx.queue = NULL;
+    ctx.overlapping_roots = roots && roots->next;
+    ctx.untracked = ctx.spilling = ctx.seen_spills = ctx.reader_failures = 0;
+    ScanStats *walk_stats = NULL;   // Streamed walk: its directory times, merged after it
+    mem_budget_begin((guint64)MAX(memory_limit_mb, 0) * 1024 * 1024);
+    g_mutex_lock(&global_scan_ctx.mutex);
+    int threats_at_start = global_scan_ctx.threats_found;
+    g_mutex_unlock(&global_scan_ctx.mutex);
 
-    if (sigdb_load(&db, sigdb_path) != 0) {
+    sig_load_report report;
+    // Loaded once per process; update_signature_db publishes newer generations
+    if (sigstore_ensure(sigdb_path, &report) != 0) {
         MessageBoxA(NULL, "Failed to load signature database.", "Scan Error", MB_OK | MB_ICONERROR);
         goto cleanup_db;
     }
+    if (report.malformed > 0) {
+        printf("[WARN] %zu of %zu signature line(s) malformed and skipped\n", report.malformed, report.lines);
+    }
+    // Content signatures are optional; a missing file just disables the engine
+    int bad_lines = 0;
+    ctx.content = content_db_load(CONTENT_DB, &bad_lines);
+    if (ctx.content && bad_lines > 0) {
+        printf("[WARN] %d malformed content signature(s) skipped\n", bad_lines);
+    }
+    ctx.features = fx_db_load(FEATURE_DB, &bad_lines);
+    if (ctx.features && bad_lines > 0) {
+        printf("[WARN] %d malformed feature signature(s) skipped\n", bad_lines);
+    }
+    if (ctx.features && fx_db_count(ctx.features) == 0) {
+        fx_db_free(ctx.features);
+        ctx.features = NULL;
+    }
+    if (fuzzy_threshold > 0) {
+        ctx.fuzzy = fuzzy_db_load(FUZZY_DB, &bad_lines);
+        if (ctx.fuzzy && bad_lines > 0) {
+            printf("[WARN] %d malformed fuzzy signature(s) skipped\n", bad_lines);
+        }
+        if (ctx.fuzzy && fuzzy_db_count(ctx.fuzzy) == 0) {
+            fuzzy_db_free(ctx.fuzzy);
+            ctx.fuzzy = NULL;
+        }
+    }
+    // Known-good lists; files recorded by earlier scans with a trusted digest need no read
+    allow_report ar;
+    // The stored index is only held while the trusted files are picked out of it
+    seen_index *recorded = seen_index_load(SEEN_DB);
+    mem_set(MEM_SEEN, seen_index_bytes(recorded));
+    ctx.allow = allowlist_load(ALLOWLIST_DB, ALLOWLIST_BASELINE, recorded, &ar);
+    mem_set(MEM_ALLOWLIST, allowlist_bytes(ctx.allow));
+    seen_index_free(recorded);
+    mem_set(MEM_SEEN, 0);
+    mem_set(MEM_ENGINES, content_db_bytes(ctx.content) + fx_db_bytes(ctx.features) + fuzzy_db_bytes(ctx.fuzzy));
+    if (ar.malformed > 0) {
+        printf("[WARN] %zu malformed allowlist line(s) skipped\n", ar.malformed);
+    }
+    if (ctx.allow) {
+        printf("[SCAN] Allowlist: %zu trusted digest(s), %zu recorded file(s) trusted while unchanged\n",
+               ar.digests, ar.files);
+    }
+    // Exclusion rules are optional too; compiled once, evaluated by the walkers
+    walk_limits.rules = scan_rules_load(RULES_FILE);
+    // Stage latencies: the walkers time each directory, the workers each file
+    scan_stats_calibrate();
+    ctx.stats = g_new0(ScanStats, 1);
+    walk_limits.dir_times = &ctx.stats->stage[STAGE_WALK_DIR];
+    // Tracing: the walk of each root on this thread, every file stage on the workers
+    ScanTrace *walk_trace = NULL;
+    if (scan_trace) {
+        ctx.trace = scan_trace_session_new();
+        walk_trace = scan_trace_thread(ctx.trace, "walker");
+    }
+    guint64 t_walk = stage_ticks();
     // --- Phase 1: Path Collection (Single-Threaded) ---
-    FilePathList *file_list = list_files_recursive(path_to_scan);
-    if (file_list == NULL || file_list->total_files == 0) {
+    // Incremental: only directories whose markers moved since the last scan are listed.
+    // Under a memory limit a full walk is streamed to the workers instead (phase 2).
+    FilePathList *file_list = NULL;
+    gboolean single_incremental = incremental && roots && !roots->next;
+    gboolean streaming = memory_limit_mb > 0 && !single_incremental;
+    PathQueue queue;
+    if (streaming) {
+        path_queue_init(&queue);
+        ctx.queue = &queue;
+        walk_stats = g_new0(ScanStats, 1);
+        walk_limits.dir_times = &walk_stats->stage[STAGE_WALK_DIR];
+    } else if (single_incremental) {
+        const char *path_to_scan = (const char *)roots->data;
+        IncrementalStats inc;
+        file_list = list_files_incremental(path_to_scan, &ctx.dirs, &inc);
+        if (walk_trace) scan_trace_span(walk_trace, STAGE_WALK_DIR, t_walk, stage_ticks(), path_to_scan);
+        if (inc.full_walk) {
+            printf("[SCAN] Full walk of %s: %s\n", path_to_scan, inc.reason);
+        } else {
+            printf("[SCAN] Incremental: %u of %u directories listed, %u unchanged, %d file(s) to scan\n",
+                   inc.dirs_listed, inc.dirs_visited, inc.dirs_skipped, file_list ? file_list->total_files : 0);
+        }
+    } else {
+        // All roots feed one worker pool, so files reachable from several are read once
+        for (GList *r = roots; r; r = r->next) {
+            FilePathList *part = list_files_recursive((const char *)r->data);
+            if (walk_trace) {
+                guint64 now = stage_ticks();
+                scan_trace_span(walk_trace, STAGE_WALK_DIR, t_walk, now, (const char *)r->data);
+                t_walk = now;
+            }
+            if (!part) continue;
+            if (!file_list) {
+                file_list = part;
+                continue;
+            }
+            file_list->paths = g_list_concat(file_list->paths, part->paths);
+            file_list->total_files += part->total_files;
+            part->paths = NULL;
+            free_filepath_list(part);
+        }
+    }
+    if (!streaming) {
+        walk_limits.dir_times = NULL;
+        if (walk_limits.rules) scan_rules_print_stats(stdout, walk_limits.rules);
+    }
+    if (!streaming && (file_list == NULL || file_list->total_files == 0)) {
         // If no files were found (or error during listing)
         scan_result = 0;
         if (file_list) free_filepath_list(file_list);
+        g_mutex_lock(&global_scan_ctx.mutex);
+        if (global_scan_ctx.stop_requested) scan_result = -2;
+        g_mutex_unlock(&global_scan_ctx.mutex);
+        if (ctx.dirs && scan_result == 0) dir_state_commit(ctx.dirs);
         goto cleanup_db;
     }
+    if (file_list) {
+        guint64 list_bytes = sizeof(FilePathList);
+        for (GList *l = file_list->paths; l; l = l->next) list_bytes += path_bytes((const char *)l->data);
+        mem_set(MEM_PATHS, list_bytes);
+    }
     // Initialize context for worker threads
-    ctx.db = &db;
     ctx.file_list = file_list;
     ctx.current_index = 0; 
+    // SHA-256 always (archive members, logs); MD5/SHA-1/SHA-512 only if the feed has them
+    // (sampled at start; a generation published mid-scan that adds an algorithm
+    // takes effect from the next scan)
+    SigReader reader;
+    if (sigstore_reader_register(&reader) != 0) {
+        // The workers will not get one either
+        MessageBoxA(NULL, "No free signature reader slot: too many scans or scanner threads are running.", "Scan Error", MB_OK | MB_ICONERROR);
+        scan_result = -1;
+        free_filepath_list(file_list);
+        goto cleanup_db;
+    }
+    const sig_db *db = sigstore_acquire(&reader);
+    ctx.hash_algos = (db ? sigdb_algos(db) : 0) | allowlist_algos(ctx.allow) | HASH_BIT(HASH_SHA256);
+    if (db) mem_set(MEM_SIGDB, sigdb_bytes(db));
+    sigstore_release(&reader);
+    sigstore_reader_unregister(&reader);
+    if (scan_record && streaming) {
+        printf("[SCAN] Memory limit: paths are streamed, so this scan is not recorded\n");
+    } else if (scan_record) {
+        ctx.record = g_new(ScanRecord, 1);
+        scan_record_init(ctx.record, (gsize)file_list->total_files, ctx.hash_algos);
+        mem_set(MEM_RECORD, (guint64)file_list->total_files * sizeof(ScanRecordEntry));
+    }
+    memset(&ctx.hash_cost, 0, sizeof(ctx.hash_cost));
+    ctx.alias_count = ctx.alias_bytes = ctx.bytes_hashed = 0;
+    ctx.types = types;
+    ctx.type_skipped = 0;
+    memset(&ctx.type_cost, 0, sizeof(ctx.type_cost));
+    memset(&ctx.fx_stats, 0, sizeof(ctx.fx_stats));
+    memset(&ctx.heur_stats, 0, sizeof(ctx.heur_stats));
+    ctx.heur_threshold = heuristic_threshold;
+    if (ctx.heur_threshold > 0) heuristic_init();
+    memset(&ctx.fuzzy_stats, 0, sizeof(ctx.fuzzy_stats));
+    memset(&ctx.allow_stats, 0, sizeof(ctx.allow_stats));
+    ctx.fuzzy_threshold = fuzzy_threshold;
+    fuzzy_init();
+    ctx.files = g_hash_table_new_full(file_identity_hash, file_identity_equal, NULL, file_seen_free);
+    g_mutex_init(&ctx.files_lock);
+    ctx.seen = seen_index_new();
+    if (!ctx.seen) {
+        MessageBoxA(NULL, "Failed to allocate scan memory.", "Scan Error", MB_OK | MB_ICONERROR);
+        free_filepath_list(file_list);
+        goto cleanup_db;
+    }
     // --- Phase 2: Launch Worker Threads (Multi-Threaded Scan) ---
     // Determine the number of threads to use (Use CPU count for max speed)
     // In signature_scan function
     guint num_processors = g_get_num_processors();
     // Use half the available cores, but at least 1
     guint num_threads = MAX(1, num_processors / 2);
+    // Leave reader slots for the real-time scanner and the updater
+    num_threads = MIN(num_threads, SIGSTORE_MAX_READERS / 2);
     GThread **threads = g_malloc(sizeof(GThread *) * num_threads); 
     if (!threads) {
         // If allocation fails, handle it gracefully before proceeding to thread launch
@@ -287,47 +1097,204 @@ int signature_scan(const char *sigdb_path, const char *path_to_scan) {
         goto cleanup_db;
     }
 
+    guint64 scan_t0 = hash_clock_ns();
     for (guint i = 0; i < num_threads; ++i) {
         threads[i] = g_thread_new(NULL, worker_thread_scan, &ctx);
     }
+    if (streaming) {
+        // Phase 1 on this thread while the workers drain the queue
+        WalkSink sink = { path_queue_push, &queue };
+        for (GList *r = roots; r; r = r->next) {
+            walk_files((const char *)r->data, &sink);
+            if (walk_trace) {
+                guint64 now = stage_ticks();
+                scan_trace_span(walk_trace, STAGE_WALK_DIR, t_walk, now, (const char *)r->data);
+                t_walk = now;
+            }
+        }
+        path_queue_close(&queue);
+        walk_limits.dir_times = NULL;
+        if (walk_limits.rules) scan_rules_print_stats(stdout, walk_limits.rules);
+    }
     // Wait for all threads to complete
     for (guint i = 0; i < num_threads; ++i) {
         g_thread_join(threads[i]);
     }
     // IMPORTANT: Free the dynamically allocated array
     g_free(threads); 
+    guint64 workers_ns = hash_clock_ns() - scan_t0;
     // Check if the scan completed or was stopped
     g_mutex_lock(&global_scan_ctx.mutex);
     // ... (rest of the code is unchanged)
-    if (global_scan_ctx.stop_requested) {
+    if (g_atomic_int_get(&ctx.reader_failures) > 0) {
+        scan_result = -1; // Workers missing: files were left unchecked
+    } else if (global_scan_ctx.stop_requested) {
         scan_result = -2; // Scan stopped by user
     } else {
         scan_result = 0; // Scan completed
     }
+    if (walk_stats) scan_stats_merge(ctx.stats, walk_stats);
+    g_mutex_unlock(&global_scan_ctx.mutex);
+    hash_cost_print(stdout, &ctx.hash_cost);
+    file_type_cost_print(stdout, &ctx.type_cost);
+    scan_stats_print(stdout, ctx.stats, workers_ns, num_threads);
+    mem_set(MEM_SEEN, seen_index_bytes(ctx.seen));
+    mem_sample_rss();
+    mem_budget_print(stdout);
+    if (streaming) {
+        printf("[SCAN] Memory limit: paths streamed to the workers, at most %u queued; the walker waited %.2f s for room for %llu (%llu while memory was tight)\n",
+               queue.peak, (double)queue.wait_us / 1e6, (unsigned long long)queue.held_back,
+               (unsigned long long)queue.held_back_tight);
+    }
+    if (ctx.untracked > 0) {
+        printf("[SCAN] Memory limit: %d single-link file(s) kept out of the hardlink table\n", ctx.untracked);
+    }
+    if (ctx.seen_spills > 0) {
+        printf("[SCAN] Memory limit: clean files spilled to disk %d time(s), merged into %s at the end\n",
+               ctx.seen_spills, SEEN_DB);
+    }
+    if (scan_stats_json && scan_stats_write_json(SCAN_STATS_JSON, ctx.stats, workers_ns, num_threads) != 0) {
+        printf("[WARN] Could not write %s\n", SCAN_STATS_JSON);
+    }
+    if (scan_stats_out) {
+        memcpy(scan_stats_out, ctx.stats, sizeof(*scan_stats_out));
+        scan_stats_out->trace = NULL;
+        scan_stats_out_ns = workers_ns;
+    }
+    if (ctx.trace) {
+        // File spans point into file_list: written before it is freed
+        guint64 spans, dropped;
+        if (scan_trace_write(ctx.trace, SCAN_TRACE_JSON, &spans, &dropped) == 0) {
+            printf("[SCAN] Trace: %llu span(s) written to %s", (unsigned long long)spans, SCAN_TRACE_JSON);
+            if (dropped > 0) printf(", %llu dropped past %u per thread", (unsigned long long)dropped, TRACE_MAX_SPANS);
+            printf("\n");
+        } else {
+            printf("[WARN] Could not write %s\n", SCAN_TRACE_JSON);
+        }
+    }
+    if (ctx.record) {
+        // Entries point into file_list too
+        if (scan_record_write(ctx.record, SCAN_RECORD_FILE) == 0) {
+            printf("[SCAN] Record: reads of this scan written to %s for fos-bench replay\n", SCAN_RECORD_FILE);
+        } else {
+            printf("[WARN] Could not write %s\n", SCAN_RECORD_FILE);
+        }
+    }
+    if (ctx.type_skipped > 0) {
+        printf("[SCAN] %llu file(s) of other types skipped after their first buffer\n",
+               (unsigned long long)ctx.type_skipped);
+    }
+    if (ctx.fx_stats.pe + ctx.fx_stats.elf > 0) {
+        printf("[SCAN] Structure: %llu PE, %llu ELF parsed (%llu malformed), %.1f MB/s\n",
+               (unsigned long long)ctx.fx_stats.pe, (unsigned long long)ctx.fx_stats.elf,
+               (unsigned long long)ctx.fx_stats.malformed,
+               ctx.fx_stats.ns ? (double)ctx.fx_stats.bytes / (1024.0 * 1024.0) / ((double)ctx.fx_stats.ns / 1e9) : 0.0);
+    }
+    if (ctx.heur_stats.files > 0) {
+        // Against SHA-256 per byte hashed: the price of heuristics on this scan's mix of files
+        double sha_ns = ctx.hash_cost.bytes ? (double)ctx.hash_cost.ns[HASH_SHA256] / (double)ctx.hash_cost.bytes : 0.0;
+        double heur_ns = ctx.hash_cost.bytes ? (double)ctx.heur_stats.ns / (double)ctx.hash_cost.bytes : 0.0;
+        printf("[SCAN] Heuristics: %llu file(s) scored, %llu flagged, %.1f MB examined, %.3f ns per byte scanned (%.1f%% of SHA-256)\n",
+               (unsigned long long)ctx.heur_stats.files, (unsigned long long)ctx.heur_stats.flagged,
+               (double)ctx.heur_stats.bytes / (1024.0 * 1024.0), heur_ns, sha_ns > 0 ? 100.0 * heur_ns / sha_ns : 0.0);
+    }
+    if (ctx.fuzzy_stats.query.queries > 0) {
+        double sha_ns = ctx.hash_cost.bytes ? (double)ctx.hash_cost.ns[HASH_SHA256] / (double)ctx.hash_cost.bytes : 0.0;
+        double fuzzy_ns = ctx.hash_cost.bytes ? (double)ctx.fuzzy_stats.ns / (double)ctx.hash_cost.bytes : 0.0;
+        printf("[SCAN] Fuzzy: %llu digest(s) looked up in %zu reference(s), %llu similar, %.1f us and %.0f candidates per query, digest %.1f%% of SHA-256\n",
+               (unsigned long long)ctx.fuzzy_stats.query.queries, fuzzy_db_count(ctx.fuzzy),
+               (unsigned long long)ctx.fuzzy_stats.matched,
+               (double)ctx.fuzzy_stats.query.ns / 1e3 / (double)ctx.fuzzy_stats.query.queries,
+               (double)ctx.fuzzy_stats.query.candidates / (double)ctx.fuzzy_stats.query.queries,
+               sha_ns > 0 ? 100.0 * fuzzy_ns / sha_ns : 0.0);
+    }
+    if (ctx.allow) {
+        // Skipped reads priced at this scan's own read rate, when it read anything
+        guint64 read_ns = 0, read_bytes = 0;
+        for (int t = 0; t < FTYPE_COUNT; ++t) {
+            read_ns += ctx.type_cost.ns[t];
+            read_bytes += ctx.type_cost.bytes[t];
+        }
+        printf("[SCAN] Allowlist: %llu trusted file(s) not read (%.1f MB), %llu trusted after hashing (%.1f MB); scan took %.2f s",
+               (unsigned long long)ctx.allow_stats.unread, (double)ctx.allow_stats.unread_bytes / (1024.0 * 1024.0),
+               (unsigned long long)ctx.allow_stats.hashed, (double)ctx.allow_stats.hashed_bytes / (1024.0 * 1024.0),
+               (double)(hash_clock_ns() - scan_t0) / 1e9);
+        if (read_bytes > 0 && ctx.allow_stats.unread_bytes > 0) {
+            double saved_ns = (double)ctx.allow_stats.unread_bytes * (double)read_ns / (double)read_bytes;
+            printf(", ~%.1f s of reading avoided", saved_ns / 1e9 / num_threads);
+        }
+        printf("\n");
+    }
+    if (ctx.alias_count > 0) {
+        printf("[SCAN] %llu path(s) were links to files already scanned: %.1f MB read, %.1f MB not re-read\n",
+               (unsigned long long)ctx.alias_count, (double)ctx.bytes_hashed / (1024.0 * 1024.0),
+               (double)ctx.alias_bytes / (1024.0 * 1024.0));
+    }
+    // Remember what was clean; the next update checks its new signatures against it.
+    // A stopped scan still records the files it finished.
+    if (seen_index_commit(ctx.seen, SEEN_DB) != 0) {
+        printf("[WARN] Could not update %s\n", SEEN_DB);
+    }
+    // Golden image: a complete, clean scan becomes the baseline other machines trust
+    g_mutex_lock(&global_scan_ctx.mutex);
+    gboolean clean_scan = global_scan_ctx.threats_found == threats_at_start;
     g_mutex_unlock(&global_scan_ctx.mutex);
+    if (golden_image && scan_result == 0 && clean_scan && ctx.seen_spills > 0) {
+        printf("[WARN] Golden image not written: part of this scan's clean files were spilled to disk\n");
+    } else if (golden_image && scan_result == 0 && clean_scan) {
+        if (allowlist_write_baseline(ctx.seen, ALLOWLIST_BASELINE) == 0) {
+            printf("[SCAN] Golden image: %zu file(s) written to %s\n", seen_index_count(ctx.seen), ALLOWLIST_BASELINE);
+        } else {
+            printf("[WARN] Could not write %s\n", ALLOWLIST_BASELINE);
+        }
+    }
+    // Markers only count once every file under them was scanned
+    if (ctx.dirs && scan_result == 0 && dir_state_commit(ctx.dirs) != 0) {
+        printf("[WARN] Could not save directory markers; the next scan walks everything\n");
+    }
     // --- Cleanup ---
     free_filepath_list(file_list);
 
     cleanup_db:
-        sigdb_free(&db);
+        content_db_free(ctx.content);
+        fx_db_free(ctx.features);
+        fuzzy_db_free(ctx.fuzzy);
+        allowlist_free(ctx.allow);
+        g_free(ctx.stats);
+        walk_limits.dir_times = NULL;
+        g_free(walk_stats);
+        if (ctx.queue) path_queue_clear(ctx.queue);
+        scan_trace_session_free(ctx.trace);
+        if (ctx.record) {
+            scan_record_free(ctx.record);
+            g_free(ctx.record);
+        }
+        seen_index_free(ctx.seen);
+        dir_state_free(ctx.dirs);
+        scan_rules_free(walk_limits.rules);
+        walk_limits.rules = NULL;
+        if (ctx.files) {
+            g_hash_table_destroy(ctx.files);
+            g_mutex_clear(&ctx.files_lock);
+        }
         g_mutex_lock(&global_scan_ctx.mutex);
         global_scan_ctx.is_running = false;
         g_mutex_unlock(&global_scan_ctx.mutex);
 
         return scan_result;
 }
-// Helper: Quick structure check
-static int is_db_valid(const char *temp_path) {
-    FILE *f = fopen(temp_path, "r");
-    if (!f) return 0;
-    char line[128];
-    int valid_hashes = 0;
-    while (fgets(line, sizeof(line), f) && valid_hashes < 10) {
-        if (line[0] == '#' || line[0] == '\r' || line[0] == '\n') continue;
-        if (strlen(line) >= 64) valid_hashes++; 
-    }
-    fclose(f);
-    return (valid_hashes > 0);
+
+int signature_scan(const char *sigdb_path, const char *path_to_scan) {
+    return signature_scan_ex(sigdb_path, path_to_scan, FALSE);
+}
+
+int signature_scan_ex(const char *sigdb_path, const char *path_to_scan, int incremental) {
+    GList root = { (gpointer)path_to_scan, NULL, NULL };
+    return scan_roots(sigdb_path, &root, incremental, FTYPE_ALL);
+}
+
+int signature_scan_paths(const char *sigdb_path, GList *paths) {
+    return scan_roots(sigdb_path, paths, FALSE, QUICK_SCAN_TYPES);
 }
 // --- COM Interface for Download Progress (C Style) ---
 typedef struct {
@@ -363,123 +1330,292 @@ static IBindStatusCallbackVtbl progress_vtbl = {
     QueryInterface, AddRef, Release, OnStartBinding, GetPriority, OnLowResource, 
     OnProgress, OnStopBinding, GetBindInfo, OnDataAvailable, OnObjectAvailable
 };
+// --- Delta Updates ---
+// FOS_FULL_URL / FOS_DELTA_URL point the updater at a mirror or a local test server
+static const char *update_url(const char *env_name, const char *fallback) {
+    const char *url = getenv(env_name);
+    return (url && *url) ? url : fallback;
+}
+// "<db>.ver" holds the Unix time of the snapshot the local DB matches; 0 = unknown
+static guint64 read_db_version(const char *db_path) {
+    char ver_path[MAX_PATH];
+    snprintf(ver_path, MAX_PATH, "%s.ver", db_path);
+    FILE *f = fopen(ver_path, "r");
+    if (!f) return 0;
+    unsigned long long version = 0;
+    if (fscanf(f, "%llu", &version) != 1) version = 0;
+    fclose(f);
+    return (guint64)version;
+}
+
+// Swaps a finished temp DB in. The previous one is kept as "<db>.old" and put
+// back if the swap fails; the delta and the full update both go through here.
+static int install_db(const char *temp_db_path, const char *db_path) {
+    char backup_path[MAX_PATH];
+    snprintf(backup_path, MAX_PATH, "%s.old", db_path);
+    gboolean backed_up = FALSE;
+    if (GetFileAttributesA(db_path) != INVALID_FILE_ATTRIBUTES) {
+        backed_up = CopyFileA(db_path, backup_path, FALSE);
+        if (!backed_up) printf("[WARN] Could not back up %s to %s\n", db_path, backup_path);
+    }
+    if (replace_file_atomic(temp_db_path, db_path) == 0) return 0;
+    if (backed_up) CopyFileA(backup_path, db_path, FALSE); // Restore
+    return -1;
+}
+
+static void write_db_version(const char *db_path, guint64 version) {
+    char ver_path[MAX_PATH];
+    snprintf(ver_path, MAX_PATH, "%s.ver", db_path);
+    FILE *f = fopen(ver_path, "w");
+    if (!f) return;
+    fprintf(f, "%llu\n", (unsigned long long)version);
+    fclose(f);
+}
+
+static guint64 downloaded_bytes(const char *path) {
+    WIN32_FILE_ATTRIBUTE_DATA fa;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &fa)) return 0;
+    return ((guint64)fa.nFileSizeHigh << 32) | fa.nFileSizeLow;
+}
+
+// --- Retro-hunt ---
+// Files that were clean when scanned but match a signature the update added.
+// Collected while the old index is pinned, acted on once the new one is live.
+typedef struct {
+    GPtrArray *paths;
+    GPtrArray *labels;
+    GArray *types;              // FileType recorded when the file was hashed
+    size_t known;               // Files in SEEN_DB
+    ULONGLONG ms;
+} RetroHunt;
+
+static void on_retro_hit(void *user, const char *path, const char *label, guint32 file_type) {
+    RetroHunt *rh = (RetroHunt *)user;
+    g_ptr_array_add(rh->paths, g_strdup(path));
+    g_ptr_array_add(rh->labels, g_strdup(label && label[0] ? label : "Unknown"));
+    g_array_append_val(rh->types, file_type);
+}
+
+// Intersects only the digests `after` adds over `before` (NULL = all of them) with
+// the recorded hashes; no file is read, hits are confirmed by size, mtime and the
+// file's stamp (identity and change time), so a rewrite with its mtime put back is no hit
+static void retro_hunt_collect(RetroHunt *rh, const sig_db *before, const sig_db *after) {
+    ULONGLONG t0 = GetTickCount64();
+    rh->paths = g_ptr_array_new_with_free_func(g_free);
+    rh->labels = g_ptr_array_new_with_free_func(g_free);
+    rh->types = g_array_new(FALSE, FALSE, sizeof(guint32));
+    seen_index *seen = seen_index_load(SEEN_DB);
+    rh->known = seen ? seen_index_count(seen) : 0;
+    if (seen) seen_index_retro_hunt(seen, before, after, on_retro_hit, rh);
+    seen_index_free(seen);
+    rh->ms = GetTickCount64() - t0;
+}
+
+static void retro_hunt_free(RetroHunt *rh) {
+    g_ptr_array_free(rh->paths, TRUE);
+    g_ptr_array_free(rh->labels, TRUE);
+    g_array_free(rh->types, TRUE);
+}
+
+static void retro_hunt_report(RetroHunt *rh) {
+    printf("[UPDATE] Retro-hunt: %zu known file(s), %u hit(s) in %llu ms\n",
+           rh->known, rh->paths->len, (unsigned long long)rh->ms);
+    for (guint i = 0; i < rh->paths->len; ++i) {
+        const char *path = g_ptr_array_index(rh->paths, i);
+        const char *label = g_ptr_array_index(rh->labels, i);
+        FileType type = (FileType)g_array_index(rh->types, guint32, i);
+        printf("[ALERT] RETRO-HUNT: %s (%s) [%s]\n", path, label, file_type_name(type));
+        if (retro_hunt_quarantine) quarantine_file(path, label);
+    }
+    retro_hunt_free(rh);
+}
+
+// Fetches only what changed since the local version and merges it into the live index.
+// Returns 0 when applied, 1 when the gap needs a full download, <0 on errors (the
+// caller falls back to the full download as well).
+static int update_from_delta(const char *db_path, IBindStatusCallback *progress) {
+    guint64 local_version = read_db_version(db_path);
+    guint64 now = (guint64)time(NULL);
+    if (local_version == 0 || now - local_version > DELTA_MAX_AGE) return 1;
+
+    ULONGLONG t_start = GetTickCount64();
+    DeleteFileA(DELTA_FILE);
+    if (URLDownloadToFileA(NULL, update_url("FOS_DELTA_URL", DELTA_URL), DELTA_FILE, 0, progress) != S_OK) return -1;
+    guint64 bytes = downloaded_bytes(DELTA_FILE);
+    ULONGLONG t_downloaded = GetTickCount64();
+
+    // Merge into the index scans are using right now (read from disk if none is loaded)
+    SigReader reader;
+    if (sigstore_ensure(db_path, NULL) != 0 || sigstore_reader_register(&reader) != 0) {
+        DeleteFileA(DELTA_FILE);
+        return -1;
+    }
+    sig_db fresh;
+    sig_delta_report report;
+    RetroHunt hunt;
+    const sig_db *base = sigstore_acquire(&reader);
+    int rc = base ? sigdb_apply_delta(base, local_version, DELTA_FILE, &fresh, &report) : -1;
+    if (rc == 0 && report.malformed == 0) retro_hunt_collect(&hunt, base, &fresh);
+    sigstore_release(&reader);
+    sigstore_reader_unregister(&reader);
+    DeleteFileA(DELTA_FILE);
+    if (rc == SIG_DELTA_GAP) return 1;
+    if (rc != 0) return -1;
+    if (report.malformed > 0) {
+        printf("[WARN] Delta rejected: %zu malformed line(s)\n", report.malformed);
+        sigdb_free(&fresh);
+        return -1;
+    }
+    ULONGLONG t_applied = GetTickCount64() - hunt.ms; // The hunt reports its own time
+
+    // Keep the on-disk feed in step so a restart loads the same index
+    char temp_db_path[MAX_PATH];
+    snprintf(temp_db_path, MAX_PATH, "%s.tmp", db_path);
+    if (sigdb_save(&fresh, temp_db_path) != 0 || install_db(temp_db_path, db_path) != 0) {
+        DeleteFileA(temp_db_path);
+        sigdb_free(&fresh);
+        retro_hunt_free(&hunt);
+        return -1;
+    }
+    ULONGLONG t_saved = GetTickCount64();
+    size_t total = sigdb_count(&fresh);
+    sigstore_publish(&fresh);
+    write_db_version(db_path, report.to_version ? report.to_version : now);
+
+    printf("[UPDATE] Delta: +%zu -%zu ~%zu (%zu signatures), %.1f KB in %llu ms, applied in %llu ms, saved in %llu ms\n",
+           report.added, report.removed, report.relabeled, total, (double)bytes / 1024.0,
+           (unsigned long long)(t_downloaded - t_start), (unsigned long long)(t_applied - t_downloaded),
+           (unsigned long long)(t_saved - t_applied));
+    retro_hunt_report(&hunt);
+    return 0;
+}
+// --- Streaming Download ---
+// Pushes the feed into fs as it arrives. A local path is read directly (tests,
+// offline mirrors). Returns the transfer status; a corrupt archive is reported
+// by feed_stream_finish instead.
+static HRESULT stream_feed(const char *url, IBindStatusCallback *progress, feed_stream *fs) {
+    unsigned char buf[UPDATE_CHUNK];
+    if (GetFileAttributesA(url) != INVALID_FILE_ATTRIBUTES) {
+        FILE *f = fopen(url, "rb");
+        if (!f) return E_FAIL;
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            if (feed_stream_write(fs, buf, n) != 0) break;
+        HRESULT hr = ferror(f) ? E_FAIL : S_OK;
+        fclose(f);
+        return hr;
+    }
+    IStream *stream = NULL;
+    HRESULT hr = URLOpenBlockingStreamA(NULL, url, &stream, 0, progress);
+    if (FAILED(hr)) return hr;
+    for (;;) {
+        ULONG got = 0;
+        hr = stream->lpVtbl->Read(stream, buf, sizeof(buf), &got);
+        if (FAILED(hr)) break;
+        if (got > 0 && feed_stream_write(fs, buf, got) != 0) break;
+        if (hr == S_FALSE || got == 0) break;   // End of stream
+    }
+    stream->lpVtbl->Release(stream);
+    return FAILED(hr) ? hr : S_OK;
+}
 // --- FINAL FULL DATABASE UPDATE LOGIC ---
 int update_signature_db(const char *db_path) {
     HRESULT coResult = CoInitialize(NULL);
     // 1. URL for the FULL database (ZIP format)
-    const char *url = "https://bazaar.abuse.ch/export/txt/sha256/full/";
-    
-    char zip_path[MAX_PATH];
-    char extracted_name[] = "full_sha256.txt"; // The specific file inside their ZIP
+    const char *url = update_url("FOS_FULL_URL", FULL_URL);
+    guint64 started_at = (guint64)time(NULL);
+    ULONGLONG t_start = GetTickCount64();
+
     char temp_db_path[MAX_PATH];
-    char backup_path[MAX_PATH];
-    char cmd_buf[512];
     char debug_msg[256];
-    // Prepare paths: signatures.zip, signatures.db.tmp, signatures.db.old
-    snprintf(zip_path, MAX_PATH, "signatures.zip"); 
+    // Prepare paths: signatures.db.tmp (install_db keeps signatures.db.old)
     snprintf(temp_db_path, MAX_PATH, "%s.tmp", db_path);
-    snprintf(backup_path, MAX_PATH, "%s.old", db_path);
     // Setup Progress Monitor
     DownloadProgress progress_monitor;
     progress_monitor.lpVtbl = &progress_vtbl;
     progress_monitor.ref_count = 1;
     update_progress = 0;
-    // 2. Download the ZIP file
-    HRESULT hr = URLDownloadToFileA(NULL, url, zip_path, 0, (IBindStatusCallback*)&progress_monitor);
+    // Only a few hundred hashes change per day: try the delta before the full export
+    if (update_from_delta(db_path, (IBindStatusCallback*)&progress_monitor) == 0) {
+        update_progress = 101;
+        CoUninitialize();
+        return 0;
+    }
+    update_progress = 0;
+    // 2. Stream the ZIP: inflate, parse and index in memory while it downloads.
+    // The expanded text is written once, to the temp DB; no zip file, no unzip process.
+    DeleteFileA(temp_db_path);
+    FILE *copy = fopen(temp_db_path, "wb");
+    feed_stream *fs = copy ? feed_stream_new(copy) : NULL;
+    if (!fs) {
+        if (copy) fclose(copy);
+        MessageBoxA(NULL, "Could not create the temporary database file.", "Update Error", MB_OK | MB_ICONERROR);
+        update_progress = -1;
+        CoUninitialize();
+        return -6;
+    }
+    HRESULT hr = stream_feed(url, (IBindStatusCallback*)&progress_monitor, fs);
     progress_monitor.lpVtbl->Release((IBindStatusCallback*)&progress_monitor);
+    int copy_failed = (fclose(copy) != 0);
+    ULONGLONG t_received = GetTickCount64();
     if (hr != S_OK) {
+        feed_stream_free(fs);
+        DeleteFileA(temp_db_path);
         snprintf(debug_msg, 256, "Download Failed.\nError Code: 0x%08lX", hr);
         MessageBoxA(NULL, debug_msg, "Update Error", MB_OK | MB_ICONERROR);
         update_progress = -1;
         CoUninitialize();
         return -1;
     }
-    // 3. UNZIP Phase (Silent Execution)
-    // We use CreateProcess instead of system() so we can hide the window (SW_HIDE).
-    snprintf(cmd_buf, sizeof(cmd_buf), 
-             "powershell -NoProfile -WindowStyle Hidden -Command \"Expand-Archive -Path '%s' -DestinationPath . -Force\"", 
-             zip_path);
-
-    STARTUPINFOA si;
-    PROCESS_INFORMATION pi;
-
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW; // Tell Windows we want to use the wShowWindow flag
-    si.wShowWindow = SW_HIDE;          // <--- THE KEY: Run completely invisible
-    
-    ZeroMemory(&pi, sizeof(pi));
-    // Launch the process
-    if (!CreateProcessA(NULL,   // No module name (use command line)
-                        cmd_buf,// Command line
-                        NULL,   // Process handle not inheritable
-                        NULL,   // Thread handle not inheritable
-                        FALSE,  // Set handle inheritance to FALSE
-                        0,      // No creation flags
-                        NULL,   // Use parent's environment block
-                        NULL,   // Use parent's starting directory
-                        &si,    // Pointer to STARTUPINFO structure
-                        &pi)    // Pointer to PROCESS_INFORMATION structure
-    ) {
-        MessageBoxA(NULL, "Could not start unzip process.", "Update Error", MB_OK | MB_ICONERROR);
-        DeleteFileA(zip_path);
-        update_progress = -1;
-        CoUninitialize();
-        return -5;
-    }
-    // Wait until child process exits.
-    WaitForSingleObject(pi.hProcess, INFINITE);
-    // Check if it actually succeeded
-    DWORD exit_code = 0;
-    GetExitCodeProcess(pi.hProcess, &exit_code);
-    // Close process and thread handles. 
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
-
-    if (exit_code != 0) {
-        MessageBoxA(NULL, "Unzip failed or was interrupted.", "Update Error", MB_OK | MB_ICONERROR);
-        DeleteFileA(zip_path);
-        update_progress = -1;
-        CoUninitialize();
-        return -5;
-    }
-    // 4. Rename extracted file (full_sha256.txt) to our temp DB name (signatures.db.tmp)
-    // First, delete any existing temp file to avoid collision
-    DeleteFileA(temp_db_path);
-    
-    if (!MoveFileA(extracted_name, temp_db_path)) {
-        // Try waiting a moment, sometimes antivirus scanning holds the new file
-        Sleep(500);
-        if (!MoveFileA(extracted_name, temp_db_path)) {
-             MessageBoxA(NULL, "Could not process extracted file.\nAccess Denied.", "Update Error", MB_OK | MB_ICONERROR);
-             update_progress = -1;
-             CoUninitialize();
-             return -6;
+    // 3. Validation: every line was checked on the way in, so only the sort is left.
+    // A truncated or garbled download is rejected as a whole.
+    update_progress = 90;
+    sig_db fresh;
+    sig_load_report report;
+    FeedStreamStats stream_stats;
+    int valid = (feed_stream_finish(fs, &fresh, &report, &stream_stats) == 0);
+    if (valid && (copy_failed || report.malformed > 0 || sigdb_count(&fresh) == 0)) {
+        if (report.malformed > 0) {
+            printf("[WARN] Update rejected: %zu of %zu line(s) malformed\n", report.malformed, report.lines);
         }
+        sigdb_free(&fresh);
+        valid = 0;
     }
-    // Clean up the zip file now that we have the content
-    DeleteFileA(zip_path);
-    // 5. Validation (Check if the extracted text file is valid)
-    update_progress = 90;
-    if (!is_db_valid(temp_db_path)) {
-        MessageBoxA(NULL, "Validation Failed: Extracted file is corrupt.", "Update Error", MB_OK | MB_ICONERROR);
+    if (!valid) {
+        MessageBoxA(NULL, "Validation Failed: Downloaded database is corrupt.", "Update Error", MB_OK | MB_ICONERROR);
         DeleteFileA(temp_db_path);
         update_progress = -1;
         CoUninitialize();
         return -2;
     }
-    // 6. Safe Atomic Swap
-    if (GetFileAttributesA(db_path) != INVALID_FILE_ATTRIBUTES) {
-        CopyFileA(db_path, backup_path, FALSE);
+    ULONGLONG t_indexed = GetTickCount64();
+    // Only what this download adds over the index in memory is hunted for
+    // (everything, if no scan has loaded one yet)
+    RetroHunt hunt;
+    SigReader reader;
+    int pinned = (sigstore_reader_register(&reader) == 0);
+    retro_hunt_collect(&hunt, pinned ? sigstore_acquire(&reader) : NULL, &fresh);
+    if (pinned) {
+        sigstore_release(&reader);
+        sigstore_reader_unregister(&reader);
     }
-    
-    if (!MoveFileExA(temp_db_path, db_path, MOVEFILE_REPLACE_EXISTING)) {
+    // 4. Safe Atomic Swap
+    if (install_db(temp_db_path, db_path) != 0) {
         MessageBoxA(NULL, "Final database swap failed.", "Update Error", MB_OK | MB_ICONERROR);
-        CopyFileA(backup_path, db_path, FALSE); // Restore
+        sigdb_free(&fresh);
+        retro_hunt_free(&hunt);
         update_progress = -1;
         CoUninitialize();
         return -3;
     }
+    // 5. Hot-swap the in-memory index; running scans move to it on their next lookup
+    size_t total = sigdb_count(&fresh);
+    sigstore_publish(&fresh);
+    write_db_version(db_path, started_at);
+    printf("[UPDATE] Full: %zu signatures, %.1f MB received (%.1f MB expanded), indexed %llu ms after the last byte, %llu ms end to end\n",
+           total, (double)stream_stats.bytes_in / (1024.0 * 1024.0), (double)stream_stats.bytes_out / (1024.0 * 1024.0),
+           (unsigned long long)(t_indexed - t_received), (unsigned long long)(GetTickCount64() - t_start));
+    retro_hunt_report(&hunt);
     // Success!
     update_progress = 101;
     CoUninitialize();
@@ -1,8 +1,27 @@
 #ifndef SIGNATURE_SCAN_H
 #define SIGNATURE_SCAN_H
+#include <glib.h>
+#include "scan_stats.h"
 
 extern volatile int update_progress;
+extern int retro_hunt_quarantine;   // Quarantine retro-hunt hits instead of only reporting them
+extern int incremental_scan;        // Full system scans skip directories unchanged since the last one
+extern int heuristic_threshold;     // Heuristic score (0-100) that flags a file as suspicious, 0 = off
+extern int golden_image;            // Completed clean scans rewrite the allowlist baseline
+extern int fuzzy_threshold;         // Largest TLSH distance to a known sample reported as a threat, 0 = off
+extern int scan_stats_json;         // Scans also dump their stage histograms as JSON
+extern int scan_trace;              // Scans also write a Chrome trace-event timeline
+extern int scan_record;             // Scans also record every file read and its I/O times, for replay
+extern int memory_limit_mb;         // Scan memory ceiling: the walk is streamed and the scan degrades near it, 0 = off
+extern ScanStats *scan_stats_out;   // When set, receives each finished scan's merged stage histograms
+extern guint64 scan_stats_out_ns;   // ... and the workers' wall time
 int signature_scan(const char *sigdb_path, const char *path_to_scan);
+// incremental: skip directories unchanged since the last incremental scan of the same path
+int signature_scan_ex(const char *sigdb_path, const char *path_to_scan, int incremental);
+// One scan over several roots (Quick Scan); a file reachable from two of them is read once
+int signature_scan_paths(const char *sigdb_path, GList *paths);
 int update_signature_db(const char *db_path);
+// Moves a file into the quarantine folder (XOR-encoded, with its original path) and logs it
+int quarantine_file(const char *src_path, const char *threat_label);
 
 #endif
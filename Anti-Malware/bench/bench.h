@@ -0,0 +1,68 @@
+#ifndef BENCH_H
+#define BENCH_H
+#include <glib.h>
+#include "scan_stats.h"
+#include "corpus.h"
+/* What the fos-bench commands share: options, one result per benchmark and the
+ * JSON lines they are appended as. bench_main.c runs the scan pipeline
+ * (walk, hash, lookup, scan, replay); bench_engines.c times the content
+ * engines one at a time, on files already in memory; bench_store.c checks the
+ * signature store under concurrent swaps. */
+
+#define BENCH_RESULTS   "bench_results.jsonl"
+#define BENCH_MAX_REPS  64
+
+typedef struct {
+    const char *root;
+    const char *out_path;       // Results, one JSON object per line, appended
+    const char *label;          // What is being measured: a commit, a build
+    guint reps;
+    guint threads;
+    unsigned algos;
+    guint64 queries;
+    const char *sigs_path;      // Replay: signatures to look the digests up in, NULL = none
+    const char *mirror;         // Replay: read the files from this copy instead of RAM
+    CorpusSpec spec;
+    char corpus[512];           // The spec as one line, so results from different corpora never mix
+} bench_opts;
+
+typedef struct {
+    const char *bench;
+    guint64 items;              // Per run
+    guint64 bytes;
+    guint reps;
+    guint64 run_ns[BENCH_MAX_REPS];
+    const StageHist *latency;   // Per item over every run, NULL if not kept
+    const ScanStats *stages;    // Scans: the pipeline's own histograms for the last run
+    guint64 recorded_io_ns;     // Replays: what the recorded scan spent opening and reading
+    guint64 recorded_cpu_ns;    // ... hashing: what the replay does again
+    guint64 recorded_sink_ns;   // ... in the engine sinks, which the replay leaves out
+    const char *covers;         // Replays: the work a run repeats, NULL = all of it
+} bench_result;
+
+// bench_main.c
+int usage(void);
+// Prints the result and appends it to o->out_path
+int emit_result(const bench_opts *o, const bench_result *r);
+guint64 bench_median_ns(const bench_result *r);
+
+// bench_engines.c: any directory, not only a generated corpus
+int bench_fxparse(const bench_opts *o);
+// -s: a content signature file; without it a synthetic set
+int bench_content(const bench_opts *o);
+// -s: a fuzzy signature file; without it a synthetic index of 100,000 references
+int bench_fuzzy(const bench_opts *o);
+// Every ZIP under the directory, members inflated and hashed (-a digests)
+int bench_zip(const bench_opts *o);
+// -s: a scan_rules.conf; without it a synthetic set. Every path of the tree, from RAM
+int bench_rules(const bench_opts *o);
+// Mutates the executables under a directory and checks what fx_parse makes of them
+int cmd_fuzz_fx(int argc, char **argv);
+
+// bench_store.c: lookups from several threads while generations are swapped in
+int cmd_hammer_sigstore(int argc, char **argv);
+
+// bench_update.c: the updater against a local HTTP stand-in, in a scratch directory
+int cmd_update_check(int argc, char **argv);
+
+#endif
@@ -0,0 +1,624 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scan_core.h"
+#include "feature_extract.h"
+#include "content_sig.h"
+#include "fuzzy_hash.h"
+#include "archive_scan.h"
+#include "scan_rules.h"
+#include "bench.h"
+
+#define ENGINE_MAX_FILE     (64u * 1024 * 1024)     // Larger files are left out
+#define ENGINE_MAX_BYTES    (1024ull * 1024 * 1024) // All inputs together, in RAM
+#define CONTENT_PATTERNS    1000                    // Synthetic set when no -s file is given
+#define FUZZY_REFERENCES    100000                  // Synthetic references when no -s file is given
+#define FUZZY_NEAR_EVERY    16                      // One input in 16 gets a near variant among them
+#define FUZZY_NEAR_FLIPS    6                       // Bucket codes changed in a near variant
+#define FUZZ_ITERATIONS     100000
+#define FUZZ_SLOW_MS        100                     // A parse this slow is a finding
+#define FUZZ_MAX_MUTATIONS  8
+#define FUZZ_HEADER_BYTES   4096                    // Half of the mutations land here
+#define FUZZ_HASH_EVERY     8                       // Section hashing is bounded and slow: not every time
+
+// --- Inputs ---
+// Read once before the clock starts: the engines are timed, not the disk
+typedef struct {
+    char *path;
+    unsigned char *data;
+    gsize len;
+} engine_input;
+
+typedef struct {
+    engine_input *items;
+    guint n;
+    guint64 bytes;
+} engine_inputs;
+
+static void free_inputs(engine_inputs *in) {
+    for (guint i = 0; i < in->n; ++i) {
+        g_free(in->items[i].path);
+        g_free(in->items[i].data);
+    }
+    g_free(in->items);
+    memset(in, 0, sizeof(*in));
+}
+
+static int load_inputs(const char *root, engine_inputs *in) {
+    memset(in, 0, sizeof(*in));
+    FilePathList *list = list_files_recursive(root);
+    if (!list) return -1;
+    in->items = g_new0(engine_input, list->total_files + 1);
+    guint64 skipped = 0;
+    for (GList *l = list->paths; l; l = l->next) {
+        gchar *data = NULL;
+        gsize len = 0;
+        if (!g_file_get_contents(l->data, &data, &len, NULL)) continue;
+        if (len == 0 || len > ENGINE_MAX_FILE || in->bytes + len > ENGINE_MAX_BYTES) {
+            g_free(data);
+            skipped++;
+            continue;
+        }
+        engine_input *e = &in->items[in->n++];
+        e->path = g_strdup(l->data);
+        e->data = (unsigned char *)data;
+        e->len = len;
+        in->bytes += len;
+    }
+    free_filepath_list(list);
+    if (skipped > 0) {
+        printf("[WARN] %llu empty or oversized file(s) left out\n", (unsigned long long)skipped);
+    }
+    if (in->n == 0) {
+        fprintf(stderr, "No readable files under %s\n", root);
+        free_inputs(in);
+        return -1;
+    }
+    return 0;
+}
+
+// --- Feature extraction ---
+// One thread: what fx_parse costs a worker per file, section hashes included
+int bench_fxparse(const bench_opts *o) {
+    engine_inputs in;
+    if (load_inputs(o->root, &in) != 0) return -1;
+    FileFeatures *ff = g_new(FileFeatures, 1);
+    StageHist *latency = g_new0(StageHist, 1);
+    bench_result r = { .bench = "fxparse" };
+    r.latency = latency;
+    r.items = in.n;
+    r.bytes = in.bytes;
+    guint64 pe = 0, elf = 0, capped = 0, malformed = 0;
+    for (r.reps = 0; r.reps < o->reps; ++r.reps) {
+        guint64 t0 = hash_clock_ns();
+        for (guint i = 0; i < in.n; ++i) {
+            guint64 f0 = hash_clock_ns();
+            int rc = fx_parse(in.items[i].data, in.items[i].len, TRUE, ff);
+            stage_hist_add(latency, hash_clock_ns() - f0);
+            if (r.reps > 0) continue;
+            if (ff->format == FX_PE) pe++;
+            if (ff->format == FX_ELF) elf++;
+            if (rc == FX_MALFORMED) malformed++;
+            if (ff->anomalies & FX_ANOMALY_CAPPED) capped++;
+        }
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+    }
+    printf("[BENCH] %llu PE, %llu ELF, %llu other; %llu malformed, %llu capped\n",
+           (unsigned long long)pe, (unsigned long long)elf,
+           (unsigned long long)(in.n - pe - elf), (unsigned long long)malformed,
+           (unsigned long long)capped);
+    int rc = emit_result(o, &r);
+    g_free(latency);
+    g_free(ff);
+    free_inputs(&in);
+    return rc;
+}
+
+// --- Content signatures ---
+/* Random patterns of 8 to 40 bytes with a wildcard now and then, the shape of
+ * a real feed; their anchors start with almost any byte, so the prefilter has
+ * little to skip. -s times a real content signature file instead. */
+static content_db *synthetic_content_db(guint n) {
+    static const char hexdig[] = "0123456789abcdef";
+    content_db *db = content_db_new();
+    guint64 rng = 0x636f6e74656e74ull;
+    char hex[2 * 40 + 1], name[32];
+    for (guint i = 0; i < n; ++i) {
+        int len = 8 + (int)(corpus_next(&rng) % 33), w = 0;
+        for (int k = 0; k < len; ++k) {
+            guint64 r = corpus_next(&rng);
+            if (k >= 4 && r % 10 == 0) {
+                hex[w++] = '?';
+                hex[w++] = '?';
+                continue;
+            }
+            hex[w++] = hexdig[(r >> 8) & 15];
+            hex[w++] = hexdig[(r >> 12) & 15];
+        }
+        hex[w] = '\0';
+        snprintf(name, sizeof(name), "Bench.Content.%u", i);
+        content_db_add(db, name, hex);
+    }
+    content_db_compile(db);
+    return db;
+}
+
+// One thread, fed in compute_file_hashes' chunks as a worker's sink sees them
+int bench_content(const bench_opts *o) {
+    engine_inputs in;
+    if (load_inputs(o->root, &in) != 0) return -1;
+    int bad = 0;
+    content_db *db = o->sigs_path ? content_db_load(o->sigs_path, &bad) : synthetic_content_db(CONTENT_PATTERNS);
+    if (!db) {
+        fprintf(stderr, "Failed to load content signatures: %s\n", o->sigs_path);
+        free_inputs(&in);
+        return -1;
+    }
+    StageHist *latency = g_new0(StageHist, 1);
+    bench_result r = { .bench = "content" };
+    r.latency = latency;
+    r.items = in.n;
+    r.bytes = in.bytes;
+    guint64 matched = 0, incomplete = 0;
+    for (r.reps = 0; r.reps < o->reps; ++r.reps) {
+        guint64 t0 = hash_clock_ns();
+        for (guint i = 0; i < in.n; ++i) {
+            guint64 f0 = hash_clock_ns();
+            content_scan cs;
+            content_scan_init(&cs, db);
+            for (gsize off = 0; off < in.items[i].len; off += SCANCORE_READ_CHUNK) {
+                content_scan_feed(&cs, in.items[i].data + off, MIN((gsize)SCANCORE_READ_CHUNK, in.items[i].len - off));
+            }
+            stage_hist_add(latency, hash_clock_ns() - f0);
+            if (r.reps == 0 && content_scan_result(&cs)) matched++;
+            if (r.reps == 0 && !content_scan_complete(&cs)) incomplete++;
+            content_scan_free(&cs);
+        }
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+    }
+    printf("[BENCH] %zu pattern(s)%s, %llu file(s) matched, %llu not fully checked, %.2f GB/s median\n",
+           content_db_count(db), o->sigs_path ? "" : " (synthetic)", (unsigned long long)matched,
+           (unsigned long long)incomplete, (double)in.bytes / (double)MAX(bench_median_ns(&r), 1));
+    if (bad > 0) printf("[WARN] %d malformed line(s) in %s\n", bad, o->sigs_path);
+    int rc = emit_result(o, &r);
+    g_free(latency);
+    content_db_free(db);
+    free_inputs(&in);
+    return rc;
+}
+
+// --- Fuzzy digests ---
+/* Random digests, plus a variant of every FUZZY_NEAR_EVERY-th input's own digest
+ * with a few bucket codes changed: most queries search an index of unrelated
+ * references, as in a real feed, and some find a neighbour. */
+static fuzzy_db *synthetic_fuzzy_db(const engine_inputs *in, guint n) {
+    fuzzy_db *db = fuzzy_db_new();
+    guint64 rng = 0x66757a7a79ull;
+    char name[32];
+    FuzzyDigest d;
+    for (guint i = 0; i < n; ++i) {
+        guint64 r = corpus_next(&rng);
+        d.checksum = (guint8)r;
+        d.lvalue = (guint8)(r >> 8);
+        d.q1ratio = (guint8)((r >> 16) & 15);
+        d.q2ratio = (guint8)((r >> 20) & 15);
+        corpus_fill(r, d.code, sizeof(d.code));
+        snprintf(name, sizeof(name), "Bench.Fuzzy.%u", i);
+        fuzzy_db_add(db, name, &d);
+    }
+    for (guint i = 0; i < in->n; i += FUZZY_NEAR_EVERY) {
+        fuzzy_state st;
+        fuzzy_state_init(&st);
+        fuzzy_update(&st, in->items[i].data, in->items[i].len);
+        if (fuzzy_final(&st, &d) != 0) continue;
+        for (int k = 0; k < FUZZY_NEAR_FLIPS; ++k) {
+            guint64 r = corpus_next(&rng);
+            d.code[r % FUZZY_CODE_SIZE] ^= (guint8)(1u << ((r >> 8) % 8));
+        }
+        snprintf(name, sizeof(name), "Bench.Near.%u", i);
+        fuzzy_db_add(db, name, &d);
+    }
+    fuzzy_db_compile(db);
+    return db;
+}
+
+// One thread: the digest as route_fuzzy feeds it, in the scan's chunks, then the
+// index query a worker makes for a file no exact signature matched
+int bench_fuzzy(const bench_opts *o) {
+    engine_inputs in;
+    if (load_inputs(o->root, &in) != 0) return -1;
+    fuzzy_init();
+    int bad = 0;
+    fuzzy_db *db = o->sigs_path ? fuzzy_db_load(o->sigs_path, &bad) : synthetic_fuzzy_db(&in, FUZZY_REFERENCES);
+    if (!db) {
+        fprintf(stderr, "Failed to load fuzzy signatures: %s\n", o->sigs_path);
+        free_inputs(&in);
+        return -1;
+    }
+    StageHist *latency = g_new0(StageHist, 1);
+    bench_result r = { .bench = "fuzzy" };
+    r.latency = latency;
+    r.items = in.n;
+    r.bytes = in.bytes;
+    guint64 digests = 0, matched = 0, digest_ns = 0;
+    FuzzyQueryStats qs = { 0 };
+    for (r.reps = 0; r.reps < o->reps; ++r.reps) {
+        guint64 t0 = hash_clock_ns();
+        for (guint i = 0; i < in.n; ++i) {
+            guint64 f0 = hash_clock_ns();
+            fuzzy_state st;
+            fuzzy_state_init(&st);
+            for (gsize off = 0; off < in.items[i].len; off += SCANCORE_READ_CHUNK) {
+                fuzzy_update(&st, in.items[i].data + off, MIN((gsize)SCANCORE_READ_CHUNK, in.items[i].len - off));
+            }
+            FuzzyDigest d;
+            int have = fuzzy_final(&st, &d) == 0;
+            guint64 f1 = hash_clock_ns();
+            int distance = 0;
+            const char *label = have ? fuzzy_db_query(db, &d, FUZZY_DEFAULT_THRESHOLD, &distance, &qs) : NULL;
+            stage_hist_add(latency, hash_clock_ns() - f0);
+            digest_ns += f1 - f0;
+            if (r.reps == 0 && have) digests++;
+            if (r.reps == 0 && label) matched++;
+        }
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+    }
+    printf("[BENCH] %zu reference(s)%s, %llu of %u file(s) with a digest, %llu matched; digest %.2f GB/s, "
+           "query %.1f us over %.0f candidate(s) on average\n",
+           fuzzy_db_count(db), o->sigs_path ? "" : " (synthetic)", (unsigned long long)digests, in.n,
+           (unsigned long long)matched, (double)in.bytes * r.reps / (double)MAX(digest_ns, 1),
+           qs.queries ? (double)qs.ns / 1e3 / (double)qs.queries : 0.0,
+           qs.queries ? (double)qs.candidates / (double)qs.queries : 0.0);
+    if (bad > 0) printf("[WARN] %d malformed line(s) in %s\n", bad, o->sigs_path);
+    int rc = emit_result(o, &r);
+    g_free(latency);
+    fuzzy_db_free(db);
+    free_inputs(&in);
+    return rc;
+}
+
+// --- ZIP archives ---
+// One thread through archive_scan_zip with the scan's limits: parse, inflate and
+// hash every member. The first run reads from disk; the median is from the page cache.
+static int count_member(void *user, const char *member_path, const MultiDigest *digest) {
+    (void)member_path;
+    (void)digest;
+    (*(guint64 *)user)++;
+    return 0;
+}
+
+int bench_zip(const bench_opts *o) {
+    FilePathList *list = list_files_recursive(o->root);
+    if (!list) return -1;
+    GPtrArray *zips = g_ptr_array_new();
+    for (GList *l = list->paths; l; l = l->next) {
+        unsigned char head[4];
+        FILE *f = fopen(l->data, "rb");
+        if (!f) continue;
+        size_t n = fread(head, 1, sizeof(head), f);
+        fclose(f);
+        if (archive_is_zip(head, n)) g_ptr_array_add(zips, l->data);
+    }
+    if (zips->len == 0) {
+        fprintf(stderr, "No ZIP files under %s\n", o->root);
+        g_ptr_array_free(zips, TRUE);
+        free_filepath_list(list);
+        return -1;
+    }
+    StageHist *latency = g_new0(StageHist, 1);
+    bench_result r = { .bench = "zip" };
+    r.latency = latency;
+    r.items = zips->len;
+    guint64 members = 0, bytes_out = 0, failed = 0;
+    for (r.reps = 0; r.reps < o->reps; ++r.reps) {
+        guint64 t0 = hash_clock_ns();
+        r.bytes = members = bytes_out = failed = 0;
+        for (guint i = 0; i < zips->len; ++i) {
+            ArchiveStats st;
+            guint64 z0 = hash_clock_ns();
+            int rc = archive_scan_zip(g_ptr_array_index(zips, i), &archive_limits, o->algos, count_member,
+                                      &members, &st);
+            stage_hist_add(latency, hash_clock_ns() - z0);
+            r.bytes += st.bytes_in;
+            bytes_out += st.bytes_out;
+            if (rc != ARCHIVE_OK) failed++;
+        }
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+    }
+    double secs = (double)MAX(bench_median_ns(&r), 1) / 1e9;
+    printf("[BENCH] %llu member(s), %.1f MB expanded (%.1f MB/s), %llu archive(s) stopped early or corrupt\n",
+           (unsigned long long)members, (double)bytes_out / (1024.0 * 1024.0),
+           (double)bytes_out / (1024.0 * 1024.0) / secs, (unsigned long long)failed);
+    int rc = emit_result(o, &r);
+    g_free(latency);
+    g_ptr_array_free(zips, TRUE);
+    free_filepath_list(list);
+    return rc;
+}
+
+// --- Scan rules ---
+/* The rule set a build agent would use: names and globs that prune whole
+ * subtrees (one matches a slice of a generated corpus), prefixes the walk never
+ * reaches, which still cost a trie step per directory, an extension list and a
+ * size bound, which makes every file carry its size and time. */
+static const char rules_synthetic[] =
+    "exclude **\\node_modules\n"
+    "exclude .git\n"
+    "exclude **\\d07\\d0[4-7]\n"
+    "exclude **\\*.tmp\n"
+    "exclude C:\\VMs\n"
+    "exclude /var/lib/docker\n"
+    "exclude_ext .iso .vmdk .vhdx .vdi .qcow2 .pdb\n"
+    "max_size 4G\n";
+
+// One directory or file of the tree, in walk order (a directory before its contents)
+typedef struct {
+    guint depth;                // Components below the root
+    gboolean is_dir;
+    char *name;
+    guint64 size;
+    gint64 mtime;
+} rule_entry;
+
+static int path_cmp(gconstpointer a, gconstpointer b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// The listing sorted, so every directory's contents follow it; its directories
+// are rebuilt from the file paths
+static GArray *rule_entries(const char *root, guint *max_depth) {
+    FilePathList *list = list_files_recursive(root);
+    if (!list) return NULL;
+    GPtrArray *paths = g_ptr_array_new();
+    for (GList *l = list->paths; l; l = l->next) g_ptr_array_add(paths, l->data);
+    g_ptr_array_sort(paths, path_cmp);
+    GArray *entries = g_array_new(FALSE, TRUE, sizeof(rule_entry));
+    size_t skip = strlen(root);
+    gchar **prev = NULL;
+    *max_depth = 0;
+    for (guint i = 0; i < paths->len; ++i) {
+        const char *path = g_ptr_array_index(paths, i);
+        const char *rel = path + skip;
+        while (*rel == G_DIR_SEPARATOR) rel++;
+        gchar **comps = g_strsplit(rel, G_DIR_SEPARATOR_S, -1);
+        guint n = g_strv_length(comps), same = 0;
+        while (prev && same + 1 < n && prev[same] && prev[same + 1] && strcmp(prev[same], comps[same]) == 0) same++;
+        for (guint d = same; d + 1 < n; ++d) {
+            rule_entry e = { d, TRUE, g_strdup(comps[d]), 0, 0 };
+            g_array_append_val(entries, e);
+        }
+        struct stat st;
+        rule_entry e = { n - 1, FALSE, g_strdup(comps[n - 1]), 0, 0 };
+        if (stat(path, &st) == 0) {
+            e.size = (guint64)st.st_size;
+            e.mtime = (gint64)st.st_mtime;
+        }
+        g_array_append_val(entries, e);
+        *max_depth = MAX(*max_depth, n);
+        g_strfreev(prev);
+        prev = comps;
+    }
+    g_strfreev(prev);
+    g_ptr_array_free(paths, TRUE);
+    free_filepath_list(list);
+    return entries;
+}
+
+// One walk's worth of decisions, as the walkers make them: a pruned directory's
+// entries are never looked at
+static guint64 rules_walk(ScanRules *rules, const char *root, const GArray *entries, RuleCursor *stack,
+                          guint64 *scanned) {
+    guint64 checked = 0;
+    *scanned = 0;
+    if (!scan_rules_begin(rules, root, &stack[0])) return 0;
+    guint pruned_at = G_MAXUINT;
+    for (guint i = 0; i < entries->len; ++i) {
+        const rule_entry *e = &g_array_index(entries, rule_entry, i);
+        if (e->depth > pruned_at) continue;
+        pruned_at = G_MAXUINT;
+        checked++;
+        if (e->is_dir) {
+            if (!scan_rules_enter_dir(rules, &stack[e->depth], e->name, &stack[e->depth + 1])) pruned_at = e->depth;
+        } else if (scan_rules_want_file(rules, &stack[e->depth], e->name, e->size, e->mtime) == RULES_SCAN) {
+            (*scanned)++;
+        }
+    }
+    return checked;
+}
+
+// One thread: every directory and file of the tree through the compiled rules,
+// from memory, so the figure is the rule cost alone
+int bench_rules(const bench_opts *o) {
+    char *synthetic = NULL;
+    if (!o->sigs_path) {
+        synthetic = g_build_filename(g_get_tmp_dir(), "fos-bench-rules.conf", NULL);
+        g_file_set_contents(synthetic, rules_synthetic, -1, NULL);
+    }
+    ScanRules *rules = scan_rules_load(o->sigs_path ? o->sigs_path : synthetic);
+    if (synthetic) remove(synthetic);
+    g_free(synthetic);
+    if (!rules) {
+        fprintf(stderr, "Failed to load scan rules: %s\n", o->sigs_path ? o->sigs_path : "(synthetic)");
+        return -1;
+    }
+    guint max_depth = 0;
+    GArray *entries = rule_entries(o->root, &max_depth);
+    if (!entries || entries->len == 0) {
+        fprintf(stderr, "No files under %s\n", o->root);
+        if (entries) g_array_free(entries, TRUE);
+        scan_rules_free(rules);
+        return -1;
+    }
+    RuleCursor *stack = g_new(RuleCursor, max_depth + 1);
+    bench_result r = { .bench = "rules" };
+    guint64 scanned = 0;
+    for (r.reps = 0; r.reps < o->reps; ++r.reps) {
+        guint64 t0 = hash_clock_ns();
+        r.items = rules_walk(rules, o->root, entries, stack, &scanned);
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+    }
+    // ns per path == ms per million paths. The walkers' own sampled figure, which
+    // each scan prints, adds a clock read to one evaluation in RULES_SAMPLE_EVERY.
+    const RuleStats *st = scan_rules_stats(rules);
+    printf("[BENCH] %llu of %u path(s) checked, %llu director%s pruned, %llu file(s) to scan: "
+           "%.1f ms per million paths (%.1f sampled)\n",
+           (unsigned long long)r.items, entries->len, (unsigned long long)(st->dirs_pruned / MAX(r.reps, 1)),
+           st->dirs_pruned / MAX(r.reps, 1) == 1 ? "y" : "ies", (unsigned long long)scanned,
+           r.items ? (double)bench_median_ns(&r) / (double)r.items : 0.0,
+           st->sampled ? (double)st->sampled_ns / (double)st->sampled : 0.0);
+    int rc = emit_result(o, &r);
+    for (guint i = 0; i < entries->len; ++i) g_free(g_array_index(entries, rule_entry, i).name);
+    g_array_free(entries, TRUE);
+    g_free(stack);
+    scan_rules_free(rules);
+    return rc;
+}
+
+// --- Fuzzing fx_parse ---
+/* Mutation fuzzing over real executables: a few bit flips, boundary values,
+ * copied blocks or a truncation per iteration, biased towards the headers.
+ * What the scanner relies on is checked after every parse, and a parse slower
+ * than --slow-ms counts as a finding, so a loop that a crafted table can
+ * stretch shows up as well as a bounds error. The same --seed replays the same
+ * inputs. Built with -fsanitize=address, memory errors stop the run at the
+ * input that caused them (raise --slow-ms to match the slower build). */
+static const guint32 fuzz_values[] = {
+    0, 1, 2, 0x7f, 0x80, 0xff, 0x100, 0x7fff, 0x8000, 0xffff,
+    0x10000, 0x7fffffff, 0x80000000, 0xfffffffe, 0xffffffff
+};
+
+static void put_le(unsigned char *p, guint32 v, int width) {
+    for (int k = 0; k < width; ++k) p[k] = (unsigned char)(v >> (8 * k));
+}
+
+// Returns the mutated length
+static gsize mutate(guint64 *rng, unsigned char *buf, gsize len) {
+    int n = 1 + (int)(corpus_next(rng) % FUZZ_MAX_MUTATIONS);
+    for (int m = 0; m < n && len > 0; ++m) {
+        guint64 r = corpus_next(rng);
+        gsize span = (r & 1) ? MIN(len, (gsize)FUZZ_HEADER_BYTES) : len;
+        gsize at = (gsize)((r >> 8) % span);
+        guint32 v = fuzz_values[(r >> 40) % G_N_ELEMENTS(fuzz_values)];
+        if ((r >> 56) % 4 == 0) v = (guint32)len - (guint32)((r >> 32) & 7);    // Near the end of the file
+        switch ((r >> 1) % 6) {
+        case 0:
+            buf[at] ^= (unsigned char)(1u << ((r >> 4) & 7));
+            break;
+        case 1:
+            buf[at] = (unsigned char)v;
+            break;
+        case 2:
+            if (at + 2 <= len) put_le(buf + at, v, 2);
+            break;
+        case 3:
+            if (at + 4 <= len) put_le(buf + at, v, 4);
+            break;
+        case 4: {
+            gsize from = (gsize)(corpus_next(rng) % len);
+            gsize k = MIN((gsize)(4 + (r >> 48) % 61), MIN(len - at, len - from));
+            memmove(buf + at, buf + from, k);
+            break;
+        }
+        default:
+            if ((r >> 4) % 8 == 0) len = at;     // Truncations are rarer: they end the parse early
+            break;
+        }
+    }
+    return len;
+}
+
+// What the scanner assumes of any FileFeatures; NULL when it all holds
+static const char *fx_check(int rc, const FileFeatures *ff, gsize len) {
+    if (rc != FX_OK && rc != FX_NOT_EXEC && rc != FX_MALFORMED) return "unknown return code";
+    if (ff->n_sections < 0 || ff->n_sections > FX_MAX_SECTIONS) return "section count out of range";
+    for (int i = 0; i < ff->n_sections; ++i) {
+        const FxSection *s = &ff->sections[i];
+        if (s->size > 0 && (s->offset > len || s->size > len - s->offset)) return "section past the end of the file";
+        if (!memchr(s->name, '\0', sizeof(s->name))) return "section name not terminated";
+    }
+    if (ff->entry_section < -1 || ff->entry_section >= ff->n_sections) return "entry section out of range";
+    if (ff->n_imports > FX_MAX_IMPORTS) return "import count over the cap";
+    return NULL;
+}
+
+static int save_finding(const char *dir, guint64 iteration, const unsigned char *buf, gsize len) {
+    if (!dir) return 0;
+    g_mkdir_with_parents(dir, 0755);
+    char name[64];
+    snprintf(name, sizeof(name), "fx-%08llu.bin", (unsigned long long)iteration);
+    char *path = g_build_filename(dir, name, NULL);
+    gboolean ok = g_file_set_contents(path, (const gchar *)buf, (gssize)len, NULL);
+    printf("[FUZZ] Saved %s\n", ok ? path : "nothing (write failed)");
+    g_free(path);
+    return ok ? 0 : -1;
+}
+
+int cmd_fuzz_fx(int argc, char **argv) {
+    guint64 iterations = FUZZ_ITERATIONS, seed = 1, slow_ns = FUZZ_SLOW_MS * 1000000ull;
+    const char *save_dir = NULL;
+    for (int i = 3; i < argc; ++i) {
+        if (i + 1 >= argc) return usage();
+        const char *opt = argv[i], *val = argv[++i];
+        if (strcmp(opt, "--iterations") == 0) iterations = strtoull(val, NULL, 10);
+        else if (strcmp(opt, "--seed") == 0) seed = strtoull(val, NULL, 10);
+        else if (strcmp(opt, "--save") == 0) save_dir = val;
+        else if (strcmp(opt, "--slow-ms") == 0) slow_ns = strtoull(val, NULL, 10) * 1000000ull;
+        else return usage();
+    }
+    engine_inputs in;
+    if (load_inputs(argv[2], &in) != 0) return 2;
+    FileFeatures *ff = g_new(FileFeatures, 1);
+    // Only executables make useful seeds; random bytes stop at the magic
+    guint kept = 0;
+    gsize max_len = 0;
+    for (guint i = 0; i < in.n; ++i) {
+        if (fx_parse(in.items[i].data, in.items[i].len, FALSE, ff) == FX_NOT_EXEC) {
+            g_free(in.items[i].path);
+            g_free(in.items[i].data);
+            continue;
+        }
+        in.items[kept++] = in.items[i];
+        max_len = MAX(max_len, in.items[i].len);
+    }
+    in.n = kept;
+    if (kept == 0) {
+        fprintf(stderr, "No PE or ELF files under %s to mutate\n", argv[2]);
+        g_free(ff);
+        free_inputs(&in);
+        return 2;
+    }
+    printf("[FUZZ] %u seed(s), %llu iteration(s), seed %llu\n", kept,
+           (unsigned long long)iterations, (unsigned long long)seed);
+
+    unsigned char *buf = g_malloc(max_len);
+    guint64 rng = seed, findings = 0, capped = 0, malformed = 0, slowest = 0;
+    guint64 t0 = hash_clock_ns();
+    for (guint64 it = 0; it < iterations; ++it) {
+        const engine_input *src = &in.items[corpus_next(&rng) % kept];
+        memcpy(buf, src->data, src->len);
+        gsize len = mutate(&rng, buf, src->len);
+        guint64 p0 = hash_clock_ns();
+        int rc = fx_parse(buf, len, it % FUZZ_HASH_EVERY == 0, ff);
+        guint64 ns = hash_clock_ns() - p0;
+        slowest = MAX(slowest, ns);
+        if (rc == FX_MALFORMED) malformed++;
+        if (ff->anomalies & FX_ANOMALY_CAPPED) capped++;
+        const char *why = fx_check(rc, ff, len);
+        if (!why && ns > slow_ns) why = "slow parse";
+        if (!why) continue;
+        findings++;
+        printf("[FUZZ] Iteration %llu from %s: %s (%.1f ms)\n", (unsigned long long)it,
+               src->path, why, (double)ns / 1e6);
+        save_finding(save_dir, it, buf, len);
+    }
+    double secs = (double)(hash_clock_ns() - t0) / 1e9;
+    printf("[FUZZ] %.0f parse(s)/s, slowest %.3f ms; %llu malformed, %llu capped, %llu finding(s)\n",
+           secs > 0 ? (double)iterations / secs : 0.0, (double)slowest / 1e6,
+           (unsigned long long)malformed, (unsigned long long)capped, (unsigned long long)findings);
+    g_free(buf);
+    g_free(ff);
+    free_inputs(&in);
+    return findings ? 1 : 0;
+}
@@ -0,0 +1,880 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "scan_bridge.h"
+#include "scan_core.h"
+#include "scan_stats.h"
+#include "sig_db.h"
+#include "scan_record.h"
+#include "corpus.h"
+#include "bench.h"
+#ifdef _WIN32
+#include <direct.h>
+#include "signature_scan.h"
+#endif
+
+#define BENCH_HIT_EVERY 16          // One lookup in 16 is a known digest
+#define REPLAY_CHUNK    (64 * 1024) // scan_core's read size
+#define REPLAY_ARENA    (16u * 1024 * 1024) // Synthetic contents, shared by every replayed file
+
+// Definition of the global context (the walker in scan_core.c polls it)
+ScanContext global_scan_ctx;
+
+int usage(void) {
+    fprintf(stderr, "Usage: fos-bench corpus <root> [--seed N] [--files N] [--depth N] [--fanout N]\n"
+                    "                        [--sizes 1k:40,16k:35,256k:20,4m:5] [--hardlinks N]\n"
+                    "                        [--planted N] [--decoys N]\n"
+                    "       fos-bench walk|hash|lookup|quarantine|scan|all <root> [-r runs] [-j threads]\n"
+                    "                        [-a md5,sha1,sha256,sha512] [-q queries] [-o results] [-l label]\n"
+                    "       fos-bench fxparse <dir> [-r runs] [-o results] [-l label]\n"
+                    "       fos-bench content <dir> [-s content signatures] [-r runs] [-o results] [-l label]\n"
+                    "       fos-bench fuzzy <dir> [-s fuzzy signatures] [-r runs] [-o results] [-l label]\n"
+                    "       fos-bench zip <dir> [-a algos] [-r runs] [-o results] [-l label]\n"
+                    "       fos-bench rules <dir> [-s scan rules] [-r runs] [-o results] [-l label]\n"
+                    "       fos-bench fuzz-fx <dir> [--iterations N] [--seed N] [--save dir]\n"
+                    "                        [--slow-ms N]\n"
+                    "       fos-bench hammer-sigstore <swaps> [-j readers] [--seed N]\n"
+                    "       fos-bench update-check <scratch dir>\n"
+                    "       fos-bench replay <record> [-m mirror] [-s signatures] [-r runs] [-j threads]\n"
+                    "                        [-a algos] [-o results] [-l label]\n"
+                    "       fos-bench mirror <record> <dir>\n"
+                    "       fos-bench compare <old results> <new results>\n");
+    return 2;
+}
+
+// --- Results ---
+static int u64_cmp(const void *a, const void *b) {
+    guint64 x = *(const guint64 *)a, y = *(const guint64 *)b;
+    return (x > y) - (x < y);
+}
+
+guint64 bench_median_ns(const bench_result *r) {
+    guint64 sorted[BENCH_MAX_REPS];
+    memcpy(sorted, r->run_ns, r->reps * sizeof(guint64));
+    qsort(sorted, r->reps, sizeof(guint64), u64_cmp);
+    return sorted[r->reps / 2];
+}
+
+// The median run is the headline: the first run warms caches, later ones may be disturbed
+int emit_result(const bench_opts *o, const bench_result *r) {
+    guint64 sorted[BENCH_MAX_REPS];
+    memcpy(sorted, r->run_ns, r->reps * sizeof(guint64));
+    qsort(sorted, r->reps, sizeof(guint64), u64_cmp);
+    guint64 min = sorted[0], median = sorted[r->reps / 2], max = sorted[r->reps - 1];
+    double secs = median ? (double)median / 1e9 : 1e-9;
+
+    printf("[BENCH] %-13s %10llu item(s) %9.1f MB  median %10.3f ms  min %10.3f ms  %12.0f items/s %9.1f MB/s\n",
+           r->bench, (unsigned long long)r->items, (double)r->bytes / (1024.0 * 1024.0),
+           (double)median / 1e6, (double)min / 1e6, (double)r->items / secs,
+           (double)r->bytes / (1024.0 * 1024.0) / secs);
+
+    FILE *f = fopen(o->out_path, "a");
+    if (!f) {
+        fprintf(stderr, "Failed to open results: %s\n", o->out_path);
+        return -1;
+    }
+    fprintf(f, "{\"bench\": ");
+    json_write_string(f, r->bench);
+    fprintf(f, ", \"label\": ");
+    json_write_string(f, o->label);
+    fprintf(f, ", \"host\": ");
+    json_write_string(f, g_get_host_name());
+    fprintf(f, ", \"cpus\": %d, \"time\": %lld, \"corpus\": ", g_get_num_processors(), (long long)time(NULL));
+    json_write_string(f, o->corpus);
+    fprintf(f, ", \"threads\": %u, \"runs\": %u, \"items\": %llu, \"bytes\": %llu"
+               ", \"min_ns\": %llu, \"median_ns\": %llu, \"max_ns\": %llu, \"items_per_s\": %.1f, \"mb_per_s\": %.2f",
+            o->threads, r->reps, (unsigned long long)r->items, (unsigned long long)r->bytes,
+            (unsigned long long)min, (unsigned long long)median, (unsigned long long)max,
+            (double)r->items / secs, (double)r->bytes / (1024.0 * 1024.0) / secs);
+    if (r->latency && r->latency->count > 0) {
+        fprintf(f, ", \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu",
+                (unsigned long long)stage_hist_quantile(r->latency, 0.50),
+                (unsigned long long)stage_hist_quantile(r->latency, 0.99),
+                (unsigned long long)stage_hist_quantile(r->latency, 0.999));
+    }
+    if (r->stages) {
+        fprintf(f, ", \"stages\": {");
+        gboolean first = TRUE;
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            const StageHist *h = &r->stages->stage[s];
+            if (h->count == 0) continue;
+            fprintf(f, "%s\"%s\": {\"count\": %llu, \"sum_ns\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu}",
+                    first ? "" : ", ", scan_stage_name((ScanStage)s), (unsigned long long)h->count,
+                    (unsigned long long)h->sum_ns, (unsigned long long)stage_hist_quantile(h, 0.50),
+                    (unsigned long long)stage_hist_quantile(h, 0.99));
+            first = FALSE;
+        }
+        fprintf(f, "}");
+    }
+    if (r->recorded_io_ns || r->recorded_cpu_ns) {
+        fprintf(f, ", \"recorded_io_ns\": %llu, \"recorded_cpu_ns\": %llu, \"recorded_sink_ns\": %llu",
+                (unsigned long long)r->recorded_io_ns, (unsigned long long)r->recorded_cpu_ns,
+                (unsigned long long)r->recorded_sink_ns);
+    }
+    if (r->covers) fprintf(f, ", \"covers\": \"%s\"", r->covers);
+    fprintf(f, "}\n");
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+// --- Options ---
+// "sha256" or "SHA-256"
+static gboolean algo_name_eq(const char *text, const char *name) {
+    for (;; ++text, ++name) {
+        if (*text == '-') ++text;
+        if (*name == '-') ++name;
+        if (g_ascii_tolower(*text) != g_ascii_tolower(*name)) return FALSE;
+        if (!*text) return TRUE;
+    }
+}
+
+static unsigned parse_algos(const char *text) {
+    unsigned algos = 0;
+    char **names = g_strsplit(text, ",", -1);
+    for (char **n = names; *n; ++n) {
+        unsigned bit = 0;
+        for (int a = 0; a < HASH_ALGO_COUNT; ++a) {
+            if (algo_name_eq(*n, hash_algo_name((HashAlgo)a))) bit = HASH_BIT(a);
+        }
+        if (!bit) {
+            algos = 0;
+            break;
+        }
+        algos |= bit;
+    }
+    g_strfreev(names);
+    return algos;
+}
+
+// Options after the command and its first argument; 2 (the usage status) on error
+static int parse_opts(int argc, char **argv, bench_opts *o) {
+    memset(o, 0, sizeof(*o));
+    o->root = argv[2];
+    o->out_path = BENCH_RESULTS;
+    o->label = "";
+    o->reps = 5;
+    o->threads = (guint)MAX(1, g_get_num_processors());
+    o->queries = 1000000;
+    for (int i = 3; i < argc; ++i) {
+        if (i + 1 >= argc) return usage();
+        const char *opt = argv[i], *val = argv[++i];
+        if (strcmp(opt, "-r") == 0) o->reps = (guint)CLAMP(atoi(val), 1, BENCH_MAX_REPS);
+        else if (strcmp(opt, "-j") == 0) o->threads = (guint)MAX(1, atoi(val));
+        else if (strcmp(opt, "-q") == 0) o->queries = MAX(1, strtoull(val, NULL, 10));
+        else if (strcmp(opt, "-o") == 0) o->out_path = val;
+        else if (strcmp(opt, "-l") == 0) o->label = val;
+        else if (strcmp(opt, "-s") == 0) o->sigs_path = val;
+        else if (strcmp(opt, "-m") == 0) o->mirror = val;
+        else if (strcmp(opt, "-a") == 0) {
+            if (!(o->algos = parse_algos(val))) {
+                fprintf(stderr, "Unknown digest in: %s\n", val);
+                return 2;
+            }
+        } else return usage();
+    }
+    return 0;
+}
+
+// --- Walk ---
+static int bench_walk(const bench_opts *o) {
+    bench_result r = { .bench = "walk" };
+    for (r.reps = 0; r.reps < o->reps; ++r.reps) {
+        guint64 t0 = hash_clock_ns();
+        FilePathList *list = list_files_recursive(o->root);
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+        if (!list) return -1;
+        r.items = (guint64)list->total_files;
+        free_filepath_list(list);
+    }
+    return emit_result(o, &r);
+}
+
+// --- Hash ---
+typedef struct {
+    char **paths;
+    gint n;
+    gint next;
+    unsigned algos;
+    GMutex lock;
+    HashCost cost;              // Merged from the workers under lock
+    StageHist *latency;
+    guint64 failed;
+} hash_job;
+
+static gpointer hash_worker(gpointer data) {
+    hash_job *job = (hash_job *)data;
+    HashCost cost = { 0 };
+    StageHist *latency = g_new0(StageHist, 1);
+    guint64 failed = 0;
+    gint i;
+    while ((i = g_atomic_int_add(&job->next, 1)) < job->n) {
+        MultiDigest d;
+        guint64 t0 = hash_clock_ns();
+        if (compute_file_hashes(job->paths[i], job->algos, &d, NULL, 0, &cost) != 0) failed++;
+        stage_hist_add(latency, hash_clock_ns() - t0);
+    }
+    g_mutex_lock(&job->lock);
+    hash_cost_add(&job->cost, &cost);
+    stage_hist_merge(job->latency, latency);
+    job->failed += failed;
+    g_mutex_unlock(&job->lock);
+    g_free(latency);
+    return NULL;
+}
+
+// Every run hashes the whole listing; the walk is not timed here
+static int bench_hash(const bench_opts *o) {
+    FilePathList *list = list_files_recursive(o->root);
+    if (!list) return -1;
+    hash_job job = { 0 };
+    job.paths = g_new(char *, list->total_files + 1);
+    for (GList *l = list->paths; l; l = l->next) job.paths[job.n++] = l->data;
+    job.algos = o->algos;
+    job.latency = g_new0(StageHist, 1);
+    g_mutex_init(&job.lock);
+    GThread **threads = g_new(GThread *, o->threads);
+    bench_result r = { .bench = "hash" };
+    r.latency = job.latency;
+    for (r.reps = 0; r.reps < o->reps; ++r.reps) {
+        job.next = 0;
+        memset(&job.cost, 0, sizeof(job.cost));
+        guint64 t0 = hash_clock_ns();
+        for (guint t = 0; t < o->threads; ++t) threads[t] = g_thread_new(NULL, hash_worker, &job);
+        for (guint t = 0; t < o->threads; ++t) g_thread_join(threads[t]);
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+    }
+    r.items = (guint64)job.n;
+    r.bytes = job.cost.bytes;
+    if (job.failed > 0) {
+        printf("[WARN] %llu read(s) failed\n", (unsigned long long)job.failed);
+    }
+    int rc = emit_result(o, &r);
+    g_free(threads);
+    g_mutex_clear(&job.lock);
+    g_free(job.latency);
+    g_free(job.paths);
+    free_filepath_list(list);
+    return rc;
+}
+
+// --- Lookup ---
+// Loading the index, then point lookups against it: mostly misses, as on a real disk
+static int bench_lookup(const bench_opts *o) {
+    char *sigs_path = corpus_sigs_path(o->root);
+    struct stat st;
+    bench_result load = { .bench = "sig-load" };
+    sig_db db;
+    sig_load_report report;
+    int rc = -1;
+    for (load.reps = 0; load.reps < o->reps; ++load.reps) {
+        if (load.reps > 0) sigdb_free(&db);
+        guint64 t0 = hash_clock_ns();
+        if (sigdb_load_ex(&db, sigs_path, &report) != 0) {
+            fprintf(stderr, "Failed to load signatures: %s\n", sigs_path);
+            g_free(sigs_path);
+            return -1;
+        }
+        load.run_ns[load.reps] = hash_clock_ns() - t0;
+    }
+    load.items = report.lines;
+    load.bytes = stat(sigs_path, &st) == 0 ? (guint64)st.st_size : 0;
+    g_free(sigs_path);
+    if (emit_result(o, &load) != 0) goto done;
+
+    const sig_index *idx = &db.idx[HASH_SHA256];
+    size_t rec = hash_digest_len(HASH_SHA256) + 4;
+    unsigned char *queries = g_malloc(o->queries * 32);
+    guint64 s = 0x62656e6368ull, expected = 0;
+    for (guint64 q = 0; q < o->queries; ++q) {
+        unsigned char *d = queries + q * 32;
+        if (idx->count > 0 && q % BENCH_HIT_EVERY == 0) {
+            memcpy(d, idx->recs + (q / BENCH_HIT_EVERY % idx->count) * rec, 32);
+            expected++;
+            continue;
+        }
+        for (int k = 0; k < 32; k += 8) {
+            guint64 v = (s += 0x9E3779B97F4A7C15ull);
+            v = (v ^ (v >> 30)) * 0xBF58476D1CE4E5B9ull;
+            v = (v ^ (v >> 27)) * 0x94D049BB133111EBull;
+            v ^= v >> 31;
+            memcpy(d + k, &v, 8);
+        }
+    }
+    bench_result r = { .bench = "lookup" };
+    r.items = o->queries;
+    guint64 hits = 0;
+    for (r.reps = 0; r.reps < o->reps; ++r.reps) {
+        hits = 0;
+        guint64 t0 = hash_clock_ns();
+        for (guint64 q = 0; q < o->queries; ++q) {
+            if (sigdb_lookup(&db, HASH_SHA256, queries + q * 32)) hits++;
+        }
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+    }
+    g_free(queries);
+    // A random miss that hits is possible in theory; a known digest that misses is a bug
+    if (hits < expected) {
+        fprintf(stderr, "Lookup found %llu of %llu known digest(s)\n",
+                (unsigned long long)hits, (unsigned long long)expected);
+        goto done;
+    }
+    rc = emit_result(o, &r);
+done:
+    sigdb_free(&db);
+    return rc;
+}
+
+// --- Quarantine and full scans (the Windows scanner) ---
+#ifdef _WIN32
+// Every listed file's size: hardlinks count once per path, as a scan reports them
+static guint64 tree_bytes(const char *root) {
+    guint64 bytes = 0;
+    FilePathList *list = list_files_recursive(root);
+    if (!list) return 0;
+    for (GList *l = list->paths; l; l = l->next) {
+        struct stat st;
+        if (stat(l->data, &st) == 0) bytes += (guint64)st.st_size;
+    }
+    free_filepath_list(list);
+    return bytes;
+}
+
+/* The scanner keeps its state in the working directory: allowlist.db,
+ * seen_hashes.db, scan_rules.conf, the optional signature DBs, directory state and
+ * the Quarantine folder. These benches run it from an empty temporary directory
+ * instead, so what the caller's directory holds neither changes the numbers nor
+ * gets written to. */
+typedef struct {
+    char *saved;                // Working directory to return to
+    char *dir;
+    char *root;                 // The corpus root, absolute
+} bench_scratch;
+
+static void remove_tree(const char *dir) {
+    GDir *d = g_dir_open(dir, 0, NULL);
+    if (d) {
+        const char *name;
+        while ((name = g_dir_read_name(d))) {
+            char *path = g_build_filename(dir, name, NULL);
+            if (g_file_test(path, G_FILE_TEST_IS_DIR)) remove_tree(path);
+            else remove(path);
+            g_free(path);
+        }
+        g_dir_close(d);
+    }
+    _rmdir(dir);
+}
+
+static void scratch_leave(bench_scratch *s) {
+    if (s->saved) _chdir(s->saved);
+    if (s->dir) remove_tree(s->dir);
+    g_free(s->saved);
+    g_free(s->dir);
+    g_free(s->root);
+}
+
+static int scratch_enter(const bench_opts *o, bench_scratch *s) {
+    s->saved = g_get_current_dir();
+    s->root = g_path_is_absolute(o->root) ? g_strdup(o->root) : g_build_filename(s->saved, o->root, NULL);
+    s->dir = g_dir_make_tmp("fos-bench-XXXXXX", NULL);
+    if (!s->dir || _chdir(s->dir) != 0) {
+        fprintf(stderr, "Cannot set up a scratch working directory\n");
+        scratch_leave(s);
+        return -1;
+    }
+    return 0;
+}
+
+// Each run first writes the planted files back, so every run quarantines the same set
+static int bench_quarantine(const bench_opts *o) {
+    bench_scratch scratch;
+    if (scratch_enter(o, &scratch) != 0) return -1;
+    StageHist *latency = g_new0(StageHist, 1);
+    bench_result r = { .bench = "quarantine" };
+    r.latency = latency;
+    int rc = 0;
+    for (r.reps = 0; r.reps < o->reps && rc == 0; ++r.reps) {
+        GPtrArray *paths = g_ptr_array_new_with_free_func(g_free);
+        corpus_plant(&o->spec, scratch.root, paths);
+        r.items = r.bytes = 0;
+        guint64 t0 = hash_clock_ns();
+        for (guint i = 0; i < paths->len; ++i) {
+            const char *path = g_ptr_array_index(paths, i);
+            struct stat st;
+            guint64 size = stat(path, &st) == 0 ? (guint64)st.st_size : 0;
+            guint64 f0 = hash_clock_ns();
+            if (quarantine_file(path, CORPUS_PLANT_LABEL) != 0) rc = -1;
+            stage_hist_add(latency, hash_clock_ns() - f0);
+            r.items++;
+            r.bytes += size;
+        }
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+        g_ptr_array_free(paths, TRUE);
+    }
+    scratch_leave(&scratch);       // Results go where the caller said, relative to its directory
+    if (rc != 0) fprintf(stderr, "Failed to quarantine a planted file\n");
+    else rc = emit_result(o, &r);
+    g_free(latency);
+    return rc;
+}
+
+// End to end as the UI runs it. The signature index is loaded by the first run and
+// reused by the rest, as in the app; the median leaves that first run out.
+static int bench_scan(const bench_opts *o) {
+    bench_scratch scratch;
+    if (scratch_enter(o, &scratch) != 0) return -1;
+    char *sigs_path = corpus_sigs_path(scratch.root);
+    ScanStats *stats = g_new0(ScanStats, 1);
+    bench_result r = { .bench = "scan" };
+    r.stages = stats;
+    r.bytes = tree_bytes(scratch.root);
+    int rc = 0;
+    scan_stats_out = stats;
+    for (r.reps = 0; r.reps < o->reps && rc == 0; ++r.reps) {
+        corpus_plant(&o->spec, scratch.root, NULL);
+        g_mutex_lock(&global_scan_ctx.mutex);
+        global_scan_ctx.is_running = true;
+        global_scan_ctx.stop_requested = false;
+        global_scan_ctx.files_scanned = 0;
+        global_scan_ctx.threats_found = 0;
+        g_mutex_unlock(&global_scan_ctx.mutex);
+        guint64 t0 = hash_clock_ns();
+        if (signature_scan(sigs_path, scratch.root) != 0) rc = -1;
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+        g_mutex_lock(&global_scan_ctx.mutex);
+        r.items = (guint64)global_scan_ctx.files_scanned;
+        guint64 threats = (guint64)global_scan_ctx.threats_found;
+        g_mutex_unlock(&global_scan_ctx.mutex);
+        if (threats != o->spec.planted) {
+            fprintf(stderr, "Scan found %llu threat(s), %u planted\n", (unsigned long long)threats, o->spec.planted);
+            rc = -1;
+        }
+    }
+    scan_stats_out = NULL;
+    scratch_leave(&scratch);
+    if (rc == 0) rc = emit_result(o, &r);
+    g_free(stats);
+    g_free(sigs_path);
+    return rc;
+}
+#else
+static int bench_quarantine(const bench_opts *o) {
+    (void)o;
+    printf("[BENCH] quarantine needs the Windows scanner; skipped\n");
+    return 0;
+}
+
+static int bench_scan(const bench_opts *o) {
+    (void)o;
+    printf("[BENCH] scan needs the Windows scanner; skipped\n");
+    return 0;
+}
+#endif
+
+// --- Replay ---
+/* A scan recorded with scan_record=1 (scan_record.tsv) run again without its disk.
+ * From RAM, every file's recorded byte count is hashed out of one synthetic arena,
+ * so only the CPU side is timed: digests, then lookups when signatures are given.
+ * With a mirror (fos-bench mirror, on a tmpfs or RAM disk), the same files go
+ * through compute_file_hashes: the whole read pipeline, minus the storage.
+ * Either way only digests and the signature lookup are replayed: the scanner's
+ * other sinks (content patterns, heuristics, fuzzy digests, archive members) are
+ * not, so their recorded time is reported apart and compared with nothing. */
+typedef struct {
+    const ScanRecord *rec;
+    gint next;
+    const unsigned char *arena;
+    const char *mirror;
+    unsigned algos;
+    const sig_db *db;
+    GMutex lock;
+    HashCost cost;              // Merged from the workers under lock
+    StageHist *latency;
+    guint64 hits;
+    guint64 failed;
+} replay_job;
+
+static guint64 path_seed(const char *path) {
+    guint64 h = 0xcbf29ce484222325ull;     // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)path; *p; ++p) h = (h ^ *p) * 0x100000001b3ull;
+    return h;
+}
+
+// "C:\dir\file" -> <mirror>\C\dir\file, "/dir/file" -> <mirror>/dir/file
+static char *mirror_path(const char *mirror, const char *path) {
+    char *rel = g_strdup(path), *w = rel;
+    for (const char *p = path; *p; ++p) {
+        if (*p != ':') *w++ = *p;
+    }
+    *w = '\0';
+    const char *r = rel;
+    while (*r == '/' || *r == '\\') ++r;
+    char *out = g_build_filename(mirror, r, NULL);
+    g_free(rel);
+    return out;
+}
+
+static int replay_from_ram(const replay_job *job, const ScanRecordEntry *e, MultiDigest *d, HashCost *cost) {
+    MultiHash mh;
+    multi_hash_init(&mh, job->algos, cost);
+    gsize off = (gsize)(path_seed(e->path) % (REPLAY_ARENA - REPLAY_CHUNK)) & ~(gsize)63;
+    for (guint64 left = e->bytes; left > 0;) {
+        size_t n = (size_t)MIN(left, (guint64)REPLAY_CHUNK);
+        multi_hash_update(&mh, job->arena + off, n);
+        left -= n;
+        off += n;
+        if (off + REPLAY_CHUNK > REPLAY_ARENA) off = 0;
+    }
+    multi_hash_final(&mh, d);
+    return 0;
+}
+
+static gpointer replay_worker(gpointer data) {
+    replay_job *job = (replay_job *)data;
+    HashCost cost = { 0 };
+    StageHist *latency = g_new0(StageHist, 1);
+    guint64 hits = 0, failed = 0;
+    gint i;
+    while ((i = g_atomic_int_add(&job->next, 1)) < (gint)job->rec->n) {
+        const ScanRecordEntry *e = &job->rec->entries[i];
+        MultiDigest d;
+        guint64 t0 = hash_clock_ns();
+        int rc;
+        if (job->mirror) {
+            char *path = mirror_path(job->mirror, e->path);
+            rc = compute_file_hashes(path, job->algos, &d, NULL, 0, &cost);
+            g_free(path);
+        } else {
+            rc = replay_from_ram(job, e, &d, &cost);
+        }
+        if (rc != 0) failed++;
+        else if (job->db && sigdb_match(job->db, &d, NULL)) hits++;
+        stage_hist_add(latency, hash_clock_ns() - t0);
+    }
+    g_mutex_lock(&job->lock);
+    hash_cost_add(&job->cost, &cost);
+    stage_hist_merge(job->latency, latency);
+    job->hits += hits;
+    job->failed += failed;
+    g_mutex_unlock(&job->lock);
+    g_free(latency);
+    return NULL;
+}
+
+static int cmd_replay(int argc, char **argv) {
+    bench_opts o;
+    int rc = parse_opts(argc, argv, &o);
+    if (rc != 0) return rc;
+    ScanRecord rec;
+    if (scan_record_load(&rec, o.root) != 0) {
+        fprintf(stderr, "Not a scan record: %s\n", o.root);
+        return 2;
+    }
+    sig_db db;
+    gboolean have_db = FALSE;
+    if (o.sigs_path) {
+        if (sigdb_load(&db, o.sigs_path) != 0) {
+            fprintf(stderr, "Failed to load signatures: %s\n", o.sigs_path);
+            scan_record_free(&rec);
+            return 2;
+        }
+        have_db = TRUE;
+    }
+    replay_job job;
+    memset(&job, 0, sizeof(job));
+    job.rec = &rec;
+    job.mirror = o.mirror;
+    // The scan's own digests unless -a says otherwise
+    job.algos = o.algos ? o.algos : (rec.algos ? rec.algos : HASH_BIT(HASH_SHA256));
+    job.db = have_db ? &db : NULL;
+    job.latency = g_new0(StageHist, 1);
+    unsigned char *arena = NULL;
+    if (!o.mirror) {
+        arena = g_malloc(REPLAY_ARENA);
+        corpus_fill(path_seed(o.root), arena, REPLAY_ARENA);
+        job.arena = arena;
+    }
+    g_mutex_init(&job.lock);
+
+    bench_result r = { .bench = o.mirror ? "replay-mirror" : "replay-cpu" };
+    r.covers = o.sigs_path ? "digests+lookup" : "digests";
+    r.latency = job.latency;
+    guint64 recorded_bytes = 0;
+    for (gsize i = 0; i < rec.n; ++i) {
+        const ScanRecordEntry *e = &rec.entries[i];
+        r.recorded_io_ns += e->open_ns + e->read_ns;
+        r.recorded_cpu_ns += e->hash_ns;
+        r.recorded_sink_ns += e->sink_ns;
+        recorded_bytes += e->bytes;
+    }
+    const char *name = strrchr(o.root, '/');
+    const char *bs = strrchr(o.root, '\\');
+    if (bs > name) name = bs;
+    snprintf(o.corpus, sizeof(o.corpus), "record=%s files=%zu bytes=%llu algos=%u signatures=%s",
+             name ? name + 1 : o.root, (size_t)rec.n, (unsigned long long)recorded_bytes, job.algos,
+             o.sigs_path ? o.sigs_path : "none");
+    GThread **threads = g_new(GThread *, o.threads);
+    for (r.reps = 0; r.reps < o.reps; ++r.reps) {
+        job.next = 0;
+        job.hits = job.failed = 0;
+        memset(&job.cost, 0, sizeof(job.cost));
+        guint64 t0 = hash_clock_ns();
+        for (guint t = 0; t < o.threads; ++t) threads[t] = g_thread_new(NULL, replay_worker, &job);
+        for (guint t = 0; t < o.threads; ++t) g_thread_join(threads[t]);
+        r.run_ns[r.reps] = hash_clock_ns() - t0;
+    }
+    r.items = rec.n;
+    r.bytes = job.cost.bytes;
+    printf("[BENCH] Recorded scan: %zu file(s) read, %.1f MB, %.2f s opening and reading, %.2f s hashing, %.2f s in the engine sinks (summed over its workers)\n",
+           (size_t)rec.n, (double)recorded_bytes / (1024.0 * 1024.0), (double)r.recorded_io_ns / 1e9,
+           (double)r.recorded_cpu_ns / 1e9, (double)r.recorded_sink_ns / 1e9);
+    printf("[BENCH] Replayed: %s only; the engine sinks are not run, compare with the recorded hashing\n",
+           o.sigs_path ? "digests and signature lookup" : "digests");
+    if (job.failed > 0) {
+        printf("[WARN] %llu file(s) missing from the mirror\n", (unsigned long long)job.failed);
+    }
+    if (have_db) {
+        printf("[BENCH] %llu signature hit(s) per run\n", (unsigned long long)job.hits);
+    }
+    rc = emit_result(&o, &r) == 0 ? 0 : 1;
+    g_free(threads);
+    g_mutex_clear(&job.lock);
+    g_free(job.latency);
+    g_free(arena);
+    if (have_db) sigdb_free(&db);
+    scan_record_free(&rec);
+    return rc;
+}
+
+// Copies what the record read into `dir`; files that are gone or changed size are
+// synthesized at their recorded size instead
+static int cmd_mirror(const char *record_path, const char *dir) {
+    ScanRecord rec;
+    if (scan_record_load(&rec, record_path) != 0) {
+        fprintf(stderr, "Not a scan record: %s\n", record_path);
+        return 2;
+    }
+    unsigned char *buf = g_malloc(REPLAY_CHUNK);
+    guint64 copied = 0, synthesized = 0, bytes = 0, failed = 0;
+    guint64 t0 = hash_clock_ns();
+    for (gsize i = 0; i < rec.n; ++i) {
+        const ScanRecordEntry *e = &rec.entries[i];
+        char *dst = mirror_path(dir, e->path);
+        char *parent = g_path_get_dirname(dst);
+        g_mkdir_with_parents(parent, 0755);
+        g_free(parent);
+        FILE *out = fopen(dst, "wb");
+        g_free(dst);
+        if (!out) {
+            failed++;
+            continue;
+        }
+        struct stat st;
+        FILE *in = (stat(e->path, &st) == 0 && (guint64)st.st_size == e->size) ? fopen(e->path, "rb") : NULL;
+        guint64 left = e->size, s = path_seed(e->path);
+        while (left > 0) {
+            size_t n = (size_t)MIN(left, (guint64)REPLAY_CHUNK);
+            if (in) {
+                if (fread(buf, 1, n, in) != n) break;
+            } else {
+                corpus_fill(s++, buf, n);
+            }
+            if (fwrite(buf, 1, n, out) != n) break;
+            left -= n;
+        }
+        if (in) fclose(in);
+        if (fclose(out) != 0 || left > 0) failed++;
+        if (in) copied++;
+        else synthesized++;
+        bytes += e->size - left;
+    }
+    printf("[MIRROR] %llu file(s) copied, %llu synthesized (gone or resized since the scan), %.1f MB in %.2f s\n",
+           (unsigned long long)copied, (unsigned long long)synthesized, (double)bytes / (1024.0 * 1024.0),
+           (double)(hash_clock_ns() - t0) / 1e9);
+    if (failed > 0) {
+        fprintf(stderr, "Failed to write %llu file(s) under %s\n", (unsigned long long)failed, dir);
+    }
+    g_free(buf);
+    scan_record_free(&rec);
+    return failed ? 2 : 0;
+}
+
+// --- Corpus ---
+static int cmd_corpus(int argc, char **argv) {
+    CorpusSpec spec;
+    corpus_spec_defaults(&spec);
+    const char *root = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        if (i + 1 >= argc) return usage();
+        const char *opt = argv[i], *val = argv[++i];
+        if (strcmp(opt, "--seed") == 0) spec.seed = strtoull(val, NULL, 10);
+        else if (strcmp(opt, "--files") == 0) spec.files = (guint)strtoul(val, NULL, 10);
+        else if (strcmp(opt, "--depth") == 0) spec.depth = (guint)strtoul(val, NULL, 10);
+        else if (strcmp(opt, "--fanout") == 0) spec.fanout = (guint)strtoul(val, NULL, 10);
+        else if (strcmp(opt, "--hardlinks") == 0) spec.hardlinks = (guint)strtoul(val, NULL, 10);
+        else if (strcmp(opt, "--planted") == 0) spec.planted = (guint)strtoul(val, NULL, 10);
+        else if (strcmp(opt, "--decoys") == 0) spec.decoys = (guint)strtoul(val, NULL, 10);
+        else if (strcmp(opt, "--sizes") == 0) {
+            if (corpus_parse_sizes(&spec, val) != 0) {
+                fprintf(stderr, "Bad size classes: %s\n", val);
+                return 2;
+            }
+        } else return usage();
+    }
+    CorpusInfo info;
+    int rc = corpus_generate(&spec, root, &info);
+    if (rc == -2) {
+        fprintf(stderr, "Corpus root is not empty: %s\n", root);
+        return 2;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Failed to write corpus: %s\n", root);
+        return 2;
+    }
+    corpus_print_info(stdout, &info);
+    return 0;
+}
+
+// --- Comparing runs ---
+// Only what fos-bench itself writes is understood: flat keys, no nesting before them
+static gboolean json_field(const char *line, const char *key, char *out, size_t len) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char *p = strstr(line, pattern);
+    if (!p) return FALSE;
+    p += strlen(pattern);
+    size_t n = 0;
+    if (*p == '"') {
+        for (++p; *p && *p != '"' && n + 1 < len; ++p) {
+            if (*p == '\\' && p[1]) ++p;
+            out[n++] = *p;
+        }
+    } else {
+        while (*p && *p != ',' && *p != '}' && n + 1 < len) out[n++] = *p++;
+    }
+    out[n] = '\0';
+    return TRUE;
+}
+
+typedef struct {
+    char bench[32];
+    char label[128];
+    char corpus[512];
+    guint threads;
+    guint64 items;
+    guint64 median_ns;
+} run_summary;
+
+// The last result of each benchmark in the file
+static GHashTable *load_results(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    GHashTable *runs = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    char line[8192], value[64];
+    while (fgets(line, sizeof(line), f)) {
+        run_summary *r = g_new0(run_summary, 1);
+        if (!json_field(line, "bench", r->bench, sizeof(r->bench)) ||
+            !json_field(line, "median_ns", value, sizeof(value))) {
+            g_free(r);
+            continue;
+        }
+        r->median_ns = strtoull(value, NULL, 10);
+        json_field(line, "label", r->label, sizeof(r->label));
+        json_field(line, "corpus", r->corpus, sizeof(r->corpus));
+        if (json_field(line, "threads", value, sizeof(value))) r->threads = (guint)strtoul(value, NULL, 10);
+        if (json_field(line, "items", value, sizeof(value))) r->items = strtoull(value, NULL, 10);
+        g_hash_table_replace(runs, r->bench, r);
+    }
+    fclose(f);
+    return runs;
+}
+
+static int cmd_compare(const char *old_path, const char *new_path) {
+    static const char *order[] = { "walk", "hash", "sig-load", "lookup", "quarantine", "scan",
+                                   "replay-cpu", "replay-mirror", "fxparse", "content", "fuzzy", "zip", "rules" };
+    GHashTable *old_runs = load_results(old_path), *new_runs = load_results(new_path);
+    if (!old_runs || !new_runs) {
+        fprintf(stderr, "Failed to read results: %s, %s\n", old_path, new_path);
+        if (old_runs) g_hash_table_destroy(old_runs);
+        if (new_runs) g_hash_table_destroy(new_runs);
+        return 2;
+    }
+    printf("  %-13s %14s %14s %9s\n", "bench", "old ms", "new ms", "change");
+    for (size_t i = 0; i < G_N_ELEMENTS(order); ++i) {
+        const run_summary *a = g_hash_table_lookup(old_runs, order[i]);
+        const run_summary *b = g_hash_table_lookup(new_runs, order[i]);
+        if (!a || !b) continue;
+        double change = a->median_ns ? 100.0 * ((double)b->median_ns - (double)a->median_ns) / (double)a->median_ns : 0.0;
+        printf("  %-13s %14.3f %14.3f %+8.1f%%", order[i], (double)a->median_ns / 1e6,
+               (double)b->median_ns / 1e6, change);
+        if (strcmp(a->corpus, b->corpus) != 0 || a->threads != b->threads || a->items != b->items) {
+            printf("  (not comparable: different corpus, threads or item count)");
+        }
+        printf("\n");
+    }
+    g_hash_table_destroy(old_runs);
+    g_hash_table_destroy(new_runs);
+    return 0;
+}
+
+// --- Running ---
+static int cmd_run(int argc, char **argv) {
+    bench_opts o;
+    int rc = parse_opts(argc, argv, &o);
+    if (rc != 0) return rc;
+    if (!o.algos) o.algos = HASH_BIT(HASH_SHA256);
+    const char *which = argv[1];
+    // The engines run on any directory: a generated corpus has no executables to parse
+    gboolean engine = strcmp(which, "fxparse") == 0 || strcmp(which, "content") == 0 ||
+                       strcmp(which, "fuzzy") == 0 || strcmp(which, "zip") == 0 || strcmp(which, "rules") == 0;
+    if (corpus_spec_load(o.root, &o.spec) == 0) {
+        corpus_spec_format(&o.spec, o.corpus, sizeof(o.corpus));
+    } else if (engine) {
+        snprintf(o.corpus, sizeof(o.corpus), "dir=%s", o.root);
+    } else {
+        fprintf(stderr, "Not a generated corpus (no .corpus file next to it): %s\n", o.root);
+        return 2;
+    }
+
+    gboolean all = strcmp(which, "all") == 0;
+    if (all || strcmp(which, "walk") == 0) rc |= bench_walk(&o);
+    if (all || strcmp(which, "hash") == 0) rc |= bench_hash(&o);
+    if (all || strcmp(which, "lookup") == 0) rc |= bench_lookup(&o);
+    if (all || strcmp(which, "quarantine") == 0) rc |= bench_quarantine(&o);
+    if (all || strcmp(which, "scan") == 0) rc |= bench_scan(&o);
+    if (strcmp(which, "fxparse") == 0) rc |= bench_fxparse(&o);
+    if (strcmp(which, "content") == 0) rc |= bench_content(&o);
+    if (strcmp(which, "fuzzy") == 0) rc |= bench_fuzzy(&o);
+    if (strcmp(which, "zip") == 0) rc |= bench_zip(&o);
+    if (strcmp(which, "rules") == 0) rc |= bench_rules(&o);
+    return rc == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) return usage();
+    g_mutex_init(&global_scan_ctx.mutex);
+    scan_stats_calibrate();
+    static const char *benches[] = { "walk", "hash", "lookup", "quarantine", "scan", "all", "fxparse", "content", "fuzzy", "zip",
+                                     "rules" };
+    int status = -1;
+    if (strcmp(argv[1], "corpus") == 0) status = cmd_corpus(argc, argv);
+    else if (strcmp(argv[1], "compare") == 0) status = argc == 4 ? cmd_compare(argv[2], argv[3]) : usage();
+    else if (strcmp(argv[1], "mirror") == 0) status = argc == 4 ? cmd_mirror(argv[2], argv[3]) : usage();
+    else if (strcmp(argv[1], "replay") == 0) status = cmd_replay(argc, argv);
+    else if (strcmp(argv[1], "fuzz-fx") == 0) status = cmd_fuzz_fx(argc, argv);
+    else if (strcmp(argv[1], "hammer-sigstore") == 0) status = cmd_hammer_sigstore(argc, argv);
+    else if (strcmp(argv[1], "update-check") == 0) status = cmd_update_check(argc, argv);
+    else {
+        for (size_t i = 0; i < G_N_ELEMENTS(benches); ++i) {
+            if (strcmp(argv[1], benches[i]) == 0) status = cmd_run(argc, argv);
+        }
+        if (status == -1) status = usage();
+    }
+    g_mutex_clear(&global_scan_ctx.mutex);
+    return status;
+}
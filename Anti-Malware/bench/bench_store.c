@@ -0,0 +1,187 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scan_core.h"
+#include "sig_db.h"
+#include "sig_store.h"
+#include "bench.h"
+
+#define HAMMER_DIGESTS      20000
+#define HAMMER_READERS      8
+#define HAMMER_ABSENT_EVERY 16      // One lookup in this many asks for a digest no generation has
+#define HAMMER_LABEL        "Hammer.Gen"
+
+// --- Signature store under swaps ---
+/* Readers look digests up without pause while this thread publishes new
+ * generations one after the other. Every generation holds the same digests,
+ * labelled with the generation number it is published as, so a reader can tell
+ * a lookup answered from the wrong index, or from one already freed (with
+ * -fsanitize=address that stops the run at the read). Also checked: readers
+ * never see generations go backwards, and registration fails cleanly once
+ * every slot is taken. */
+typedef struct {
+    const unsigned char *digests;   // HAMMER_DIGESTS * 32
+    volatile gint stop;
+} hammer_shared;
+
+typedef struct {
+    hammer_shared *sh;
+    guint64 rng;
+    guint64 lookups, generations_seen;
+    guint64 missing, wrong_label, backwards, false_hits;
+} hammer_reader;
+
+static gpointer hammer_reader_thread(gpointer data) {
+    hammer_reader *hr = (hammer_reader *)data;
+    SigReader reader;
+    if (sigstore_reader_register(&reader) != 0) {
+        hr->missing++;
+        return NULL;
+    }
+    guint last = 0;
+    char expected[32];
+    unsigned char absent[32];
+    while (!g_atomic_int_get(&hr->sh->stop)) {
+        guint gen = 0;
+        const sig_db *db = sigstore_acquire_ex(&reader, &gen);
+        if (!db) {
+            sigstore_release(&reader);
+            continue;
+        }
+        if (gen < last) hr->backwards++;
+        if (gen != last) hr->generations_seen++;
+        last = gen;
+        snprintf(expected, sizeof(expected), HAMMER_LABEL "%u", gen);
+        guint64 r = corpus_next(&hr->rng);
+        const unsigned char *d = hr->sh->digests + (r % HAMMER_DIGESTS) * 32;
+        if ((r >> 32) % HAMMER_ABSENT_EVERY == 0) {
+            memcpy(absent, d, sizeof(absent));
+            absent[31] ^= 0x5a;
+            if (sigdb_lookup(db, HASH_SHA256, absent)) hr->false_hits++;
+        } else {
+            const char *label = sigdb_lookup(db, HASH_SHA256, d);
+            if (!label) hr->missing++;
+            else if (strcmp(label, expected) != 0) hr->wrong_label++;
+        }
+        sigstore_release(&reader);
+        hr->lookups++;
+    }
+    sigstore_reader_unregister(&reader);
+    return NULL;
+}
+
+// Every digest under one label, as the feed text the updater would stream in
+static int hammer_build(const unsigned char *digests, guint gen, sig_db *db) {
+    static const char hexdig[] = "0123456789abcdef";
+    GString *text = g_string_sized_new(HAMMER_DIGESTS * 90);
+    char line[128];
+    for (guint i = 0; i < HAMMER_DIGESTS; ++i) {
+        const unsigned char *d = digests + (gsize)i * 32;
+        for (int k = 0; k < 32; ++k) {
+            line[2 * k] = hexdig[d[k] >> 4];
+            line[2 * k + 1] = hexdig[d[k] & 15];
+        }
+        int n = snprintf(line + 64, sizeof(line) - 64, " " HAMMER_LABEL "%u\n", gen);
+        g_string_append_len(text, line, 64 + n);
+    }
+    sig_builder *b = sigdb_builder_new();
+    int rc = sigdb_builder_feed(b, text->str, text->len);
+    g_string_free(text, TRUE);
+    if (rc != 0) {
+        sigdb_builder_free(b);
+        return -1;
+    }
+    return sigdb_builder_finish(b, db, NULL);
+}
+
+// Every slot taken, one more refused, then all of them free again
+static int hammer_slots(void) {
+    SigReader *r = g_new(SigReader, SIGSTORE_MAX_READERS + 1);
+    int taken = 0;
+    while (taken <= SIGSTORE_MAX_READERS && sigstore_reader_register(&r[taken]) == 0) taken++;
+    int refused = taken == SIGSTORE_MAX_READERS && r[taken].slot == -1;
+    for (int i = 0; i < taken; ++i) sigstore_reader_unregister(&r[i]);
+    int again = sigstore_reader_register(&r[0]) == 0;
+    sigstore_reader_unregister(&r[0]);
+    g_free(r);
+    printf("[HAMMER] Slots: %d of %d registered, the next %s, free again %s\n", taken, SIGSTORE_MAX_READERS,
+           refused ? "refused" : "NOT refused", again ? "yes" : "NO");
+    return refused && again ? 0 : -1;
+}
+
+int cmd_hammer_sigstore(int argc, char **argv) {
+    guint64 swaps = strtoull(argv[2], NULL, 10), seed = 1;
+    guint readers = HAMMER_READERS;
+    for (int i = 3; i < argc; ++i) {
+        if (i + 1 >= argc) return usage();
+        const char *opt = argv[i], *val = argv[++i];
+        if (strcmp(opt, "-j") == 0) readers = (guint)strtoul(val, NULL, 10);
+        else if (strcmp(opt, "--seed") == 0) seed = strtoull(val, NULL, 10);
+        else return usage();
+    }
+    if (swaps == 0 || readers == 0 || readers >= SIGSTORE_MAX_READERS) return usage();
+    if (hammer_slots() != 0) return 1;
+
+    unsigned char *digests = g_malloc((gsize)HAMMER_DIGESTS * 32);
+    guint64 rng = seed;
+    for (guint i = 0; i < HAMMER_DIGESTS * 4; ++i) {
+        guint64 v = corpus_next(&rng);
+        memcpy(digests + (gsize)i * 8, &v, 8);
+    }
+    hammer_shared sh = { digests, 0 };
+    sig_db db;
+    if (hammer_build(digests, sigstore_generation() + 1, &db) != 0) {
+        g_free(digests);
+        return 1;
+    }
+    sigstore_publish(&db);
+
+    hammer_reader *hr = g_new0(hammer_reader, readers);
+    GThread **threads = g_new(GThread *, readers);
+    for (guint t = 0; t < readers; ++t) {
+        hr[t].sh = &sh;
+        hr[t].rng = seed * 1000003ull + t + 1;
+        threads[t] = g_thread_new(NULL, hammer_reader_thread, &hr[t]);
+    }
+    // Building is not timed: only the swap and the grace period behind it
+    guint64 publish_ns = 0, publish_max = 0, built = 0;
+    guint64 t0 = hash_clock_ns();
+    for (guint64 s = 0; s < swaps; ++s) {
+        if (hammer_build(digests, sigstore_generation() + 1, &db) != 0) break;
+        built++;
+        guint64 p0 = hash_clock_ns();
+        sigstore_publish(&db);
+        guint64 ns = hash_clock_ns() - p0;
+        publish_ns += ns;
+        publish_max = MAX(publish_max, ns);
+    }
+    g_atomic_int_set(&sh.stop, 1);
+    for (guint t = 0; t < readers; ++t) g_thread_join(threads[t]);
+    double secs = (double)(hash_clock_ns() - t0) / 1e9;
+
+    hammer_reader sum = { 0 };
+    for (guint t = 0; t < readers; ++t) {
+        sum.lookups += hr[t].lookups;
+        sum.generations_seen += hr[t].generations_seen;
+        sum.missing += hr[t].missing;
+        sum.wrong_label += hr[t].wrong_label;
+        sum.backwards += hr[t].backwards;
+        sum.false_hits += hr[t].false_hits;
+    }
+    printf("[HAMMER] %llu swap(s) under %u reader(s): %.0f lookups/s, %.1f generations seen per reader, "
+           "publish %.3f ms mean, %.3f ms max\n",
+           (unsigned long long)built, readers, secs > 0 ? (double)sum.lookups / secs : 0.0,
+           (double)sum.generations_seen / readers, built ? (double)publish_ns / 1e6 / (double)built : 0.0,
+           (double)publish_max / 1e6);
+    printf("[HAMMER] %llu missing, %llu from the wrong generation, %llu going backwards, %llu false hit(s)\n",
+           (unsigned long long)sum.missing, (unsigned long long)sum.wrong_label,
+           (unsigned long long)sum.backwards, (unsigned long long)sum.false_hits);
+    sigstore_shutdown();
+    g_free(threads);
+    g_free(hr);
+    g_free(digests);
+    guint64 failures = sum.missing + sum.wrong_label + sum.backwards + sum.false_hits;
+    return failures == 0 && built == swaps ? 0 : 1;
+}
@@ -0,0 +1,392 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scan_core.h"
+#include "sig_db.h"
+#include "corpus.h"
+#include "bench.h"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#include <direct.h>
+#include <time.h>
+#include "sig_store.h"
+#include "signature_scan.h"
+
+#define UPDATE_DB        "signatures.db"
+#define UPDATE_DIGESTS   64
+#define UPDATE_CASES     4
+#define UPDATE_MAX_FILES (UPDATE_CASES * 2)
+#define UPDATE_HOUR      (60 * 60)
+
+// --- Local update server ---
+/* A stand-in for the feed mirror on 127.0.0.1, on a port the OS picks: it serves
+ * in-memory bodies by path and 404 for anything else, and counts the requests
+ * per path so a case can tell which download the updater chose. Every case uses
+ * its own paths and the responses say no-store, so nothing comes from the URL
+ * cache of an earlier case or run. */
+typedef struct {
+    char path[64];
+    GString *body;              // NULL: answered 404, still counted
+    int hits;
+} served_file;
+
+typedef struct {
+    SOCKET listener;
+    int port;
+    volatile gint stop;
+    GMutex lock;
+    served_file files[UPDATE_MAX_FILES];
+    int n_files;
+    int misses;                 // Requests for a path no case registered
+} http_standin;
+
+static served_file *standin_find(http_standin *hs, const char *path) {
+    for (int i = 0; i < hs->n_files; ++i)
+        if (strcmp(hs->files[i].path, path) == 0) return &hs->files[i];
+    return NULL;
+}
+
+static void standin_reply(http_standin *hs, SOCKET s) {
+    char req[4096];
+    int len = 0, n;
+    while (len < (int)sizeof(req) - 1 && (n = recv(s, req + len, (int)sizeof(req) - 1 - len, 0)) > 0) {
+        len += n;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n")) break;
+    }
+    req[len] = '\0';
+    char path[64] = "";
+    if (strncmp(req, "GET ", 4) == 0) {
+        size_t plen = strcspn(req + 4, " ?\r\n");
+        if (plen < sizeof(path)) {
+            memcpy(path, req + 4, plen);
+            path[plen] = '\0';
+        }
+    }
+    g_mutex_lock(&hs->lock);
+    served_file *f = standin_find(hs, path);
+    GString *out = g_string_new(NULL);
+    if (f) f->hits++;
+    if (f && f->body) {
+        g_string_append_printf(out, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %lu\r\n"
+                               "Cache-Control: no-store\r\nConnection: close\r\n\r\n", (unsigned long)f->body->len);
+        g_string_append_len(out, f->body->str, f->body->len);
+    } else {
+        if (!f) hs->misses++;
+        g_string_append(out, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+                             "Cache-Control: no-store\r\nConnection: close\r\n\r\n");
+    }
+    g_mutex_unlock(&hs->lock);
+    for (gsize sent = 0; sent < out->len; ) {
+        n = send(s, out->str + sent, (int)(out->len - sent), 0);
+        if (n <= 0) break;
+        sent += (gsize)n;
+    }
+    g_string_free(out, TRUE);
+    shutdown(s, SD_SEND);
+    closesocket(s);
+}
+
+static gpointer standin_thread(gpointer data) {
+    http_standin *hs = (http_standin *)data;
+    for (;;) {
+        SOCKET s = accept(hs->listener, NULL, NULL);
+        if (g_atomic_int_get(&hs->stop)) {
+            if (s != INVALID_SOCKET) closesocket(s);
+            break;
+        }
+        if (s == INVALID_SOCKET) continue;
+        standin_reply(hs, s);
+    }
+    return NULL;
+}
+
+static int standin_start(http_standin *hs) {
+    memset(hs, 0, sizeof(*hs));
+    g_mutex_init(&hs->lock);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    int addr_len = (int)sizeof(addr);
+    hs->listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (hs->listener == INVALID_SOCKET) return -1;
+    if (bind(hs->listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(hs->listener, 8) != 0 ||
+        getsockname(hs->listener, (struct sockaddr *)&addr, &addr_len) != 0) {
+        closesocket(hs->listener);
+        return -1;
+    }
+    hs->port = ntohs(addr.sin_port);
+    return 0;
+}
+
+// Wakes the accept with a connection of its own, then waits for the thread
+static void standin_stop(http_standin *hs, GThread *thread) {
+    g_atomic_int_set(&hs->stop, 1);
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short)hs->port);
+    if (s != INVALID_SOCKET) {
+        connect(s, (struct sockaddr *)&addr, sizeof(addr));
+        closesocket(s);
+    }
+    g_thread_join(thread);
+    closesocket(hs->listener);
+    for (int i = 0; i < hs->n_files; ++i)
+        if (hs->files[i].body) g_string_free(hs->files[i].body, TRUE);
+    g_mutex_clear(&hs->lock);
+}
+
+// Takes the body (NULL = 404); `path` starts with '/'
+static void standin_serve(http_standin *hs, const char *path, GString *body) {
+    g_mutex_lock(&hs->lock);
+    served_file *f = &hs->files[hs->n_files++];
+    g_strlcpy(f->path, path, sizeof(f->path));
+    f->body = body;
+    f->hits = 0;
+    g_mutex_unlock(&hs->lock);
+}
+
+static int standin_hits(http_standin *hs, const char *path) {
+    g_mutex_lock(&hs->lock);
+    served_file *f = standin_find(hs, path);
+    int hits = f ? f->hits : 0;
+    g_mutex_unlock(&hs->lock);
+    return hits;
+}
+
+// --- Update cases ---
+typedef struct {
+    http_standin *hs;
+    const unsigned char *digests;   // UPDATE_DIGESTS * 32
+    guint64 run;                    // Start time: keeps the paths of one run apart from the last
+    int failures;
+} update_check;
+
+static void digest_hex(const unsigned char *d, char *hex) {
+    static const char hexdig[] = "0123456789abcdef";
+    for (int k = 0; k < 32; ++k) {
+        hex[2 * k] = hexdig[d[k] >> 4];
+        hex[2 * k + 1] = hexdig[d[k] & 15];
+    }
+    hex[64] = '\0';
+}
+
+// Feed lines for digests [first, last), prefixed with `op` ("" in a full feed)
+static GString *feed_lines(GString *text, const update_check *uc, int first, int last, const char *op,
+                           const char *label) {
+    char hex[65];
+    for (int i = first; i < last; ++i) {
+        digest_hex(uc->digests + (gsize)i * 32, hex);
+        g_string_append_printf(text, "%s%s%s%s\n", op, hex, label ? " " : "", label ? label : "");
+    }
+    return text;
+}
+
+static void write_version(guint64 version) {
+    FILE *f = fopen(UPDATE_DB ".ver", "w");
+    if (!f) return;
+    fprintf(f, "%llu\n", (unsigned long long)version);
+    fclose(f);
+}
+
+static guint64 read_version(void) {
+    unsigned long long v = 0;
+    FILE *f = fopen(UPDATE_DB ".ver", "r");
+    if (!f) return 0;
+    if (fscanf(f, "%llu", &v) != 1) v = 0;
+    fclose(f);
+    return (guint64)v;
+}
+
+// Whole file, NULL when missing; g_free it
+static char *slurp(const char *path, gsize *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    GString *s = g_string_new(NULL);
+    char buf[16384];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) g_string_append_len(s, buf, n);
+    fclose(f);
+    *len = s->len;
+    return g_string_free(s, FALSE);
+}
+
+static void check(update_check *uc, const char *name, int ok, const char *what) {
+    if (ok) return;
+    printf("[UPDATE-CHECK] %s: FAILED, %s\n", name, what);
+    uc->failures++;
+}
+
+// On disk and in the live index: digest `i` present or not, and under `label`
+static void check_digest(update_check *uc, const char *name, const sig_db *disk, int i, const char *label) {
+    const unsigned char *d = uc->digests + (gsize)i * 32;
+    char what[128];
+    const char *on_disk = sigdb_lookup(disk, HASH_SHA256, d);
+    snprintf(what, sizeof(what), "digest %d %s in the saved DB", i, label ? "missing or mislabelled" : "still");
+    check(uc, name, label ? (on_disk && strcmp(on_disk, label) == 0) : !on_disk, what);
+
+    SigReader reader;
+    if (sigstore_reader_register(&reader) != 0) {
+        check(uc, name, 0, "no reader slot");
+        return;
+    }
+    const sig_db *live = sigstore_acquire(&reader);
+    const char *in_memory = live ? sigdb_lookup(live, HASH_SHA256, d) : NULL;
+    snprintf(what, sizeof(what), "digest %d %s in the live index", i, label ? "missing or mislabelled" : "still");
+    check(uc, name, label ? (in_memory && strcmp(in_memory, label) == 0) : !in_memory, what);
+    sigstore_release(&reader);
+    sigstore_reader_unregister(&reader);
+}
+
+/* Runs one update against the stand-in. `delta`/`full` (NULL = 404) go to
+ * per-case paths; each must be requested once if expected and never otherwise,
+ * and the local DB must end up with the previous DB as <db>.old byte for byte, and the
+ * present/absent digests as listed (-1 ends each list). */
+typedef struct {
+    const char *name;
+    guint64 local_version;
+    GString *delta, *full;
+    gboolean expect_delta, expect_full;
+    guint64 expect_version;         // 0: at least the time the update started
+    int present[4];
+    const char *present_label;
+    int absent[4];
+} update_case;
+
+static void run_case(update_check *uc, const update_case *c, int index) {
+    char delta_path[64], full_path[64], url[128];
+    snprintf(delta_path, sizeof(delta_path), "/%llu/%d/delta", (unsigned long long)uc->run, index);
+    snprintf(full_path, sizeof(full_path), "/%llu/%d/full", (unsigned long long)uc->run, index);
+    snprintf(url, sizeof(url), "FOS_DELTA_URL=http://127.0.0.1:%d%s", uc->hs->port, delta_path);
+    _putenv(url);
+    snprintf(url, sizeof(url), "FOS_FULL_URL=http://127.0.0.1:%d%s", uc->hs->port, full_path);
+    _putenv(url);
+    standin_serve(uc->hs, delta_path, c->delta);
+    standin_serve(uc->hs, full_path, c->full);
+
+    // The live index is what a delta is merged into: start it from the DB on disk
+    write_version(c->local_version);
+    DeleteFileA(UPDATE_DB ".old");
+    gsize before_len = 0, old_len = 0;
+    char *before = slurp(UPDATE_DB, &before_len);
+    if (!before || sigstore_load(UPDATE_DB, NULL) != 0) {
+        check(uc, c->name, 0, "no local DB to start from");
+        g_free(before);
+        return;
+    }
+    guint64 started = (guint64)time(NULL);
+    guint64 t0 = hash_clock_ns();
+    int rc = update_signature_db(UPDATE_DB);
+    double ms = (double)(hash_clock_ns() - t0) / 1e6;
+    int failures = uc->failures;
+
+    check(uc, c->name, rc == 0, "update_signature_db did not return 0");
+    check(uc, c->name, standin_hits(uc->hs, delta_path) == (c->expect_delta ? 1 : 0),
+          c->expect_delta ? "the delta was not requested once" : "the delta was requested");
+    check(uc, c->name, standin_hits(uc->hs, full_path) == (c->expect_full ? 1 : 0),
+          c->expect_full ? "the full feed was not requested once" : "the full feed was requested");
+    char *old = slurp(UPDATE_DB ".old", &old_len);
+    check(uc, c->name, old && old_len == before_len && memcmp(old, before, before_len) == 0,
+          "<db>.old is not the previous DB");
+    guint64 version = read_version();
+    check(uc, c->name, c->expect_version ? version == c->expect_version : version >= started,
+          "<db>.ver not updated");
+    check(uc, c->name, GetFileAttributesA(UPDATE_DB ".tmp") == INVALID_FILE_ATTRIBUTES, "<db>.tmp left behind");
+
+    sig_db disk;
+    if (sigdb_load(&disk, UPDATE_DB) == 0) {
+        for (int i = 0; i < 4 && c->present[i] >= 0; ++i) check_digest(uc, c->name, &disk, c->present[i], c->present_label);
+        for (int i = 0; i < 4 && c->absent[i] >= 0; ++i) check_digest(uc, c->name, &disk, c->absent[i], NULL);
+        sigdb_free(&disk);
+    } else {
+        check(uc, c->name, 0, "the saved DB does not load");
+    }
+    if (uc->failures == failures) printf("[UPDATE-CHECK] %s: ok, %.1f ms\n", c->name, ms);
+    g_free(old);
+    g_free(before);
+}
+
+int cmd_update_check(int argc, char **argv) {
+    if (argc != 3) return usage();
+    CreateDirectoryA(argv[2], NULL);
+    if (_chdir(argv[2]) != 0) {
+        fprintf(stderr, "Cannot use %s as the scratch directory\n", argv[2]);
+        return 1;
+    }
+    const char *leftovers[] = { UPDATE_DB, UPDATE_DB ".old", UPDATE_DB ".ver", UPDATE_DB ".tmp", "signatures.delta" };
+    for (size_t i = 0; i < G_N_ELEMENTS(leftovers); ++i) DeleteFileA(leftovers[i]);
+
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 1;
+    http_standin hs;
+    if (standin_start(&hs) != 0) {
+        fprintf(stderr, "Cannot listen on 127.0.0.1\n");
+        WSACleanup();
+        return 1;
+    }
+    GThread *server = g_thread_new(NULL, standin_thread, &hs);
+
+    unsigned char digests[UPDATE_DIGESTS * 32];
+    corpus_fill(33, digests, sizeof(digests));
+    guint64 now = (guint64)time(NULL);
+    update_check uc = { &hs, digests, now, 0 };
+
+    // The DB the first case starts from: digests 0-31
+    GString *base = feed_lines(g_string_new(NULL), &uc, 0, 32, "", "Update.Base");
+    FILE *f = fopen(UPDATE_DB, "wb");
+    if (f) {
+        fwrite(base->str, 1, base->len, f);
+        fclose(f);
+    }
+    g_string_free(base, TRUE);
+
+    update_case cases[UPDATE_CASES];
+    memset(cases, 0, sizeof(cases));
+    // A recent DB takes the delta: one digest added, one removed, no full download
+    GString *delta = g_string_new(NULL);
+    g_string_append_printf(delta, "# from: %llu\n# to: %llu\n", (unsigned long long)(now - UPDATE_HOUR),
+                           (unsigned long long)(now - 60));
+    feed_lines(delta, &uc, 32, 33, "+", "Update.Delta");
+    feed_lines(delta, &uc, 0, 1, "-", NULL);
+    cases[0] = (update_case){ "delta", now - UPDATE_HOUR, delta, NULL, TRUE, FALSE, now - 60,
+                              { 32, -1 }, "Update.Delta", { 0, -1 } };
+    // A delta that starts after the local version leaves a gap: the full feed instead
+    GString *gap = g_string_new(NULL);
+    g_string_append_printf(gap, "# from: %llu\n# to: %llu\n", (unsigned long long)(now + UPDATE_HOUR),
+                           (unsigned long long)(now + 2 * UPDATE_HOUR));
+    feed_lines(gap, &uc, 1, 2, "-", NULL);
+    cases[1] = (update_case){ "gap", now - UPDATE_HOUR, gap,
+                              feed_lines(g_string_new(NULL), &uc, 40, 48, "", "Update.Full"), TRUE, TRUE, 0,
+                              { 40, 47, -1 }, "Update.Full", { 1, 32, -1 } };
+    // No delta on the server: the full feed
+    cases[2] = (update_case){ "no-delta", now - UPDATE_HOUR, NULL,
+                              feed_lines(g_string_new(NULL), &uc, 48, 56, "", "Update.Mirror"), TRUE, TRUE, 0,
+                              { 48, 55, -1 }, "Update.Mirror", { 40, -1 } };
+    // A DB older than a day may have missed entries: the delta is not even asked for
+    cases[3] = (update_case){ "stale", now - 2 * 24 * UPDATE_HOUR, g_string_new("# from: 1\n"),
+                              feed_lines(g_string_new(NULL), &uc, 56, 64, "", "Update.Stale"), FALSE, TRUE, 0,
+                              { 56, 63, -1 }, "Update.Stale", { 48, -1 } };
+    for (int i = 0; i < UPDATE_CASES; ++i) run_case(&uc, &cases[i], i + 1);
+
+    standin_stop(&hs, server);
+    WSACleanup();
+    sigstore_shutdown();
+    printf("[UPDATE-CHECK] %d failure(s), %d request(s) for paths not served\n", uc.failures, hs.misses);
+    return uc.failures == 0 ? 0 : 1;
+}
+#else
+int cmd_update_check(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    printf("[UPDATE-CHECK] needs the Windows updater; skipped\n");
+    return 0;
+}
+#endif
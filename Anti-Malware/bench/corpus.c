@@ -0,0 +1,346 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "corpus.h"
+#include "multi_hash.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define CORPUS_WRITE_BUFFER (64 * 1024)
+
+// Independent streams: what file i looks like does not depend on the files before it
+#define STREAM_FILE   0x66696c65ull
+#define STREAM_PLANT  0x706c6e74ull
+#define STREAM_LINK   0x6c696e6bull
+#define STREAM_DECOY  0x6465636full
+
+// --- Deterministic randomness ---
+// SplitMix64: one add and three multiply-xorshifts per 8 bytes, the same on every platform
+static guint64 mix_next(guint64 *s) {
+    guint64 z = (*s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static guint64 stream_seed(const CorpusSpec *spec, guint64 stream, guint64 i) {
+    guint64 s = spec->seed ^ (stream << 32) ^ (i * 0xD1B54A32D192ED03ull);
+    return mix_next(&s);
+}
+
+guint64 corpus_next(guint64 *state) {
+    return mix_next(state);
+}
+
+void corpus_fill(guint64 seed, unsigned char *buf, size_t len) {
+    guint64 s = seed;
+    size_t k = 0;
+    for (; k + 8 <= len; k += 8) {
+        guint64 v = mix_next(&s);
+        memcpy(buf + k, &v, 8);
+    }
+    if (k < len) {
+        guint64 v = mix_next(&s);
+        memcpy(buf + k, &v, len - k);
+    }
+}
+
+// --- Spec ---
+void corpus_spec_defaults(CorpusSpec *spec) {
+    memset(spec, 0, sizeof(*spec));
+    spec->seed = 1;
+    spec->files = 10000;
+    spec->depth = 3;
+    spec->fanout = 8;
+    spec->planted = 16;
+    spec->decoys = 100000;
+    corpus_parse_sizes(spec, "1k:40,16k:35,256k:20,4m:5");
+}
+
+int corpus_parse_sizes(CorpusSpec *spec, const char *text) {
+    guint n = 0;
+    const char *p = text;
+    while (*p) {
+        if (n == CORPUS_MAX_CLASSES) return -1;
+        char *end;
+        guint64 max = strtoull(p, &end, 10);
+        switch (*end) {
+            case 'k': case 'K': max <<= 10; ++end; break;
+            case 'm': case 'M': max <<= 20; ++end; break;
+            case 'g': case 'G': max <<= 30; ++end; break;
+        }
+        if (end == p || *end != ':') return -1;
+        p = end + 1;
+        unsigned long weight = strtoul(p, &end, 10);
+        if (end == p || weight == 0 || (*end && *end != ',')) return -1;
+        spec->class_max[n] = max;
+        spec->class_weight[n] = (guint)weight;
+        ++n;
+        p = *end ? end + 1 : end;
+    }
+    if (n == 0) return -1;
+    spec->n_classes = n;
+    return 0;
+}
+
+static int format_sizes(const CorpusSpec *spec, char *buf, size_t len) {
+    size_t used = 0;
+    for (guint c = 0; c < spec->n_classes && used < len; ++c) {
+        guint64 v = spec->class_max[c];
+        const char *unit = "";
+        if (v && v % (1ull << 30) == 0) { v >>= 30; unit = "g"; }
+        else if (v && v % (1ull << 20) == 0) { v >>= 20; unit = "m"; }
+        else if (v && v % (1ull << 10) == 0) { v >>= 10; unit = "k"; }
+        used += (size_t)snprintf(buf + used, len - used, "%s%llu%s:%u", c ? "," : "",
+                                 (unsigned long long)v, unit, spec->class_weight[c]);
+    }
+    return used < len ? 0 : -1;
+}
+
+void corpus_spec_format(const CorpusSpec *spec, char *buf, size_t len) {
+    char sizes[256];
+    format_sizes(spec, sizes, sizeof(sizes));
+    snprintf(buf, len, "seed=%llu files=%u depth=%u fanout=%u sizes=%s hardlinks=%u planted=%u decoys=%u",
+             (unsigned long long)spec->seed, spec->files, spec->depth, spec->fanout, sizes,
+             spec->hardlinks, spec->planted, spec->decoys);
+}
+
+static char *sidecar_path(const char *root, const char *ext) {
+    char *trimmed = g_strdup(root);
+    size_t n = strlen(trimmed);
+    while (n > 1 && (trimmed[n - 1] == '/' || trimmed[n - 1] == '\\')) trimmed[--n] = '\0';
+    char *path = g_strconcat(trimmed, ext, NULL);
+    g_free(trimmed);
+    return path;
+}
+
+char *corpus_sigs_path(const char *root) {
+    return sidecar_path(root, ".sigs");
+}
+
+static int save_spec(const CorpusSpec *spec, const char *root) {
+    char sizes[256];
+    format_sizes(spec, sizes, sizeof(sizes));
+    char *path = sidecar_path(root, ".corpus");
+    FILE *f = fopen(path, "w");
+    g_free(path);
+    if (!f) return -1;
+    fprintf(f, "seed=%llu\nfiles=%u\ndepth=%u\nfanout=%u\nsizes=%s\nhardlinks=%u\nplanted=%u\ndecoys=%u\n",
+            (unsigned long long)spec->seed, spec->files, spec->depth, spec->fanout, sizes,
+            spec->hardlinks, spec->planted, spec->decoys);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+int corpus_spec_load(const char *root, CorpusSpec *spec) {
+    char *path = sidecar_path(root, ".corpus");
+    FILE *f = fopen(path, "r");
+    g_free(path);
+    if (!f) return -1;
+    corpus_spec_defaults(spec);
+    int rc = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (strncmp(line, "seed=", 5) == 0) spec->seed = strtoull(line + 5, NULL, 10);
+        else if (strncmp(line, "files=", 6) == 0) spec->files = (guint)strtoul(line + 6, NULL, 10);
+        else if (strncmp(line, "depth=", 6) == 0) spec->depth = (guint)strtoul(line + 6, NULL, 10);
+        else if (strncmp(line, "fanout=", 7) == 0) spec->fanout = (guint)strtoul(line + 7, NULL, 10);
+        else if (strncmp(line, "sizes=", 6) == 0) rc |= corpus_parse_sizes(spec, line + 6);
+        else if (strncmp(line, "hardlinks=", 10) == 0) spec->hardlinks = (guint)strtoul(line + 10, NULL, 10);
+        else if (strncmp(line, "planted=", 8) == 0) spec->planted = (guint)strtoul(line + 8, NULL, 10);
+        else if (strncmp(line, "decoys=", 7) == 0) spec->decoys = (guint)strtoul(line + 7, NULL, 10);
+    }
+    fclose(f);
+    return rc;
+}
+
+// --- Layout ---
+// Relative paths of every directory, breadth first; "" is the root
+static GPtrArray *corpus_dirs(const CorpusSpec *spec) {
+    GPtrArray *dirs = g_ptr_array_new_with_free_func(g_free);
+    g_ptr_array_add(dirs, g_strdup(""));
+    guint level_start = 0;
+    for (guint d = 0; d < spec->depth; ++d) {
+        guint level_end = dirs->len;
+        for (guint i = level_start; i < level_end; ++i) {
+            for (guint c = 0; c < spec->fanout; ++c) {
+                if (dirs->len >= CORPUS_MAX_DIRS) return dirs;
+                char name[16];
+                snprintf(name, sizeof(name), "d%02u", c);
+                const char *parent = g_ptr_array_index(dirs, i);
+                g_ptr_array_add(dirs, *parent ? g_build_filename(parent, name, NULL) : g_strdup(name));
+            }
+        }
+        level_start = level_end;
+    }
+    return dirs;
+}
+
+// Where file i of a stream goes and how large it is; the rest of the stream is its content
+typedef struct {
+    char *path;
+    guint64 size;
+    guint64 rng;
+} corpus_file;
+
+static void place_file(const CorpusSpec *spec, const char *root, GPtrArray *dirs,
+                       guint64 stream, guint64 i, const char *name_fmt, corpus_file *f) {
+    f->rng = stream_seed(spec, stream, i);
+    const char *dir = g_ptr_array_index(dirs, mix_next(&f->rng) % dirs->len);
+    guint total = 0;
+    for (guint c = 0; c < spec->n_classes; ++c) total += spec->class_weight[c];
+    guint pick = (guint)(mix_next(&f->rng) % total), c = 0;
+    while (pick >= spec->class_weight[c]) pick -= spec->class_weight[c++];
+    guint64 max = spec->class_max[c], min = max / 2;
+    f->size = min + mix_next(&f->rng) % (max - min + 1);
+    char name[32];
+    snprintf(name, sizeof(name), name_fmt, (unsigned)i);
+    f->path = g_build_filename(root, dir, name, NULL);
+}
+
+// Writes the file's bytes; `digest` (may be NULL) receives their SHA-256
+static int write_file(corpus_file *f, unsigned char *buf, MultiDigest *digest) {
+    FILE *out = fopen(f->path, "wb");
+    if (!out) return -1;
+    MultiHash mh;
+    if (digest) multi_hash_init(&mh, HASH_BIT(HASH_SHA256), NULL);
+    guint64 left = f->size;
+    while (left > 0) {
+        size_t n = (size_t)MIN(left, (guint64)CORPUS_WRITE_BUFFER);
+        for (size_t k = 0; k < n; k += 8) {
+            guint64 v = mix_next(&f->rng);
+            memcpy(buf + k, &v, 8);
+        }
+        if (digest) multi_hash_update(&mh, buf, n);
+        if (fwrite(buf, 1, n, out) != n) break;
+        left -= n;
+    }
+    if (digest) multi_hash_final(&mh, digest);
+    int ok = left == 0 && !ferror(out);
+    if (fclose(out) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+static void write_sig(FILE *sigs, const unsigned char *digest, const char *label) {
+    static const char digits[] = "0123456789abcdef";
+    char hex[65];
+    for (int i = 0; i < 32; ++i) {
+        hex[2 * i] = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 15];
+    }
+    hex[64] = '\0';
+    fprintf(sigs, "%s %s\n", hex, label);
+}
+
+static int make_link(const char *target, const char *link_path) {
+#ifdef _WIN32
+    return CreateHardLinkA(link_path, target, NULL) ? 0 : -1;
+#else
+    return link(target, link_path);
+#endif
+}
+
+// --- Generation ---
+static int root_is_empty(const char *root) {
+    GDir *d = g_dir_open(root, 0, NULL);
+    if (!d) return 1;           // Missing: created below
+    int empty = g_dir_read_name(d) == NULL;
+    g_dir_close(d);
+    return empty;
+}
+
+int corpus_generate(const CorpusSpec *spec, const char *root, CorpusInfo *info) {
+    memset(info, 0, sizeof(*info));
+    guint64 t0 = hash_clock_ns();
+    if (spec->n_classes == 0) return -1;
+    if (!root_is_empty(root)) return -2;
+    GPtrArray *dirs = corpus_dirs(spec);
+    int rc = 0;
+    for (guint i = 0; i < dirs->len; ++i) {
+        char *path = g_build_filename(root, (const char *)g_ptr_array_index(dirs, i), NULL);
+        if (g_mkdir_with_parents(path, 0755) != 0) rc = -1;
+        g_free(path);
+    }
+    info->dirs = dirs->len;
+    char *sigs_path = corpus_sigs_path(root);
+    FILE *sigs = fopen(sigs_path, "w");
+    g_free(sigs_path);
+    unsigned char *buf = g_malloc(CORPUS_WRITE_BUFFER + 8);   // Filled 8 bytes at a time
+    if (!sigs) rc = -1;
+
+    for (guint i = 0; rc == 0 && i < spec->files; ++i) {
+        corpus_file f;
+        place_file(spec, root, dirs, STREAM_FILE, i, "f%07u.bin", &f);
+        if (write_file(&f, buf, NULL) != 0) rc = -1;
+        info->files++;
+        info->bytes += f.size;
+        g_free(f.path);
+    }
+    for (guint i = 0; rc == 0 && i < spec->planted; ++i) {
+        corpus_file f;
+        MultiDigest d;
+        place_file(spec, root, dirs, STREAM_PLANT, i, "p%05u.bin", &f);
+        if (write_file(&f, buf, &d) != 0) rc = -1;
+        else write_sig(sigs, d.digest[HASH_SHA256], CORPUS_PLANT_LABEL);
+        info->files++;
+        info->planted++;
+        info->bytes += f.size;
+        g_free(f.path);
+    }
+    // Links point at regular files only, so quarantining a planted file never breaks one
+    for (guint i = 0; rc == 0 && spec->files > 0 && i < spec->hardlinks; ++i) {
+        guint64 s = stream_seed(spec, STREAM_LINK, i);
+        corpus_file target, link;
+        place_file(spec, root, dirs, STREAM_FILE, mix_next(&s) % spec->files, "f%07u.bin", &target);
+        place_file(spec, root, dirs, STREAM_LINK, i, "l%06u.bin", &link);
+        if (make_link(target.path, link.path) == 0) info->hardlinks++;
+        else info->link_failures++;
+        g_free(target.path);
+        g_free(link.path);
+    }
+    guint64 s = stream_seed(spec, STREAM_DECOY, 0);
+    for (guint i = 0; rc == 0 && i < spec->decoys; ++i) {
+        unsigned char digest[32];
+        for (int k = 0; k < 32; k += 8) {
+            guint64 v = mix_next(&s);
+            memcpy(digest + k, &v, 8);
+        }
+        write_sig(sigs, digest, CORPUS_DECOY_LABEL);
+    }
+    if (sigs && fclose(sigs) != 0) rc = -1;
+    if (rc == 0) rc = save_spec(spec, root);
+    g_free(buf);
+    g_ptr_array_free(dirs, TRUE);
+    info->ns = hash_clock_ns() - t0;
+    return rc;
+}
+
+int corpus_plant(const CorpusSpec *spec, const char *root, GPtrArray *paths) {
+    GPtrArray *dirs = corpus_dirs(spec);
+    unsigned char *buf = g_malloc(CORPUS_WRITE_BUFFER + 8);   // Filled 8 bytes at a time
+    int written = 0;
+    for (guint i = 0; i < spec->planted; ++i) {
+        corpus_file f;
+        place_file(spec, root, dirs, STREAM_PLANT, i, "p%05u.bin", &f);
+        if (write_file(&f, buf, NULL) == 0) written++;
+        if (paths) g_ptr_array_add(paths, f.path);
+        else g_free(f.path);
+    }
+    g_free(buf);
+    g_ptr_array_free(dirs, TRUE);
+    return written;
+}
+
+void corpus_print_info(FILE *out, const CorpusInfo *info) {
+    fprintf(out, "[CORPUS] %llu file(s) (%llu planted) in %llu director(ies), %.1f MB, %llu hardlink(s)",
+            (unsigned long long)info->files, (unsigned long long)info->planted,
+            (unsigned long long)info->dirs, (double)info->bytes / (1024.0 * 1024.0),
+            (unsigned long long)info->hardlinks);
+    if (info->link_failures > 0) {
+        fprintf(out, ", %llu not supported here", (unsigned long long)info->link_failures);
+    }
+    fprintf(out, ", written in %.2f s\n", (double)info->ns / 1e9);
+}
@@ -0,0 +1,64 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+#include <glib.h>
+#include <stdio.h>
+/* Synthetic scan corpora for the benchmarks: the same spec and seed always
+ * produce the same tree, byte for byte, on any machine.
+ *
+ * Directories form a tree `depth` levels deep with `fanout` children each;
+ * every file lands in one of them at random (the root included). File sizes
+ * come from weighted classes, each file uniform in [max/2, max] of its class.
+ * Contents are pseudo-random, so nothing compresses or dedups. Planted files
+ * are written like the others, and their SHA-256 goes to <root>.sigs along with
+ * random decoy digests, so lookups run against an index of realistic size.
+ * The spec itself is saved as <root>.corpus, next to the tree rather than in it. */
+
+#define CORPUS_MAX_CLASSES  8
+#define CORPUS_MAX_DIRS     (1u << 20)
+#define CORPUS_PLANT_LABEL  "Bench.Planted"
+#define CORPUS_DECOY_LABEL  "Bench.Decoy"
+
+typedef struct {
+    guint64 seed;
+    guint files;
+    guint depth;
+    guint fanout;
+    guint n_classes;
+    guint64 class_max[CORPUS_MAX_CLASSES];     // Bytes
+    guint class_weight[CORPUS_MAX_CLASSES];
+    guint hardlinks;            // Extra paths to existing files
+    guint planted;              // Files whose digest is a signature
+    guint decoys;               // Signatures that match nothing
+} CorpusSpec;
+
+typedef struct {
+    guint64 files;              // Regular files written, planted ones included
+    guint64 dirs;
+    guint64 bytes;
+    guint64 hardlinks;
+    guint64 link_failures;      // Filesystems without hardlinks
+    guint64 planted;
+    guint64 ns;
+} CorpusInfo;
+
+// 10000 files, 3 levels of 8 directories, mostly small files, 16 planted
+void corpus_spec_defaults(CorpusSpec *spec);
+// "1k:40,16k:35,256k:20,4m:5": size class maxima (k, m, g suffixes) and weights
+int corpus_parse_sizes(CorpusSpec *spec, const char *text);
+// One line, the same keys as the .corpus file: what a result was measured on
+void corpus_spec_format(const CorpusSpec *spec, char *buf, size_t len);
+int corpus_spec_load(const char *root, CorpusSpec *spec);
+// The tree under `root` (missing or empty), <root>.sigs and <root>.corpus
+int corpus_generate(const CorpusSpec *spec, const char *root, CorpusInfo *info);
+// Rewrites only the planted files, after a quarantine removed them. Returns how many;
+// `paths` (may be NULL) receives each one's path, for the caller to free.
+int corpus_plant(const CorpusSpec *spec, const char *root, GPtrArray *paths);
+// The generator's pseudo-random bytes for `seed`, for other synthetic contents
+void corpus_fill(guint64 seed, unsigned char *buf, size_t len);
+// One step of the same generator, for other deterministic choices
+guint64 corpus_next(guint64 *state);
+// "<root>.sigs", g_free it
+char *corpus_sigs_path(const char *root);
+void corpus_print_info(FILE *out, const CorpusInfo *info);
+
+#endif
@@ -0,0 +1,64 @@
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scan_bridge.h"
+#include "manifest.h"
+
+// Definition of the global context (the walker in scan_core.c polls it)
+ScanContext global_scan_ctx;
+
+static int usage(void) {
+    fprintf(stderr, "Usage: fos-manifest write <manifest> <root>... [-j threads]\n"
+                    "       fos-manifest diff <old manifest> <new manifest> [report]\n");
+    return 2;
+}
+
+static int cmd_write(int argc, char **argv) {
+    const char *out_path = argv[2];
+    guint threads = 0;
+    GList *roots = NULL;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (guint)atoi(argv[++i]);
+        else roots = g_list_append(roots, argv[i]);
+    }
+    if (!roots) return usage();
+    ManifestStats st;
+    int rc = manifest_write(roots, out_path, threads, &st);
+    g_list_free(roots);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to write manifest: %s\n", out_path);
+        return 2;
+    }
+    manifest_print_stats(stdout, &st);
+    return 0;
+}
+
+// Exit status: 0 no differences, 1 differences, 2 trouble (like diff(1))
+static int cmd_diff(int argc, char **argv) {
+    FILE *report = stdout;
+    if (argc > 4 && !(report = fopen(argv[4], "w"))) {
+        fprintf(stderr, "Failed to open report: %s\n", argv[4]);
+        return 2;
+    }
+    ManifestDiffStats st;
+    int rc = manifest_diff(argv[2], argv[3], report, &st);
+    if (report != stdout) fclose(report);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to read manifests: %s, %s\n", argv[2], argv[3]);
+        return 2;
+    }
+    manifest_print_diff_stats(report == stdout ? stderr : stdout, &st);
+    return (st.added || st.removed || st.modified || st.touched) ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) return usage();
+    g_mutex_init(&global_scan_ctx.mutex);
+    int status;
+    if (strcmp(argv[1], "write") == 0) status = cmd_write(argc, argv);
+    else if (strcmp(argv[1], "diff") == 0) status = cmd_diff(argc, argv);
+    else status = usage();
+    g_mutex_clear(&global_scan_ctx.mutex);
+    return status;
+}
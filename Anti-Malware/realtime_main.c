@@ -0,0 +1,46 @@
+#include <glib.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "scan_bridge.h"
+#include "realtime_scan.h"
+
+// Definition of the global context (the walker in scan_core.c polls it)
+ScanContext global_scan_ctx;
+
+static void on_signal(int sig) {
+    if (sig == SIGHUP) realtime_scan_reload();
+    else realtime_scan_stop();
+}
+
+// Usage: fos-realtime [signatures.db] [mount] [workers]
+int main(int argc, char **argv) {
+    const char *db_path = (argc > 1) ? argv[1] : "signatures.db";
+
+    RealtimeConfig cfg;
+    realtime_config_defaults(&cfg);
+    if (argc > 2) cfg.mount_path = argv[2];
+    if (argc > 3) cfg.num_workers = (guint)atoi(argv[3]);
+
+    g_mutex_init(&global_scan_ctx.mutex);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGHUP, on_signal);      // Reload signatures without dropping protection
+
+    printf("Real-time protection active on %s (Ctrl+C to stop, SIGHUP to reload signatures)\n", cfg.mount_path);
+    fflush(stdout);
+
+    RealtimeStats stats;
+    int status = realtime_scan_run(db_path, &cfg, &stats);
+    if (status == -1) {
+        fprintf(stderr, "Failed to load signature database: %s\n", db_path);
+    } else if (status == -2) {
+        fprintf(stderr, "fanotify unavailable (requires root / CAP_SYS_ADMIN)\n");
+    } else {
+        if (status == -3) fprintf(stderr, "Unsupported fanotify event format; real-time protection stopped\n");
+        realtime_print_stats(stdout, &stats);
+    }
+
+    g_mutex_clear(&global_scan_ctx.mutex);
+    return status == 0 ? 0 : 1;
+}
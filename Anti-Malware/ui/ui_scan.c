@@ -77,22 +77,12 @@ gpointer scan_worker_thread(gpointer user_data) {
     g_mutex_unlock(&global_scan_ctx.mutex);
 
     if (strcmp(mode, "QUICK_SCAN") == 0) {
+        // One pass over all roots: %TEMP% inside %LOCALAPPDATA% and the like are read once
         GList *paths = get_quick_scan_paths();
-        GList *iter = paths;
-        while (iter != NULL) {
-            char *folder_path = (char *)iter->data;
-            g_mutex_lock(&global_scan_ctx.mutex);
-            if (global_scan_ctx.stop_requested) { 
-                g_mutex_unlock(&global_scan_ctx.mutex); 
-                break; 
-            }
-            g_mutex_unlock(&global_scan_ctx.mutex);
-            signature_scan(db_path, folder_path);
-            iter = iter->next;
-        }
+        signature_scan_paths(db_path, paths);
         g_list_free_full(paths, g_free);
     } else if (strcmp(mode, "FULL_SYSTEM") == 0) {
-        signature_scan(db_path, "C:\\Users"); 
+        signature_scan_ex(db_path, "C:\\Users", incremental_scan);
     } else {
         signature_scan(db_path, mode);
     }